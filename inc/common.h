@@ -24,17 +24,49 @@
  */
 #ifndef COMMON_H_
 #define COMMON_H_
+#include <stdbool.h>
 #include <stdio.h>
 #include <stdint.h>
 
-int g_verbose_flag;
-int g_debug_flag;
-const int kMaxStringLength;
-const int kMaxMessageLength;
-const int kMaxSeqName;
+extern int g_verbose_flag;
+extern int g_debug_flag;
+extern const int kMaxStringLength;
+extern const int kMaxMessageLength;
+extern const int kMaxSeqName;
+extern const uint64_t kFnv1aOffsetBasis;
 
-void de_verbose(char const *fmt, ...);
-void de_debug(char const *fmt, ...);
+// Logging levels. Calls above DE_LOG_LEVEL are compiled out entirely, calls at or
+// below it cost one predicted-not-taken branch on the flag when the flag is off,
+// and their arguments are only evaluated when the message is actually printed.
+#define DE_LOG_NONE 0
+#define DE_LOG_VERBOSE 1
+#define DE_LOG_DEBUG 2
+#ifndef DE_LOG_LEVEL
+#define DE_LOG_LEVEL DE_LOG_DEBUG
+#endif
+#if defined(__GNUC__)
+#define de_unlikely(x) __builtin_expect(!!(x), 0)
+#else
+#define de_unlikely(x) (x)
+#endif
+// true when de_verbose() / de_debug() messages would be printed. Use it to guard
+// logging-only work, e.g. walking a list just to print it.
+#define de_verboseEnabled() (DE_LOG_LEVEL >= DE_LOG_VERBOSE && de_unlikely(g_verbose_flag))
+#define de_debugEnabled() (DE_LOG_LEVEL >= DE_LOG_DEBUG && de_unlikely(g_debug_flag))
+// the if (0) arms keep the arguments type checked and "used" when compiled out.
+#if DE_LOG_LEVEL >= DE_LOG_VERBOSE
+#define de_verbose(...) do { if (de_unlikely(g_verbose_flag)) de_logVerbose(__VA_ARGS__); } while (0)
+#else
+#define de_verbose(...) do { if (0) de_logVerbose(__VA_ARGS__); } while (0)
+#endif
+#if DE_LOG_LEVEL >= DE_LOG_DEBUG
+#define de_debug(...) do { if (de_unlikely(g_debug_flag)) de_logDebug(__VA_ARGS__); } while (0)
+#else
+#define de_debug(...) do { if (0) de_logDebug(__VA_ARGS__); } while (0)
+#endif
+
+void de_logVerbose(char const *fmt, ...); // prefer de_verbose()
+void de_logDebug(char const *fmt, ...); // prefer de_debug()
 void* de_malloc(size_t n);
 int64_t de_getline(char **s, int64_t *n, FILE *f);
 FILE* de_fopen(const char *s, char const *mode);
@@ -47,5 +79,13 @@ int minint(int a, int b);
 char* de_strtok(char **s, char t);
 unsigned countChar(char *s, const char c);
 char** extractSubStrings(char *nameList, unsigned n, const char delineator);
+// 64 bit FNV-1a of n bytes, continuing from h, kFnv1aOffsetBasis to start. Unlike
+// stHash_stringKey() it is the same on every build, so it may be kept in files.
+uint64_t de_fnv1a(uint64_t h, const void *data, size_t n);
+// writing a file so that a reader never sees half of it: write to the FILE de_openAtomic()
+// returns, NULL if it can not, then de_closeAtomic() renames it over path if isWritten, else
+// removes it. de_closeAtomic() frees *tmpPath and returns true if path was replaced.
+FILE* de_openAtomic(const char *path, char **tmpPath);
+bool de_closeAtomic(FILE *fp, char *tmpPath, const char *path, bool isWritten);
 
 #endif // COMMON_H_
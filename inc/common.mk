@@ -9,7 +9,7 @@ ifeq (${SYS},FreeBSD)
 # cxx = gcc46 -std=c99 -Wno-unused-but-set-variable
 	cxx = gcc34 -std=c99 -Wno-unused-but-set-variable
 	cpp = g++
-	lm = -lm
+	lm = -lm -lpthread
 else ifeq (${SYS},Darwin) # This is to deal with the Mavericks replacing gcc with clang fully
   cxx = clang -std=c99 -stdlib=libstdc++
   cpp = clang++ -stdlib=libstdc++
@@ -17,7 +17,7 @@ else ifeq (${SYS},Darwin) # This is to deal with the Mavericks replacing gcc wit
 else
 	cxx = gcc -std=c99
 	cpp = g++
-	lm = -lm
+	lm = -lm -lpthread
 endif
 
 # subset of JPL suggested flags (removed: -Wtraditional -Wcast-qual -Wconversion)
@@ -35,10 +35,26 @@ cflags_ultraDbg = -Wall -Werror --pedantic -g -fno-inline -DBEN_DEBUG -BEN_ULTRA
 #Profile flags
 cflags_prof = -Wall -Werror --pedantic -pg -O3 -g
 
+#Build profile: debug (default) or release. Use `make release` from the top level
+#rather than setting this by hand, the profiles must not share object files.
+BUILD = debug
+march = native
+cflags_release = -march=${march} -flto
+ifeq (${BUILD},release)
+	cflags_build = ${cflags_opt} ${cflags_release}
+	libFlags = -O3 ${cflags_release}
+else
+	cflags_build = ${cflags_dbg}
+	libFlags = -O0 -g -fno-inline
+endif
+
 sonLibPath = ../../sonLib/lib
 
+#Highest de_verbose() / de_debug() level compiled in: 0 none, 1 verbose, 2 debug (see inc/common.h)
+logLevel = 2
+
 #Flags to use
-cflags = ${cflags_dbg} -I ${sonLibPath} -I ../inc -I ../external
+cflags = ${cflags_build} -DDE_LOG_LEVEL=${logLevel} -I ${sonLibPath} -I ../inc -I ../external
 testFlags = -O0 -g -Wall -Werror --pedantic -I ${sonLibPath} -I ../inc -I ../external
 #cflags = ${cflags_dbg}
 
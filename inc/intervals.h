@@ -0,0 +1,65 @@
+/*
+ * Copyright (C) 2012 by
+ * Dent Earl (dearl@soe.ucsc.edu, dentearl@gmail.com)
+ * ... and other members of the Reconstruction Team of David Haussler's
+ * lab (BME Dept. UCSC).
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef INTERVALS_H_
+#define INTERVALS_H_
+#include <stdbool.h>
+#include <stdint.h>
+
+/* The half open intervals [start, end) of one sequence, e.g. the lines of a
+ * bed file that name it, for answering "is this position covered?".
+ *
+ * Intervals are added in any order and intervals_finish() sorts them and
+ * merges the ones that overlap or touch, after which the intervals are two
+ * parallel arrays of disjoint, increasing starts and ends. Lookups never
+ * allocate: intervals_contains() is a binary search, and a cursor answers a
+ * run of positions that only increase (or only decrease) in amortized
+ * constant time, e.g. the positions of one sequence down a maf line.
+ * A finished intervals_t is only read by lookups, so it can be shared by
+ * threads, each with cursors of its own.
+ */
+typedef struct intervals {
+    uint64_t *starts;
+    uint64_t *ends;
+    uint64_t n;
+    uint64_t capacity;
+    bool isFinished;
+} intervals_t;
+typedef struct intervalsCursor {
+    const intervals_t *intervals;
+    uint64_t i; // the first interval ending after the last position looked up
+} intervalsCursor_t;
+
+intervals_t* intervals_new(void);
+void intervals_destroy(intervals_t *iv);
+void intervals_add(intervals_t *iv, uint64_t start, uint64_t end); // end is exclusive
+// sort and merge. false if any two of the intervals added overlapped, touching is fine.
+bool intervals_finish(intervals_t *iv);
+uint64_t intervals_getNumber(const intervals_t *iv); // after intervals_finish()
+uint64_t intervals_getTotalLength(const intervals_t *iv); // bases covered, after intervals_finish()
+bool intervals_contains(const intervals_t *iv, uint64_t pos); // iv may be NULL, for no intervals
+void intervals_initCursor(intervalsCursor_t *c, const intervals_t *iv); // iv may be NULL
+bool intervals_cursorContains(intervalsCursor_t *c, uint64_t pos);
+
+#endif // INTERVALS_H_
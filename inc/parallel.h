@@ -0,0 +1,62 @@
+/*
+ * Copyright (C) 2012 by
+ * Dent Earl (dearl@soe.ucsc.edu, dentearl@gmail.com)
+ * ... and other members of the Reconstruction Team of David Haussler's
+ * lab (BME Dept. UCSC).
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef PARALLEL_H_
+#define PARALLEL_H_
+#include <stdint.h>
+
+/* A small pthreads work queue for running independent pieces of work, e.g.
+ * the shards of a sharded maf, side by side.
+ *
+ * parallel_for() calls task(i, worker, data) exactly once for every i in
+ * [0, n), spread over at most numWorkers threads, and returns when all of
+ * the calls have. worker is in [0, numWorkers) and never changes for the
+ * life of a thread, so each worker can be given an accumulator of its own
+ * which the caller merges once parallel_for() has returned. Indices are
+ * handed out in increasing order. With a single worker everything runs in
+ * the calling thread.
+ */
+typedef void (*parallelTask_t)(uint64_t i, unsigned worker, void *data);
+
+/* A pool keeps its workers between runs, for work that comes in batches,
+ * e.g. the blocks of a maf as they are read. parallel_start() hands the
+ * indices of a run out as parallel_for() does but returns at once, so the
+ * calling thread can read the next batch while the workers test this one,
+ * and parallel_wait() returns when every call of the run has. One run at a
+ * time. A pool of a single worker starts no thread and parallel_start()
+ * runs everything in the calling thread before returning.
+ */
+typedef struct parallelPool parallelPool_t;
+
+unsigned parallel_numberOfProcessors(void);
+// the number of workers to use for n tasks when requested were asked for,
+// 0 meaning one per processor. Never more than n, never less than 1.
+unsigned parallel_numberOfWorkers(unsigned requested, uint64_t n);
+void parallel_for(uint64_t n, unsigned numWorkers, parallelTask_t task, void *data);
+parallelPool_t* parallel_startPool(unsigned numWorkers);
+void parallel_start(parallelPool_t *pool, uint64_t n, parallelTask_t task, void *data);
+void parallel_wait(parallelPool_t *pool);
+void parallel_finishPool(parallelPool_t *pool); // waits for the run, if any, and stops the workers
+
+#endif // PARALLEL_H_
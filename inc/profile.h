@@ -0,0 +1,88 @@
+/*
+ * Copyright (C) 2012 by
+ * Dent Earl (dearl@soe.ucsc.edu, dentearl@gmail.com)
+ * ... and other members of the Reconstruction Team of David Haussler's
+ * lab (BME Dept. UCSC).
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef PROFILE_H_
+#define PROFILE_H_
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Lightweight phase timing for the mafTools programs.
+ *
+ * Spans mark one-off phases of a program (counting pairs, sampling,
+ * reporting, ...) and are written out as "complete" events in the Chrome
+ * trace event format (load the file in chrome://tracing or Perfetto).
+ * Timers accumulate the total time spent in calls that happen far too often
+ * to record individually (e.g. maf_readBlock()) and are written out once, in
+ * the "otherData" section of the trace.
+ *
+ * Nothing is recorded unless profile_init() has been called, and when
+ * profiling is off every call below reduces to a test of g_profile_flag.
+ * Spans and timers may be recorded from any thread, each thread gets a row
+ * of its own in the trace.
+ */
+typedef struct profileSpan {
+    const char *name; // must be a string literal, or otherwise outlive the program
+    uint64_t start; // nanoseconds, monotonic clock. 0 when profiling is off.
+} profileSpan_t;
+typedef struct profileTimer {
+    const char *name;
+    uint64_t total; // nanoseconds
+    uint64_t calls;
+    bool isRegistered;
+    struct profileTimer *next;
+} profileTimer_t;
+
+extern int g_profile_flag;
+
+// declare a function local accumulating timer, e.g. PROFILE_TIMER(t, "maf_readBlock");
+#define PROFILE_TIMER(var, label) static profileTimer_t var = {label, 0, 0, false, NULL}
+
+void profile_init(const char *filename);
+void profile_finish(void);
+uint64_t profile_now(void);
+void profile_record(const char *name, uint64_t start, uint64_t stop);
+void profile_accumulate(profileTimer_t *timer, uint64_t start, uint64_t stop);
+
+static inline profileSpan_t profile_begin(const char *name) {
+    profileSpan_t span = {name, 0};
+    if (g_profile_flag) {
+        span.start = profile_now();
+    }
+    return span;
+}
+static inline void profile_end(profileSpan_t span) {
+    if (g_profile_flag && span.start != 0) {
+        profile_record(span.name, span.start, profile_now());
+    }
+}
+static inline uint64_t profile_timerStart(void) {
+    return g_profile_flag ? profile_now() : 0;
+}
+static inline void profile_timerStop(profileTimer_t *timer, uint64_t start) {
+    if (g_profile_flag && start != 0) {
+        profile_accumulate(timer, start, profile_now());
+    }
+}
+
+#endif // PROFILE_H_
@@ -26,13 +26,16 @@
 #define SHAREDMAF_H_
 #include <stdbool.h>
 #include <stdint.h>
+#include <stdio.h>
 
 typedef struct mafFileApi mafFileApi_t;
 typedef struct mafBlock mafBlock_t;
 typedef struct mafLine mafLine_t;
 
 // creators, destroyers
-mafFileApi_t* maf_newMfa(const char *filename, char const *mode);
+mafFileApi_t* maf_newMfa(const char *filename, char const *mode); // "-" is stdin / stdout
+mafFileApi_t* maf_newMfaFromFile(FILE *fp, const char *name); // fp is not closed by the mfa
+mafFileApi_t* maf_newMfaFromFd(int fd, const char *name, char const *mode); // fd is closed by the mfa
 mafBlock_t* maf_newMafBlock(void);
 mafBlock_t* maf_newMafBlockFromString(const char *s, uint64_t lineNumber);
 mafBlock_t* maf_newMafBlockListFromString(const char *s, uint64_t lineNumber);
@@ -86,6 +89,7 @@ char* maf_mafLine_getSequence(mafLine_t *ml);
 uint64_t maf_mafLine_getSequenceFieldLength(mafLine_t *ml);
 mafLine_t* maf_mafLine_getNext(mafLine_t *ml);
 // setters
+void maf_mafFileApi_setContinued(mafFileApi_t *mfa);
 void maf_mafBlock_setHeadLine(mafBlock_t *mb, mafLine_t *ml);
 void maf_mafBlock_setTailLine(mafBlock_t *mb, mafLine_t *ml);
 void maf_mafBlock_setNumberOfLines(mafBlock_t *mb, uint64_t n);
@@ -111,6 +115,11 @@ void maf_mafLine_setSourceLength(mafLine_t *ml, uint64_t n);
 void maf_mafLine_setSequence(mafLine_t *ml, char *s);
 void maf_mafLine_setNext(mafLine_t *ml, mafLine_t *next);
 // utilities
+bool maf_isStdStream(const char *filename);
+void maf_spoolStdin(void); // for programs that need to read "-" more than once
+bool maf_isShardSpec(const char *spec); // "@manifest" or a glob pattern, e.g. "aln.chr*.maf"
+char** maf_getShardList(const char *spec, unsigned *n); // a plain filename is a list of one
+void maf_destroyShardList(char **shards, unsigned n);
 unsigned maf_mafBlock_getNumberOfBlocks(mafBlock_t *b);
 bool maf_mafBlock_containsSequence(mafBlock_t *m);
 char* maf_mafLine_imputeLine(mafLine_t* ml);
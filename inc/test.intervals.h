@@ -0,0 +1,97 @@
+/*
+ * Copyright (C) 2012 by
+ * Dent Earl (dearl@soe.ucsc.edu, dentearl@gmail.com)
+ * ... and other members of the Reconstruction Team of David Haussler's
+ * lab (BME Dept. UCSC).
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef TEST_INTERVALS_H_
+#define TEST_INTERVALS_H_
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "CuTest.h"
+#include "common.h"
+#include "intervals.h"
+
+static bool intervals_naiveContains(uint64_t (*a)[2], unsigned n, uint64_t pos) {
+    for (unsigned i = 0; i < n; ++i) {
+        if (a[i][0] <= pos && pos < a[i][1]) {
+            return true;
+        }
+    }
+    return false;
+}
+static void test_intervals_finish(CuTest *testCase) {
+    // added out of order, overlapping and touching intervals come out sorted and merged
+    assert(testCase != NULL);
+    intervals_t *iv = intervals_new();
+    intervals_add(iv, 50, 60);
+    intervals_add(iv, 10, 20);
+    intervals_add(iv, 20, 25);
+    intervals_add(iv, 5, 5); // empty, dropped
+    CuAssertTrue(testCase, intervals_finish(iv));
+    CuAssertTrue(testCase, intervals_getNumber(iv) == 2);
+    CuAssertTrue(testCase, iv->starts[0] == 10 && iv->ends[0] == 25);
+    CuAssertTrue(testCase, iv->starts[1] == 50 && iv->ends[1] == 60);
+    CuAssertTrue(testCase, intervals_getTotalLength(iv) == 25);
+    intervals_add(iv, 55, 70);
+    CuAssertTrue(testCase, !intervals_finish(iv));
+    CuAssertTrue(testCase, intervals_getNumber(iv) == 2);
+    CuAssertTrue(testCase, iv->starts[1] == 50 && iv->ends[1] == 70);
+    intervals_destroy(iv);
+    CuAssertTrue(testCase, !intervals_contains(NULL, 0));
+}
+static void test_intervals_lookups(CuTest *testCase) {
+    // binary search and cursors, going up, down and jumping, agree with a scan of the intervals
+    assert(testCase != NULL);
+    uint64_t a[][2] = {{0, 3}, {7, 8}, {10, 20}, {21, 22}, {30, 31}, {33, 40}, {41, 42}, {44, 45},
+                       {47, 48}, {50, 51}, {53, 54}, {56, 57}, {60, 100}, {200, 201}};
+    unsigned n = sizeof(a) / sizeof(a[0]);
+    intervals_t *iv = intervals_new();
+    for (unsigned i = n; i > 0; --i) {
+        intervals_add(iv, a[i - 1][0], a[i - 1][1]);
+    }
+    CuAssertTrue(testCase, intervals_finish(iv));
+    intervalsCursor_t up, down, jumps;
+    intervals_initCursor(&up, iv);
+    intervals_initCursor(&down, iv);
+    intervals_initCursor(&jumps, iv);
+    for (uint64_t pos = 0; pos < 210; ++pos) {
+        bool expected = intervals_naiveContains(a, n, pos);
+        CuAssertTrue(testCase, intervals_contains(iv, pos) == expected);
+        CuAssertTrue(testCase, intervals_cursorContains(&up, pos) == expected);
+        CuAssertTrue(testCase, intervals_cursorContains(&down, 209 - pos) == intervals_naiveContains(a, n, 209 - pos));
+        uint64_t jump = (pos * 7919) % 210;
+        CuAssertTrue(testCase, intervals_cursorContains(&jumps, jump) == intervals_naiveContains(a, n, jump));
+    }
+    intervalsCursor_t none;
+    intervals_initCursor(&none, NULL);
+    CuAssertTrue(testCase, !intervals_cursorContains(&none, 1));
+    intervals_destroy(iv);
+}
+CuSuite* intervals_TestSuite(void) {
+    CuSuite* suite = CuSuiteNew();
+    SUITE_ADD_TEST(suite, test_intervals_finish);
+    SUITE_ADD_TEST(suite, test_intervals_lookups);
+    return suite;
+}
+
+#endif // TEST_INTERVALS_H_
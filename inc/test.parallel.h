@@ -0,0 +1,126 @@
+/*
+ * Copyright (C) 2012 by
+ * Dent Earl (dearl@soe.ucsc.edu, dentearl@gmail.com)
+ * ... and other members of the Reconstruction Team of David Haussler's
+ * lab (BME Dept. UCSC).
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef TEST_PARALLEL_H_
+#define TEST_PARALLEL_H_
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "CuTest.h"
+#include "common.h"
+#include "parallel.h"
+
+typedef struct parallelTestData {
+    unsigned numWorkers;
+    uint64_t *calls; // calls[i], the number of times task i was run
+    uint64_t *sums; // sums[w], the sum of the indices run by worker w
+    int badWorker;
+} parallelTestData_t;
+
+static void parallel_testTask(uint64_t i, unsigned worker, void *data) {
+    parallelTestData_t *d = (parallelTestData_t *) data;
+    if (worker >= d->numWorkers) {
+        d->badWorker = 1;
+        return;
+    }
+    ++(d->calls[i]); // each i is handed out once, so no two threads share calls[i]
+    d->sums[worker] += i;
+}
+static void test_parallel_for(CuTest *testCase) {
+    // every index runs exactly once and per worker accumulators add up
+    assert(testCase != NULL);
+    const uint64_t n = 1000;
+    unsigned workerCounts[] = {1, 2, 7};
+    for (unsigned k = 0; k < sizeof(workerCounts) / sizeof(workerCounts[0]); ++k) {
+        parallelTestData_t d;
+        d.numWorkers = workerCounts[k];
+        d.calls = (uint64_t *) calloc(n, sizeof(uint64_t));
+        d.sums = (uint64_t *) calloc(d.numWorkers, sizeof(uint64_t));
+        d.badWorker = 0;
+        parallel_for(n, d.numWorkers, parallel_testTask, &d);
+        CuAssertIntEquals(testCase, 0, d.badWorker);
+        uint64_t total = 0;
+        for (uint64_t i = 0; i < n; ++i) {
+            CuAssertTrue(testCase, d.calls[i] == 1);
+        }
+        for (unsigned w = 0; w < d.numWorkers; ++w) {
+            total += d.sums[w];
+        }
+        CuAssertTrue(testCase, total == n * (n - 1) / 2);
+        free(d.calls);
+        free(d.sums);
+    }
+    CuAssertTrue(testCase, parallel_numberOfWorkers(0, 1000) == parallel_numberOfProcessors());
+    CuAssertTrue(testCase, parallel_numberOfWorkers(8, 3) == 3);
+    CuAssertTrue(testCase, parallel_numberOfWorkers(8, 0) == 1);
+    CuAssertTrue(testCase, parallel_numberOfWorkers(2, 10) == 2);
+}
+static void test_parallel_pool(CuTest *testCase) {
+    // one pool serves several runs of varying size, including empty ones
+    assert(testCase != NULL);
+    const uint64_t n = 1000;
+    uint64_t runs[] = {n, 0, 1, 3, n, 17};
+    unsigned numRuns = sizeof(runs) / sizeof(runs[0]);
+    unsigned workerCounts[] = {1, 2, 7};
+    for (unsigned k = 0; k < sizeof(workerCounts) / sizeof(workerCounts[0]); ++k) {
+        parallelTestData_t d;
+        d.numWorkers = workerCounts[k];
+        d.calls = (uint64_t *) calloc(n, sizeof(uint64_t));
+        d.sums = (uint64_t *) calloc(d.numWorkers, sizeof(uint64_t));
+        d.badWorker = 0;
+        parallelPool_t *pool = parallel_startPool(d.numWorkers);
+        uint64_t expectedTotal = 0;
+        for (unsigned r = 0; r < numRuns; ++r) {
+            parallel_start(pool, runs[r], parallel_testTask, &d);
+            parallel_wait(pool);
+            expectedTotal += runs[r] * (runs[r] - (runs[r] > 0)) / 2;
+        }
+        parallel_start(pool, n, parallel_testTask, &d);
+        parallel_finishPool(pool); // waits for the last run
+        expectedTotal += n * (n - 1) / 2;
+        CuAssertIntEquals(testCase, 0, d.badWorker);
+        for (uint64_t i = 0; i < n; ++i) {
+            uint64_t expected = 0;
+            for (unsigned r = 0; r < numRuns; ++r) {
+                expected += (i < runs[r]);
+            }
+            CuAssertTrue(testCase, d.calls[i] == expected + 1);
+        }
+        uint64_t total = 0;
+        for (unsigned w = 0; w < d.numWorkers; ++w) {
+            total += d.sums[w];
+        }
+        CuAssertTrue(testCase, total == expectedTotal);
+        free(d.calls);
+        free(d.sums);
+    }
+}
+CuSuite* parallel_TestSuite(void) {
+    CuSuite* suite = CuSuiteNew();
+    SUITE_ADD_TEST(suite, test_parallel_for);
+    SUITE_ADD_TEST(suite, test_parallel_pool);
+    return suite;
+}
+
+#endif // TEST_PARALLEL_H_
@@ -0,0 +1,91 @@
+/* 
+ * Copyright (C) 2012 by 
+ * Dent Earl (dearl@soe.ucsc.edu, dentearl@gmail.com)
+ * ... and other members of the Reconstruction Team of David Haussler's 
+ * lab (BME Dept. UCSC).
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE. 
+ */
+#ifndef TEST_PROFILE_H_
+#define TEST_PROFILE_H_
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "CuTest.h"
+#include "common.h"
+#include "profile.h"
+
+static char* profile_test_slurp(const char *filename) {
+    FILE *fp = de_fopen(filename, "r");
+    fseek(fp, 0, SEEK_END);
+    long n = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    char *s = (char*) de_malloc(n + 1);
+    size_t r = fread(s, 1, n, fp);
+    s[r] = '\0';
+    fclose(fp);
+    return s;
+}
+static void test_profile_disabled(CuTest *testCase) {
+    // with profiling off spans and timers must not even read the clock
+    assert(testCase != NULL);
+    CuAssertIntEquals(testCase, 0, g_profile_flag);
+    profileSpan_t span = profile_begin("disabled");
+    CuAssertTrue(testCase, span.start == 0);
+    profile_end(span);
+    CuAssertTrue(testCase, profile_timerStart() == 0);
+    profile_finish(); // must be a no-op
+    CuAssertIntEquals(testCase, 0, g_profile_flag);
+}
+static void test_profile_trace(CuTest *testCase) {
+    assert(testCase != NULL);
+    const char *filename = "test.profile.json";
+    PROFILE_TIMER(timer, "profileTestTimer");
+    profile_init(filename);
+    CuAssertIntEquals(testCase, 1, g_profile_flag);
+    profileSpan_t outer = profile_begin("profileTestOuter");
+    CuAssertTrue(testCase, outer.start != 0);
+    for (int i = 0; i < 3; ++i) {
+        uint64_t start = profile_timerStart();
+        profile_timerStop(&timer, start);
+    }
+    profileSpan_t inner = profile_begin("profileTestInner");
+    profile_end(inner);
+    profile_end(outer);
+    CuAssertTrue(testCase, timer.calls == 3);
+    profile_finish();
+    CuAssertIntEquals(testCase, 0, g_profile_flag);
+    char *s = profile_test_slurp(filename);
+    CuAssertTrue(testCase, strstr(s, "\"traceEvents\"") != NULL);
+    CuAssertTrue(testCase, strstr(s, "\"name\": \"profileTestOuter\"") != NULL);
+    CuAssertTrue(testCase, strstr(s, "\"name\": \"profileTestInner\"") != NULL);
+    CuAssertTrue(testCase, strstr(s, "\"ph\": \"X\"") != NULL);
+    CuAssertTrue(testCase, strstr(s, "\"profileTestTimer\": {\"calls\": 3,") != NULL);
+    free(s);
+    remove(filename);
+}
+CuSuite* profile_TestSuite(void) {
+    CuSuite* suite = CuSuiteNew();
+    SUITE_ADD_TEST(suite, test_profile_disabled);
+    SUITE_ADD_TEST(suite, test_profile_trace);
+    return suite;
+}
+
+#endif // TEST_PROFILE_H_
@@ -26,6 +26,9 @@
 #include <stdio.h>
 #include "CuTest.h"
 #include "test.common.h"
+#include "test.intervals.h"
+#include "test.parallel.h"
+#include "test.profile.h"
 #include "test.sharedMaf.h"
 
 CuSuite* mafShared_TestSuite(void);
@@ -35,8 +38,14 @@ int include_RunAllTests(void) {
   CuSuite *suite = CuSuiteNew();
   CuSuite *common_s = common_TestSuite();
   CuSuite *maf_s = mafShared_TestSuite();
+  CuSuite *profile_s = profile_TestSuite();
+  CuSuite *parallel_s = parallel_TestSuite();
+  CuSuite *intervals_s = intervals_TestSuite();
   CuSuiteAddSuite(suite, common_s);
   CuSuiteAddSuite(suite, maf_s);
+  CuSuiteAddSuite(suite, profile_s);
+  CuSuiteAddSuite(suite, parallel_s);
+  CuSuiteAddSuite(suite, intervals_s);
   CuSuiteRun(suite);
   CuSuiteSummary(suite, output);
   CuSuiteDetails(suite, output);
@@ -45,6 +54,9 @@ int include_RunAllTests(void) {
   int status = (suite->failCount > 0);
   free(common_s);
   free(maf_s);
+  free(profile_s);
+  free(parallel_s);
+  free(intervals_s);
   CuSuiteDelete(suite);
   return status;
 }
@@ -0,0 +1,105 @@
+/*
+ * Copyright (C) 2012 by
+ * Dent Earl (dearl@soe.ucsc.edu, dentearl@gmail.com)
+ * ... and other members of the Reconstruction Team of David Haussler's
+ * lab (BME Dept. UCSC).
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/*
+ * Measures the per-column cost of the logging calls in a column walk shaped like
+ * getComparisonOrderFromRow() in mafTransitiveClosure, with debugging turned off:
+ *     function: the old out-of-line varargs call, which checks the flag inside
+ *     macro:    de_debug(), the flag is tested inline and the arguments skipped
+ *     none:     the walk with no logging at all
+ * Build and run with `make bench` from lib/.
+ */
+#define _POSIX_C_SOURCE 199309L // clock_gettime
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "common.h"
+
+#define LOG_FUNCTION(...) de_logDebug(__VA_ARGS__)
+#define LOG_MACRO(...) de_debug(__VA_ARGS__)
+#define LOG_NONE(...) do { } while (0)
+
+#define COLUMN_WALK(name, log)                                          \
+    static uint64_t name(const char *row, uint64_t n) {                 \
+        uint64_t regions = 0, end = 0;                                  \
+        bool inGap = false;                                             \
+        for (uint64_t i = 0; i < n; ++i) {                              \
+            log("position %" PRIu64 "\n", i);                           \
+            if (row[i] == '-') {                                        \
+                log("now inside a gap region\n");                       \
+                if (!inGap) {                                           \
+                    inGap = true;                                       \
+                    ++regions;                                          \
+                    log("creating newTodo at %" PRIu64 "\n", i);        \
+                } else {                                                \
+                    log("extending gap end to %" PRIu64 "\n", i);       \
+                }                                                       \
+            } else {                                                    \
+                log("now inside a sequence region\n");                  \
+                inGap = false;                                          \
+                log("moving ref with end to %" PRIu64 "\n", i);         \
+                end = i;                                                \
+            }                                                           \
+        }                                                               \
+        return regions + end;                                           \
+    }
+COLUMN_WALK(walkFunction, LOG_FUNCTION)
+COLUMN_WALK(walkMacro, LOG_MACRO)
+COLUMN_WALK(walkNone, LOG_NONE)
+
+static double seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+static void report(const char *name, uint64_t (*walk)(const char*, uint64_t),
+                   const char *row, uint64_t n, unsigned reps) {
+    uint64_t check = 0;
+    double t = seconds();
+    for (unsigned r = 0; r < reps; ++r) {
+        check += walk(row, n);
+    }
+    t = seconds() - t;
+    printf("%-10s %8.3f ns/column  (checksum %" PRIu64 ")\n", name, t * 1e9 / ((double) n * reps), check);
+}
+int main(int argc, char **argv) {
+    uint64_t n = 1 << 20;
+    unsigned reps = (argc > 1) ? (unsigned) strtoul(argv[1], NULL, 10) : 50;
+    char *row = de_malloc(n);
+    srand(1);
+    for (uint64_t i = 0; i < n; ++i) {
+        // runs of sequence broken by short gaps, roughly 20% gap columns
+        row[i] = ((i > 0) && (row[i - 1] == '-')) ? ((rand() % 2) ? '-' : 'A') : ((rand() % 8) ? 'A' : '-');
+    }
+    g_debug_flag = 0;
+    report("function", walkFunction, row, n, reps);
+    report("macro", walkMacro, row, n, reps);
+    report("none", walkNone, row, n, reps);
+    free(row);
+    return EXIT_SUCCESS;
+}
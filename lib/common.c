@@ -22,6 +22,7 @@
  * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
  * THE SOFTWARE. 
  */
+#define _POSIX_C_SOURCE 200809L // mkstemp(), fdopen(), fchmod()
 
 #include <assert.h>
 #include <inttypes.h>
@@ -32,6 +33,9 @@
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
 #include "CuTest.h"
 #include "common.h"
 
@@ -40,6 +44,7 @@ int g_debug_flag = 0;
 const int kMaxStringLength = 2048;
 const int kMaxMessageLength = 1024;
 const int kMaxSeqName = 1 << 9;
+const uint64_t kFnv1aOffsetBasis = 0xcbf29ce484222325ULL;
 
 void* de_malloc(size_t n) {
     void *i;
@@ -106,7 +111,7 @@ static void de_message(char const *type, char const *fmt, ...) {
     vfprintf(stderr, fmt, args);
     va_end(args);
 }
-void de_verbose(char const *fmt, ...) {
+void de_logVerbose(char const *fmt, ...) {
     if (!g_verbose_flag) {
         return;
     }
@@ -122,7 +127,7 @@ void de_verbose(char const *fmt, ...) {
     de_message("Verbose", str);
     va_end(args);
 }
-void de_debug(char const *fmt, ...) {
+void de_logDebug(char const *fmt, ...) {
     if (!g_debug_flag) {
         return;
     }
@@ -264,3 +269,38 @@ char** extractSubStrings(char *nameList, unsigned n, const char delineator) {
     copy = NULL;
     return mat;
 }
+uint64_t de_fnv1a(uint64_t h, const void *data, size_t n) {
+    const unsigned char *c = (const unsigned char *) data;
+    for (size_t i = 0; i < n; ++i) {
+        h ^= c[i];
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+FILE* de_openAtomic(const char *path, char **tmpPath) {
+    *tmpPath = de_malloc(strlen(path) + 8);
+    sprintf(*tmpPath, "%s.XXXXXX", path);
+    int fd = mkstemp(*tmpPath);
+    FILE *fp = (fd < 0) ? NULL : fdopen(fd, "w");
+    if (fp == NULL) {
+        if (fd >= 0) {
+            close(fd);
+            remove(*tmpPath);
+        }
+        free(*tmpPath);
+        *tmpPath = NULL;
+    }
+    return fp;
+}
+bool de_closeAtomic(FILE *fp, char *tmpPath, const char *path, bool isWritten) {
+    // mkstemp() makes the file owner only, it is given the mode fopen() would have
+    mode_t mask = umask(0);
+    umask(mask);
+    (void) fchmod(fileno(fp), 0666 & ~mask);
+    bool isReplaced = (fclose(fp) == 0) && isWritten && (rename(tmpPath, path) == 0);
+    if (!isReplaced) {
+        remove(tmpPath);
+    }
+    free(tmpPath);
+    return isReplaced;
+}
@@ -0,0 +1,172 @@
+/*
+ * Copyright (C) 2012 by
+ * Dent Earl (dearl@soe.ucsc.edu, dentearl@gmail.com)
+ * ... and other members of the Reconstruction Team of David Haussler's
+ * lab (BME Dept. UCSC).
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include "common.h"
+#include "intervals.h"
+
+// a cursor steps over this many intervals before it falls back to a binary search
+static const uint64_t kCursorSteps = 8;
+
+intervals_t* intervals_new(void) {
+    intervals_t *iv = (intervals_t *) de_malloc(sizeof(*iv));
+    iv->starts = NULL;
+    iv->ends = NULL;
+    iv->n = 0;
+    iv->capacity = 0;
+    iv->isFinished = true;
+    return iv;
+}
+void intervals_destroy(intervals_t *iv) {
+    if (iv == NULL) {
+        return;
+    }
+    free(iv->starts);
+    free(iv->ends);
+    free(iv);
+}
+void intervals_add(intervals_t *iv, uint64_t start, uint64_t end) {
+    if (start >= end) {
+        return;
+    }
+    if (iv->n == iv->capacity) {
+        iv->capacity = (iv->capacity == 0) ? 16 : 2 * iv->capacity;
+        iv->starts = (uint64_t *) realloc(iv->starts, sizeof(*(iv->starts)) * iv->capacity);
+        iv->ends = (uint64_t *) realloc(iv->ends, sizeof(*(iv->ends)) * iv->capacity);
+        if (iv->starts == NULL || iv->ends == NULL) {
+            fprintf(stderr, "Error, realloc failed.\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    iv->starts[iv->n] = start;
+    iv->ends[iv->n] = end;
+    ++(iv->n);
+    iv->isFinished = false;
+}
+typedef struct interval {
+    uint64_t start;
+    uint64_t end;
+} interval_t;
+static int cmpInterval(const void *a, const void *b) {
+    const interval_t *x = (const interval_t *) a;
+    const interval_t *y = (const interval_t *) b;
+    if (x->start != y->start) {
+        return (x->start < y->start) ? -1 : 1;
+    }
+    return (x->end < y->end) ? -1 : (x->end > y->end);
+}
+bool intervals_finish(intervals_t *iv) {
+    if (iv->isFinished) {
+        return true;
+    }
+    interval_t *a = (interval_t *) de_malloc(sizeof(*a) * iv->n);
+    for (uint64_t i = 0; i < iv->n; ++i) {
+        a[i].start = iv->starts[i];
+        a[i].end = iv->ends[i];
+    }
+    qsort(a, iv->n, sizeof(*a), cmpInterval);
+    bool isDisjoint = true;
+    uint64_t m = 0;
+    for (uint64_t i = 0; i < iv->n; ++i) {
+        if (m > 0 && a[i].start <= iv->ends[m - 1]) {
+            isDisjoint = isDisjoint && a[i].start == iv->ends[m - 1];
+            if (a[i].end > iv->ends[m - 1]) {
+                iv->ends[m - 1] = a[i].end;
+            }
+        } else {
+            iv->starts[m] = a[i].start;
+            iv->ends[m] = a[i].end;
+            ++m;
+        }
+    }
+    free(a);
+    iv->n = m;
+    iv->isFinished = true;
+    return isDisjoint;
+}
+uint64_t intervals_getNumber(const intervals_t *iv) {
+    assert(iv->isFinished);
+    return iv->n;
+}
+uint64_t intervals_getTotalLength(const intervals_t *iv) {
+    assert(iv->isFinished);
+    uint64_t length = 0;
+    for (uint64_t i = 0; i < iv->n; ++i) {
+        length += iv->ends[i] - iv->starts[i];
+    }
+    return length;
+}
+static uint64_t intervals_upperBound(const intervals_t *iv, uint64_t lo, uint64_t hi, uint64_t pos) {
+    // the first i in [lo, hi) with ends[i] > pos, hi if there is none
+    while (lo < hi) {
+        uint64_t mid = lo + (hi - lo) / 2;
+        if (iv->ends[mid] <= pos) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+bool intervals_contains(const intervals_t *iv, uint64_t pos) {
+    if (iv == NULL) {
+        return false;
+    }
+    assert(iv->isFinished);
+    uint64_t i = intervals_upperBound(iv, 0, iv->n, pos);
+    return i < iv->n && iv->starts[i] <= pos;
+}
+void intervals_initCursor(intervalsCursor_t *c, const intervals_t *iv) {
+    assert(iv == NULL || iv->isFinished);
+    c->intervals = iv;
+    c->i = 0;
+}
+bool intervals_cursorContains(intervalsCursor_t *c, uint64_t pos) {
+    const intervals_t *iv = c->intervals;
+    if (iv == NULL) {
+        return false;
+    }
+    uint64_t i = c->i;
+    uint64_t steps = 0;
+    // forwards past the intervals ending at or before pos
+    while (i < iv->n && iv->ends[i] <= pos && steps < kCursorSteps) {
+        ++i;
+        ++steps;
+    }
+    if (i < iv->n && iv->ends[i] <= pos) {
+        i = intervals_upperBound(iv, i, iv->n, pos);
+    }
+    // or backwards over the intervals that end after pos
+    while (i > 0 && iv->ends[i - 1] > pos && steps < kCursorSteps) {
+        --i;
+        ++steps;
+    }
+    if (i > 0 && iv->ends[i - 1] > pos) {
+        i = intervals_upperBound(iv, 0, i, pos);
+    }
+    c->i = i;
+    return i < iv->n && iv->starts[i] <= pos;
+}
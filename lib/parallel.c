@@ -0,0 +1,224 @@
+/*
+ * Copyright (C) 2012 by
+ * Dent Earl (dearl@soe.ucsc.edu, dentearl@gmail.com)
+ * ... and other members of the Reconstruction Team of David Haussler's
+ * lab (BME Dept. UCSC).
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#define _POSIX_C_SOURCE 200112L // sysconf()
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "common.h"
+#include "parallel.h"
+
+typedef struct parallelQueue {
+    pthread_mutex_t lock;
+    uint64_t next; // the next index to hand out
+    uint64_t n;
+    parallelTask_t task;
+    void *data;
+} parallelQueue_t;
+typedef struct parallelWorker {
+    parallelQueue_t *queue;
+    unsigned id;
+} parallelWorker_t;
+typedef struct parallelPoolWorker {
+    struct parallelPool *pool;
+    unsigned id;
+} parallelPoolWorker_t;
+struct parallelPool {
+    pthread_mutex_t lock;
+    pthread_cond_t isWork; // a run was started or the pool is finishing
+    pthread_cond_t isDone; // the last call of a run returned
+    uint64_t next; // the next index of the run to hand out
+    uint64_t n;
+    uint64_t numDone;
+    parallelTask_t task;
+    void *data;
+    int isFinishing;
+    unsigned numWorkers;
+    pthread_t *threads;
+    parallelPoolWorker_t *workers;
+};
+
+unsigned parallel_numberOfProcessors(void) {
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return (n < 1) ? 1 : (unsigned) n;
+}
+unsigned parallel_numberOfWorkers(unsigned requested, uint64_t n) {
+    unsigned workers = (requested == 0) ? parallel_numberOfProcessors() : requested;
+    if (workers > n) {
+        workers = (unsigned) n;
+    }
+    return (workers < 1) ? 1 : workers;
+}
+static void* parallel_work(void *arg) {
+    parallelWorker_t *worker = (parallelWorker_t *) arg;
+    parallelQueue_t *queue = worker->queue;
+    while (1) {
+        pthread_mutex_lock(&(queue->lock));
+        uint64_t i = queue->next;
+        if (i < queue->n) {
+            ++(queue->next);
+        }
+        pthread_mutex_unlock(&(queue->lock));
+        if (i >= queue->n) {
+            break;
+        }
+        queue->task(i, worker->id, queue->data);
+    }
+    return NULL;
+}
+static void* parallel_poolWork(void *arg) {
+    parallelPoolWorker_t *worker = (parallelPoolWorker_t *) arg;
+    parallelPool_t *pool = worker->pool;
+    pthread_mutex_lock(&(pool->lock));
+    while (1) {
+        while (pool->next >= pool->n && !pool->isFinishing) {
+            pthread_cond_wait(&(pool->isWork), &(pool->lock));
+        }
+        if (pool->next >= pool->n) {
+            break;
+        }
+        uint64_t i = (pool->next)++;
+        parallelTask_t task = pool->task;
+        void *data = pool->data;
+        pthread_mutex_unlock(&(pool->lock));
+        task(i, worker->id, data);
+        pthread_mutex_lock(&(pool->lock));
+        if (++(pool->numDone) == pool->n) {
+            pthread_cond_signal(&(pool->isDone));
+        }
+    }
+    pthread_mutex_unlock(&(pool->lock));
+    return NULL;
+}
+parallelPool_t* parallel_startPool(unsigned numWorkers) {
+    parallelPool_t *pool = (parallelPool_t *) de_malloc(sizeof(*pool));
+    pool->next = 0;
+    pool->n = 0;
+    pool->numDone = 0;
+    pool->task = NULL;
+    pool->data = NULL;
+    pool->isFinishing = 0;
+    pool->numWorkers = (numWorkers < 1) ? 1 : numWorkers;
+    pool->threads = NULL;
+    pool->workers = NULL;
+    if (pool->numWorkers == 1) {
+        return pool;
+    }
+    pthread_mutex_init(&(pool->lock), NULL);
+    pthread_cond_init(&(pool->isWork), NULL);
+    pthread_cond_init(&(pool->isDone), NULL);
+    pool->threads = (pthread_t *) de_malloc(sizeof(*(pool->threads)) * pool->numWorkers);
+    pool->workers = (parallelPoolWorker_t *) de_malloc(sizeof(*(pool->workers)) * pool->numWorkers);
+    for (unsigned w = 0; w < pool->numWorkers; ++w) {
+        pool->workers[w].pool = pool;
+        pool->workers[w].id = w;
+        if (pthread_create(&(pool->threads[w]), NULL, parallel_poolWork, &(pool->workers[w])) != 0) {
+            fprintf(stderr, "Error, unable to start worker thread %u of %u\n", w + 1, pool->numWorkers);
+            exit(EXIT_FAILURE);
+        }
+    }
+    return pool;
+}
+void parallel_start(parallelPool_t *pool, uint64_t n, parallelTask_t task, void *data) {
+    if (pool->numWorkers == 1) {
+        for (uint64_t i = 0; i < n; ++i) {
+            task(i, 0, data);
+        }
+        return;
+    }
+    pthread_mutex_lock(&(pool->lock));
+    if (pool->numDone != pool->n) {
+        fprintf(stderr, "Error, a run was started before the last one was waited for\n");
+        exit(EXIT_FAILURE);
+    }
+    pool->task = task;
+    pool->data = data;
+    pool->next = 0;
+    pool->numDone = 0;
+    pool->n = n;
+    pthread_cond_broadcast(&(pool->isWork));
+    pthread_mutex_unlock(&(pool->lock));
+}
+void parallel_wait(parallelPool_t *pool) {
+    if (pool->numWorkers == 1) {
+        return;
+    }
+    pthread_mutex_lock(&(pool->lock));
+    while (pool->numDone < pool->n) {
+        pthread_cond_wait(&(pool->isDone), &(pool->lock));
+    }
+    pthread_mutex_unlock(&(pool->lock));
+}
+void parallel_finishPool(parallelPool_t *pool) {
+    if (pool == NULL) {
+        return;
+    }
+    if (pool->numWorkers > 1) {
+        parallel_wait(pool);
+        pthread_mutex_lock(&(pool->lock));
+        pool->isFinishing = 1;
+        pthread_cond_broadcast(&(pool->isWork));
+        pthread_mutex_unlock(&(pool->lock));
+        for (unsigned w = 0; w < pool->numWorkers; ++w) {
+            pthread_join(pool->threads[w], NULL);
+        }
+        pthread_cond_destroy(&(pool->isDone));
+        pthread_cond_destroy(&(pool->isWork));
+        pthread_mutex_destroy(&(pool->lock));
+        free(pool->threads);
+        free(pool->workers);
+    }
+    free(pool);
+}
+void parallel_for(uint64_t n, unsigned numWorkers, parallelTask_t task, void *data) {
+    if (numWorkers <= 1 || n <= 1) {
+        for (uint64_t i = 0; i < n; ++i) {
+            task(i, 0, data);
+        }
+        return;
+    }
+    parallelQueue_t queue;
+    pthread_mutex_init(&(queue.lock), NULL);
+    queue.next = 0;
+    queue.n = n;
+    queue.task = task;
+    queue.data = data;
+    pthread_t *threads = (pthread_t *) de_malloc(sizeof(*threads) * numWorkers);
+    parallelWorker_t *workers = (parallelWorker_t *) de_malloc(sizeof(*workers) * numWorkers);
+    for (unsigned w = 0; w < numWorkers; ++w) {
+        workers[w].queue = &queue;
+        workers[w].id = w;
+        if (pthread_create(&threads[w], NULL, parallel_work, &workers[w]) != 0) {
+            fprintf(stderr, "Error, unable to start worker thread %u of %u\n", w + 1, numWorkers);
+            exit(EXIT_FAILURE);
+        }
+    }
+    for (unsigned w = 0; w < numWorkers; ++w) {
+        pthread_join(threads[w], NULL);
+    }
+    pthread_mutex_destroy(&(queue.lock));
+    free(threads);
+    free(workers);
+}
@@ -0,0 +1,153 @@
+/*
+ * Copyright (C) 2012 by
+ * Dent Earl (dearl@soe.ucsc.edu, dentearl@gmail.com)
+ * ... and other members of the Reconstruction Team of David Haussler's
+ * lab (BME Dept. UCSC).
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#define _POSIX_C_SOURCE 200112L // clock_gettime()
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h> // getpid
+#include "common.h"
+#include "profile.h"
+
+typedef struct profileEvent {
+    const char *name;
+    uint64_t start;
+    uint64_t duration;
+    unsigned tid; // 1 for the first thread to record anything, 2 for the next, ...
+} profileEvent_t;
+
+int g_profile_flag = 0;
+static char *g_profileFilename = NULL;
+static profileEvent_t *g_profileEvents = NULL;
+static uint64_t g_profileNumEvents = 0;
+static uint64_t g_profileMaxEvents = 0;
+static uint64_t g_profileOrigin = 0; // all timestamps are reported relative to this
+static profileTimer_t *g_profileTimers = NULL;
+static pthread_t *g_profileThreads = NULL; // g_profileThreads[tid - 1] is the thread with that tid
+static unsigned g_profileNumThreads = 0;
+static pthread_mutex_t g_profileLock = PTHREAD_MUTEX_INITIALIZER; // guards everything above
+
+uint64_t profile_now(void) {
+    // nanoseconds from a monotonic clock, never 0.
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000 + (uint64_t) ts.tv_nsec + 1;
+}
+void profile_init(const char *filename) {
+    // turn profiling on, results will be written to filename by profile_finish()
+    if (filename == NULL) {
+        return;
+    }
+    free(g_profileFilename);
+    g_profileFilename = de_strdup(filename);
+    g_profileOrigin = profile_now();
+    g_profile_flag = 1;
+}
+static unsigned profile_threadId(void) {
+    // call with g_profileLock held.
+    pthread_t self = pthread_self();
+    for (unsigned i = 0; i < g_profileNumThreads; ++i) {
+        if (pthread_equal(g_profileThreads[i], self)) {
+            return i + 1;
+        }
+    }
+    g_profileThreads = (pthread_t *) realloc(g_profileThreads, sizeof(*g_profileThreads) * (g_profileNumThreads + 1));
+    if (g_profileThreads == NULL) {
+        fprintf(stderr, "Error, unable to allocate memory for profile threads.\n");
+        exit(EXIT_FAILURE);
+    }
+    g_profileThreads[g_profileNumThreads++] = self;
+    return g_profileNumThreads;
+}
+void profile_record(const char *name, uint64_t start, uint64_t stop) {
+    pthread_mutex_lock(&g_profileLock);
+    if (g_profileNumEvents == g_profileMaxEvents) {
+        g_profileMaxEvents = (g_profileMaxEvents == 0) ? 64 : 2 * g_profileMaxEvents;
+        g_profileEvents = (profileEvent_t *) realloc(g_profileEvents,
+                                                     sizeof(*g_profileEvents) * g_profileMaxEvents);
+        if (g_profileEvents == NULL) {
+            fprintf(stderr, "Error, unable to allocate memory for profile events.\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    g_profileEvents[g_profileNumEvents].name = name;
+    g_profileEvents[g_profileNumEvents].start = start;
+    g_profileEvents[g_profileNumEvents].duration = stop - start;
+    g_profileEvents[g_profileNumEvents].tid = profile_threadId();
+    ++g_profileNumEvents;
+    pthread_mutex_unlock(&g_profileLock);
+}
+void profile_accumulate(profileTimer_t *timer, uint64_t start, uint64_t stop) {
+    pthread_mutex_lock(&g_profileLock);
+    if (!timer->isRegistered) {
+        timer->isRegistered = true;
+        timer->next = g_profileTimers;
+        g_profileTimers = timer;
+    }
+    timer->total += stop - start;
+    ++(timer->calls);
+    pthread_mutex_unlock(&g_profileLock);
+}
+static void profile_writeMicroseconds(FILE *fp, uint64_t ns) {
+    fprintf(fp, "%" PRIu64 ".%03" PRIu64, ns / 1000, ns % 1000);
+}
+void profile_finish(void) {
+    // write all recorded events out as a Chrome trace event format JSON file and
+    // turn profiling off.
+    if (!g_profile_flag) {
+        return;
+    }
+    FILE *fp = de_fopen(g_profileFilename, "w");
+    long pid = (long) getpid();
+    fprintf(fp, "{\"displayTimeUnit\": \"ms\",\n\"traceEvents\": [\n");
+    for (uint64_t i = 0; i < g_profileNumEvents; ++i) {
+        fprintf(fp, "{\"name\": \"%s\", \"cat\": \"mafTools\", \"ph\": \"X\", \"pid\": %ld, \"tid\": %u, \"ts\": ",
+                g_profileEvents[i].name, pid, g_profileEvents[i].tid);
+        profile_writeMicroseconds(fp, g_profileEvents[i].start - g_profileOrigin);
+        fprintf(fp, ", \"dur\": ");
+        profile_writeMicroseconds(fp, g_profileEvents[i].duration);
+        fprintf(fp, "}%s\n", (i + 1 < g_profileNumEvents) ? "," : "");
+    }
+    fprintf(fp, "],\n\"otherData\": {");
+    for (profileTimer_t *t = g_profileTimers; t != NULL; t = t->next) {
+        fprintf(fp, "\n\"%s\": {\"calls\": %" PRIu64 ", \"totalMicroseconds\": ", t->name, t->calls);
+        profile_writeMicroseconds(fp, t->total);
+        fprintf(fp, "}%s", (t->next != NULL) ? "," : "");
+    }
+    fprintf(fp, "}\n}\n");
+    fclose(fp);
+    free(g_profileEvents);
+    g_profileEvents = NULL;
+    g_profileNumEvents = 0;
+    g_profileMaxEvents = 0;
+    free(g_profileThreads);
+    g_profileThreads = NULL;
+    g_profileNumThreads = 0;
+    free(g_profileFilename);
+    g_profileFilename = NULL;
+    g_profile_flag = 0;
+}
@@ -22,8 +22,11 @@
  * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
  * THE SOFTWARE.
  */
+#define _POSIX_C_SOURCE 200809L // fdopen(), mkstemp()
 #include <assert.h>
 #include <ctype.h>
+#include <errno.h>
+#include <glob.h>
 #include <inttypes.h>
 #include <math.h>
 #include <stdbool.h>
@@ -31,8 +34,10 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 #include "common.h"
 #include "CuTest.h"
+#include "profile.h"
 #include "sharedMaf.h"
 
 struct mafFileApi {
@@ -41,10 +46,15 @@ struct mafFileApi {
   // functions
   uint64_t lineNumber; // last read line / wrote
   FILE *mfp; // maf file pointer
-  char *filename; // filename of the maf
+  bool ownsFile; // if false, mfp belongs to the caller (e.g. stdin) and is never closed here
+  char *filename; // filename of the maf, "-" for stdin / stdout
   char *lastLine; /* a temporary cache in case the header fails to have a blank
                    * line before the first alignment block.
                    */
+  char **shards; // when reading a shard spec, the files that make up the maf, else NULL
+  unsigned numShards;
+  unsigned shardIndex; // index of the shard currently open in mfp
+  bool isContinued; // if true there is no header, the first lines are read as body lines
 };
 struct mafLine {
   // a mafLine struct is a single line of a mafBlock
@@ -257,8 +267,10 @@ mafLine_t* maf_newMafLineFromString(const char *s, uint64_t lineNumber) {
     cline = NULL;
     return ml;
   }
+  // strtok_r, mafs may be parsed on several threads at once
   char *tkn = NULL;
-  tkn = strtok(cline, " \t");
+  char *save = NULL;
+  tkn = strtok_r(cline, " \t", &save);
   if (tkn == NULL) {
     free(cline);
     cline = NULL;
@@ -266,7 +278,7 @@ mafLine_t* maf_newMafLineFromString(const char *s, uint64_t lineNumber) {
     sprintf(error, "Unable to separate line on tabs and spaces at line definition field:\n%s", s);
     maf_failBadFormat(lineNumber, error);
   }
-  tkn = strtok(NULL, " \t"); // name field
+  tkn = strtok_r(NULL, " \t", &save); // name field
   if (tkn == NULL) {
     free(cline);
     cline = NULL;
@@ -275,21 +287,21 @@ mafLine_t* maf_newMafLineFromString(const char *s, uint64_t lineNumber) {
   char *species = (char *) de_malloc(strlen(tkn) + 1);
   strcpy(species, tkn);
   ml->species = species;
-  tkn = strtok(NULL, " \t"); // start position
+  tkn = strtok_r(NULL, " \t", &save); // start position
   if (tkn == NULL) {
     free(cline);
     cline = NULL;
     maf_failBadFormat(lineNumber, "Unable to separate line on tabs and spaces at start position field.");
   }
   ml->start = strtoul(tkn, NULL, 10);
-  tkn = strtok(NULL, " \t"); // length position
+  tkn = strtok_r(NULL, " \t", &save); // length position
   if (tkn == NULL){
     free(cline);
     cline = NULL;
     maf_failBadFormat(lineNumber, "Unable to separate line on tabs and spaces at length position field.");
   }
   ml->length = strtoul(tkn, NULL, 10);
-  tkn = strtok(NULL, " \t"); // strand
+  tkn = strtok_r(NULL, " \t", &save); // strand
   if (tkn == NULL) {
     free(cline);
     cline = NULL;
@@ -301,14 +313,14 @@ mafLine_t* maf_newMafLineFromString(const char *s, uint64_t lineNumber) {
     maf_failBadFormat(lineNumber, error);
   }
   ml->strand = tkn[0];
-  tkn = strtok(NULL, " \t"); // source length position
+  tkn = strtok_r(NULL, " \t", &save); // source length position
   if (tkn == NULL) {
     free(cline);
     cline = NULL;
     maf_failBadFormat(lineNumber, "Unable to separate line on tabs and spaces at source length field.");
   }
   ml->sourceLength = strtoul(tkn, NULL, 10);
-  tkn = strtok(NULL, " \t"); // sequence field
+  tkn = strtok_r(NULL, " \t", &save); // sequence field
   if (tkn == NULL) {
     free(cline);
     cline = NULL;
@@ -375,14 +387,238 @@ mafBlock_t* maf_copyMafBlock(mafBlock_t *orig) {
   mb->sequenceFieldLength = orig->sequenceFieldLength;
   return mb;
 }
-mafFileApi_t* maf_newMfa(const char *filename, char const *mode) {
+static char *g_stdinSpool = NULL; // path of the temporary copy of stdin, see maf_spoolStdin()
+
+static mafFileApi_t* maf_newMfaFromStream(FILE *fp, const char *name, bool ownsFile) {
   mafFileApi_t *mfa = (mafFileApi_t *) de_malloc(sizeof(*mfa));
   mfa->lineNumber = 0;
   mfa->lastLine = NULL;
-  mfa->mfp = de_fopen(filename, mode);
-  mfa->filename = de_strdup(filename);
+  mfa->mfp = fp;
+  mfa->ownsFile = ownsFile;
+  mfa->filename = de_strdup(name);
+  mfa->shards = NULL;
+  mfa->numShards = 0;
+  mfa->shardIndex = 0;
+  mfa->isContinued = false;
   return mfa;
 }
+mafFileApi_t* maf_newMfa(const char *filename, char const *mode) {
+  // open filename for reading or writing. The filename "-" is stdin when reading
+  // and stdout when writing. When reading, filename may also be a shard spec
+  // (see maf_isShardSpec()), in which case the shards are read back to back as
+  // one maf. Only the first shard's header is returned.
+  if (mode[0] == 'r' && maf_isShardSpec(filename)) {
+    unsigned n;
+    char **shards = maf_getShardList(filename, &n);
+    mafFileApi_t *mfa = maf_newMfaFromStream(de_fopen(shards[0], mode), shards[0], true);
+    mfa->shards = shards;
+    mfa->numShards = n;
+    return mfa;
+  }
+  if (maf_isStdStream(filename)) {
+    if (mode[0] == 'r') {
+      if (g_stdinSpool != NULL) {
+        return maf_newMfaFromStream(de_fopen(g_stdinSpool, mode), filename, true);
+      }
+      return maf_newMfaFromFile(stdin, filename);
+    }
+    return maf_newMfaFromFile(stdout, filename);
+  }
+  return maf_newMfaFromStream(de_fopen(filename, mode), filename, true);
+}
+mafFileApi_t* maf_newMfaFromFile(FILE *fp, const char *name) {
+  // wrap an already open stream, which need not be seekable. The stream is NOT
+  // closed by maf_destroyMfa() or maf_writeAll(). name is only used in messages.
+  assert(fp != NULL);
+  return maf_newMfaFromStream(fp, name, false);
+}
+mafFileApi_t* maf_newMfaFromFd(int fd, const char *name, char const *mode) {
+  // wrap an open file descriptor, which need not be seekable. The descriptor
+  // is owned by the mafFileApi_t from here on and closed by maf_destroyMfa().
+  FILE *fp = fdopen(fd, mode);
+  if (fp == NULL) {
+    fprintf(stderr, "Error, unable to open file descriptor %d for mode \"%s\"\n", fd, mode);
+    exit(EXIT_FAILURE);
+  }
+  return maf_newMfaFromStream(fp, name, true);
+}
+bool maf_isStdStream(const char *filename) {
+  return strcmp(filename, "-") == 0;
+}
+bool maf_isShardSpec(const char *spec) {
+  // a shard spec is either "@manifest", where manifest lists one maf per line,
+  // or a glob pattern, e.g. "alignment.chr*.maf". Anything that exists as a
+  // file is taken to be a plain maf.
+  if (maf_isStdStream(spec) || access(spec, F_OK) == 0) {
+    return false;
+  }
+  return spec[0] == '@' || strpbrk(spec, "*?[") != NULL;
+}
+static char* maf_resolveShardPath(const char *manifest, const char *path) {
+  // paths in a manifest are relative to the directory the manifest is in
+  const char *slash = strrchr(manifest, '/');
+  if (path[0] == '/' || slash == NULL) {
+    return de_strdup(path);
+  }
+  size_t n = slash - manifest + 1;
+  char *s = (char *) de_malloc(n + strlen(path) + 1);
+  memcpy(s, manifest, n);
+  strcpy(s + n, path);
+  return s;
+}
+static char** maf_readShardManifest(const char *manifest, unsigned *n) {
+  // one path per line, blank lines and lines starting with # are ignored
+  extern const int kMaxStringLength;
+  FILE *fp = de_fopen(manifest, "r");
+  int64_t len = kMaxStringLength;
+  char *line = (char *) de_malloc(len);
+  unsigned max = 16;
+  char **shards = (char **) de_malloc(sizeof(*shards) * max);
+  *n = 0;
+  int64_t status;
+  do {
+    status = de_getline(&line, &len, fp);
+    char *s = line;
+    while (isspace((unsigned char) *s)) {
+      ++s;
+    }
+    char *end = s + strlen(s);
+    while (end > s && isspace((unsigned char) *(end - 1))) {
+      *(--end) = '\0';
+    }
+    if (*s == '\0' || *s == '#') {
+      continue;
+    }
+    if (*n == max) {
+      max *= 2;
+      shards = (char **) realloc(shards, sizeof(*shards) * max);
+      assert(shards != NULL);
+    }
+    shards[(*n)++] = maf_resolveShardPath(manifest, s);
+  } while (status != -1);
+  free(line);
+  fclose(fp);
+  if (*n == 0) {
+    fprintf(stderr, "Error, shard manifest %s does not list any files.\n", manifest);
+    exit(EXIT_FAILURE);
+  }
+  return shards;
+}
+static char** maf_globShards(const char *pattern, unsigned *n) {
+  // glob() sorts its matches, so the shard order is the lexical order of the paths
+  glob_t g;
+  if (glob(pattern, 0, NULL, &g) != 0 || g.gl_pathc == 0) {
+    fprintf(stderr, "Error, no files match the shard pattern %s\n", pattern);
+    exit(EXIT_FAILURE);
+  }
+  *n = g.gl_pathc;
+  char **shards = (char **) de_malloc(sizeof(*shards) * (*n));
+  for (unsigned i = 0; i < *n; ++i) {
+    shards[i] = de_strdup(g.gl_pathv[i]);
+  }
+  globfree(&g);
+  return shards;
+}
+char** maf_getShardList(const char *spec, unsigned *n) {
+  // the files making up spec, in the order they are to be read. A spec that
+  // is not a shard spec is a list of one.
+  if (!maf_isShardSpec(spec)) {
+    char **shards = (char **) de_malloc(sizeof(*shards));
+    shards[0] = de_strdup(spec);
+    *n = 1;
+    return shards;
+  }
+  if (spec[0] == '@') {
+    return maf_readShardManifest(spec + 1, n);
+  }
+  return maf_globShards(spec, n);
+}
+void maf_destroyShardList(char **shards, unsigned n) {
+  if (shards == NULL) {
+    return;
+  }
+  for (unsigned i = 0; i < n; ++i) {
+    free(shards[i]);
+  }
+  free(shards);
+}
+static bool maf_openNextShard(mafFileApi_t *mfa) {
+  // move a sharded mfa on to its next file, line numbers restart with each file.
+  if (mfa->shardIndex + 1 >= mfa->numShards) {
+    return false;
+  }
+  fclose(mfa->mfp);
+  ++(mfa->shardIndex);
+  mfa->mfp = de_fopen(mfa->shards[mfa->shardIndex], "r");
+  free(mfa->filename);
+  mfa->filename = de_strdup(mfa->shards[mfa->shardIndex]);
+  mfa->lineNumber = 0;
+  free(mfa->lastLine);
+  mfa->lastLine = NULL;
+  return true;
+}
+static void maf_removeStdinSpool(void) {
+  if (g_stdinSpool != NULL) {
+    if (remove(g_stdinSpool) != 0) {
+      fprintf(stderr, "Warning, unable to remove the temporary copy of stdin %s: %s\n",
+              g_stdinSpool, strerror(errno));
+    }
+    free(g_stdinSpool);
+    g_stdinSpool = NULL;
+  }
+}
+void maf_spoolStdin(void) {
+  // Programs that read their input more than once call this before opening "-".
+  // stdin is copied to a temporary file, once, and every later
+  // maf_newMfa("-", "r") reads from the start of that copy. The copy is removed
+  // at exit.
+  if (g_stdinSpool != NULL) {
+    return;
+  }
+  const char *tmpDir = getenv("TMPDIR");
+  if (tmpDir == NULL || tmpDir[0] == '\0') {
+    tmpDir = "/tmp";
+  }
+  char *path = (char *) de_malloc(strlen(tmpDir) + strlen("/mafTools.stdin.XXXXXX") + 1);
+  sprintf(path, "%s/mafTools.stdin.XXXXXX", tmpDir);
+  int fd = mkstemp(path);
+  if (fd == -1) {
+    fprintf(stderr, "Error, unable to create a temporary file to hold stdin, %s: %s\n",
+            path, strerror(errno));
+    exit(EXIT_FAILURE);
+  }
+  FILE *fp = fdopen(fd, "w");
+  if (fp == NULL) {
+    fprintf(stderr, "Error, unable to open the temporary file %s to hold stdin: %s\n",
+            path, strerror(errno));
+    close(fd);
+    remove(path);
+    exit(EXIT_FAILURE);
+  }
+  char buffer[1 << 16];
+  size_t n;
+  while ((n = fread(buffer, 1, sizeof(buffer), stdin)) > 0) {
+    if (fwrite(buffer, 1, n, fp) != n) {
+      fprintf(stderr, "Error, failed writing stdin to temporary file %s: %s\n", path, strerror(errno));
+      fclose(fp);
+      remove(path);
+      exit(EXIT_FAILURE);
+    }
+  }
+  if (ferror(stdin)) {
+    fprintf(stderr, "Error, failed reading stdin: %s\n", strerror(errno));
+    fclose(fp);
+    remove(path);
+    exit(EXIT_FAILURE);
+  }
+  if (fclose(fp) != 0) {
+    fprintf(stderr, "Error, failed writing stdin to temporary file %s: %s\n", path, strerror(errno));
+    remove(path);
+    exit(EXIT_FAILURE);
+  }
+  g_stdinSpool = path;
+  atexit(maf_removeStdinSpool);
+}
 void maf_destroyMafLineList(mafLine_t *ml) {
   // walk down a mafLine_t following the ->next pointers, search and destroy
   if (ml == NULL) {
@@ -424,13 +660,19 @@ void maf_destroyMafBlockList(mafBlock_t *mb) {
 }
 void maf_destroyMfa(mafFileApi_t *mfa) {
   if (mfa->mfp != NULL) {
-    fclose(mfa->mfp);
+    if (mfa->ownsFile) {
+      fclose(mfa->mfp);
+    } else {
+      fflush(mfa->mfp);
+    }
     mfa->mfp = NULL;
   }
   free(mfa->lastLine);
   mfa->lastLine = NULL;
   free(mfa->filename);
   mfa->filename = NULL;
+  maf_destroyShardList(mfa->shards, mfa->numShards);
+  mfa->shards = NULL;
   free(mfa);
   mfa = NULL;
 }
@@ -440,6 +682,13 @@ char* maf_mafFileApi_getFilename(mafFileApi_t *mfa) {
 uint64_t maf_mafFileApi_getLineNumber(mafFileApi_t *mfa) {
   return mfa->lineNumber;
 }
+void maf_mafFileApi_setContinued(mafFileApi_t *mfa) {
+  // read the maf as though it followed another maf in the same file, i.e. its
+  // header lines are read as ordinary body lines. Must be called before the
+  // first read.
+  assert(mfa->lineNumber == 0);
+  mfa->isContinued = true;
+}
 mafLine_t* maf_mafBlock_getHeadLine(mafBlock_t *mb) {
   return mb->headLine;
 }
@@ -927,28 +1176,34 @@ mafBlock_t* maf_readBlockBody(mafFileApi_t *mfa) {
   line = NULL;
   return thisBlock;
 }
-mafBlock_t* maf_readBlock(mafFileApi_t *mfa) {
-  // either returns a pointer to the next mafBlock in the maf file,
-  // or a NULL pointer if the end of the file has been reached.
-  if (mfa->lineNumber == 0) {
+static mafBlock_t* maf_readBlock_(mafFileApi_t *mfa) {
+  mafBlock_t *mb = NULL;
+  if (mfa->lineNumber == 0 && !mfa->isContinued) {
     // header
-    mafBlock_t *header = maf_readBlockHeader(mfa);
-    if (header->headLine != NULL) {
-      return header;
-    } else {
-      maf_destroyMafBlockList(header);
-      return NULL;
-    }
+    mb = maf_readBlockHeader(mfa);
   } else {
     // body
-    mafBlock_t *mb = maf_readBlockBody(mfa);
-    if (mb->headLine != NULL) {
-      return mb;
-    } else {
-      maf_destroyMafBlockList(mb);
-      return NULL;
-    }
+    mb = maf_readBlockBody(mfa);
+  }
+  if (mb->headLine == NULL) {
+    maf_destroyMafBlockList(mb);
+    mb = NULL;
   }
+  return mb;
+}
+mafBlock_t* maf_readBlock(mafFileApi_t *mfa) {
+  // either returns a pointer to the next mafBlock in the maf file,
+  // or a NULL pointer if the end of the file has been reached.
+  PROFILE_TIMER(timer, "maf_readBlock");
+  uint64_t start = profile_timerStart();
+  mafBlock_t *mb = maf_readBlock_(mfa);
+  while (mb == NULL && mfa->shards != NULL && maf_openNextShard(mfa)) {
+    // every shard has a header of its own, only the first one is passed on
+    maf_destroyMafBlockList(maf_readBlockHeader(mfa));
+    mb = maf_readBlock_(mfa);
+  }
+  profile_timerStop(&timer, start);
+  return mb;
 }
 mafBlock_t* maf_readAll(mafFileApi_t *mfa) {
   // read an entire mfa, creating a linked list of mafBlock_t, returning the head.
@@ -969,10 +1224,16 @@ void maf_writeAll(mafFileApi_t *mfa, mafBlock_t *mb) {
   }
   fprintf(mfa->mfp, "\n");
   ++(mfa->lineNumber);
-  fclose(mfa->mfp);
+  if (mfa->ownsFile) {
+    fclose(mfa->mfp);
+  } else {
+    fflush(mfa->mfp);
+  }
   mfa->mfp = NULL;
 }
 void maf_writeBlock(mafFileApi_t *mfa, mafBlock_t *mb) {
+  PROFILE_TIMER(timer, "maf_writeBlock");
+  uint64_t start = profile_timerStart();
   mafLine_t *ml = mb->headLine;
   while (ml != NULL) {
     fprintf(mfa->mfp, "%s\n", ml->line);
@@ -981,6 +1242,7 @@ void maf_writeBlock(mafFileApi_t *mfa, mafBlock_t *mb) {
   }
   fprintf(mfa->mfp, "\n");
   ++(mfa->lineNumber);
+  profile_timerStop(&timer, start);
 }
 void maf_mafBlock_appendToAlignmentBlock(mafBlock_t *m, char *s) {
   mafLine_t *ml = maf_mafBlock_getHeadLine(m);
@@ -1008,7 +1270,7 @@ void maf_mafBlock_print(mafBlock_t *m) {
   mafLine_t* ml = maf_mafBlock_getHeadLine(m);
   char *line = NULL;
   uint64_t maxName = 1, maxStart = 1, maxLen = 1, maxSource = 1;
-  char fmtName[10] = "\0", fmtStart[32] = "\0", fmtLen[32] = "\0", fmtSource[32] = "\0", fmtLine[256] = "\0";
+  char fmtName[32] = "\0", fmtStart[32] = "\0", fmtLen[32] = "\0", fmtSource[32] = "\0", fmtLine[256] = "\0";
   while (ml != NULL) {
     line = maf_mafLine_getLine(ml);
     if (line == NULL) {
@@ -393,6 +393,139 @@ s rn3.chr4     81344243 40 + 187371129 -AA-GGGGATGCTAAGCCAATGAGTTGTTGTCTCTCAATGT
   maf_destroyMfa(mapi);
   free(input);
 }
+static void test_readFromPipe(CuTest *testCase) {
+  // a pipe is not seekable, verify header, blocks and line numbers come through intact
+  assert(testCase != NULL);
+  const char *input = "##maf version=1\n\
+a score=0\n\
+s hg18.chr7    27578828 5 + 158545518 AAA-GG\n\
+s panTro1.chr6 28741140 5 + 161576975 AAA-GG\n\
+\n\
+a score=1\n\
+s hg18.chr7    27578900 3 + 158545518 TAA\n\
+\n";
+  int fds[2];
+  CuAssertTrue(testCase, pipe(fds) == 0);
+  CuAssertTrue(testCase, write(fds[1], input, strlen(input)) == (ssize_t) strlen(input));
+  close(fds[1]);
+  mafFileApi_t *mapi = maf_newMfaFromFd(fds[0], "pipe", "r");
+  CuAssertStrEquals(testCase, "pipe", maf_mafFileApi_getFilename(mapi));
+  mafBlock_t *mb = maf_readBlock(mapi);
+  CuAssertTrue(testCase, mb != NULL);
+  CuAssertStrEquals(testCase, "##maf version=1", maf_mafLine_getLine(maf_mafBlock_getHeadLine(mb)));
+  maf_destroyMafBlockList(mb);
+  mb = maf_readBlock(mapi);
+  CuAssertTrue(testCase, mb != NULL);
+  CuAssertTrue(testCase, maf_mafBlock_getNumberOfSequences(mb) == 2);
+  CuAssertTrue(testCase, maf_mafLine_getLineNumber(maf_mafBlock_getHeadLine(mb)) == 2);
+  maf_destroyMafBlockList(mb);
+  mb = maf_readBlock(mapi);
+  CuAssertTrue(testCase, mb != NULL);
+  CuAssertTrue(testCase, maf_mafBlock_getNumberOfSequences(mb) == 1);
+  CuAssertTrue(testCase, maf_mafLine_getLineNumber(maf_mafBlock_getHeadLine(mb)) == 6);
+  CuAssertStrEquals(testCase, "TAA", maf_mafLine_getSequence(maf_mafLine_getNext(maf_mafBlock_getHeadLine(mb))));
+  maf_destroyMafBlockList(mb);
+  CuAssertTrue(testCase, maf_readBlock(mapi) == NULL);
+  maf_destroyMfa(mapi);
+}
+static void test_readFromFile(CuTest *testCase) {
+  // an mfa wrapped around a caller's FILE* must leave the FILE* open
+  assert(testCase != NULL);
+  createTmpFolder();
+  char *input = de_strdup("##maf version=1\n\
+\n\
+a score=0\n\
+s hg18.chr7    27578828 5 + 158545518 AAA-GG\n\
+\n");
+  writeStringToTmpFile(input);
+  FILE *fp = de_fopen("test_tmp/test.maf", "r");
+  mafFileApi_t *mapi = maf_newMfaFromFile(fp, "test_tmp/test.maf");
+  mafBlock_t *mb = maf_readAll(mapi);
+  CuAssertTrue(testCase, maf_mafBlock_getNumberOfBlocks(mb) == 2);
+  maf_destroyMafBlockList(mb);
+  maf_destroyMfa(mapi);
+  CuAssertTrue(testCase, fgetc(fp) == EOF);
+  CuAssertTrue(testCase, fclose(fp) == 0);
+  CuAssertTrue(testCase, maf_isStdStream("-"));
+  CuAssertTrue(testCase, !maf_isStdStream("test_tmp/test.maf"));
+  unlink("test_tmp/test.maf");
+  rmdir("test_tmp");
+  free(input);
+}
+static void writeStringToFile(const char *filename, const char *s) {
+  FILE *f = de_fopen(filename, "w");
+  fprintf(f, "%s", s);
+  fclose(f);
+}
+static void test_readShards(CuTest *testCase) {
+  // a manifest or a glob reads its shards back to back as one maf, with only
+  // the first shard's header, and a plain filename is a list of one.
+  assert(testCase != NULL);
+  createTmpFolder();
+  writeStringToFile("test_tmp/shard.0.maf", "##maf version=1\n\
+\n\
+a score=0\n\
+s hg18.chr7    27578828 5 + 158545518 AAA-GG\n\
+\n");
+  writeStringToFile("test_tmp/shard.1.maf", "##maf version=1\n\
+# shard 1\n\
+\n\
+a score=1\n\
+s hg18.chr7    27578900 3 + 158545518 TAA\n\
+\n\
+a score=2\n\
+s hg18.chr7    27579000 2 + 158545518 TA\n\
+\n");
+  writeStringToFile("test_tmp/shards.txt", "# comment\n\nshard.0.maf\n  shard.1.maf  \n");
+  const char *specs[] = {"@test_tmp/shards.txt", "test_tmp/shard.*.maf"};
+  for (unsigned s = 0; s < 2; ++s) {
+    CuAssertTrue(testCase, maf_isShardSpec(specs[s]));
+    unsigned n = 0;
+    char **shards = maf_getShardList(specs[s], &n);
+    CuAssertTrue(testCase, n == 2);
+    CuAssertStrEquals(testCase, "test_tmp/shard.0.maf", shards[0]);
+    CuAssertStrEquals(testCase, "test_tmp/shard.1.maf", shards[1]);
+    maf_destroyShardList(shards, n);
+    mafFileApi_t *mapi = maf_newMfa(specs[s], "r");
+    mafBlock_t *mb = maf_readAll(mapi);
+    CuAssertTrue(testCase, maf_mafBlock_getNumberOfBlocks(mb) == 4);
+    CuAssertStrEquals(testCase, "##maf version=1", maf_mafLine_getLine(maf_mafBlock_getHeadLine(mb)));
+    CuAssertTrue(testCase, maf_mafLine_getNext(maf_mafBlock_getHeadLine(mb)) == NULL);
+    mafBlock_t *b = maf_mafBlock_getNext(mb);
+    CuAssertStrEquals(testCase, "a score=0", maf_mafLine_getLine(maf_mafBlock_getHeadLine(b)));
+    b = maf_mafBlock_getNext(b);
+    CuAssertStrEquals(testCase, "a score=1", maf_mafLine_getLine(maf_mafBlock_getHeadLine(b)));
+    CuAssertTrue(testCase, maf_mafLine_getLineNumber(maf_mafBlock_getHeadLine(b)) == 4);
+    b = maf_mafBlock_getNext(b);
+    CuAssertStrEquals(testCase, "TA", maf_mafLine_getSequence(maf_mafLine_getNext(maf_mafBlock_getHeadLine(b))));
+    CuAssertStrEquals(testCase, "test_tmp/shard.1.maf", maf_mafFileApi_getFilename(mapi));
+    maf_destroyMafBlockList(mb);
+    maf_destroyMfa(mapi);
+  }
+  CuAssertTrue(testCase, !maf_isShardSpec("test_tmp/shard.0.maf"));
+  CuAssertTrue(testCase, !maf_isShardSpec("-"));
+  unsigned n = 0;
+  char **shards = maf_getShardList("test_tmp/shard.0.maf", &n);
+  CuAssertTrue(testCase, n == 1);
+  CuAssertStrEquals(testCase, "test_tmp/shard.0.maf", shards[0]);
+  maf_destroyShardList(shards, n);
+  // a continued maf has no header, its header lines are ordinary lines as
+  // they would be in the concatenation of the shards.
+  mafFileApi_t *mapi = maf_newMfa("test_tmp/shard.1.maf", "r");
+  maf_mafFileApi_setContinued(mapi);
+  mafBlock_t *mb = maf_readAll(mapi);
+  CuAssertTrue(testCase, maf_mafBlock_getNumberOfBlocks(mb) == 3);
+  CuAssertTrue(testCase, maf_mafLine_getType(maf_mafBlock_getHeadLine(mb)) == '#');
+  CuAssertStrEquals(testCase, "# shard 1", maf_mafLine_getLine(maf_mafLine_getNext(maf_mafBlock_getHeadLine(mb))));
+  CuAssertTrue(testCase, maf_mafLine_getType(maf_mafLine_getNext(maf_mafBlock_getHeadLine(mb))) == '#');
+  CuAssertTrue(testCase, maf_mafFileApi_getLineNumber(mapi) == 9);
+  maf_destroyMafBlockList(mb);
+  maf_destroyMfa(mapi);
+  unlink("test_tmp/shard.0.maf");
+  unlink("test_tmp/shard.1.maf");
+  unlink("test_tmp/shards.txt");
+  rmdir("test_tmp");
+}
 static void test_readWriteMaf(CuTest *testCase) {
   // make sure that we can do a complete read and complete write and that
   // the output is identical to the input.
@@ -663,6 +796,9 @@ CuSuite* mafShared_TestSuite(void) {
   SUITE_ADD_TEST(suite, test_readBlock2);
   SUITE_ADD_TEST(suite, test_lineNumbers);
   SUITE_ADD_TEST(suite, test_readWriteMaf);
+  SUITE_ADD_TEST(suite, test_readFromPipe);
+  SUITE_ADD_TEST(suite, test_readFromFile);
+  SUITE_ADD_TEST(suite, test_readShards);
   SUITE_ADD_TEST(suite, test_newMafBlockFromString_0);
   SUITE_ADD_TEST(suite, test_flipBlockStrand_0);
   SUITE_ADD_TEST(suite, test_flipBlockStrand_1);
@@ -29,17 +29,29 @@
 #include "comparatorAPI.h"
 #include "test.comparatorAPI.h"
 #include "test.comparatorRandom.h"
+#include "test.comparatorPairStore.h"
+#include "test.comparatorPairCount.h"
+#include "test.comparatorExact.h"
 
 CuSuite* comparatorAPI_TestSuite(void);
 CuSuite* comparatorRandom_TestSuite(void);
+CuSuite* comparatorPairStore_TestSuite(void);
+CuSuite* comparatorPairCount_TestSuite(void);
+CuSuite* comparatorExact_TestSuite(void);
 
 int comparator_RunAllTests(void) {
     CuString *output = CuStringNew();
     CuSuite *suite = CuSuiteNew();
     CuSuite *comparatorAPI_s = comparatorAPI_TestSuite();
     CuSuite *comparatorRandom_s = comparatorRandom_TestSuite();
+    CuSuite *comparatorPairStore_s = comparatorPairStore_TestSuite();
+    CuSuite *comparatorPairCount_s = comparatorPairCount_TestSuite();
+    CuSuite *comparatorExact_s = comparatorExact_TestSuite();
     CuSuiteAddSuite(suite, comparatorAPI_s);
     CuSuiteAddSuite(suite, comparatorRandom_s);
+    CuSuiteAddSuite(suite, comparatorPairStore_s);
+    CuSuiteAddSuite(suite, comparatorPairCount_s);
+    CuSuiteAddSuite(suite, comparatorExact_s);
     CuSuiteRun(suite);
     CuSuiteSummary(suite, output);
     CuSuiteDetails(suite, output);
@@ -48,6 +60,9 @@ int comparator_RunAllTests(void) {
     int status = (suite->failCount > 0);
     free(comparatorAPI_s);
     free(comparatorRandom_s);
+    free(comparatorPairStore_s);
+    free(comparatorPairCount_s);
+    free(comparatorExact_s);
     CuSuiteDelete(suite);
     return status;
 }
@@ -0,0 +1,561 @@
+/*
+ * Copyright (C) 2009-2013 by
+ * Dent Earl (dearl@soe.ucsc.edu, dentearl@gmail.com)
+ * Benedict Paten (benedict@soe.ucsc.edu, benedictpaten@gmail.com)
+ * ... and other members of the Reconstruction Team of David Haussler's
+ * lab (BME Dept. UCSC).
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/*
+ * Times the pieces of a comparison on synthetic alignments, over a grid of block shapes, and
+ * writes one CSV line per measurement so that thresholds such as the switch from brute force
+ * to analytic sampling in samplePairsFromColumn() can be set from data:
+ *     bruteForce, analytic, naive: the column samplers of samplePairsFromColumn(), one
+ *                                  pass over the columns of a block per rep
+ *     skipping:                    samplePairsFromColumnBySkipping(), what the default sampler uses
+ *     homology:                    testHomologyOnColumn() against a Bernoulli sample of the block
+ *     compareMAFs_AB/reservoir,
+ *     compareMAFs_AB/bernoulli:    one direction of a comparison, end to end, of two mafs of
+ *                                  --blocks such blocks written to --tmpDir
+ * A block has --rows rows, each a run of --columns characters with each character a gap with
+ * probability --gapRate. A row is a second copy (a paralog, at another position) of the sequence
+ * of an earlier row of the block with probability --duplication. The second maf of a comparison
+ * is the first with one row in ten dropped and one in ten shifted by a base. The result field is,
+ * summed over the reps, the pairs sampled, the records found by the homology tests (a record may
+ * be found more than once, see recordNearPair()) or the pairs tested. Build and run with
+ * `make -s bench > bench.csv` from mafComparator/, passing options with benchArgs="...", and with
+ * BUILD=release for representative numbers.
+ */
+#define _POSIX_C_SOURCE 200112L // clock_gettime, getpid
+#include <getopt.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "common.h"
+#include "sharedMaf.h"
+#include "sonLib.h"
+#include "comparatorAPI.h"
+#include "comparatorRandom.h"
+#include "comparatorPairStore.h"
+
+static const uint64_t kSourceLength = (uint64_t) 1 << 30;
+
+typedef struct _benchOptions {
+    stList *rows; // of uint64_t*
+    stList *gapRates; // of double*
+    stList *duplications;
+    stList *acceptProbabilities;
+    uint64_t numColumns;
+    uint64_t numBlocks;
+    uint64_t numberOfSamples;
+    uint64_t reps;
+    uint64_t seed;
+    char *tmpDir;
+    bool isSamplers;
+    bool isHomology;
+    bool isCompare;
+} BenchOptions;
+typedef struct _syntheticMaf {
+    // the blocks of a synthetic maf, made one at a time into the same buffers
+    uint64_t numRows;
+    uint64_t numColumns;
+    double gapRate;
+    double duplication;
+    char **nameTable; // seq0, seq1, ... one per row at most
+    uint64_t *nextPos; // of each name, the blocks of a sequence follow one another
+    RandomStream random;
+    // the current block
+    uint64_t *nameIds; // of each row, an index into nameTable
+    char **names; // of each row, nameTable[nameIds[row]]
+    uint64_t *starts;
+    uint64_t *lengths;
+    char **mat; // numRows rows of numColumns characters
+} SyntheticMaf;
+
+static SyntheticMaf* syntheticMaf_construct(uint64_t numRows, uint64_t numColumns, double gapRate,
+                                            double duplication, uint64_t seed) {
+    SyntheticMaf *s = (SyntheticMaf *) st_malloc(sizeof(*s));
+    s->numRows = numRows;
+    s->numColumns = numColumns;
+    s->gapRate = gapRate;
+    s->duplication = duplication;
+    s->nameTable = (char **) st_malloc(sizeof(*(s->nameTable)) * numRows);
+    for (uint64_t i = 0; i < numRows; ++i) {
+        s->nameTable[i] = stString_print("seq%" PRIu64, i);
+    }
+    s->nextPos = (uint64_t *) st_calloc(numRows, sizeof(*(s->nextPos)));
+    randomStream_init(&(s->random), seed, 0);
+    s->nameIds = (uint64_t *) st_malloc(sizeof(*(s->nameIds)) * numRows);
+    s->names = (char **) st_malloc(sizeof(*(s->names)) * numRows);
+    s->starts = (uint64_t *) st_malloc(sizeof(*(s->starts)) * numRows);
+    s->lengths = (uint64_t *) st_malloc(sizeof(*(s->lengths)) * numRows);
+    s->mat = (char **) st_malloc(sizeof(*(s->mat)) * numRows);
+    for (uint64_t i = 0; i < numRows; ++i) {
+        s->mat[i] = (char *) st_malloc(numColumns + 1);
+    }
+    return s;
+}
+static void syntheticMaf_destruct(SyntheticMaf *s) {
+    for (uint64_t i = 0; i < s->numRows; ++i) {
+        free(s->nameTable[i]);
+        free(s->mat[i]);
+    }
+    free(s->nameTable);
+    free(s->nextPos);
+    free(s->nameIds);
+    free(s->names);
+    free(s->starts);
+    free(s->lengths);
+    free(s->mat);
+    free(s);
+}
+static stSet* syntheticMaf_getNames(SyntheticMaf *s) {
+    stSet *names = stSet_construct3(stHash_stringKey, stHash_stringEqualKey, free);
+    for (uint64_t i = 0; i < s->numRows; ++i) {
+        stSet_insert(names, stString_copy(s->nameTable[i]));
+    }
+    return names;
+}
+static void syntheticMaf_nextBlock(SyntheticMaf *s) {
+    uint64_t numNames = 0;
+    for (uint64_t r = 0; r < s->numRows; ++r) {
+        if (r > 0 && randomStream_unit(&(s->random)) < s->duplication) {
+            s->nameIds[r] = s->nameIds[randomStream_uniformInt(&(s->random), r)];
+        } else {
+            s->nameIds[r] = numNames++;
+        }
+        s->names[r] = s->nameTable[s->nameIds[r]];
+        uint64_t length = 0;
+        for (uint64_t c = 0; c < s->numColumns; ++c) {
+            if (randomStream_unit(&(s->random)) < s->gapRate) {
+                s->mat[r][c] = '-';
+            } else {
+                s->mat[r][c] = "ACGT"[randomStream_uniformInt(&(s->random), 4)];
+                ++length;
+            }
+        }
+        if (length == 0) {
+            s->mat[r][0] = 'A';
+            length = 1;
+        }
+        s->mat[r][s->numColumns] = '\0';
+        s->lengths[r] = length;
+    }
+    // names are reused from block to block, so place every row after the last of its name
+    for (uint64_t r = 0; r < s->numRows; ++r) {
+        s->starts[r] = s->nextPos[s->nameIds[r]];
+        s->nextPos[s->nameIds[r]] += s->lengths[r] + 1;
+    }
+}
+static void writeBlock(FILE *f, SyntheticMaf *s, bool *isKept, uint64_t *shifts) {
+    fprintf(f, "a score=0\n");
+    for (uint64_t r = 0; r < s->numRows; ++r) {
+        if (isKept[r]) {
+            fprintf(f, "s %s %" PRIu64 " %" PRIu64 " + %" PRIu64 " %s\n", s->names[r],
+                    s->starts[r] + shifts[r], s->lengths[r], kSourceLength, s->mat[r]);
+        }
+    }
+    fprintf(f, "\n");
+}
+static void writeSyntheticMafs(SyntheticMaf *s, uint64_t numBlocks, const char *mafA, const char *mafB) {
+    FILE *fa = de_fopen(mafA, "w");
+    FILE *fb = de_fopen(mafB, "w");
+    fprintf(fa, "##maf version=1\n\n");
+    fprintf(fb, "##maf version=1\n\n");
+    bool *isKept = (bool *) st_malloc(sizeof(*isKept) * s->numRows);
+    uint64_t *shifts = (uint64_t *) st_malloc(sizeof(*shifts) * s->numRows);
+    for (uint64_t b = 0; b < numBlocks; ++b) {
+        syntheticMaf_nextBlock(s);
+        uint64_t numKept = 0;
+        for (uint64_t r = 0; r < s->numRows; ++r) {
+            isKept[r] = true;
+            shifts[r] = 0;
+        }
+        writeBlock(fa, s, isKept, shifts);
+        for (uint64_t r = 0; r < s->numRows; ++r) {
+            isKept[r] = randomStream_unit(&(s->random)) >= 0.1;
+            shifts[r] = (randomStream_unit(&(s->random)) < 0.1) ? 1 : 0;
+            numKept += isKept[r];
+        }
+        if (numKept > 1) {
+            writeBlock(fb, s, isKept, shifts);
+        }
+    }
+    free(isKept);
+    free(shifts);
+    fclose(fa);
+    fclose(fb);
+}
+typedef struct _blockColumns {
+    // the columns of a synthetic block as the samplers see them: the names and positions of the
+    // rows without a gap in column c are colNames[c * numRows + k], colPositions[...], for k
+    // below colCounts[c], and the position of every row rowPositions[c * numRows + r]
+    uint64_t numRows;
+    uint64_t numColumns;
+    char **colNames;
+    uint64_t *colPositions;
+    uint64_t *colCounts;
+    uint64_t *rowPositions;
+} BlockColumns;
+
+static BlockColumns* blockColumns_construct(SyntheticMaf *s) {
+    BlockColumns *bc = (BlockColumns *) st_malloc(sizeof(*bc));
+    uint64_t n = s->numRows * s->numColumns;
+    bc->numRows = s->numRows;
+    bc->numColumns = s->numColumns;
+    bc->colNames = (char **) st_malloc(sizeof(*(bc->colNames)) * n);
+    bc->colPositions = (uint64_t *) st_malloc(sizeof(*(bc->colPositions)) * n);
+    bc->colCounts = (uint64_t *) st_malloc(sizeof(*(bc->colCounts)) * s->numColumns);
+    bc->rowPositions = (uint64_t *) st_malloc(sizeof(*(bc->rowPositions)) * n);
+    uint64_t *pos = (uint64_t *) st_malloc(sizeof(*pos) * s->numRows);
+    memcpy(pos, s->starts, sizeof(*pos) * s->numRows);
+    for (uint64_t c = 0; c < s->numColumns; ++c) {
+        uint64_t k = 0;
+        for (uint64_t r = 0; r < s->numRows; ++r) {
+            bc->rowPositions[c * s->numRows + r] = pos[r];
+            if (s->mat[r][c] != '-') {
+                bc->colNames[c * s->numRows + k] = s->names[r];
+                bc->colPositions[c * s->numRows + k] = pos[r];
+                ++k;
+                ++pos[r];
+            }
+        }
+        bc->colCounts[c] = k;
+    }
+    free(pos);
+    return bc;
+}
+static void blockColumns_destruct(BlockColumns *bc) {
+    free(bc->colNames);
+    free(bc->colPositions);
+    free(bc->colCounts);
+    free(bc->rowPositions);
+    free(bc);
+}
+static void sampleBlockBySkipping(PairSampler *sampler, PairStore *pairs, BlockColumns *bc) {
+    uint64_t firstPair = 0;
+    pairSampler_beginBlock(sampler, firstPair);
+    for (uint64_t c = 0; c < bc->numColumns; ++c) {
+        uint64_t k = bc->colCounts[c];
+        samplePairsFromColumnBySkipping(sampler, pairs, k, firstPair, bc->colNames + c * bc->numRows,
+                                        bc->colPositions + c * bc->numRows);
+        firstPair += chooseTwo(k);
+    }
+}
+static double seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+static void report(const char *benchmark, SyntheticMaf *s, uint64_t numBlocks, double acceptProbability,
+                   uint64_t numberOfSamples, uint64_t reps, double t, uint64_t result) {
+    // the empty fields are those a benchmark does not have
+    printf("%s,%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%g,%g,", benchmark, s->numRows, s->numColumns, numBlocks,
+           s->gapRate, s->duplication);
+    if (numberOfSamples == 0) {
+        printf("%g,,", acceptProbability);
+    } else {
+        printf(",%" PRIu64 ",", numberOfSamples);
+    }
+    printf("%" PRIu64 ",%.6f,%.3f,%" PRIu64 "\n", reps, t,
+           t * 1e9 / ((double) reps * numBlocks * s->numColumns), result);
+    fflush(stdout);
+}
+static void benchSamplers(SyntheticMaf *s, BlockColumns *bc, stSet *names, double p, BenchOptions *o) {
+    PairStore *pairs = pairStore_construct(names);
+    uint64_t *chooseTwoArray = buildChooseTwoArray();
+    bool *legitRows = (bool *) st_malloc(sizeof(*legitRows) * s->numRows);
+    for (uint64_t r = 0; r < s->numRows; ++r) {
+        legitRows[r] = true;
+    }
+    RandomStream random;
+    PairSampler sampler;
+    const char *samplers[] = {"bruteForce", "analytic", "naive", "skipping"};
+    for (unsigned i = 0; i < sizeof(samplers) / sizeof(*samplers); ++i) {
+        randomStream_init(&random, o->seed, 1);
+        pairSampler_initBernoulli(&sampler, p, o->seed);
+        uint64_t sampled = 0;
+        double t = 0.0;
+        for (uint64_t rep = 0; rep < o->reps; ++rep) {
+            double t0 = seconds();
+            if (i == 3) {
+                sampleBlockBySkipping(&sampler, pairs, bc);
+            }
+            for (uint64_t c = 0; i < 3 && c < bc->numColumns; ++c) {
+                uint64_t k = bc->colCounts[c];
+                char **nameArray = bc->colNames + c * bc->numRows;
+                uint64_t *positions = bc->colPositions + c * bc->numRows;
+                if (i == 0) {
+                    samplePairsFromColumnBruteForce(&random, p, pairs, chooseTwoArray, nameArray, positions,
+                                                    k, chooseTwo(k));
+                } else if (i == 1) {
+                    samplePairsFromColumnAnalytic(&random, p, pairs, chooseTwoArray, nameArray, positions,
+                                                  k, chooseTwo(k));
+                } else {
+                    // the naive sampler takes the whole column, gaps and all
+                    samplePairsFromColumnNaive(&random, s->mat, c, legitRows, p, pairs, chooseTwoArray,
+                                               s->names, bc->rowPositions + c * bc->numRows, s->numRows,
+                                               chooseTwo(s->numRows));
+                }
+            }
+            t += seconds() - t0;
+            sampled += pairStore_size(pairs);
+            pairStore_clear(pairs);
+        }
+        report(samplers[i], s, 1, p, 0, o->reps, t, sampled);
+    }
+    free(legitRows);
+    free(chooseTwoArray);
+    pairStore_destruct(pairs);
+}
+static void benchHomology(SyntheticMaf *s, BlockColumns *bc, stSet *names, double p, BenchOptions *o) {
+    PairStore *pairs = pairStore_construct(names);
+    PairSampler sampler;
+    pairSampler_initBernoulli(&sampler, p, o->seed);
+    sampleBlockBySkipping(&sampler, pairs, bc);
+    pairStore_sort(pairs);
+    bool *legitRows = (bool *) st_malloc(sizeof(*legitRows) * s->numRows);
+    int64_t *rowNameIds = (int64_t *) st_malloc(sizeof(*rowNameIds) * s->numRows);
+    for (uint64_t r = 0; r < s->numRows; ++r) {
+        legitRows[r] = true;
+        rowNameIds[r] = pairStore_getNameId(pairs, s->names[r]);
+    }
+    uint64_t *allPositions = (uint64_t *) st_malloc(sizeof(*allPositions) * s->numRows);
+    uint64_t *columnKeys = (uint64_t *) st_malloc(sizeof(*columnKeys) * s->numRows);
+    PairIndexList *positivePairs = pairIndexList_construct();
+    uint64_t found = 0;
+    double t = seconds();
+    for (uint64_t rep = 0; rep < o->reps; ++rep) {
+        memcpy(allPositions, s->starts, sizeof(*allPositions) * s->numRows);
+        for (uint64_t c = 0; c < s->numColumns; ++c) {
+            testHomologyOnColumn(s->mat, c, s->numRows, legitRows, rowNameIds, pairs, positivePairs,
+                                 allPositions, columnKeys, 0);
+            for (uint64_t r = 0; r < s->numRows; ++r) {
+                allPositions[r] += (s->mat[r][c] != '-');
+            }
+        }
+        found += positivePairs->length;
+        positivePairs->length = 0;
+    }
+    t = seconds() - t;
+    report("homology", s, 1, p, 0, o->reps, t, found);
+    pairIndexList_destruct(positivePairs);
+    free(columnKeys);
+    free(allPositions);
+    free(rowNameIds);
+    free(legitRows);
+    pairStore_destruct(pairs);
+}
+static void benchCompare(SyntheticMaf *s, BenchOptions *o) {
+    char *mafA = stString_print("%s/benchComparator.%d.a.maf", o->tmpDir, (int) getpid());
+    char *mafB = stString_print("%s/benchComparator.%d.b.maf", o->tmpDir, (int) getpid());
+    writeSyntheticMafs(s, o->numBlocks, mafA, mafB);
+    stSet *legitSequences = stSet_construct3(stHash_stringKey, stHash_stringEqualKey, free);
+    stHash *sequenceLengthHash = stHash_construct3(stHash_stringKey, stHash_stringEqualKey, free, free);
+    populateNames(mafA, legitSequences, sequenceLengthHash);
+    stHash *intervalsHash = stHash_construct3(stHash_stringKey, stHash_stringEqualKey, free, free);
+    stHash *wigglePairHash = stHash_construct3(stHash_stringKey, stHash_stringEqualKey, free,
+                                               (void(*)(void *)) wiggleContainer_destruct);
+    Options *options = options_construct();
+    options->numberOfSamples = o->numberOfSamples;
+    options->randomSeed = o->seed;
+    options->numThreads = 1;
+    for (unsigned i = 0; i < 2; ++i) {
+        options->isReservoirSampling = (i == 0);
+        uint64_t numberOfPairs = 0;
+        uint64_t tested = 0;
+        double t = seconds();
+        stSortedSet *results = compareMAFs_AB(mafA, mafB, &numberOfPairs, legitSequences, intervalsHash,
+                                              wigglePairHash, true, options, sequenceLengthHash);
+        t = seconds() - t;
+        stSortedSetIterator *it = stSortedSet_getIterator(results);
+        ResultPair *rp = NULL;
+        while ((rp = stSortedSet_getNext(it)) != NULL) {
+            tested += rp->total;
+        }
+        stSortedSet_destructIterator(it);
+        stSortedSet_destruct(results);
+        report(i == 0 ? "compareMAFs_AB/reservoir" : "compareMAFs_AB/bernoulli", s, o->numBlocks, 0.0,
+               o->numberOfSamples, 1, t, tested);
+    }
+    // clean up
+    options_destruct(options);
+    stHash_destruct(wigglePairHash);
+    stHash_destruct(intervalsHash);
+    stHash_destruct(sequenceLengthHash);
+    stSet_destruct(legitSequences);
+    remove(mafA);
+    remove(mafB);
+    free(mafA);
+    free(mafB);
+}
+static stList* parseList(const char *s, bool isDouble) {
+    // a comma separated list of numbers
+    stList *list = stList_construct3(0, free);
+    char *end = (char *) s;
+    do {
+        s = end + (*end == ',');
+        if (isDouble) {
+            double *d = (double *) st_malloc(sizeof(*d));
+            *d = strtod(s, &end);
+            stList_append(list, d);
+        } else {
+            uint64_t *u = (uint64_t *) st_malloc(sizeof(*u));
+            *u = strtoull(s, &end, 10);
+            stList_append(list, u);
+        }
+        if (end == s || (*end != ',' && *end != '\0')) {
+            fprintf(stderr, "Error, bad list of numbers: %s\n", s);
+            exit(EXIT_FAILURE);
+        }
+    } while (*end != '\0');
+    return list;
+}
+static void usage(void) {
+    fprintf(stderr, "Usage: benchComparator [options] > bench.csv\n\n"
+            "Times the pair samplers, homology tests and end to end comparisons of mafComparator on\n"
+            "synthetic alignments, one CSV line per measurement. Lists are comma separated and every\n"
+            "combination of their values is measured.\n\n"
+            "  --rows LIST                rows of a block [default: 2,3,4,5,6,8,16,32,64]\n"
+            "  --columns N                columns of a block [default: 1000]\n"
+            "  --gapRate LIST             chance of a gap at each character [default: 0,0.1,0.3]\n"
+            "  --duplication LIST         chance of a row repeating the sequence of an earlier row\n"
+            "                             [default: 0,0.2]\n"
+            "  --acceptProbability LIST   per pair chance of sampling, column benchmarks only\n"
+            "                             [default: 0.001,0.01,0.1,0.5]\n"
+            "  --reps N                   passes over the block of a column benchmark [default: 10]\n"
+            "  --blocks N                 blocks of the mafs of compareMAFs_AB [default: 200]\n"
+            "  --samples N                samples of compareMAFs_AB [default: 100000]\n"
+            "  --seed N                   [default: 1]\n"
+            "  --tmpDir DIR               where the mafs of compareMAFs_AB go [default: $TMPDIR, or /tmp]\n"
+            "  --benchmarks LIST          of samplers, homology and compare [default: all three]\n"
+            "  -h, --help\n");
+}
+static void parseOptions(int argc, char **argv, BenchOptions *o) {
+    char *rows = "2,3,4,5,6,8,16,32,64";
+    char *gapRates = "0,0.1,0.3";
+    char *duplications = "0,0.2";
+    char *acceptProbabilities = "0.001,0.01,0.1,0.5";
+    char *benchmarks = "samplers,homology,compare";
+    o->numColumns = 1000;
+    o->numBlocks = 200;
+    o->numberOfSamples = 100000;
+    o->reps = 10;
+    o->seed = 1;
+    o->tmpDir = (getenv("TMPDIR") != NULL) ? getenv("TMPDIR") : "/tmp";
+    static struct option longOptions[] = {
+        {"rows", required_argument, 0, 'r'},
+        {"columns", required_argument, 0, 'c'},
+        {"gapRate", required_argument, 0, 'g'},
+        {"duplication", required_argument, 0, 'd'},
+        {"acceptProbability", required_argument, 0, 'p'},
+        {"reps", required_argument, 0, 'n'},
+        {"blocks", required_argument, 0, 'b'},
+        {"samples", required_argument, 0, 's'},
+        {"seed", required_argument, 0, 'e'},
+        {"tmpDir", required_argument, 0, 't'},
+        {"benchmarks", required_argument, 0, 'm'},
+        {"help", no_argument, 0, 'h'},
+        {0, 0, 0, 0}
+    };
+    int key;
+    while ((key = getopt_long(argc, argv, "h", longOptions, NULL)) != -1) {
+        switch (key) {
+        case 'r': rows = optarg; break;
+        case 'c': o->numColumns = strtoull(optarg, NULL, 10); break;
+        case 'g': gapRates = optarg; break;
+        case 'd': duplications = optarg; break;
+        case 'p': acceptProbabilities = optarg; break;
+        case 'n': o->reps = strtoull(optarg, NULL, 10); break;
+        case 'b': o->numBlocks = strtoull(optarg, NULL, 10); break;
+        case 's': o->numberOfSamples = strtoull(optarg, NULL, 10); break;
+        case 'e': o->seed = strtoull(optarg, NULL, 10); break;
+        case 't': o->tmpDir = optarg; break;
+        case 'm': benchmarks = optarg; break;
+        case 'h':
+            usage();
+            exit(EXIT_SUCCESS);
+        default:
+            usage();
+            exit(EXIT_FAILURE);
+        }
+    }
+    o->rows = parseList(rows, false);
+    o->gapRates = parseList(gapRates, true);
+    o->duplications = parseList(duplications, true);
+    o->acceptProbabilities = parseList(acceptProbabilities, true);
+    o->isSamplers = strstr(benchmarks, "samplers") != NULL;
+    o->isHomology = strstr(benchmarks, "homology") != NULL;
+    o->isCompare = strstr(benchmarks, "compare") != NULL;
+    if (o->numColumns == 0 || o->reps == 0 || o->numBlocks == 0) {
+        fprintf(stderr, "Error, --columns, --reps and --blocks must be positive.\n");
+        exit(EXIT_FAILURE);
+    }
+    for (int64_t i = 0; i < stList_length(o->rows); ++i) {
+        if (*(uint64_t *) stList_get(o->rows, i) < 2) {
+            fprintf(stderr, "Error, a block needs at least 2 --rows.\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+}
+int main(int argc, char **argv) {
+    BenchOptions o;
+    parseOptions(argc, argv, &o);
+    printf("benchmark,rows,columns,blocks,gapRate,duplication,acceptProbability,samples,reps,seconds,"
+           "nsPerColumn,result\n");
+    for (int64_t i = 0; i < stList_length(o.rows); ++i) {
+        uint64_t numRows = *(uint64_t *) stList_get(o.rows, i);
+        for (int64_t j = 0; j < stList_length(o.gapRates); ++j) {
+            double gapRate = *(double *) stList_get(o.gapRates, j);
+            for (int64_t k = 0; k < stList_length(o.duplications); ++k) {
+                double duplication = *(double *) stList_get(o.duplications, k);
+                SyntheticMaf *s = syntheticMaf_construct(numRows, o.numColumns, gapRate, duplication, o.seed);
+                stSet *names = syntheticMaf_getNames(s);
+                syntheticMaf_nextBlock(s);
+                BlockColumns *bc = blockColumns_construct(s);
+                for (int64_t l = 0; l < stList_length(o.acceptProbabilities); ++l) {
+                    double p = *(double *) stList_get(o.acceptProbabilities, l);
+                    if (o.isSamplers) {
+                        benchSamplers(s, bc, names, p, &o);
+                    }
+                    if (o.isHomology) {
+                        benchHomology(s, bc, names, p, &o);
+                    }
+                }
+                if (o.isCompare) {
+                    benchCompare(s, &o);
+                }
+                blockColumns_destruct(bc);
+                stSet_destruct(names);
+                syntheticMaf_destruct(s);
+            }
+        }
+    }
+    stList_destruct(o.rows);
+    stList_destruct(o.gapRates);
+    stList_destruct(o.duplications);
+    stList_destruct(o.acceptProbabilities);
+    return EXIT_SUCCESS;
+}
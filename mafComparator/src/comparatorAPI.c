@@ -27,12 +27,20 @@
 
 #include <math.h>
 #include <string.h>
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
 #include "sonLib.h"
 #include "common.h"
+#include "parallel.h"
+#include "profile.h"
 #include "comparatorAPI.h"
 #include "comparatorRandom.h"
 
 const unsigned kChooseTwoCacheLength = 101;
+const uint64_t kHomologyBatchBlocksPerWorker = 256;
+static const uint64_t kMaf2SeedMask = 0x5deece66dULL; // keeps the maf2 sample off --seed's
+bool g_isVerboseFailures = false;
 
 void aPair_fillOut(APair *aPair, char *seq1, char *seq2, uint64_t pos1, uint64_t pos2) {
     int i = strcmp(seq1, seq2);
@@ -71,6 +79,7 @@ WiggleContainer* wiggleContainer_init(void) {
 Options* options_construct(void) {
     Options *o = (Options*) st_malloc(sizeof(*o));
     o->logLevelString = NULL;
+    o->profileFile = NULL;
     o->mafFile1 = NULL;
     o->mafFile2 = NULL;
     o->outputFile = NULL;
@@ -86,6 +95,18 @@ Options* options_construct(void) {
     o->numPairs1 = 0;
     o->numPairs2 = 0;
     o->wiggleBinLength = 100000; // by default have bins of length 100,000
+    o->numThreads = 0;
+    o->isConcurrent = false;
+    o->isReservoirSampling = false;
+    o->isPairCountCached = false;
+    o->isExact = false;
+    o->exactMemory = (uint64_t) 1024 << 20; // by default sort the pairs in a GiB of memory
+    o->sampleMemory = 0;
+    o->tmpDir = NULL;
+    o->batchFile = NULL;
+    o->truthPairsFile = NULL;
+    o->shardSpec = NULL;
+    o->shardSequences = NULL;
     return o;
 }
 APair* aPair_construct(const char *seq1, const char *seq2, uint64_t pos1, uint64_t pos2) {
@@ -139,6 +160,7 @@ void options_destruct(Options *o) {
         return;
     }
     free(o->logLevelString);
+    free(o->profileFile);
     free(o->mafFile1);
     free(o->mafFile2);
     free(o->outputFile);
@@ -146,6 +168,13 @@ void options_destruct(Options *o) {
     free(o->wigglePairs);
     free(o->legitSequences);
     free(o->numPairsString);
+    free(o->tmpDir);
+    free(o->batchFile);
+    free(o->truthPairsFile);
+    free(o->shardSpec);
+    if (o->shardSequences != NULL) {
+        stSet_destruct(o->shardSequences);
+    }
     free(o);
     o = NULL;
 }
@@ -429,27 +458,113 @@ uint64_t countPairsInColumn(char **mat, uint64_t c, uint64_t numSeqs,
         return chooseTwo(possiblePartners);
     }
 }
-uint64_t walkBlockCountingPairs(mafBlock_t *mb, stSet *legitSequences, uint64_t *chooseTwoArray) {
-    // size is the MAXIMUM INDEX of the chooseTwo array
-    uint64_t count = 0;
+static uint64_t lowBits(uint64_t n) {
+    // the mask of the n, at most 64, lowest bits
+    return (n >= 64) ? UINT64_MAX : (((uint64_t) 1 << n) - 1);
+}
+static uint64_t nonGapMask(const char *s, uint64_t n) {
+    // bit i is set when s[i], i < n <= 64, is not a gap. only the number of rows without a gap in
+    // each column is wanted, so within a group of 8 columns the bit order only has to be the same
+    // for every row, whatever the byte order of the machine.
+    uint64_t gaps = 0;
+    uint64_t i = 0;
+#ifdef __AVX2__
+    const __m256i dash = _mm256_set1_epi8('-');
+    for (; i + 32 <= n; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *) (s + i));
+        gaps |= (uint64_t) (uint32_t) _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, dash)) << i;
+    }
+#endif
+    for (; i + 8 <= n; i += 8) {
+        uint64_t x;
+        memcpy(&x, s + i, sizeof(x));
+        x ^= 0x2d2d2d2d2d2d2d2dULL; // '-' bytes become zero
+        uint64_t y = ~(((x & 0x7f7f7f7f7f7f7f7fULL) + 0x7f7f7f7f7f7f7f7fULL) | x) & 0x8080808080808080ULL;
+        gaps |= (((y >> 7) * 0x0102040810204080ULL) >> 56) << i; // the high bits of the zero bytes
+    }
+    for (; i < n; ++i) {
+        gaps |= (uint64_t) (s[i] == '-') << i;
+    }
+    return ~gaps & lowBits(n);
+}
+uint64_t countPairsInRows(char **rows, uint64_t *lengths, uint64_t numRows, uint64_t numColumns) {
+    // the sum over the columns of chooseTwo(the number of rows without a gap in the column), as
+    // countPairsInColumn() counts it. a row shorter than numColumns has no gaps past its end, as
+    // in the sequence matrix of a block. the non-gap bitmask of every 64 columns of a row is added
+    // into a bit sliced counter, plane k of which holds bit k of the count of each column, and the
+    // sums of the counts and of their squares are read off the planes with popcounts,
+    //     sum n = sum_j 2^j |plane_j|,  sum n^2 = sum_j sum_k 2^(j+k) |plane_j & plane_k|,
+    // so the cost is in words rather than in characters and the pairs are (sum n^2 - sum n) / 2.
+    // rows are walked one at a time, reading each straight through.
+    uint64_t numChunks = (numColumns + 63) / 64;
+    unsigned numPlanes = 1;
+    while (numPlanes < 64 && ((uint64_t) 1 << numPlanes) <= numRows) {
+        ++numPlanes;
+    }
+    uint64_t *planes = (uint64_t *) st_calloc(numChunks * numPlanes, sizeof(*planes));
+    for (uint64_t r = 0; r < numRows; ++r) {
+        for (uint64_t chunk = 0; chunk < numChunks; ++chunk) {
+            uint64_t start = chunk * 64;
+            uint64_t n = (numColumns - start < 64) ? numColumns - start : 64;
+            uint64_t available = (lengths[r] <= start) ? 0 : lengths[r] - start;
+            uint64_t mask;
+            if (available >= n) {
+                mask = nonGapMask(rows[r] + start, n);
+            } else {
+                mask = nonGapMask(rows[r] + start, available) | (lowBits(n) & ~lowBits(available));
+            }
+            // ripple carry add of one to the count of each column in mask
+            uint64_t *p = planes + chunk * numPlanes;
+            for (unsigned k = 0; mask != 0; ++k) {
+                uint64_t carry = p[k] & mask;
+                p[k] ^= mask;
+                mask = carry;
+            }
+        }
+    }
+    uint64_t twicePairs = 0;
+    for (uint64_t chunk = 0; chunk < numChunks; ++chunk) {
+        uint64_t *p = planes + chunk * numPlanes;
+        uint64_t sum = 0, sumOfSquares = 0;
+        for (unsigned j = 0; j < numPlanes; ++j) {
+            uint64_t pj = __builtin_popcountll(p[j]);
+            sum += pj << j;
+            sumOfSquares += pj << (2 * j);
+            for (unsigned k = j + 1; k < numPlanes; ++k) {
+                sumOfSquares += (uint64_t) __builtin_popcountll(p[j] & p[k]) << (j + k + 1);
+            }
+        }
+        twicePairs += sumOfSquares - sum;
+    }
+    free(planes);
+    return twicePairs / 2;
+}
+uint64_t walkBlockCountingPairs(mafBlock_t *mb, stSet *legitSequences) {
+    // the pairs of the legit sequences in the block, see countPairsInRows(). the sequences are
+    // read in place rather than copied into a matrix.
     uint64_t numSeqs = maf_mafBlock_getNumberOfSequences(mb);
-    if (numSeqs < 1) {
+    if (numSeqs < 2) {
         return 0;
     }
-    uint64_t seqFieldLength = maf_mafBlock_getSequenceFieldLength(mb);
-    char **names = maf_mafBlock_getSpeciesArray(mb);
-    char **mat = maf_mafBlock_getSequenceMatrix(mb, numSeqs, seqFieldLength);
-    bool *legitRows = getLegitRows(names, numSeqs, legitSequences);
-    for (uint64_t c = 0; c < seqFieldLength; ++c) {
-        count += countPairsInColumn(mat, c, numSeqs, legitRows, chooseTwoArray);
+    char **rows = (char **) st_malloc(sizeof(*rows) * numSeqs);
+    uint64_t *lengths = (uint64_t *) st_malloc(sizeof(*lengths) * numSeqs);
+    uint64_t numRows = 0;
+    for (mafLine_t *ml = maf_mafBlock_getHeadLine(mb); ml != NULL; ml = maf_mafLine_getNext(ml)) {
+        if (maf_mafLine_getType(ml) != 's') {
+            continue;
+        }
+        if (legitSequences != NULL && stSet_search(legitSequences, maf_mafLine_getSpecies(ml)) == NULL) {
+            continue;
+        }
+        rows[numRows] = maf_mafLine_getSequence(ml);
+        lengths[numRows++] = maf_mafLine_getSequenceFieldLength(ml);
     }
-    // clean up
-    for (uint64_t i = 0; i < numSeqs; ++i) {
-        free(names[i]);
+    uint64_t count = 0;
+    if (numRows > 1) {
+        count = countPairsInRows(rows, lengths, numRows, maf_mafBlock_getSequenceFieldLength(mb));
     }
-    free(names);
-    maf_mafBlock_destroySequenceMatrix(mat, numSeqs);
-    free(legitRows);
+    free(rows);
+    free(lengths);
     return count;
 }
 uint64_t chooseTwo(uint64_t n) {
@@ -467,18 +582,48 @@ uint64_t* buildChooseTwoArray(void) {
     }
     return cta;
 }
-uint64_t countPairsInMaf(const char *filename, stSet *legitSequences) {
-    mafFileApi_t *mfa = maf_newMfa(filename, "r");
+typedef struct _shardPairCount {
+    char **shards;
+    stSet *legitSequences; // only ever read
+    uint64_t *workerCounts;
+} ShardPairCount;
+static void countPairsInShard(uint64_t i, unsigned worker, void *data) {
+    ShardPairCount *spc = (ShardPairCount *) data;
+    mafFileApi_t *mfa = maf_newMfa(spc->shards[i], "r");
     mafBlock_t *mb = NULL;
     uint64_t counter = 0;
-    uint64_t *chooseTwoArray = buildChooseTwoArray();
     while ((mb = maf_readBlock(mfa)) != NULL) {
-        counter += walkBlockCountingPairs(mb, legitSequences, chooseTwoArray);
+        counter += walkBlockCountingPairs(mb, spc->legitSequences);
         maf_destroyMafBlockList(mb);
     }
-    // clean up
-    free(chooseTwoArray);
     maf_destroyMfa(mfa);
+    spc->workerCounts[worker] += counter;
+}
+uint64_t countPairsInBlocks(mafBlock_t *blocks, stSet *legitSequences) {
+    // as countPairsInMaf() for a maf already read into memory with maf_readAll()
+    uint64_t counter = 0;
+    for (mafBlock_t *mb = blocks; mb != NULL; mb = maf_mafBlock_getNext(mb)) {
+        counter += walkBlockCountingPairs(mb, legitSequences);
+    }
+    return counter;
+}
+uint64_t countPairsInMaf(const char *filename, stSet *legitSequences, unsigned numThreads) {
+    // filename may be a sharded maf, in which case up to numThreads shards
+    // are counted at once.
+    ShardPairCount spc;
+    unsigned numShards;
+    spc.shards = maf_getShardList(filename, &numShards);
+    unsigned numWorkers = parallel_numberOfWorkers(numThreads, numShards);
+    spc.legitSequences = legitSequences;
+    spc.workerCounts = (uint64_t *) st_calloc(numWorkers, sizeof(uint64_t));
+    parallel_for(numShards, numWorkers, countPairsInShard, &spc);
+    uint64_t counter = 0;
+    for (unsigned w = 0; w < numWorkers; ++w) {
+        counter += spc.workerCounts[w];
+    }
+    // clean up
+    free(spc.workerCounts);
+    maf_destroyShardList(spc.shards, numShards);
     return counter;
 }
 static uint64_t uint64Key(const void *k) {
@@ -516,8 +661,8 @@ uint64_t countLegitGaplessPositions(char **mat, uint64_t c, uint64_t numRows, bo
     }
     return a;
 }
-void samplePairsFromColumn(double acceptProbability,
-                           stSortedSet *pairs, uint64_t numSeqs, uint64_t *chooseTwoArray,
+void samplePairsFromColumn(RandomStream *random, double acceptProbability,
+                           PairStore *pairs, uint64_t numSeqs, uint64_t *chooseTwoArray,
                            char **nameArray, uint64_t *columnPositions) {
     // acceptProbability is the per base accept probability, pairs is where we store pairs,
     // numSeqs is the number of sequences in either array, columnMlArray is an array that contains
@@ -533,46 +678,141 @@ void samplePairsFromColumn(double acceptProbability,
         // keep in mind the sequence of values for v = k choose 2 is
         // k: 2 3 4  5 ...
         // v: 1 3 6 10 ...
-        samplePairsFromColumnBruteForce(acceptProbability, pairs,
+        samplePairsFromColumnBruteForce(random, acceptProbability, pairs,
                                         chooseTwoArray, nameArray,
                                         columnPositions, numSeqs, numPairs);
     } else {
-        samplePairsFromColumnAnalytic(acceptProbability, pairs,
+        samplePairsFromColumnAnalytic(random, acceptProbability, pairs,
                                       chooseTwoArray, nameArray,
                                       columnPositions, numSeqs, numPairs);
     }
     free(nameArray);
     free(columnPositions);
 }
-void samplePairsFromColumnBruteForce(double acceptProbability, stSortedSet *pairs,
+static void pairSampler_skip(PairSampler *s, double gap) {
+    // move s->next on by gap + 1 pairs, gap a non-negative whole number, possibly huge
+    if (gap >= 1.8e19 || (uint64_t) gap >= UINT64_MAX - s->next - 1) {
+        s->next = UINT64_MAX;
+    } else {
+        s->next += (uint64_t) gap + 1;
+    }
+}
+static void pairSampler_advance(PairSampler *s) {
+    // move on to the next pair to sample after s->next
+    if (s->size == 0) {
+        // the gaps between independently accepted pairs are geometric
+        pairSampler_skip(s, floor(log(randomStream_openUnit(&(s->random))) / s->logQ));
+    } else if (s->next + 1 < s->size) {
+        // filling the reservoir, every pair is taken
+        ++(s->next);
+    } else {
+        // Li's Algorithm L (ACM TOMS 20(4), 1994). once the reservoir is full the gap to the next
+        // pair that replaces a member is geometric too, its success probability w shrinking as
+        // the stream grows.
+        s->w *= exp(log(randomStream_openUnit(&(s->random))) / (double) s->size);
+        pairSampler_skip(s, floor(log(randomStream_openUnit(&(s->random))) / log1p(-(s->w))));
+    }
+}
+static void pairSampler_startBernoulli(PairSampler *s, uint64_t firstPair) {
+    // the first pair sampled at or after firstPair
+    if (s->logQ == 0.0) {
+        s->next = UINT64_MAX;
+        return;
+    }
+    double gap = floor(log(randomStream_openUnit(&(s->random))) / s->logQ);
+    if (gap >= 1.8e19 || (uint64_t) gap >= UINT64_MAX - firstPair) {
+        s->next = UINT64_MAX;
+    } else {
+        s->next = firstPair + (uint64_t) gap;
+    }
+}
+void pairSampler_initBernoulli(PairSampler *s, double acceptProbability, uint64_t seed) {
+    // every pair is sampled independently with acceptProbability, as by samplePairsFromColumn(),
+    // but by drawing the gaps between sampled pairs rather than a decision per pair or per column.
+    s->size = 0;
+    s->w = 0.0;
+    s->seed = seed;
+    s->block = 0;
+    randomStream_init(&(s->random), seed, 0);
+    // log(1 - p), -infinity takes every pair and 0 none
+    if (acceptProbability <= 0.0) {
+        s->logQ = 0.0;
+    } else {
+        s->logQ = (acceptProbability >= 1.0) ? -INFINITY : log1p(-acceptProbability);
+    }
+    pairSampler_startBernoulli(s, 0);
+}
+void pairSampler_initReservoir(PairSampler *s, uint64_t size, uint64_t seed) {
+    // a uniform sample of exactly min(size, total) pairs drawn in a single pass without knowing
+    // the total number of pairs up front. every pair is in the sample with probability
+    // size / total, as with pairSampler_initBernoulli(size / total).
+    s->size = size;
+    s->w = 1.0;
+    s->logQ = 0.0;
+    s->next = (size == 0) ? UINT64_MAX : 0;
+    s->seed = seed;
+    s->block = 0;
+    randomStream_init(&(s->random), seed, 0);
+}
+void pairSampler_beginBlock(PairSampler *s, uint64_t firstPair) {
+    /* Called before the pairs of a block, firstPair being the index of its first pair. The random
+     * numbers used in the block are those of stream s->block + 1 of the seed, stream 0 being left
+     * to callers that never begin a block. A Bernoulli sampler forgets the gap drawn in the blocks
+     * before, the gaps being memoryless, and draws the gap to its first pair afresh, so which
+     * pairs of a block are sampled depends only on the seed, the block's index and its contents,
+     * and the blocks may be sampled in any order, or at once, by setting s->block. A reservoir
+     * carries its state from block to block and so must see the blocks in order.
+     */
+    randomStream_init(&(s->random), s->seed, ++(s->block));
+    if (s->size == 0) {
+        pairSampler_startBernoulli(s, firstPair);
+    }
+}
+bool pairSampler_isInColumn(PairSampler *s, uint64_t firstPair, uint64_t numPairs) {
+    // firstPair is the index, over every pair in the maf, of the first pair of a column
+    // with numPairs pairs. false means the column can be passed over.
+    return s->next >= firstPair && s->next - firstPair < numPairs;
+}
+void samplePairsFromColumnBySkipping(PairSampler *s, PairStore *pairs, uint64_t numSeqs, uint64_t firstPair,
+                                     char **nameArray, uint64_t *columnPositions) {
+    // samples the pairs of a column chosen by s, see pairSampler_isInColumn(). numSeqs is the
+    // length of nameArray and columnPositions. a reservoir's members are kept in slot order.
+    uint64_t numPairs = chooseTwo(numSeqs);
+    uint64_t p1, p2;
+    while (pairSampler_isInColumn(s, firstPair, numPairs)) {
+        arrayIndexToPairIndices(s->next - firstPair, numSeqs, &p1, &p2);
+        if (s->size == 0 || s->next < s->size) {
+            pairStore_addNamed(pairs, nameArray[p1], columnPositions[p1], nameArray[p2], columnPositions[p2]);
+        } else {
+            pairStore_setNamed(pairs, randomStream_uniformInt(&(s->random), s->size),
+                               nameArray[p1], columnPositions[p1], nameArray[p2], columnPositions[p2]);
+        }
+        pairSampler_advance(s);
+    }
+}
+void samplePairsFromColumnBruteForce(RandomStream *random, double acceptProbability, PairStore *pairs,
                                      uint64_t *chooseTwoArray,
                                      char **nameArray, uint64_t *positions, uint64_t numSeqs,
                                      uint64_t numPairs) {
     uint64_t p1, p2;
     for (uint64_t i = 0; i < numPairs; ++i) {
-        if (st_random() <= acceptProbability) {
+        if (randomStream_unit(random) <= acceptProbability) {
             arrayIndexToPairIndices(i, numSeqs, &p1, &p2);
-            // printf("1. adding pair (%s %u):(%s %u)\n", maf_mafLine_getSpecies(mlArray[p1]),
-            //        positions[p1], maf_mafLine_getSpecies(mlArray[p2]), positions[p2]);
-            APair *aPair = aPair_construct(nameArray[p1], nameArray[p2],
-                                           positions[p1], positions[p2]);
-            stSortedSet_insert(pairs, aPair);
+            pairStore_addNamed(pairs, nameArray[p1], positions[p1], nameArray[p2], positions[p2]);
         }
     }
 }
-void samplePairsFromColumnAnalytic(double acceptProbability, stSortedSet *pairs,
+void samplePairsFromColumnAnalytic(RandomStream *random, double acceptProbability, PairStore *pairs,
                                    uint64_t *chooseTwoArray,
                                    char **nameArray, uint64_t *positions, uint64_t numSeqs,
                                    uint64_t numPairs) {
-    uint64_t n = rbinom(numPairs, acceptProbability);
+    uint64_t n = rbinom(random, numPairs, acceptProbability);
     if (n == 0) {
         return;
     }
     stSet *set = stSet_construct3(uint64Key, uint64EqualKey, free);
     uint64_t *randPair = st_malloc(sizeof(*randPair));
     uint64_t numPairsToSample = 0;
-    int offset = 0; // used when numPairs > INT64_MAX, offset is the number of times to multiply by INT64_MAX
-    (void) offset;
     if (((double) n > numPairs / 2.0) && (numPairs > n)) {
         // sample (numSeqs - n) many pairs
         numPairsToSample = numPairs - n;
@@ -581,45 +821,11 @@ void samplePairsFromColumnAnalytic(double acceptProbability, stSortedSet *pairs,
         numPairsToSample = n;
     }
     uint64_t i = 0;
-    if (numPairs > UINT64_MAX) {
-        // panic!
-        fprintf(stderr, "Error in samplePairsFromColumnAnalytic(), numPairs (%" PRIu64
-                ") > UINT64_MAX (%" PRIu64 "), this will cause st_randomInt64() to fail.\n", numPairs, UINT64_MAX);
-        exit(EXIT_FAILURE);
-    } else if (numPairs > INT64_MAX) {
-        // will have to sample from a shifted range using st_randomInt64()
-        int64_t imin = INT64_MAX - numPairs; // shift range
-        assert(imin < 0);
-        int64_t randi;
-        while (i < numPairsToSample) {
-            randi = st_randomInt64(imin, INT64_MAX); // sample from shifted range
-            assert((randi - imin) >= 0);
-            *randPair = randi - imin; // shift range back
-            assert(*randPair <= numPairs);
-            if (stSet_search(set, randPair) == NULL) {
-                stSet_insert(set, uint64Copy(randPair));
-                ++i;
-            }
-        }
-    } else if (numPairs > INT64_MAX){
-        // sample straight away using st_randomInt64()
-        while (i < numPairsToSample) {
-            *randPair = st_randomInt64(0, numPairs);
-            assert(*randPair <= numPairs);
-            if (stSet_search(set, randPair) == NULL) {
-                stSet_insert(set, uint64Copy(randPair));
-                ++i;
-            }
-        }
-    } else {
-        // sample straight away using st_randomInt()
-        while (i < numPairsToSample) {
-            *randPair = st_randomInt(0, numPairs);
-            assert(*randPair <= numPairs);
-            if (stSet_search(set, randPair) == NULL) {
-                stSet_insert(set, uint64Copy(randPair));
-                ++i;
-            }
+    while (i < numPairsToSample) {
+        *randPair = randomStream_uniformInt(random, numPairs);
+        if (stSet_search(set, randPair) == NULL) {
+            stSet_insert(set, uint64Copy(randPair));
+            ++i;
         }
     }
     stSetIterator *sit = stSet_getIterator(set);
@@ -630,9 +836,7 @@ void samplePairsFromColumnAnalytic(double acceptProbability, stSortedSet *pairs,
         while ((key = stSet_getNext(sit)) != NULL) {
             // use nameArray
             arrayIndexToPairIndices(*key, numSeqs, &p1, &p2);
-            APair *aPair = aPair_construct(nameArray[p1], nameArray[p2],
-                                           positions[p1], positions[p2]);
-            stSortedSet_insert(pairs, aPair);
+            pairStore_addNamed(pairs, nameArray[p1], positions[p1], nameArray[p2], positions[p2]);
         }
     } else {
         // items in set *have not* been sampled
@@ -640,9 +844,7 @@ void samplePairsFromColumnAnalytic(double acceptProbability, stSortedSet *pairs,
             *randPair = i;
             if (stSet_search(set, randPair) == NULL) {
                 arrayIndexToPairIndices(i, numSeqs, &p1, &p2);
-                APair *aPair = aPair_construct(nameArray[p1], nameArray[p2],
-                                               positions[p1], positions[p2]);
-                stSortedSet_insert(pairs, aPair);
+                pairStore_addNamed(pairs, nameArray[p1], positions[p1], nameArray[p2], positions[p2]);
             }
         }
     }
@@ -651,8 +853,9 @@ void samplePairsFromColumnAnalytic(double acceptProbability, stSortedSet *pairs,
     stSet_destruct(set);
     free(randPair);
 }
-void samplePairsFromColumnNaive(char **mat, uint64_t c, bool *legitRows, double acceptProbability,
-                                stSortedSet *pairs,
+void samplePairsFromColumnNaive(RandomStream *random, char **mat, uint64_t c, bool *legitRows,
+                                double acceptProbability,
+                                PairStore *pairs,
                                 uint64_t *chooseTwoArray,
                                 char **nameArray, uint64_t *positions, uint64_t numSeqs,
                                 uint64_t numPairs) {
@@ -670,10 +873,8 @@ void samplePairsFromColumnNaive(char **mat, uint64_t c, bool *legitRows, double
         if ((mat[p1][c] == '-') || (mat[p2][c]) == '-') {
             continue;
         }
-        if (st_random() <= acceptProbability) {
-            APair *aPair = aPair_construct(nameArray[p1], nameArray[p2],
-                                           positions[p1], positions[p2]);
-            stSortedSet_insert(pairs, aPair);
+        if (randomStream_unit(random) <= acceptProbability) {
+            pairStore_addNamed(pairs, nameArray[p1], positions[p1], nameArray[p2], positions[p2]);
         }
     }
 }
@@ -802,11 +1003,15 @@ void validateMafBlockSourceLengths(const char *filename, mafBlock_t *mb, stHash
         ml = maf_mafLine_getNext(ml);
     }
 }
-void walkBlockSamplingPairs(const char *filename, mafBlock_t *mb, stSortedSet *sampledPairs,
-                            double acceptProbability, stSet *legitSequences,
-                            uint64_t *chooseTwoArray, uint64_t *numPairs, stHash *sequenceLengthHash) {
+void walkBlockSamplingPairs(const char *filename, mafBlock_t *mb, PairStore *sampledPairs,
+                            PairSampler *sampler, stSet *legitSequences, uint64_t *chooseTwoArray,
+                            uint64_t *numPairs, stHash *sequenceLengthHash) {
+    // numPairs is the running count of pairs in the maf, and so the index of the block's first
+    // pair. only columns that hold a pair chosen by the sampler are looked at beyond their pair count.
     uint64_t numSeqs = maf_mafBlock_getNumberOfSequences(mb);
     uint64_t numLegitGaplessPositions; // number of legit gapless sequences in the given column
+    uint64_t numColumnPairs;
+    pairSampler_beginBlock(sampler, *numPairs);
     if (numSeqs < 2) {
         return;
     }
@@ -814,36 +1019,49 @@ void walkBlockSamplingPairs(const char *filename, mafBlock_t *mb, stSortedSet *s
 
     uint64_t seqFieldLength = maf_mafBlock_getSequenceFieldLength(mb);
     char **names = maf_mafBlock_getSpeciesArray(mb);
-    char **mat = maf_mafBlock_getSequenceMatrix(mb, numSeqs, seqFieldLength);
     bool *legitRows = getLegitRows(names, numSeqs, legitSequences);
     uint64_t numLegit = sumBoolArray(legitRows, numSeqs);
     if (numLegit < 2) {
+        for (uint64_t i = 0; i < numSeqs; ++i) {
+            free(names[i]);
+        }
+        free(names);
+        free(legitRows);
         return;
     }
+    char **mat = maf_mafBlock_getSequenceMatrix(mb, numSeqs, seqFieldLength);
     mafLine_t **mlArray = maf_mafBlock_getMafLineArray_seqOnly(mb);
     uint64_t *allPositions = maf_mafBlock_getPosCoordStartArray(mb);
     int *allStrandInts = maf_mafBlock_getStrandIntArray(mb);
-    char **gaplessNameArray = NULL;
-    uint64_t *gaplessPositions = NULL;
+    // the valid (legit and non gap) sequences of a column, only filled in for sampled columns
+    char **gaplessNameArray = (char **) st_malloc(sizeof(*gaplessNameArray) * numSeqs);
+    uint64_t *gaplessPositions = (uint64_t *) st_malloc(sizeof(*gaplessPositions) * numSeqs);
     // walk over each column in the block
     for (uint64_t c = 0; c < seqFieldLength; ++c) {
         numLegitGaplessPositions = countLegitGaplessPositions(mat, c, numSeqs, legitRows);
-        // create arrays that contain *only* the valid (legit and non gap) sequences for this column
-        gaplessNameArray = extractLegitGaplessNamesFromMlArrayByColumn(mat, c, mlArray, legitRows,
-                                                                       numSeqs, numLegitGaplessPositions);
-        gaplessPositions = cullPositionsByColumn(mat, c, allPositions, legitRows,
-                                                 numSeqs, numLegitGaplessPositions);
-        samplePairsFromColumn(acceptProbability, sampledPairs, numLegitGaplessPositions, chooseTwoArray,
-                              gaplessNameArray, gaplessPositions);
-        updatePositions(mat, c, allPositions, allStrandInts, numSeqs);
-        // double check:
         if (numLegitGaplessPositions < kChooseTwoCacheLength) {
-            *numPairs += chooseTwoArray[numLegitGaplessPositions];
+            numColumnPairs = chooseTwoArray[numLegitGaplessPositions];
         } else {
-            *numPairs += chooseTwo(numLegitGaplessPositions);
+            numColumnPairs = chooseTwo(numLegitGaplessPositions);
+        }
+        if (pairSampler_isInColumn(sampler, *numPairs, numColumnPairs)) {
+            uint64_t j = 0;
+            for (uint64_t r = 0; r < numSeqs; ++r) {
+                if (legitRows[r] && mat[r][c] != '-') {
+                    // not copies, elements of gaplessNameArray should not be modified
+                    gaplessNameArray[j] = maf_mafLine_getSpecies(mlArray[r]);
+                    gaplessPositions[j++] = allPositions[r];
+                }
+            }
+            samplePairsFromColumnBySkipping(sampler, sampledPairs, numLegitGaplessPositions, *numPairs,
+                                            gaplessNameArray, gaplessPositions);
         }
+        updatePositions(mat, c, allPositions, allStrandInts, numSeqs);
+        *numPairs += numColumnPairs;
     }
     // clean up
+    free(gaplessNameArray);
+    free(gaplessPositions);
     free(mlArray);
     free(allPositions);
     free(allStrandInts);
@@ -854,20 +1072,90 @@ void walkBlockSamplingPairs(const char *filename, mafBlock_t *mb, stSortedSet *s
     maf_mafBlock_destroySequenceMatrix(mat, numSeqs);
     free(legitRows);
 }
-void samplePairsFromMaf(const char *filename, stSortedSet *pairs, double acceptProbability,
+void samplePairsFromMaf(const char *filename, PairStore *pairs, PairSampler *sampler,
                         stSet *legitSequences, uint64_t *numPairs, stHash *sequenceLengthHash) {
     mafFileApi_t *mfa = maf_newMfa(filename, "r");
     mafBlock_t *mb = NULL;
     uint64_t *chooseTwoArray = buildChooseTwoArray();
     while ((mb = maf_readBlock(mfa)) != NULL) {
-        walkBlockSamplingPairs(filename, mb, pairs, acceptProbability, legitSequences, chooseTwoArray,
-                               numPairs, sequenceLengthHash);
+        walkBlockSamplingPairs(filename, mb, pairs, sampler, legitSequences, chooseTwoArray, numPairs,
+                               sequenceLengthHash);
         maf_destroyMafBlockList(mb);
     }
+    pairStore_sort(pairs);
     // clean up
     free(chooseTwoArray);
     maf_destroyMfa(mfa);
 }
+typedef struct _blockSampling {
+    // the blocks of a maf sampled side by side by independent (Bernoulli) samplers, see
+    // pairSampler_beginBlock(). each worker keeps its own sampler, pairs and count.
+    const char *filename;
+    mafBlock_t **blocks;
+    PairSampler *samplers; // [worker]
+    PairStore **pairs; // [worker]
+    uint64_t *numPairs; // [worker]
+    stSet *legitSequences;
+    stHash *sequenceLengthHash;
+    uint64_t *chooseTwoArray;
+} BlockSampling;
+static void sampleBlock(uint64_t i, unsigned worker, void *data) {
+    BlockSampling *bs = (BlockSampling *) data;
+    bs->samplers[worker].block = i;
+    walkBlockSamplingPairs(bs->filename, bs->blocks[i], bs->pairs[worker], bs->samplers + worker,
+                           bs->legitSequences, bs->chooseTwoArray, bs->numPairs + worker, bs->sequenceLengthHash);
+}
+void samplePairsFromBlocks(const char *filename, mafBlock_t *blocks, PairStore *pairs, PairSampler *sampler,
+                           stSet *legitSequences, uint64_t *numPairs, stHash *sequenceLengthHash,
+                           unsigned numThreads) {
+    // as samplePairsFromMaf() for a maf already read into memory, filename is only used in messages.
+    // independent sampling is spread over numThreads workers and gives the same pairs for any number.
+    uint64_t *chooseTwoArray = buildChooseTwoArray();
+    uint64_t numBlocks = 0;
+    for (mafBlock_t *mb = blocks; mb != NULL; mb = maf_mafBlock_getNext(mb)) {
+        ++numBlocks;
+    }
+    unsigned numWorkers = parallel_numberOfWorkers(numThreads, numBlocks);
+    if (sampler->size != 0 || numWorkers < 2) {
+        for (mafBlock_t *mb = blocks; mb != NULL; mb = maf_mafBlock_getNext(mb)) {
+            walkBlockSamplingPairs(filename, mb, pairs, sampler, legitSequences, chooseTwoArray, numPairs,
+                                   sequenceLengthHash);
+        }
+    } else {
+        BlockSampling bs;
+        bs.filename = filename;
+        bs.blocks = (mafBlock_t **) st_malloc(sizeof(*(bs.blocks)) * numBlocks);
+        bs.samplers = (PairSampler *) st_malloc(sizeof(*(bs.samplers)) * numWorkers);
+        bs.pairs = (PairStore **) st_malloc(sizeof(*(bs.pairs)) * numWorkers);
+        bs.numPairs = (uint64_t *) st_calloc(numWorkers, sizeof(*(bs.numPairs)));
+        bs.legitSequences = legitSequences;
+        bs.sequenceLengthHash = sequenceLengthHash;
+        bs.chooseTwoArray = chooseTwoArray;
+        uint64_t i = 0;
+        for (mafBlock_t *mb = blocks; mb != NULL; mb = maf_mafBlock_getNext(mb)) {
+            bs.blocks[i++] = mb;
+        }
+        for (unsigned w = 0; w < numWorkers; ++w) {
+            bs.samplers[w] = *sampler;
+            bs.pairs[w] = (w == 0) ? pairs : pairStore_construct(legitSequences);
+        }
+        parallel_for(numBlocks, numWorkers, sampleBlock, &bs);
+        for (unsigned w = 0; w < numWorkers; ++w) {
+            *numPairs += bs.numPairs[w];
+            if (w > 0) {
+                pairStore_append(pairs, bs.pairs[w]);
+                pairStore_destruct(bs.pairs[w]);
+            }
+        }
+        sampler->block += numBlocks;
+        free(bs.blocks);
+        free(bs.samplers);
+        free(bs.pairs);
+        free(bs.numPairs);
+    }
+    pairStore_sort(pairs);
+    free(chooseTwoArray);
+}
 void countPairs(APair *pair, stHash *intervalsHash, int64_t *counter,
                 stSortedSet *legitPairs, void *a, uint64_t near) {
     /*
@@ -895,18 +1183,42 @@ bool inInterval(stHash *intervalsHash, char *seq, uint64_t pos) {
     /*
      * check to see if the sequence and position are within the intervals hash.
      */
-    stSortedSet *intervals = stHash_search(intervalsHash, seq);
-    if (intervals == NULL) {
-        return false;
+    return intervals_contains(stHash_search(intervalsHash, seq), pos);
+}
+PairIntervals* pairIntervals_construct(PairStore *names, stHash *intervalsHash) {
+    PairIntervals *pi = (PairIntervals *) st_malloc(sizeof(*pi));
+    pi->byId = NULL;
+    pi->id1 = UINT64_MAX;
+    intervals_initCursor(&(pi->cursor1), NULL);
+    if (stHash_size(intervalsHash) == 0) {
+        return pi;
     }
-    stIntTuple *i = stIntTuple_construct2( pos, INT64_MAX);
-    stIntTuple *j = stSortedSet_searchLessThanOrEqual(intervals, i);
-    stIntTuple_destruct(i);
-    if (j == NULL) {
-        return false;
+    pi->byId = (intervals_t **) st_malloc(sizeof(*(pi->byId)) * (names->numNames + 1));
+    for (uint64_t id = 0; id < names->numNames; ++id) {
+        pi->byId[id] = stHash_search(intervalsHash, pairStore_getName(names, id));
+    }
+    return pi;
+}
+void pairIntervals_destruct(PairIntervals *pi) {
+    if (pi == NULL) {
+        return;
     }
-    assert(stIntTuple_length(j) == 2);
-    return stIntTuple_get(j, 0) <= pos && pos < stIntTuple_get(j, 1);
+    free(pi->byId);
+    free(pi);
+}
+void pairIntervals_locate(PairIntervals *pi, uint64_t id1, uint64_t pos1, uint64_t id2, uint64_t pos2,
+                          bool *isInInterval1, bool *isInInterval2) {
+    if (pi->byId == NULL) {
+        *isInInterval1 = false;
+        *isInInterval2 = false;
+        return;
+    }
+    if (id1 != pi->id1) {
+        pi->id1 = id1;
+        intervals_initCursor(&(pi->cursor1), pi->byId[id1]);
+    }
+    *isInInterval1 = intervals_cursorContains(&(pi->cursor1), pos1);
+    *isInInterval2 = intervals_contains(pi->byId[id2], pos2);
 }
 uint64_t findLowerBound(uint64_t pos, uint64_t near) {
     // since we have unsigned values we must be careful about subtracting
@@ -917,80 +1229,16 @@ uint64_t findLowerBound(uint64_t pos, uint64_t near) {
         return pos - near;
     }
 }
-void recordNearPair(APair *thisPair, stSortedSet *sampledPairs, uint64_t near, stSet *positivePairs) {
-    /* given thisPair, if thisPair is in the table `sampledPairs' then record it in the positivePairs set.
-     * if the `near' option is set, do this not only for thisPair but for all pairs within +- `near'.
-     * if near = 0 this will just look at thisPair->pos1 and thisPair->pos2 and record those values.
+void recordNearPair(PairStore *sampledPairs, uint64_t id1, uint64_t pos1, uint64_t id2, uint64_t pos2,
+                    uint64_t near, PairIndexList *positivePairs) {
+    /* given the pair (id1 pos1, id2 pos2), if it is in the store `sampledPairs' then record its index
+     * in positivePairs. if the `near' option is set, do this not only for the pair but for all pairs
+     * within +- `near'. if near = 0 this will just look at pos1 and pos2 and record those values.
      */
-    APair *aPair;
-    uint64_t i = thisPair->pos1;
-    // Try modifying position 1
-    for (thisPair->pos1 = findLowerBound(thisPair->pos1, near); thisPair->pos1 < i + near + 1; thisPair->pos1++) {
-        if ((aPair = stSortedSet_search(sampledPairs, thisPair)) != NULL) {
-            if (strcmp(thisPair->seq1, aPair->seq1) == 0 && strcmp(thisPair->seq2, aPair->seq2) == 0 &&
-                thisPair->pos1 == aPair->pos1 && thisPair->pos2 == aPair->pos2) {
-                // printf("positivePair1: (%s %u, %s %u):(%s %u, %s %u)\n",
-                //        thisPair->seq1, thisPair->pos1, thisPair->seq2, thisPair->pos2,
-                //        aPair->seq1, aPair->pos1, aPair->seq2, aPair->pos2);
-                stSet_insert(positivePairs, aPair);
-            }
-        }
-    }
-    thisPair->pos1 = i; // reset pos 1
+    // Try modifying position 1, a range scan if the store is indexed by pos1
+    pairStore_appendPos1Range(sampledPairs, id1, findLowerBound(pos1, near), pos1 + near, id2, pos2, positivePairs);
     // Try modifying position 2
-    i = thisPair->pos2;
-    for (thisPair->pos2 = findLowerBound(thisPair->pos2, near); thisPair->pos2 < i + near + 1; thisPair->pos2++) {
-        if ((aPair = stSortedSet_search(sampledPairs, thisPair)) != NULL) {
-            if (strcmp(thisPair->seq1, aPair->seq1) == 0 && strcmp(thisPair->seq2, aPair->seq2) == 0 &&
-                thisPair->pos1 == aPair->pos1 && thisPair->pos2 == aPair->pos2) {
-                // printf("positivePair2: (%s %u, %s %u):(%s %u, %s %u)\n",
-                //        thisPair->seq1, thisPair->pos1, thisPair->seq2, thisPair->pos2,
-                //        aPair->seq1, aPair->pos1, aPair->seq2, aPair->pos2);
-                stSet_insert(positivePairs, aPair);
-            }
-        }
-    }
-    thisPair->pos2 = i; // reset pos 2
-}
-stHash* constructPositionHash(char **mat, uint64_t c, char **names, uint64_t numSeqs,
-                              uint64_t *allPositions, bool *legitRows) {
-    stHash *posHash = stHash_construct3(aPositionKey, aPositionEqualKey, aPosition_destruct, free);
-    APosition *pos = NULL;
-    // printf("constructing position hash on col %"PRIu64", numseqs: %"PRIu64"\n", c, numSeqs);
-    for (uint64_t r = 0; r < numSeqs; ++r) {
-        if (!legitRows[r]) {
-            // printf("row %"PRIu64" not legit.\n", r);
-            continue;
-        }
-        if (mat[r][c] == '-') {
-            // printf("row %"PRIu64" col %"PRIu64" is gap.\n", r, c);
-            continue;
-        }
-        pos = aPosition_construct(stString_copy(names[r]), allPositions[r]);
-        if (stHash_search(posHash, pos) == NULL) {
-            // printf("adding position to posHash (%s %u %c)\n", names[r], allPositions[r], mat[r][c]);
-            stHash_insert(posHash, pos, stString_copy(""));
-        } else {
-            aPosition_destruct(pos);
-        }
-    }
-    return posHash;
-}
-bool pairMemberInPositionHash(stHash *positionHash, APair *thisPair) {
-    // we know seq1 and pos1 are in the position hash. what matters is if seq2 and pos2 are in.
-    APosition *p = aPosition_init();
-    p->name = stString_copy(thisPair->seq2);
-    p->pos = thisPair->pos2;
-    // printf("checking to see if pairmemberinpositionhash, (%s %u)... ", p->name, p->pos);
-    if (stHash_search(positionHash, p) != NULL) {
-        // printf("YES :D\n");
-        aPosition_destruct(p);
-        return true;
-    } else {
-        // printf("NO :(\n");
-    }
-    aPosition_destruct(p);
-    return false;
+    pairStore_appendPos2Range(sampledPairs, id1, pos1, id2, findLowerBound(pos2, near), pos2 + near, positivePairs);
 }
 void printSortedSet(stSortedSet *pairs) {
     stSortedSetIterator *sit = NULL;
@@ -1013,69 +1261,104 @@ void printHash(stHash *hash) {
     printf("\n");
     stHash_destructIterator(hit);
 }
-void testHomologyOnColumn(char **mat, uint64_t c, uint64_t numSeqs, bool *legitRows, char **names,
-                          stSortedSet *sampledPairs, stSet *positivePairs, mafLine_t **mlArray,
-                          uint64_t *allPositions, uint64_t near) {
+static int cmpUint64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *) a;
+    uint64_t y = *(const uint64_t *) b;
+    return (x < y) ? -1 : (x > y);
+}
+uint64_t collectColumnPositions(char **mat, uint64_t c, uint64_t numSeqs, bool *legitRows, int64_t *rowNameIds,
+                                uint64_t *allPositions, uint64_t *columnKeys) {
+    // fill columnKeys, of length numSeqs, with the distinct (name id, position)s of the legit
+    // non gap rows of column c packed with pairStore_packPosition(), sorted. returns their number.
+    // rows with no name id, or a position too large to store, can not be part of a sampled pair.
+    uint64_t n = 0;
+    for (uint64_t r = 0; r < numSeqs; ++r) {
+        if (!legitRows[r] || mat[r][c] == '-' || rowNameIds[r] < 0
+            || !pairStore_isStorablePosition(allPositions[r])) {
+            continue;
+        }
+        columnKeys[n++] = pairStore_packPosition((uint64_t) rowNameIds[r], allPositions[r]);
+    }
+    if (n < 2) {
+        return n;
+    }
+    if (n <= 32) {
+        // columns are mostly a handful of rows
+        for (uint64_t i = 1; i < n; ++i) {
+            uint64_t key = columnKeys[i];
+            uint64_t j = i;
+            for (; j > 0 && columnKeys[j - 1] > key; --j) {
+                columnKeys[j] = columnKeys[j - 1];
+            }
+            columnKeys[j] = key;
+        }
+    } else {
+        qsort(columnKeys, n, sizeof(*columnKeys), cmpUint64);
+    }
+    uint64_t m = 1;
+    for (uint64_t i = 1; i < n; ++i) {
+        if (columnKeys[i] != columnKeys[m - 1]) {
+            columnKeys[m++] = columnKeys[i];
+        }
+    }
+    return m;
+}
+static bool columnHasPosition(uint64_t *columnKeys, uint64_t n, uint64_t key) {
+    uint64_t lo = 0, hi = n;
+    while (lo < hi) {
+        uint64_t mid = lo + (hi - lo) / 2;
+        if (columnKeys[mid] < key) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo < n && columnKeys[lo] == key;
+}
+void testHomologyOnColumn(char **mat, uint64_t c, uint64_t numSeqs, bool *legitRows, int64_t *rowNameIds,
+                          PairStore *sampledPairs, PairIndexList *positivePairs, uint64_t *allPositions,
+                          uint64_t *columnKeys, uint64_t near) {
     /* For a given column,
-       1) hash all the positions in the column
-       2) For each position in the hash:
-       ..a) Iterate over pairs involving the position in the sortedSet,
-       .....i) check if other aligned positions are in the hash of step 1.
+       1) collect all the positions in the column, into the scratch array columnKeys
+       2) For each position collected:
+       ..a) Iterate over pairs involving the position in the store,
+       .....i) check if other aligned positions were collected in step 1.
+       rowNameIds holds the store's name id of each row. nothing is allocated.
      */
-    APair *thisPair = NULL;
-    APair *thatPair = NULL;
-    APair *otherPair = NULL;
-    APosition *key = NULL;
-    stHash *positionHash = NULL;
-    stHashIterator *hit = NULL;
-    stSortedSetIterator *sit = NULL;
+    uint64_t n = pairStore_size(sampledPairs);
+    uint64_t id, pos, id1, pos1, id2, pos2;
     // 1.
-    positionHash = constructPositionHash(mat, c, names, numSeqs, allPositions, legitRows);
-    hit = stHash_getIterator(positionHash);
+    uint64_t numKeys = collectColumnPositions(mat, c, numSeqs, legitRows, rowNameIds, allPositions, columnKeys);
+    if (numKeys < 2) {
+        return;
+    }
     // 2.
-    while ((key = stHash_getNext(hit)) != NULL) {
-        assert(thisPair == NULL);
-        thisPair = aPair_init();
-        thisPair->seq1 = stString_copy(key->name);
-        thisPair->pos1 = key->pos;
-        if ((thatPair = stSortedSet_searchGreaterThanOrEqual(sampledPairs, thisPair)) != NULL) {
-            if (strcmp(thisPair->seq1, thatPair->seq1) != 0){
-                aPair_destruct(thisPair);
-                thisPair = NULL;
-                continue;
-            }
-            if (thisPair->pos1 != thatPair->pos1) {
-                aPair_destruct(thisPair);
-                thisPair = NULL;
-                continue;
+    for (uint64_t k = 0; k < numKeys; ++k) {
+        pairStore_unpackPosition(columnKeys[k], &id, &pos);
+        if (!pairStore_isFirstName(sampledPairs, id)) {
+            continue;
+        }
+        uint64_t i = pairStore_lowerBound(sampledPairs, id, pos, 0, 0);
+        if (i == n) {
+            continue;
+        }
+        pairStore_get(sampledPairs, i, &id1, &pos1, &id2, &pos2);
+        if (id1 != id || pos1 != pos) {
+            continue;
+        }
+        // 2a.
+        for (; i < n; ++i) {
+            pairStore_get(sampledPairs, i, &id1, &pos1, &id2, &pos2);
+            if (!closeEnough(pos, pos1, near)) {
+                // bail out on iteration once we've overstepped the range of interest
+                break;
             }
-            sit = stSortedSet_getIteratorFrom(sampledPairs, thatPair);
-            // 2a.
-            while ((otherPair = stSortedSet_getNext(sit)) != NULL) {
-                if ((strcmp(thatPair->seq1, thatPair->seq1) != 0) ||
-                    (!closeEnough(thatPair->pos1, otherPair->pos1, near))) {
-                    // bail out on iteration once we've overstepped the range of interest
-                    aPair_destruct(thisPair);
-                    thisPair = NULL;
-                    break;
-                }
-                thisPair->seq2 = stString_copy(otherPair->seq2);
-                thisPair->pos2 = otherPair->pos2;
-                // 2ai.
-                if (pairMemberInPositionHash(positionHash, thisPair)) {
-                    recordNearPair(thisPair, sampledPairs, near, positivePairs);
-                }
-                free(thisPair->seq2);
-                thisPair->seq2 = NULL;
+            // 2ai.
+            if (columnHasPosition(columnKeys, numKeys, pairStore_packPosition(id2, pos2))) {
+                recordNearPair(sampledPairs, id, pos, id2, pos2, near, positivePairs);
             }
-            stSortedSet_destructIterator(sit);
         }
-        aPair_destruct(thisPair);
-        thisPair = NULL;
     }
-    assert(thisPair == NULL);
-    stHash_destructIterator(hit);
-    stHash_destruct(positionHash);
 }
 void printAllPositions(uint64_t *allPositions, mafBlock_t *mb) {
     printf("allPositions: [");
@@ -1091,7 +1374,7 @@ void printAllStrandInts(int *allStrandInts, mafBlock_t *mb) {
     }
     printf("]\n");
 }
-void walkBlockTestingHomology(mafBlock_t *mb, stSortedSet *sampledPairs, stSet *positivePairs,
+void walkBlockTestingHomology(mafBlock_t *mb, PairStore *sampledPairs, PairIndexList *positivePairs,
                               stSet *legitSequences, uint64_t near) {
     uint64_t numSeqs = maf_mafBlock_getNumberOfSequences(mb);
     if (numSeqs < 2) {
@@ -1099,200 +1382,544 @@ void walkBlockTestingHomology(mafBlock_t *mb, stSortedSet *sampledPairs, stSet *
     }
     uint64_t seqFieldLength = maf_mafBlock_getSequenceFieldLength(mb);
     char **names = maf_mafBlock_getSpeciesArray(mb);
-    char **mat = maf_mafBlock_getSequenceMatrix(mb, numSeqs, seqFieldLength);
     bool *legitRows = getLegitRows(names, numSeqs, legitSequences);
-    uint64_t numLegit = sumBoolArray(legitRows, numSeqs);
-    if (numLegit < 2) {
-        return;
-    }
-    mafLine_t **mlArray = createMafLineArray(mb, numLegit, legitRows);
-    uint64_t *allPositions = maf_mafBlock_getPosCoordStartArray(mb);
-    int *allStrandInts = maf_mafBlock_getStrandIntArray(mb);
-    for (uint64_t c = 0; c < seqFieldLength; ++c) {
-        testHomologyOnColumn(mat, c, numSeqs, legitRows, names, sampledPairs, positivePairs,
-                             mlArray, allPositions, near);
-        updatePositions(mat, c, allPositions, allStrandInts, numSeqs);
+    // look the names up once per block, columns then only deal in packed keys. a block
+    // without the first name of some record, e.g. one of a --shard's sequences, is passed over.
+    int64_t *rowNameIds = st_malloc(sizeof(*rowNameIds) * numSeqs);
+    bool hasFirstName = false;
+    for (uint64_t i = 0; i < numSeqs; ++i) {
+        rowNameIds[i] = legitRows[i] ? pairStore_getNameId(sampledPairs, names[i]) : -1;
+        hasFirstName = hasFirstName || (rowNameIds[i] >= 0
+                                        && pairStore_isFirstName(sampledPairs, (uint64_t) rowNameIds[i]));
+    }
+    if (hasFirstName && sumBoolArray(legitRows, numSeqs) >= 2) {
+        char **mat = maf_mafBlock_getSequenceMatrix(mb, numSeqs, seqFieldLength);
+        uint64_t *columnKeys = st_malloc(sizeof(*columnKeys) * numSeqs);
+        uint64_t *allPositions = maf_mafBlock_getPosCoordStartArray(mb);
+        int *allStrandInts = maf_mafBlock_getStrandIntArray(mb);
+        for (uint64_t c = 0; c < seqFieldLength; ++c) {
+            testHomologyOnColumn(mat, c, numSeqs, legitRows, rowNameIds, sampledPairs, positivePairs,
+                                 allPositions, columnKeys, near);
+            updatePositions(mat, c, allPositions, allStrandInts, numSeqs);
+        }
+        free(allPositions);
+        free(allStrandInts);
+        free(columnKeys);
+        maf_mafBlock_destroySequenceMatrix(mat, numSeqs);
     }
     // clean up
-    free(mlArray);
-    free(allPositions);
-    free(allStrandInts);
     for (uint64_t i = 0; i < numSeqs; ++i) {
          free(names[i]);
     }
     free(names);
-    maf_mafBlock_destroySequenceMatrix(mat, numSeqs);
+    free(rowNameIds);
     free(legitRows);
 }
-void performHomologyTests(const char *filename, stSortedSet *sampledPairs, stSet *positivePairs,
-                          stSet *legitSequences, uint64_t near) {
-    mafFileApi_t *mfa = maf_newMfa(filename, "r");
+typedef struct homologyBatch {
+    mafBlock_t **blocks;
+    bool ownsBlocks; // blocks read from a file are destroyed once tested
+    PairStore *sampledPairs; // read only while the batch runs
+    PairIndexList **workerPositivePairs;
+    stSet *legitSequences;
+    uint64_t near;
+} HomologyBatch;
+static void testHomologyOnBatchBlock(uint64_t i, unsigned worker, void *data) {
+    HomologyBatch *hb = (HomologyBatch *) data;
+    walkBlockTestingHomology(hb->blocks[i], hb->sampledPairs, hb->workerPositivePairs[worker],
+                             hb->legitSequences, hb->near);
+    if (hb->ownsBlocks) {
+        maf_destroyMafBlockList(hb->blocks[i]);
+    }
+}
+void markPositivePairs(PairIndexList *list, bool *positivePairs) {
+    // set the flag of every pair index in list and empty it
+    for (uint64_t i = 0; i < list->length; ++i) {
+        positivePairs[list->indices[i]] = true;
+    }
+    list->length = 0;
+}
+static mafBlock_t* takeBlock(mafFileApi_t *mfa, mafBlock_t **next) {
+    // the next block read from mfa or, when mfa is NULL, the next block of an in memory maf
+    if (mfa != NULL) {
+        return maf_readBlock(mfa);
+    }
+    mafBlock_t *mb = *next;
+    if (mb != NULL) {
+        *next = maf_mafBlock_getNext(mb);
+    }
+    return mb;
+}
+static uint64_t takeBatch(mafFileApi_t *mfa, mafBlock_t **next, mafBlock_t **batch, uint64_t batchLength) {
+    // fill batch with up to batchLength blocks, returns the number taken
+    uint64_t n = 0;
     mafBlock_t *mb = NULL;
-    while ((mb = maf_readBlock(mfa)) != NULL) {
-        walkBlockTestingHomology(mb, sampledPairs, positivePairs, legitSequences, near);
-        maf_destroyMafBlockList(mb);
+    while (n < batchLength && (mb = takeBlock(mfa, next)) != NULL) {
+        batch[n++] = mb;
+    }
+    return n;
+}
+static void testHomologyOnBlocks(mafFileApi_t *mfa, mafBlock_t *blocks, PairStore *sampledPairs,
+                                 bool *positivePairs, stSet *legitSequences, uint64_t near,
+                                 unsigned numThreads) {
+    // positivePairs has one flag per pair in the sorted store sampledPairs and the flags
+    // of the pairs found in the maf are set. blocks are taken on this thread and handed
+    // out in batches to a pool of up to numThreads workers, 0 meaning one per processor,
+    // and the next batch is read while the workers test the last one. every worker records
+    // the indices of the pairs it finds in a list of its own and the lists are folded into
+    // the flags at the end, so the result does not depend on the schedule.
+    if (near > 0) {
+        pairStore_indexByPos1(sampledPairs);
+    }
+    unsigned numWorkers = parallel_numberOfWorkers(numThreads, UINT64_MAX);
+    uint64_t batchLength = kHomologyBatchBlocksPerWorker * numWorkers;
+    PairIndexList **found = (PairIndexList **) st_malloc(sizeof(*found) * numWorkers);
+    for (unsigned w = 0; w < numWorkers; ++w) {
+        found[w] = pairIndexList_construct();
+    }
+    HomologyBatch hb[2];
+    for (unsigned b = 0; b < 2; ++b) {
+        hb[b].blocks = (mafBlock_t **) st_malloc(sizeof(*(hb[b].blocks)) * batchLength);
+        hb[b].ownsBlocks = (mfa != NULL);
+        hb[b].sampledPairs = sampledPairs;
+        hb[b].workerPositivePairs = found;
+        hb[b].legitSequences = legitSequences;
+        hb[b].near = near;
+    }
+    parallelPool_t *pool = parallel_startPool(numWorkers);
+    unsigned b = 0;
+    uint64_t n = takeBatch(mfa, &blocks, hb[b].blocks, batchLength);
+    while (n > 0) {
+        parallel_start(pool, n, testHomologyOnBatchBlock, &hb[b]);
+        b = !b;
+        n = (n == batchLength) ? takeBatch(mfa, &blocks, hb[b].blocks, batchLength) : 0;
+        parallel_wait(pool);
+    }
+    parallel_finishPool(pool);
+    for (unsigned w = 0; w < numWorkers; ++w) {
+        markPositivePairs(found[w], positivePairs);
+        pairIndexList_destruct(found[w]);
     }
     // clean up
+    free(found);
+    free(hb[0].blocks);
+    free(hb[1].blocks);
+}
+void performHomologyTests(const char *filename, PairStore *sampledPairs, bool *positivePairs,
+                          stSet *legitSequences, uint64_t near, unsigned numThreads) {
+    mafFileApi_t *mfa = maf_newMfa(filename, "r");
+    testHomologyOnBlocks(mfa, NULL, sampledPairs, positivePairs, legitSequences, near, numThreads);
     maf_destroyMfa(mfa);
 }
-void homologyTests1(APair *thisPair, stHash *intervalsHash, stSortedSet *pairs,
-                    stSet *positivePairs, stSet *legitPairs, int64_t near) {
+void performHomologyTestsOnBlocks(mafBlock_t *blocks, PairStore *sampledPairs, bool *positivePairs,
+                                  stSet *legitSequences, uint64_t near, unsigned numThreads) {
+    // as performHomologyTests() for a maf already read into memory with maf_readAll()
+    testHomologyOnBlocks(NULL, blocks, sampledPairs, positivePairs, legitSequences, near, numThreads);
+}
+void homologyTests1(APair *thisPair, stHash *intervalsHash, PairStore *pairs,
+                    PairIndexList *positivePairs, stSet *legitPairs, int64_t near) {
     /*
      * If both members of *thisPair are in the intersection of maf1 and maf2,
-     * and *thisPair is in the set *pairs then adds to the result pair a positive result.
+     * and *thisPair is in the store *pairs then adds to the result pair a positive result.
      */
     if ((stSet_search(legitPairs, thisPair->seq1) != NULL)
         && (stSet_search(legitPairs, thisPair->seq2) != NULL)) {
-        recordNearPair(thisPair, pairs, near, positivePairs);
+        int64_t id1 = pairStore_getNameId(pairs, thisPair->seq1);
+        int64_t id2 = pairStore_getNameId(pairs, thisPair->seq2);
+        if (id1 >= 0 && id2 >= 0) {
+            recordNearPair(pairs, id1, thisPair->pos1, id2, thisPair->pos2, near, positivePairs);
+        }
     }
 }
-bool positionIsInWiggleRegion(WiggleContainer *wc, uint64_t *refPos) {
+bool positionIsInWiggleRegion(WiggleContainer *wc, uint64_t refPos) {
     // verify that refPos, a positive coordinate, is within the wiggle
     // container's region of interest
     if (wc == NULL) {
         return false;
     }
-    if (refPos == NULL) {
-        return false;
+    return wc->refStart <= refPos && refPos - wc->refStart < wc->refLength;
+}
+ResultPair* getResultPair(stSortedSet *resultPairs, const char *seq1, const char *seq2) {
+    // the ResultPair of the sequence pair, added to resultPairs if it is not there yet
+    APair pair;
+    pair.seq1 = (char *) seq1;
+    pair.seq2 = (char *) seq2;
+    ResultPair *resultPair = stSortedSet_search(resultPairs, &pair);
+    if (resultPair == NULL) {
+        // the stSortedSet resultPairs is searched only based on sequence names.
+        resultPair = resultPair_construct(seq1, seq2);
+        stSortedSet_insert(resultPairs, resultPair);
     }
-    if (*refPos < wc->refStart) {
-        return false;
+    return resultPair;
+}
+PairWiggles* pairWiggles_construct(PairStore *names, stHash *wigglePairHash) {
+    PairWiggles *pw = (PairWiggles *) st_malloc(sizeof(*pw));
+    pw->indexById = NULL;
+    pw->numIndexed = 0;
+    pw->table = NULL;
+    if (stHash_size(wigglePairHash) == 0) {
+        return pw;
+    }
+    pw->indexById = (int64_t *) st_malloc(sizeof(*(pw->indexById)) * (names->numNames + 1));
+    for (uint64_t id = 0; id < names->numNames; ++id) {
+        pw->indexById[id] = -1;
+    }
+    stList *wiggles = stHash_getValues(wigglePairHash);
+    for (int64_t i = 0; i < stList_length(wiggles); ++i) {
+        WiggleContainer *wc = stList_get(wiggles, i);
+        int64_t idRef = pairStore_getNameId(names, wc->ref);
+        int64_t idPartner = pairStore_getNameId(names, wc->partner);
+        if (idRef < 0 || idPartner < 0) {
+            continue;
+        }
+        if (pw->indexById[idRef] < 0) {
+            pw->indexById[idRef] = pw->numIndexed++;
+        }
+        if (pw->indexById[idPartner] < 0) {
+            pw->indexById[idPartner] = pw->numIndexed++;
+        }
     }
-    if (*refPos > wc->refStart + wc->refLength) {
-        return false;
+    pw->table = (WiggleContainer **) st_calloc(pw->numIndexed * pw->numIndexed + 1, sizeof(*(pw->table)));
+    for (int64_t i = 0; i < stList_length(wiggles); ++i) {
+        WiggleContainer *wc = stList_get(wiggles, i);
+        int64_t idRef = pairStore_getNameId(names, wc->ref);
+        int64_t idPartner = pairStore_getNameId(names, wc->partner);
+        if (idRef >= 0 && idPartner >= 0) {
+            pw->table[pw->indexById[idRef] * pw->numIndexed + pw->indexById[idPartner]] = wc;
+        }
     }
-    return true;
+    stList_destruct(wiggles);
+    return pw;
 }
-void enumerateHomologyResults(stSortedSet *sampledPairs, stSortedSet *resultPairs, stHash *intervalsHash,
-                              stSet *positivePairs, stHash *wigglePairHash, bool isAtoB,
-                              uint64_t wiggleBinLength) {
-    /*
-     * For every pair in 'sampledPairs', add 1 to the total number of homology tests for the sequence-pair
-     * (the ResultPair).
-     */
-    static stSortedSetIterator *sit;
-    sit = stSortedSet_getIterator(sampledPairs);
-    APair *pair = NULL;
-    ResultPair *thisResultPair = NULL;
-    WiggleContainer *wc = NULL;
-    uint64_t *refPos = NULL;
-    uint64_t localPos = 0; // local offset within the region of interest (0 is wc->refStart)
-    char wigKey[kMaxStringLength];
-    wigKey[0] = '\0';
-    while ((pair = stSortedSet_getNext(sit)) != NULL) {
-        if ((thisResultPair = stSortedSet_search(resultPairs, pair)) == NULL) {
-            // the stSortedSet resultPairs is searched only based on sequence names.
-            thisResultPair = resultPair_construct(pair->seq1, pair->seq2);
-            stSortedSet_insert(resultPairs, thisResultPair);
-        }
-        sprintf(wigKey, "%s-%s", pair->seq1, pair->seq2);
-        if ((wc = stHash_search(wigglePairHash, wigKey)) == NULL) {
-            // seq1 is not the ref
-            sprintf(wigKey, "%s-%s", pair->seq2, pair->seq1);
-            if ((wc = stHash_search(wigglePairHash, wigKey)) == NULL) {
-                // seq2 is also not the ref
-                wigKey[0] = '\0';
-            } else {
-                refPos = buildUInt64(pair->pos2);
+void pairWiggles_destruct(PairWiggles *pw) {
+    if (pw == NULL) {
+        return;
+    }
+    free(pw->indexById);
+    free(pw->table);
+    free(pw);
+}
+WiggleContainer* pairWiggles_get(PairWiggles *pw, uint64_t id1, uint64_t id2, bool *isSeq1Ref) {
+    // the wiggle container of the pair of names, with either one as the reference, or NULL. a
+    // container with id1 as the reference is preferred.
+    *isSeq1Ref = false;
+    if (pw->indexById == NULL || pw->indexById[id1] < 0 || pw->indexById[id2] < 0) {
+        return NULL;
+    }
+    uint64_t i1 = pw->indexById[id1];
+    uint64_t i2 = pw->indexById[id2];
+    WiggleContainer *wc = pw->table[i1 * pw->numIndexed + i2];
+    if (wc != NULL) {
+        *isSeq1Ref = true;
+        return wc;
+    }
+    return pw->table[i2 * pw->numIndexed + i1];
+}
+void tallyHomologyResult(ResultPair *resultPair, WiggleContainer *wc, uint64_t refPos, bool isInInterval1,
+                         bool isInInterval2, APair *pair, bool foundPair, bool isAtoB, uint64_t wiggleBinLength) {
+    // count one homology test of pair, positive or not, in its ResultPair and, if refPos (its
+    // position on the reference of wc, which may be NULL) is in the region of interest, in the
+    // wiggle container wc. isInInterval1 and 2 say whether each position of pair is in the
+    // --bedFiles intervals.
+    if (isInInterval1) {
+        if (isInInterval2) {
+            ++(resultPair->totalBoth);
+            if (foundPair) {
+                ++(resultPair->inBoth);
             }
         } else {
-            refPos = buildUInt64(pair->pos1);
-        }
-        bool foundPair = stSet_search(positivePairs, pair) != NULL;
-        if (inInterval(intervalsHash, pair->seq1, pair->pos1)) {
-            if (inInterval(intervalsHash, pair->seq2, pair->pos2)) {
-                ++(thisResultPair->totalBoth);
-                if (foundPair) {
-                    ++(thisResultPair->inBoth);
-                }
-            } else {
-                ++(thisResultPair->totalA);
-                if (foundPair) {
-                    ++(thisResultPair->inA);
-                }
+            ++(resultPair->totalA);
+            if (foundPair) {
+                ++(resultPair->inA);
+            }
+        }
+    } else {
+        if (isInInterval2) {
+            ++(resultPair->totalB);
+            if (foundPair) {
+                ++(resultPair->inB);
             }
         } else {
-            if (inInterval(intervalsHash, pair->seq2, pair->pos2)) {
-                ++(thisResultPair->totalB);
-                if (foundPair) {
-                    ++(thisResultPair->inB);
-                }
-            } else {
-                ++(thisResultPair->totalNeither);
-                if (foundPair) {
-                    ++(thisResultPair->inNeither);
-                }
+            ++(resultPair->totalNeither);
+            if (foundPair) {
+                ++(resultPair->inNeither);
             }
         }
+    }
 
-        ++(thisResultPair->total);
-        // put results in wiggle pairs
-        if (positionIsInWiggleRegion(wc, refPos)) {
-            localPos = *refPos - wc->refStart;
-            if (isAtoB) {
-                ++(wc->absentAtoB[(int)floor(localPos / wiggleBinLength)]);
-            } else {
-                ++(wc->absentBtoA[(int)floor(localPos / wiggleBinLength)]);
-            }
-        }
+    ++(resultPair->total);
+    // put results in wiggle pairs, the bin is the local offset within the region of interest
+    // (0 is wc->refStart) over the bin length
+    if (positionIsInWiggleRegion(wc, refPos)) {
+        uint64_t bin = (refPos - wc->refStart) / wiggleBinLength;
         if (foundPair) {
-            ++(thisResultPair->inAll);
-            if (positionIsInWiggleRegion(wc, refPos)) {
-                localPos = *refPos - wc->refStart;
-                if (isAtoB) {
-                    --(wc->absentAtoB[(int)floor(localPos / wiggleBinLength)]);
-                    ++(wc->presentAtoB[(int)floor(localPos / wiggleBinLength)]);
-                } else {
-                    --(wc->absentBtoA[(int)floor(localPos / wiggleBinLength)]);
-                    ++(wc->presentBtoA[(int)floor(localPos / wiggleBinLength)]);
-                }
-            }
+            ++((isAtoB ? wc->presentAtoB : wc->presentBtoA)[bin]);
         } else {
-           if (g_isVerboseFailures){
-              fprintf(stderr, "sampled pair not present in comparison: (%s, %" PRIu64 "):(%s, %" PRIu64 ")\n",
-                      pair->seq1, pair->pos1, pair->seq2, pair->pos2);
-           }
+            ++((isAtoB ? wc->absentAtoB : wc->absentBtoA)[bin]);
         }
-        if (refPos != NULL) {
-            free(refPos);
-            refPos = NULL;
+    }
+    if (foundPair) {
+        ++(resultPair->inAll);
+    } else {
+       if (g_isVerboseFailures){
+          fprintf(stderr, "sampled pair not present in comparison: (%s, %" PRIu64 "):(%s, %" PRIu64 ")\n",
+                  pair->seq1, pair->pos1, pair->seq2, pair->pos2);
+       }
+    }
+}
+void enumerateHomologyResults(PairStore *sampledPairs, stSortedSet *resultPairs, stHash *intervalsHash,
+                              bool *positivePairs, stHash *wigglePairHash, bool isAtoB,
+                              uint64_t wiggleBinLength) {
+    /*
+     * For every pair in 'sampledPairs', add 1 to the total number of homology tests for the sequence-pair
+     * (the ResultPair).
+     */
+    APair aPair;
+    APair *pair = &aPair;
+    uint64_t id1, id2;
+    WiggleContainer *wc = NULL;
+    bool isSeq1Ref, isInInterval1, isInInterval2;
+    PairIntervals *intervals = pairIntervals_construct(sampledPairs, intervalsHash);
+    PairWiggles *wiggles = pairWiggles_construct(sampledPairs, wigglePairHash);
+    for (uint64_t i = 0; i < pairStore_size(sampledPairs); ++i) {
+        pairStore_get(sampledPairs, i, &id1, &(pair->pos1), &id2, &(pair->pos2));
+        pair->seq1 = pairStore_getName(sampledPairs, id1);
+        pair->seq2 = pairStore_getName(sampledPairs, id2);
+        wc = pairWiggles_get(wiggles, id1, id2, &isSeq1Ref);
+        pairIntervals_locate(intervals, id1, pair->pos1, id2, pair->pos2, &isInInterval1, &isInInterval2);
+        tallyHomologyResult(getResultPair(resultPairs, pair->seq1, pair->seq2), wc,
+                            isSeq1Ref ? pair->pos1 : pair->pos2,
+                            isInInterval1, isInInterval2, pair, positivePairs[i], isAtoB, wiggleBinLength);
+    }
+    pairWiggles_destruct(wiggles);
+    pairIntervals_destruct(intervals);
+}
+bool lookUpNumberOfPairs(const char *mafFileA, mafBlock_t *blocksA, uint64_t *numberOfPairs,
+                         stSet *legitSequences, Options *options) {
+    // fills in *numberOfPairs, if it is not already set via the command line, from the pair count
+    // cache or, as only the Bernoulli sampler needs it ahead of sampling, by counting. blocksA is
+    // NULL when mafFileA is streamed. returns true if the value came from the cache.
+    if (*numberOfPairs != 0) {
+        return false;
+    }
+    if (options->isPairCountCached && pairCount_readCache(mafFileA, legitSequences, numberOfPairs)) {
+        return true;
+    }
+    if (!options->isReservoirSampling) {
+        profileSpan_t span = profile_begin("countPairsInMaf");
+        if (blocksA == NULL) {
+            *numberOfPairs = countPairsInMaf(mafFileA, legitSequences, options->numThreads);
+        } else {
+            *numberOfPairs = countPairsInBlocks(blocksA, legitSequences);
+        }
+        profile_end(span);
+        if (options->isPairCountCached) {
+            pairCount_writeCache(mafFileA, legitSequences, *numberOfPairs);
         }
     }
-    stSortedSet_destructIterator(sit);
+    return false;
+}
+void checkNumberOfPairs(const char *mafFileA, uint64_t *numberOfPairs, uint64_t verifiedNumberOfPairs,
+                        bool isCached, stSet *legitSequences, Options *options) {
+    // exits if the count made while sampling mafFileA disagrees with *numberOfPairs, when that is
+    // already known, and sets *numberOfPairs (and the pair count cache) from it otherwise.
+    if (*numberOfPairs != 0 && verifiedNumberOfPairs != *numberOfPairs) {
+        if (isCached) {
+            char *path = pairCount_getCachePath(mafFileA);
+            fprintf(stderr, "Error, %s holds %" PRIu64 " pairs but %s has %" PRIu64 ", remove %s and rerun\n",
+                    path, *numberOfPairs, mafFileA, verifiedNumberOfPairs, path);
+            free(path);
+        } else {
+            fprintf(stderr, "Error, differing numberOfPairs values, %"PRIu64" != %"PRIu64"\n",
+                    verifiedNumberOfPairs, *numberOfPairs);
+        }
+        exit(EXIT_FAILURE);
+    }
+    if (*numberOfPairs == 0 && options->isPairCountCached) {
+        pairCount_writeCache(mafFileA, legitSequences, verifiedNumberOfPairs);
+    }
+    *numberOfPairs = verifiedNumberOfPairs;
+}
+uint64_t comparisonSeed(Options *options, bool isAtoB) {
+    // the seed of the sample taken from maf1 (isAtoB) or maf2, the two samples never share random numbers
+    return isAtoB ? options->randomSeed : options->randomSeed ^ kMaf2SeedMask;
+}
+PairStore* samplePairsForComparison(const char *mafFileA, mafBlock_t *blocksA, uint64_t *numberOfPairs,
+                                    bool isCached, stSet *legitSequences, Options *options,
+                                    uint64_t seed, stHash *sequenceLengthHash) {
+    // the sorted sample of pairs from mafFileA (blocksA if not NULL) to test on the other maf, NULL
+    // if mafFileA has no pairs. *numberOfPairs is checked against the count made while sampling
+    // if it is already known and set from it otherwise. seed is comparisonSeed().
+    if (!options->isReservoirSampling && *numberOfPairs == 0) {
+        return NULL;
+    }
+    PairSampler sampler;
+    if (options->isReservoirSampling) {
+        pairSampler_initReservoir(&sampler, options->numberOfSamples, seed);
+    } else {
+        pairSampler_initBernoulli(&sampler, ((double) options->numberOfSamples) / (double) *numberOfPairs, seed);
+    }
+    PairStore *pairs = pairStore_construct(legitSequences);
+    uint64_t verifiedNumberOfPairs = 0;
+    profileSpan_t span;
+    if (blocksA == NULL) {
+        span = profile_begin("samplePairsFromMaf");
+        samplePairsFromMaf(mafFileA, pairs, &sampler, legitSequences, &verifiedNumberOfPairs,
+                           sequenceLengthHash);
+    } else {
+        span = profile_begin("samplePairsFromBlocks");
+        samplePairsFromBlocks(mafFileA, blocksA, pairs, &sampler, legitSequences,
+                              &verifiedNumberOfPairs, sequenceLengthHash, options->numThreads);
+    }
+    profile_end(span);
+    checkNumberOfPairs(mafFileA, numberOfPairs, verifiedNumberOfPairs, isCached, legitSequences, options);
+    if (options->shardSequences != NULL) {
+        // the whole maf is sampled, so the sample does not depend on the sharding, and the pairs
+        // of other shards dropped
+        pairStore_retainFirstNames(pairs, options->shardSequences);
+    }
+    if (pairStore_size(pairs) == 0) {
+        pairStore_destruct(pairs);
+        return NULL;
+    }
+    return pairs;
 }
 stSortedSet *compareMAFs_AB(const char *mafFileA, const char *mafFileB, uint64_t *numberOfPairs,
                             stSet *legitSequences, stHash *intervalsHash, stHash *wigglePairHash,
                             bool isAtoB, Options *options, stHash *sequenceLengthHash) {
-    // count the number of pairs in mafFileA
-    if (*numberOfPairs == 0) {
-        // can be manually set via the command line
-        *numberOfPairs = countPairsInMaf(mafFileA, legitSequences);
-    }
-    if (*numberOfPairs == 0) {
-        return stSortedSet_construct3((int(*)(const void *, const void *)) aPair_cmpFunction_seqsOnly, (void(*)(void *)) aPair_destruct);
-    }
-    double acceptProbability = ((double) options->numberOfSamples) / (double) *numberOfPairs;
-    stSortedSet *pairs = stSortedSet_construct3((int(*)(const void *, const void *)) aPair_cmpFunction, (void(*)(void *)) aPair_destruct);
     // sample pairs from mafFileA
-    uint64_t verifiedNumberOfPairs = 0;
-    samplePairsFromMaf(mafFileA, pairs, acceptProbability, legitSequences, &verifiedNumberOfPairs,
-                       sequenceLengthHash);
-    if (verifiedNumberOfPairs != *numberOfPairs) {
-        fprintf(stderr, "Error, differing numberOfPairs values, %"PRIu64" != %"PRIu64"\n",
-                verifiedNumberOfPairs, *numberOfPairs);
-        exit(EXIT_FAILURE);
+    bool isCached = lookUpNumberOfPairs(mafFileA, NULL, numberOfPairs, legitSequences, options);
+    PairStore *pairs = samplePairsForComparison(mafFileA, NULL, numberOfPairs, isCached, legitSequences,
+                                                options, comparisonSeed(options, isAtoB), sequenceLengthHash);
+    if (pairs == NULL) {
+        return stSortedSet_construct3((int(*)(const void *, const void *)) aPair_cmpFunction_seqsOnly, (void(*)(void *)) aPair_destruct);
     }
     // perform homology tests on mafFileB using sampled pairs from mafFileA
-    stSet *positivePairs = stSet_construct(); // comparison by pointer
-    performHomologyTests(mafFileB, pairs, positivePairs, legitSequences, options->near);
+    bool *positivePairs = (bool *) st_calloc(pairStore_size(pairs) + 1, sizeof(*positivePairs));
+    profileSpan_t span = profile_begin("performHomologyTests");
+    performHomologyTests(mafFileB, pairs, positivePairs, legitSequences, options->near, options->numThreads);
+    profile_end(span);
     stSortedSet *resultPairs = stSortedSet_construct3((int(*)(const void *, const void *)) aPair_cmpFunction_seqsOnly, (void(*)(void *)) aPair_destruct);
+    span = profile_begin("enumerateHomologyResults");
     enumerateHomologyResults(pairs, resultPairs, intervalsHash, positivePairs, wigglePairHash, isAtoB,
                              options->wiggleBinLength);
+    profile_end(span);
     // clean up
-    stSortedSet_destruct(pairs);
-    stSet_destruct(positivePairs);
+    pairStore_destruct(pairs);
+    free(positivePairs);
     return resultPairs;
 }
+typedef struct _mafInMemory {
+    const char *filename;
+    mafBlock_t *blocks;
+} MafInMemory;
+static void readMafIntoMemory(uint64_t i, unsigned worker, void *data) {
+    MafInMemory *m = ((MafInMemory *) data) + i;
+    mafFileApi_t *mfa = maf_newMfa(m->filename, "r");
+    m->blocks = maf_readAll(mfa);
+    maf_destroyMfa(mfa);
+}
+void readMafsConcurrently(const char *mafFile1, const char *mafFile2, mafBlock_t **blocks1, mafBlock_t **blocks2) {
+    // parse both mafs into memory at the same time, one thread each
+    MafInMemory mafs[2] = {{mafFile1, NULL}, {mafFile2, NULL}};
+    profileSpan_t span = profile_begin("readMafsConcurrently");
+    parallel_for(2, 2, readMafIntoMemory, mafs);
+    profile_end(span);
+    *blocks1 = mafs[0].blocks;
+    *blocks2 = mafs[1].blocks;
+}
+typedef struct _comparisonDirection {
+    // one of the two comparisons run by compareMAFsConcurrently(), sampling from A testing on B
+    const char *mafFileA;
+    const char *mafFileB;
+    mafBlock_t *blocksA;
+    mafBlock_t *blocksB;
+    uint64_t *numberOfPairs;
+    bool isCached; // *numberOfPairs came from the pair count cache
+    bool isAtoB;
+    PairStore *pairs; // NULL when there is nothing to sample
+    bool *positivePairs;
+    stSet *legitSequences; // only ever read
+    Options *options; // only ever read
+    uint64_t near;
+    unsigned numThreads;
+} ComparisonDirection;
+static void countDirectionPairs(uint64_t i, unsigned worker, void *data) {
+    ComparisonDirection *d = ((ComparisonDirection *) data) + i;
+    d->isCached = lookUpNumberOfPairs(d->mafFileA, d->blocksA, d->numberOfPairs, d->legitSequences, d->options);
+}
+static void testDirectionHomology(uint64_t i, unsigned worker, void *data) {
+    ComparisonDirection *d = ((ComparisonDirection *) data) + i;
+    if (d->pairs != NULL) {
+        performHomologyTestsOnBlocks(d->blocksB, d->pairs, d->positivePairs, d->legitSequences,
+                                     d->near, d->numThreads);
+    }
+}
+void compareMAFsConcurrently(mafBlock_t *blocks1, mafBlock_t *blocks2, stSet *legitSequences,
+                             stHash *intervalsHash, stHash *wigglePairHash, Options *options,
+                             stHash *sequenceLengthHash, stSortedSet **results_12, stSortedSet **results_21) {
+    /* The maf1 -> maf2 and maf2 -> maf1 comparisons of compareMAFs_AB() on two mafs read into
+     * memory with readMafsConcurrently(), so each file is parsed once rather than once per pass.
+     * Pair counting (only needed by --bernoulli) and homology testing run for both directions at
+     * once, each direction with half of the --threads workers. Sampling is keyed by comparisonSeed()
+     * and the block, see pairSampler_beginBlock(), so the results are the same as two
+     * compareMAFs_AB() calls.
+     */
+    unsigned numWorkers = parallel_numberOfWorkers(options->numThreads, UINT64_MAX);
+    ComparisonDirection d[2];
+    d[0].mafFileA = options->mafFile1;
+    d[0].mafFileB = options->mafFile2;
+    d[0].blocksA = blocks1;
+    d[0].blocksB = blocks2;
+    d[0].numberOfPairs = &(options->numPairs1);
+    d[0].isAtoB = true;
+    d[1].mafFileA = options->mafFile2;
+    d[1].mafFileB = options->mafFile1;
+    d[1].blocksA = blocks2;
+    d[1].blocksB = blocks1;
+    d[1].numberOfPairs = &(options->numPairs2);
+    d[1].isAtoB = false;
+    for (unsigned i = 0; i < 2; ++i) {
+        d[i].pairs = NULL;
+        d[i].positivePairs = NULL;
+        d[i].legitSequences = legitSequences;
+        d[i].options = options;
+        d[i].near = options->near;
+        d[i].numThreads = (numWorkers > 1) ? numWorkers / 2 : 1;
+    }
+    profileSpan_t span = profile_begin("lookUpNumberOfPairs");
+    parallel_for(2, 2, countDirectionPairs, d);
+    profile_end(span);
+    for (unsigned i = 0; i < 2; ++i) {
+        d[i].pairs = samplePairsForComparison(d[i].mafFileA, d[i].blocksA, d[i].numberOfPairs, d[i].isCached,
+                                              legitSequences, options, comparisonSeed(options, d[i].isAtoB),
+                                              sequenceLengthHash);
+        if (d[i].pairs == NULL) {
+            continue;
+        }
+        d[i].positivePairs = (bool *) st_calloc(pairStore_size(d[i].pairs) + 1, sizeof(*(d[i].positivePairs)));
+    }
+    span = profile_begin("performHomologyTestsOnBlocks");
+    parallel_for(2, 2, testDirectionHomology, d);
+    profile_end(span);
+    stSortedSet **results[2] = {results_12, results_21};
+    for (unsigned i = 0; i < 2; ++i) {
+        *(results[i]) = stSortedSet_construct3((int(*)(const void *, const void *)) aPair_cmpFunction_seqsOnly,
+                                               (void(*)(void *)) aPair_destruct);
+        if (d[i].pairs == NULL) {
+            continue;
+        }
+        if (g_isVerboseFailures) {
+            fprintf(stderr, "# Sampling from %s, comparing to %s\n", d[i].mafFileA, d[i].mafFileB);
+            fprintf(stderr, "# seq1\tabsPos1\torigPos1\tseq2\tabsPos2\torigPos2\n");
+        }
+        span = profile_begin("enumerateHomologyResults");
+        enumerateHomologyResults(d[i].pairs, *(results[i]), intervalsHash, d[i].positivePairs, wigglePairHash,
+                                 d[i].isAtoB, options->wiggleBinLength);
+        profile_end(span);
+        pairStore_destruct(d[i].pairs);
+        free(d[i].positivePairs);
+    }
+}
 ResultPair *aggregateResult(void *(*getNextPair)(void *, void *), stSortedSet *set, void *seqName,
                             const char *name1, const char *name2) {
     /* loop through all ResultPairs available via the getNextPair() iterator and aggregate their
@@ -1413,14 +2040,17 @@ void reportResultsForWigglesArrays(FILE *fileHandle, WiggleContainer *wc) {
     }
     fprintf(fileHandle, "</absentMaf2ToMaf1>\n");
 }
+static int cmpWiggleKeys(const void *a, const void *b) {
+    return strcmp((const char *) a, (const char *) b);
+}
 void reportResultsForWiggles(stHash *wigglePairHash, FILE *fileHandle) {
-    //
-    stHashIterator *hit = stHash_getIterator(wigglePairHash);
+    // in key order, so that the report does not depend on how the hash was filled
+    stList *keys = stHash_getKeys(wigglePairHash);
+    stList_sort(keys, cmpWiggleKeys);
     WiggleContainer *wc = NULL;
-    char *key = NULL;
     findentprintf(fileHandle, 1, "<wigglePairs>\n");
-    while ((key = stHash_getNext(hit)) != NULL) {
-        wc = stHash_search(wigglePairHash, key);
+    for (int64_t i = 0; i < stList_length(keys); ++i) {
+        wc = stHash_search(wigglePairHash, stList_get(keys, i));
         findentprintf(fileHandle, 2, "<wigglePair reference=\"%s\" partner=\"%s\" "
                       "referenceStart=\"%" PRIu64 "\" referenceLength=\"%" PRIu64 "\" "
                       "numberOfBins=\"%" PRIu64 "\" "
@@ -1431,7 +2061,7 @@ void reportResultsForWiggles(stHash *wigglePairHash, FILE *fileHandle) {
         findentprintf(fileHandle, 2, "</wigglePair>\n");
     }
     findentprintf(fileHandle, 1, "</wigglePairs>\n");
-    stHash_destructIterator(hit);
+    stList_destruct(keys);
 }
 void reportResult(const char *tagName, double total, double totalTrue, FILE *fileHandle, unsigned tabLevel) {
     assert(total >= totalTrue);
@@ -1498,43 +2128,51 @@ void reportResults(stSortedSet *results_AB, const char *mafFileA, const char *ma
     assert(tabLevel == 1);
     return;
 }
+static void populateNamesFromBlock(mafBlock_t *mb, stSet *set, stHash *sequenceLengthHash) {
+    mafLine_t *ml = maf_mafBlock_getHeadLine(mb);
+    char *name = NULL;
+    while (ml != NULL) {
+        if (maf_mafLine_getType(ml) == 's') {
+            name = maf_mafLine_getSpecies(ml);
+            if (stHash_search(sequenceLengthHash, name) == NULL) {
+                stHash_insert(sequenceLengthHash, stString_copy(name),
+                              buildInt64(maf_mafLine_getSourceLength(ml)));
+            } else {
+                if (*(int64_t*)stHash_search(sequenceLengthHash, name) != maf_mafLine_getSourceLength(ml)) {
+                    fprintf(stderr, "Inconsistency detected in a maf. Previous source length for sequence "
+                            "%s was %" PRIu64 " but changed to %" PRIu64 " on line %" PRIu64 "\n",
+                            name, maf_mafLine_getSourceLength(ml),
+                            *(int64_t*)stHash_search(sequenceLengthHash, name),
+                            maf_mafLine_getLineNumber(ml));
+                    exit(EXIT_FAILURE);
+                }
+            }
+            if (stSet_search(set, name) == NULL) {
+                stSet_insert(set, stString_copy(name));
+            }
+        }
+        ml = maf_mafLine_getNext(ml);
+    }
+}
 void populateNames(const char *filename, stSet *set, stHash *sequenceLengthHash) {
     /*
      * populates a set with the names of sequences from a MAF file.
      */
     mafFileApi_t *mfa = maf_newMfa(filename, "r");
     mafBlock_t *mb = NULL;
-    mafLine_t *ml = NULL;
-    char *name = NULL;
     while ((mb = maf_readBlock(mfa)) != NULL) {
-        ml = maf_mafBlock_getHeadLine(mb);
-        while (ml != NULL) {
-            if (maf_mafLine_getType(ml) == 's') {
-                name = maf_mafLine_getSpecies(ml);
-                if (stHash_search(sequenceLengthHash, name) == NULL) {
-                    stHash_insert(sequenceLengthHash, stString_copy(name),
-                                  buildInt64(maf_mafLine_getSourceLength(ml)));
-                } else {
-                    if (*(int64_t*)stHash_search(sequenceLengthHash, name) != maf_mafLine_getSourceLength(ml)) {
-                        fprintf(stderr, "Inconsistency detected in a maf. Previous source length for sequence "
-                                "%s was %" PRIu64 " but changed to %" PRIu64 " on line %" PRIu64 "\n",
-                                name, maf_mafLine_getSourceLength(ml),
-                                *(int64_t*)stHash_search(sequenceLengthHash, name),
-                                maf_mafLine_getLineNumber(ml));
-                        exit(EXIT_FAILURE);
-                    }
-                }
-                if (stSet_search(set, name) == NULL) {
-                    stSet_insert(set, stString_copy(name));
-                }
-            }
-            ml = maf_mafLine_getNext(ml);
-        }
+        populateNamesFromBlock(mb, set, sequenceLengthHash);
         maf_destroyMafBlockList(mb);
     }
     // clean up
     maf_destroyMfa(mfa);
 }
+void populateNamesFromBlocks(mafBlock_t *blocks, stSet *set, stHash *sequenceLengthHash) {
+    // as populateNames() for a maf already read into memory with maf_readAll()
+    for (mafBlock_t *mb = blocks; mb != NULL; mb = maf_mafBlock_getNext(mb)) {
+        populateNamesFromBlock(mb, set, sequenceLengthHash);
+    }
+}
 void writeXMLHeader(FILE *fileHandle){
     fprintf(fileHandle, "<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"yes\" ?>\n");
     return;
@@ -1601,13 +2239,25 @@ void buildWigglePairHash(stHash *sequenceLengthHash, stList *wigglePairPatternLi
     }
 }
 void buildSeqNamesSet(Options *options, stSet *seqNamesSet, stHash *sequenceLengthHash) {
+    buildSeqNamesSetFromBlocks(options, seqNamesSet, sequenceLengthHash, NULL, NULL);
+}
+void buildSeqNamesSetFromBlocks(Options *options, stSet *seqNamesSet, stHash *sequenceLengthHash,
+                                mafBlock_t *blocks1, mafBlock_t *blocks2) {
+    // the names are read from the mafs held in memory when --concurrent is set, else from the files
     uint64_t length = 0;
     if (options->legitSequences == NULL) {
         // read the input maf files and construct the set and hash from them
         stSet *seqNamesSet1 = stSet_construct3(stHash_stringKey, stHash_stringEqualKey, free);
         stSet *seqNamesSet2 = stSet_construct3(stHash_stringKey, stHash_stringEqualKey, free);
-        populateNames(options->mafFile1, seqNamesSet1, sequenceLengthHash);
-        populateNames(options->mafFile2, seqNamesSet2, sequenceLengthHash);
+        profileSpan_t span = profile_begin("populateNames");
+        if (options->isConcurrent) {
+            populateNamesFromBlocks(blocks1, seqNamesSet1, sequenceLengthHash);
+            populateNamesFromBlocks(blocks2, seqNamesSet2, sequenceLengthHash);
+        } else {
+            populateNames(options->mafFile1, seqNamesSet1, sequenceLengthHash);
+            populateNames(options->mafFile2, seqNamesSet2, sequenceLengthHash);
+        }
+        profile_end(span);
         stSet *seqNamesSetTmp = stSet_getIntersection(seqNamesSet1, seqNamesSet2);
         stSetIterator *sit = stSet_getIterator(seqNamesSetTmp);
         char *key = NULL;
@@ -40,6 +40,10 @@
 #include "bioioC.h"
 #include "sonLib.h"
 #include "sharedMaf.h"
+#include "intervals.h"
+#include "comparatorPairStore.h"
+#include "comparatorPairCount.h"
+#include "comparatorRandom.h"
 
 typedef struct _options {
     // used to hold all the command line options
@@ -47,6 +51,7 @@ typedef struct _options {
     char *mafFile1;
     char *mafFile2;
     char *outputFile;
+    char *profileFile; // Chrome trace event output, NULL when not profiling
     char *bedFiles;
     char *wigglePairs;
     uint64_t wiggleRegionStart;
@@ -59,7 +64,31 @@ typedef struct _options {
     uint64_t numPairs1;
     uint64_t numPairs2;
     uint64_t wiggleBinLength;
+    unsigned numThreads; // shards of a sharded maf read at once, 0 for one per processor
+    bool isConcurrent; // read each maf into memory once and run both comparisons side by side
+    bool isReservoirSampling; // a fixed size reservoir rather than sampling each pair independently
+    bool isPairCountCached; // read and write the FILE.pairCount sidecars, see comparatorPairCount.h
+    bool isExact; // test every pair instead of a sample, see comparatorExact.h
+    uint64_t exactMemory; // bytes of pairs --exact sorts in memory before spilling to tmpDir
+    uint64_t sampleMemory; // --sampleMemory, bytes the sample is held in, 0 to hold it all in memory
+    char *tmpDir; // NULL for $TMPDIR, or /tmp
+    char *batchFile; // --batch, lines of prediction maf and report, see comparatorBatch.h
+    char *truthPairsFile; // --truthPairs, the --batch sample of maf1 kept for later runs
+    char *shardSpec; // --shard, see comparatorShard.h
+    stSet *shardSequences; // the legit sequences of --shard, NULL for every sequence
 } Options;
+typedef struct _pairSampler {
+    // chooses the pairs of a maf to sample in one pass, by their index over every pair in the maf,
+    // so that only the columns holding a chosen pair need to be looked at. see
+    // pairSampler_initBernoulli() and pairSampler_initReservoir().
+    uint64_t next; // index of the next pair to sample, UINT64_MAX once there are no more
+    uint64_t size; // number of pairs kept by a reservoir, 0 for independent (Bernoulli) sampling
+    double w; // reservoir only
+    double logQ; // Bernoulli only, log(1 - acceptProbability)
+    uint64_t seed;
+    uint64_t block; // index of the next block, see pairSampler_beginBlock()
+    RandomStream random; // keyed by (seed, block)
+} PairSampler;
 typedef struct _pair {
     // used for sampling pairs of aligned positions
     char *seq1;
@@ -102,14 +131,44 @@ typedef struct _wiggleContainer {
     uint64_t *absentAtoB;
     uint64_t *absentBtoA;
 } WiggleContainer;
-bool g_isVerboseFailures;
+typedef struct _pairIntervals {
+    // the --bedFiles intervals (an intervals_t per sequence in intervalsHash) of the names of a
+    // PairStore, by name id. pairs taken in store order have increasing pos1 for each id1, so
+    // pos1 is looked up with a cursor and pos2 with a binary search.
+    intervals_t **byId; // NULL when no sequence has intervals
+    uint64_t id1; // of cursor1
+    intervalsCursor_t cursor1;
+} PairIntervals;
+typedef struct _pairWiggles {
+    // the --wigglePairs containers (the values of wigglePairHash) of the names of a PairStore. the
+    // names that are in some wiggle pair get dense indices, so finding the container of a pair of
+    // name ids is two array reads rather than formatting and hashing "seq1-seq2" keys.
+    int64_t *indexById; // -1 for names in no wiggle pair. NULL when there are no wiggle pairs
+    uint64_t numIndexed;
+    WiggleContainer **table; // [index of ref * numIndexed + index of partner]
+} PairWiggles;
+extern bool g_isVerboseFailures;
+extern const uint64_t kHomologyBatchBlocksPerWorker; // blocks handed to each worker at a time
 
 Options* options_construct(void);
 void options_destruct(Options* o);
 void populateNames(const char *mAFFile, stSet *set, stHash *seqLengthHash);
+void populateNamesFromBlocks(mafBlock_t *blocks, stSet *set, stHash *seqLengthHash);
+bool lookUpNumberOfPairs(const char *mafFileA, mafBlock_t *blocksA, uint64_t *numberOfPairs,
+                         stSet *legitSequences, Options *options);
+void checkNumberOfPairs(const char *mafFileA, uint64_t *numberOfPairs, uint64_t verifiedNumberOfPairs,
+                        bool isCached, stSet *legitSequences, Options *options);
+PairStore* samplePairsForComparison(const char *mafFileA, mafBlock_t *blocksA, uint64_t *numberOfPairs,
+                                    bool isCached, stSet *legitSequences, Options *options,
+                                    uint64_t seed, stHash *sequenceLengthHash);
+uint64_t comparisonSeed(Options *options, bool isAtoB);
 stSortedSet* compareMAFs_AB(const char *mAFFileA, const char *mAFFileB, uint64_t *numberOfPairsInFile,
                             stSet *legitimateSequences, stHash *intervalsHash, stHash *wigHash, bool isAtoB,
                             Options *options, stHash *sequenceLengthHash);
+void readMafsConcurrently(const char *mafFile1, const char *mafFile2, mafBlock_t **blocks1, mafBlock_t **blocks2);
+void compareMAFsConcurrently(mafBlock_t *blocks1, mafBlock_t *blocks2, stSet *legitimateSequences,
+                             stHash *intervalsHash, stHash *wigHash, Options *options,
+                             stHash *sequenceLengthHash, stSortedSet **results_12, stSortedSet **results_21);
 void findentprintf(FILE *fp, unsigned indent, char const *fmt, ...);
 void reportResults(stSortedSet *results_AB, const char *mAFFileA, const char *mAFFileB,
                    FILE *fileHandle, uint64_t near, stSet *legitimateSequences,
@@ -126,8 +185,6 @@ ResultPair *resultPair_construct(const char *seq1, const char *seq2);
 void aPosition_fillOut(APosition *aPosition, char *name, uint64_t pos);
 APosition* aPosition_init(void);
 APosition* aPosition_construct(const char *name, uint64_t pos);
-stHash* constructPositionHash(char **mat, uint64_t c, char **names, uint64_t numSeqs,
-                              uint64_t *allPositions, bool *legitRows);
 void aPosition_destruct(void *p);
 void resultPair_destruct(ResultPair *rp);
 int aPair_cmpFunction_seqsOnly(APair *aPair1, APair *aPair2);
@@ -138,14 +195,16 @@ bool closeEnough(uint64_t p1, uint64_t p2, uint64_t near);
 void wiggleContainer_destruct(WiggleContainer *wc);
 void writeXMLHeader( FILE *fileHandle );
 bool* getLegitRows(char **names, uint64_t numSeqs, stSet *legitPairs);
-uint64_t walkBlockCountingPairs(mafBlock_t *mb, stSet *legitPairs, uint64_t *chooseTwoArray);
+uint64_t walkBlockCountingPairs(mafBlock_t *mb, stSet *legitPairs);
+uint64_t countPairsInRows(char **rows, uint64_t *lengths, uint64_t numRows, uint64_t numColumns);
 int64_t* buildInt(int64_t n);
 int64_t* buildInt64(int64_t n);
 uint64_t* buildUInt64(uint64_t n);
 uint64_t* uint64Copy(uint64_t *i);
 uint64_t chooseTwo(uint64_t n);
 uint64_t* buildChooseTwoArray(void);
-uint64_t countPairsInMaf(const char *filename, stSet *legitPairs);
+uint64_t countPairsInMaf(const char *filename, stSet *legitPairs, unsigned numThreads);
+uint64_t countPairsInBlocks(mafBlock_t *blocks, stSet *legitPairs);
 uint64_t countPairsInColumn(char **mat, uint64_t c, uint64_t numSeqs, bool *legitRows, uint64_t *chooseTwoArray);
 uint64_t countLegitGaplessPositions(char **mat, uint64_t c, uint64_t numRows, bool *legitRows);
 void countPairs(APair *pair, stHash *intervalsHash, int64_t *counter,
@@ -156,36 +215,62 @@ void arrayIndexToPairIndices(uint64_t i, uint64_t n, uint64_t *r, uint64_t *c);
 void samplePairs(APair *thisPair, stHash *intervalsHash, stSortedSet *pairs,
                  double *acceptProbability, stHash *legitPairs, uint64_t near);
 bool inInterval(stHash *intervalsHash, char *seq, uint64_t pos);
+PairIntervals* pairIntervals_construct(PairStore *names, stHash *intervalsHash);
+void pairIntervals_destruct(PairIntervals *pi);
+void pairIntervals_locate(PairIntervals *pi, uint64_t id1, uint64_t pos1, uint64_t id2, uint64_t pos2,
+                          bool *isInInterval1, bool *isInInterval2);
 uint64_t findLowerBound(uint64_t pos, uint64_t near);
-void recordNearPair(APair *thisPair, stSortedSet *sampledPairs, uint64_t near, stSet *positivePairs);
-void samplePairsFromMaf(const char *filename, stSortedSet *pairs, double acceptProbability,
+void recordNearPair(PairStore *sampledPairs, uint64_t id1, uint64_t pos1, uint64_t id2, uint64_t pos2,
+                    uint64_t near, PairIndexList *positivePairs);
+void pairSampler_initBernoulli(PairSampler *sampler, double acceptProbability, uint64_t seed);
+void pairSampler_initReservoir(PairSampler *sampler, uint64_t size, uint64_t seed);
+void pairSampler_beginBlock(PairSampler *sampler, uint64_t firstPair);
+bool pairSampler_isInColumn(PairSampler *sampler, uint64_t firstPair, uint64_t numPairs);
+void samplePairsFromMaf(const char *filename, PairStore *pairs, PairSampler *sampler,
                         stSet *legitSequences, uint64_t *numPairs, stHash *sequenceLengthHash);
-void samplePairsFromColumn(double acceptProbability, stSortedSet *sampledPairs,
+void samplePairsFromBlocks(const char *filename, mafBlock_t *blocks, PairStore *pairs, PairSampler *sampler,
+                           stSet *legitSequences, uint64_t *numPairs, stHash *sequenceLengthHash,
+                           unsigned numThreads);
+void samplePairsFromColumn(RandomStream *random, double acceptProbability, PairStore *sampledPairs,
                            uint64_t numSeqs, uint64_t *chooseTwoArray,
                            char **nameArray, uint64_t *columnPositions);
-void samplePairsFromColumnBruteForce(double acceptProbability, stSortedSet *sampledPairs,
+void samplePairsFromColumnBySkipping(PairSampler *sampler, PairStore *sampledPairs, uint64_t numSeqs,
+                                     uint64_t firstPair, char **nameArray, uint64_t *columnPositions);
+void samplePairsFromColumnBruteForce(RandomStream *random, double acceptProbability, PairStore *sampledPairs,
                                      uint64_t *chooseTwoArray,
                                      char **nameArray, uint64_t *positions, uint64_t numSeqs,
                                      uint64_t numPairs);
-void samplePairsFromColumnAnalytic(double acceptProbability, stSortedSet *sampledPairs,
+void samplePairsFromColumnAnalytic(RandomStream *random, double acceptProbability, PairStore *sampledPairs,
                                    uint64_t *chooseTwoArray,
                                    char **nameArray, uint64_t *positions, uint64_t numSeqs,
                                    uint64_t numPairs);
-void samplePairsFromColumnNaive(char **mat, uint64_t c, bool *legitRows, double acceptProbability,
-                                stSortedSet *sampledPairs, uint64_t *chooseTwoArray,
+void samplePairsFromColumnNaive(RandomStream *random, char **mat, uint64_t c, bool *legitRows,
+                                double acceptProbability,
+                                PairStore *sampledPairs, uint64_t *chooseTwoArray,
                                 char **nameArray, uint64_t *positions, uint64_t numSeqs,
                                 uint64_t numPairs);
-void walkBlockTestingHomology(mafBlock_t *mb, stSortedSet *sampledPairs, stSet *positivePairs,
+void walkBlockTestingHomology(mafBlock_t *mb, PairStore *sampledPairs, PairIndexList *positivePairs,
                               stSet *legitSequences, uint64_t near);
-void testHomologyOnColumn(char **mat, uint64_t c, uint64_t numSeqs, bool *legitRows, char **names,
-                          stSortedSet *sampledPairs, stSet *positivePairs, mafLine_t **mlArray,
-                          uint64_t *allPositions, uint64_t near);
-void performHomologyTests(const char *filename, stSortedSet *sampledPairs, stSet *positivePairs,
-                          stSet *legitSequences, uint64_t near);
-void homologyTests1(APair *thisPair, stHash *intervalsHash, stSortedSet *pairs,
-                    stSet *positivePairs, stSet *legitPairs, int64_t near);
-void enumerateHomologyResults(stSortedSet *sampledPairs, stSortedSet *resultPairs, stHash *intervalsHash,
-                              stSet *positivePairs, stHash *wigglePairHash, bool isAtoB,
+uint64_t collectColumnPositions(char **mat, uint64_t c, uint64_t numSeqs, bool *legitRows, int64_t *rowNameIds,
+                                uint64_t *allPositions, uint64_t *columnKeys);
+void testHomologyOnColumn(char **mat, uint64_t c, uint64_t numSeqs, bool *legitRows, int64_t *rowNameIds,
+                          PairStore *sampledPairs, PairIndexList *positivePairs, uint64_t *allPositions,
+                          uint64_t *columnKeys, uint64_t near);
+void markPositivePairs(PairIndexList *list, bool *positivePairs);
+void performHomologyTests(const char *filename, PairStore *sampledPairs, bool *positivePairs,
+                          stSet *legitSequences, uint64_t near, unsigned numThreads);
+void performHomologyTestsOnBlocks(mafBlock_t *blocks, PairStore *sampledPairs, bool *positivePairs,
+                                  stSet *legitSequences, uint64_t near, unsigned numThreads);
+void homologyTests1(APair *thisPair, stHash *intervalsHash, PairStore *pairs,
+                    PairIndexList *positivePairs, stSet *legitPairs, int64_t near);
+ResultPair* getResultPair(stSortedSet *resultPairs, const char *seq1, const char *seq2);
+PairWiggles* pairWiggles_construct(PairStore *names, stHash *wigglePairHash);
+void pairWiggles_destruct(PairWiggles *pw);
+WiggleContainer* pairWiggles_get(PairWiggles *pw, uint64_t id1, uint64_t id2, bool *isSeq1Ref);
+void tallyHomologyResult(ResultPair *resultPair, WiggleContainer *wc, uint64_t refPos, bool isInInterval1,
+                         bool isInInterval2, APair *pair, bool foundPair, bool isAtoB, uint64_t wiggleBinLength);
+void enumerateHomologyResults(PairStore *sampledPairs, stSortedSet *resultPairs, stHash *intervalsHash,
+                              bool *positivePairs, stHash *wigglePairHash, bool isAtoB,
                               uint64_t wiggleBinLength);
 ResultPair *aggregateResult(void *(*getNextPair)(void *, void *), stSortedSet *set, void *seqName,
                             const char *name1, const char *name2);
@@ -200,7 +285,6 @@ int* cullStrandInts(int *allStrandInts, uint64_t numSeqs, bool *legitRows, uint6
 char** extractLegitGaplessNamesFromMlArrayByColumn(char **mat, uint64_t c, mafLine_t **mlArray, bool *legitRows,
                                                    uint64_t numRows, uint64_t numLegitGaplessPositions);
 void validateMafBlockSourceLengths(const char *filename, mafBlock_t *mb, stHash *sequenceLengthHash);
-bool pairMemberInPositionHash(stHash *positionHash, APair *thisPair);
 void printmlarray(mafLine_t **mlArray, uint64_t n);
 void printHash(stHash *hash);
 void printAllPositions(uint64_t *allPositions, mafBlock_t *mb);
@@ -208,7 +292,7 @@ void printAllStrandInts(int *allStrandInts, mafBlock_t *mb);
 uint64_t countLegitPositions(char **mat, uint64_t c, uint64_t numRows);
 mafLine_t** cullMlArrayByColumn(char **mat, uint64_t c, mafLine_t **mlArray, bool *legitRows, uint64_t numRows, uint64_t numLegitGaplessPositions);
 uint64_t* cullPositionsByColumn(char **mat, uint64_t c, uint64_t *positions, bool *legitRows, uint64_t numRows, uint64_t numLegitGaplessPositions);
-void walkBlockSamplingPairs(const char *filename, mafBlock_t *mb, stSortedSet *sampledPairs, double acceptProbability, stSet *legitSequences, uint64_t *chooseTwoArray, uint64_t *numPairs, stHash *sequenceLengthHash);
+void walkBlockSamplingPairs(const char *filename, mafBlock_t *mb, PairStore *sampledPairs, PairSampler *sampler, stSet *legitSequences, uint64_t *chooseTwoArray, uint64_t *numPairs, stHash *sequenceLengthHash);
 int aPair_cmpFunction(APair *aPair1, APair *aPair2);
 uint64_t sumBoolArray(bool *legitRows, uint64_t numSeqs);
 mafLine_t** createMafLineArray(mafBlock_t *mb, uint64_t numLegit, bool *legitRows);
@@ -221,5 +305,7 @@ void buildWigglePairHash(stHash *sequenceLengthHash, stList *wigglePairPatternLi
                          uint64_t wiggleRegionStop);
 void reportResultsForWiggles(stHash *wigglePairHash, FILE *fileHandle);
 void buildSeqNamesSet(Options *options, stSet *seqNamesSet, stHash *sequenceLengthHash);
-bool positionIsInWiggleRegion(WiggleContainer *wc, uint64_t *refPos);
+void buildSeqNamesSetFromBlocks(Options *options, stSet *seqNamesSet, stHash *sequenceLengthHash,
+                                mafBlock_t *blocks1, mafBlock_t *blocks2);
+bool positionIsInWiggleRegion(WiggleContainer *wc, uint64_t refPos);
 #endif /* _COMPARATOR_API_H_ */
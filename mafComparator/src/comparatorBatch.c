@@ -0,0 +1,528 @@
+/*
+ * Copyright (C) 2012 by
+ * Dent Earl (dearl@soe.ucsc.edu, dentearl@gmail.com)
+ * ... and other members of the Reconstruction Team of David Haussler's
+ * lab (BME Dept. UCSC).
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <assert.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sonLib.h"
+#include "common.h"
+#include "sharedMaf.h"
+#include "parallel.h"
+#include "profile.h"
+#include "comparatorAPI.h"
+#include "comparatorPairStore.h"
+#include "comparatorPairCount.h"
+#include "comparatorBatch.h"
+
+static const char *kTruthPairsHeader = "mafComparatorTruthPairs 2";
+
+BatchComparison* batchComparison_construct(const char *mafFile2, const char *outputFile) {
+    BatchComparison *bc = (BatchComparison *) st_malloc(sizeof(*bc));
+    bc->mafFile2 = stString_copy(mafFile2);
+    bc->outputFile = stString_copy(outputFile);
+    bc->legitSequences = stSet_construct3(stHash_stringKey, stHash_stringEqualKey, free);
+    bc->wigglePairHash = stHash_construct3(stHash_stringKey, stHash_stringEqualKey,
+                                           free, (void(*)(void *)) wiggleContainer_destruct);
+    bc->numPairs1 = 0;
+    bc->numPairs2 = 0;
+    bc->truthSample = 0;
+    bc->results_12 = NULL;
+    bc->results_21 = NULL;
+    return bc;
+}
+void batchComparison_destruct(BatchComparison *bc) {
+    if (bc == NULL) {
+        return;
+    }
+    free(bc->mafFile2);
+    free(bc->outputFile);
+    stSet_destruct(bc->legitSequences);
+    stHash_destruct(bc->wigglePairHash);
+    if (bc->results_12 != NULL) {
+        stSortedSet_destruct(bc->results_12);
+    }
+    if (bc->results_21 != NULL) {
+        stSortedSet_destruct(bc->results_21);
+    }
+    free(bc);
+}
+stList* readBatchFile(const char *filename) {
+    // blank lines and lines starting with # are skipped
+    stList *batch = stList_construct3(0, (void(*)(void *)) batchComparison_destruct);
+    FILE *fp = de_fopen(filename, "r");
+    int64_t nBytes = 100;
+    char *line = st_malloc(nBytes + 1);
+    uint64_t lineNumber = 0;
+    while (benLine(&line, &nBytes, fp) != -1) {
+        ++lineNumber;
+        char *currentLocation = line;
+        char *maf = stString_getNextWord(&currentLocation);
+        if (maf == NULL || maf[0] == '#') {
+            free(maf);
+            continue;
+        }
+        char *out = stString_getNextWord(&currentLocation);
+        char *extra = stString_getNextWord(&currentLocation);
+        if (out == NULL || extra != NULL) {
+            fprintf(stderr, "Error, line %" PRIu64 " of %s should be a prediction maf and a report file.\n",
+                    lineNumber, filename);
+            exit(EXIT_FAILURE);
+        }
+        if (maf_isStdStream(maf)) {
+            fprintf(stderr, "Error, line %" PRIu64 " of %s, predictions can not be read from stdin.\n",
+                    lineNumber, filename);
+            exit(EXIT_FAILURE);
+        }
+        if (!maf_isShardSpec(maf)) {
+            fclose(de_fopen(maf, "r"));
+        }
+        stList_append(batch, batchComparison_construct(maf, out));
+        free(maf);
+        free(out);
+    }
+    free(line);
+    fclose(fp);
+    if (stList_length(batch) == 0) {
+        fprintf(stderr, "Error, %s lists no predictions.\n", filename);
+        exit(EXIT_FAILURE);
+    }
+    return batch;
+}
+static void insertCopies(stSet *set, stSet *from) {
+    stSetIterator *sit = stSet_getIterator(from);
+    char *name;
+    while ((name = stSet_getNext(sit)) != NULL) {
+        if (stSet_search(set, name) == NULL) {
+            stSet_insert(set, stString_copy(name));
+        }
+    }
+    stSet_destructIterator(sit);
+}
+static void buildPredictionWigglePairHash(Options *options, BatchComparison *bc, stSet *names1, stSet *names2,
+                                          stHash *sequenceLengthHash, stList *wigglePairPatternList) {
+    // a single comparison makes wiggles for every sequence of its two mafs, so only the lengths of
+    // the truth's and this prediction's sequences are offered to buildWigglePairHash()
+    stHash *lengths = sequenceLengthHash;
+    if (names1 != NULL) {
+        lengths = stHash_construct3(stHash_stringKey, stHash_stringEqualKey, free, free);
+        stHashIterator *hit = stHash_getIterator(sequenceLengthHash);
+        char *name;
+        while ((name = stHash_getNext(hit)) != NULL) {
+            if (stSet_search(names1, name) != NULL || stSet_search(names2, name) != NULL) {
+                stHash_insert(lengths, stString_copy(name),
+                              buildInt64(*(int64_t *) stHash_search(sequenceLengthHash, name)));
+            }
+        }
+        stHash_destructIterator(hit);
+    }
+    buildWigglePairHash(lengths, wigglePairPatternList, bc->wigglePairHash, options->wiggleBinLength,
+                        options->wiggleRegionStart, options->wiggleRegionStop);
+    if (lengths != sequenceLengthHash) {
+        stHash_destruct(lengths);
+    }
+}
+void buildBatchSeqNamesSets(Options *options, stList *batch, stSet *truthSequences,
+                            stHash *sequenceLengthHash, stList *wigglePairPatternList) {
+    profileSpan_t span = profile_begin("populateNames");
+    if (options->legitSequences != NULL) {
+        // the command line names every sequence, of every comparison
+        buildSeqNamesSet(options, truthSequences, sequenceLengthHash);
+        for (int64_t i = 0; i < stList_length(batch); ++i) {
+            BatchComparison *bc = stList_get(batch, i);
+            insertCopies(bc->legitSequences, truthSequences);
+            buildPredictionWigglePairHash(options, bc, NULL, NULL, sequenceLengthHash, wigglePairPatternList);
+        }
+        profile_end(span);
+        return;
+    }
+    stSet *names1 = stSet_construct3(stHash_stringKey, stHash_stringEqualKey, free);
+    populateNames(options->mafFile1, names1, sequenceLengthHash);
+    for (int64_t i = 0; i < stList_length(batch); ++i) {
+        BatchComparison *bc = stList_get(batch, i);
+        stSet *names2 = stSet_construct3(stHash_stringKey, stHash_stringEqualKey, free);
+        populateNames(bc->mafFile2, names2, sequenceLengthHash);
+        stSet *shared = stSet_getIntersection(names1, names2);
+        insertCopies(bc->legitSequences, shared);
+        insertCopies(truthSequences, shared);
+        buildPredictionWigglePairHash(options, bc, names1, names2, sequenceLengthHash, wigglePairPatternList);
+        stSet_destruct(shared);
+        stSet_destruct(names2);
+    }
+    stSet_destruct(names1);
+    profile_end(span);
+}
+static bool formatTruthPairsKey(const char *mafFile1, Options *options, stSet *truthSequences,
+                                char *key, size_t n) {
+    // everything the truth sample depends on but the maf's contents, false if the maf can not be stamped
+    uint64_t mafSize;
+    int64_t mafTime;
+    if (!pairCount_statMaf(mafFile1, &mafSize, &mafTime)) {
+        return false;
+    }
+    snprintf(key, n, "%" PRIu64 " %" PRId64 " %016" PRIx64 " %s %" PRIu64 " %" PRIu64,
+             mafSize, mafTime, pairCount_hashNames(truthSequences),
+             options->isReservoirSampling ? "reservoir" : "bernoulli",
+             options->numberOfSamples, options->randomSeed);
+    return true;
+}
+bool readTruthPairs(const char *path, Options *options, stSet *truthSequences, PairStore **pairs,
+                    uint64_t *numPairs1) {
+    char key[256];
+    char line[512];
+    if (!formatTruthPairsKey(options->mafFile1, options, truthSequences, key, sizeof(key))) {
+        return false;
+    }
+    FILE *fp = fopen(path, "r");
+    if (fp == NULL) {
+        return false;
+    }
+    size_t keyLength = strlen(key);
+    uint64_t numPairs = 0;
+    bool isFound = fgets(line, sizeof(line), fp) != NULL
+        && strncmp(line, kTruthPairsHeader, strlen(kTruthPairsHeader)) == 0
+        && fgets(line, sizeof(line), fp) != NULL
+        && strncmp(line, key, keyLength) == 0 && line[keyLength] == ' '
+        && sscanf(line + keyLength, "%" SCNu64, &numPairs) == 1;
+    if (isFound) {
+        PairStore *ps = pairStore_construct(truthSequences);
+        isFound = pairStore_readRecords(ps, fp);
+        if (isFound) {
+            *numPairs1 = numPairs;
+        }
+        if (isFound && pairStore_size(ps) > 0) {
+            *pairs = ps;
+        } else {
+            pairStore_destruct(ps);
+            *pairs = NULL;
+        }
+    }
+    if (!isFound) {
+        st_logInfo("%s does not hold a sample of %s, resampling\n", path, options->mafFile1);
+    }
+    fclose(fp);
+    return isFound;
+}
+void writeTruthPairs(const char *path, Options *options, stSet *truthSequences, PairStore *pairs,
+                     uint64_t numPairs1) {
+    char key[256];
+    if (!formatTruthPairsKey(options->mafFile1, options, truthSequences, key, sizeof(key))) {
+        fprintf(stderr, "Warning, the sample of %s is not kept in %s, stdin and sharded mafs can not "
+                "be told apart from later versions of themselves\n", options->mafFile1, path);
+        return;
+    }
+    char *tmpPath = NULL;
+    FILE *fp = de_openAtomic(path, &tmpPath);
+    if (fp == NULL) {
+        fprintf(stderr, "Warning, unable to write the truth pairs file %s\n", path);
+        return;
+    }
+    PairStore *empty = (pairs == NULL) ? pairStore_construct(truthSequences) : NULL;
+    bool isWritten = fprintf(fp, "%s\n%s %" PRIu64 "\n", kTruthPairsHeader, key, numPairs1) > 0
+        && pairStore_writeRecords((pairs == NULL) ? empty : pairs, fp);
+    if (!de_closeAtomic(fp, tmpPath, path, isWritten)) {
+        fprintf(stderr, "Warning, unable to write the truth pairs file %s\n", path);
+    }
+    pairStore_destruct(empty);
+}
+typedef struct _blockTests {
+    // blocks tested on several stores at once by a pool of workers. blocks are added in
+    // batches to one of two buffers while the workers test, then destroy, those of the
+    // other. every worker records the indices of the pairs it finds in a list of its own
+    // per store, the lists are folded into the flags at the end so the result does not
+    // depend on the schedule.
+    mafBlock_t **blocks[2];
+    uint64_t numBlocks; // in the buffer being filled
+    unsigned filling; // the buffer being filled
+    mafBlock_t **running; // the buffer being tested
+    uint64_t numStores;
+    PairStore **stores; // a NULL store is skipped
+    stSet **legitSequences;
+    bool **positivePairs;
+    PairIndexList **found; // numWorkers x numStores
+    unsigned numWorkers;
+    parallelPool_t *pool;
+    uint64_t near;
+} BlockTests;
+static void blockTests_init(BlockTests *bt, uint64_t numStores, unsigned numThreads, uint64_t near) {
+    bt->numWorkers = parallel_numberOfWorkers(numThreads, UINT64_MAX);
+    bt->numStores = numStores;
+    bt->numBlocks = 0;
+    bt->filling = 0;
+    bt->running = NULL;
+    bt->near = near;
+    for (unsigned b = 0; b < 2; ++b) {
+        bt->blocks[b] = (mafBlock_t **) st_malloc(sizeof(*(bt->blocks[b])) * kHomologyBatchBlocksPerWorker
+                                                  * bt->numWorkers);
+    }
+    bt->stores = (PairStore **) st_calloc(numStores, sizeof(*(bt->stores)));
+    bt->legitSequences = (stSet **) st_calloc(numStores, sizeof(*(bt->legitSequences)));
+    bt->positivePairs = (bool **) st_calloc(numStores, sizeof(*(bt->positivePairs)));
+    bt->found = (PairIndexList **) st_malloc(sizeof(*(bt->found)) * bt->numWorkers * numStores);
+    for (uint64_t i = 0; i < bt->numWorkers * numStores; ++i) {
+        bt->found[i] = pairIndexList_construct();
+    }
+    bt->pool = parallel_startPool(bt->numWorkers);
+}
+static void blockTests_destruct(BlockTests *bt) {
+    parallel_finishPool(bt->pool);
+    for (uint64_t i = 0; i < bt->numWorkers * bt->numStores; ++i) {
+        pairIndexList_destruct(bt->found[i]);
+    }
+    free(bt->found);
+    free(bt->positivePairs);
+    free(bt->legitSequences);
+    free(bt->stores);
+    free(bt->blocks[0]);
+    free(bt->blocks[1]);
+}
+static void testBlockOnStores(uint64_t i, unsigned worker, void *data) {
+    BlockTests *bt = (BlockTests *) data;
+    for (uint64_t s = 0; s < bt->numStores; ++s) {
+        if (bt->stores[s] != NULL) {
+            walkBlockTestingHomology(bt->running[i], bt->stores[s], bt->found[worker * bt->numStores + s],
+                                     bt->legitSequences[s], bt->near);
+        }
+    }
+    maf_destroyMafBlockList(bt->running[i]);
+}
+static void blockTests_run(BlockTests *bt) {
+    // hand the buffer being filled to the workers, once they are done with the other one
+    parallel_wait(bt->pool);
+    if (bt->numBlocks == 0) {
+        return;
+    }
+    bt->running = bt->blocks[bt->filling];
+    parallel_start(bt->pool, bt->numBlocks, testBlockOnStores, bt);
+    bt->filling = !(bt->filling);
+    bt->numBlocks = 0;
+}
+static void blockTests_add(BlockTests *bt, mafBlock_t *mb) {
+    bt->blocks[bt->filling][bt->numBlocks++] = mb;
+    if (bt->numBlocks == kHomologyBatchBlocksPerWorker * bt->numWorkers) {
+        blockTests_run(bt);
+    }
+}
+static void blockTests_finish(BlockTests *bt) {
+    // test the blocks left and set the flags of the pairs found
+    blockTests_run(bt);
+    parallel_wait(bt->pool);
+    for (unsigned w = 0; w < bt->numWorkers; ++w) {
+        for (uint64_t s = 0; s < bt->numStores; ++s) {
+            if (bt->stores[s] != NULL) {
+                markPositivePairs(bt->found[w * bt->numStores + s], bt->positivePairs[s]);
+            }
+        }
+    }
+}
+static PairStore* samplePredictionTestingTruth(Options *options, BatchComparison *bc, PairStore *truthPairs,
+                                               bool *truthPositives, stHash *sequenceLengthHash) {
+    // the pass over a prediction: its pairs are sampled, as samplePairsForComparison() does, and the
+    // blocks are then tested on the truth sample. returns the sorted sample, NULL if there is none.
+    bool isCached = lookUpNumberOfPairs(bc->mafFile2, NULL, &(bc->numPairs2), bc->legitSequences, options);
+    bool isSampling = options->isReservoirSampling || bc->numPairs2 != 0;
+    PairSampler sampler;
+    if (!isSampling) {
+        // nothing to sample, though the truth is still tested
+    } else if (options->isReservoirSampling) {
+        pairSampler_initReservoir(&sampler, options->numberOfSamples, comparisonSeed(options, false));
+    } else {
+        pairSampler_initBernoulli(&sampler, ((double) options->numberOfSamples) / (double) bc->numPairs2,
+                                  comparisonSeed(options, false));
+    }
+    PairStore *pairs = pairStore_construct(bc->legitSequences);
+    uint64_t verifiedNumberOfPairs = 0;
+    uint64_t *chooseTwoArray = buildChooseTwoArray();
+    BlockTests bt;
+    blockTests_init(&bt, 1, options->numThreads, options->near);
+    bt.stores[0] = truthPairs;
+    bt.legitSequences[0] = bc->legitSequences;
+    bt.positivePairs[0] = truthPositives;
+    mafFileApi_t *mfa = maf_newMfa(bc->mafFile2, "r");
+    mafBlock_t *mb = NULL;
+    while ((mb = maf_readBlock(mfa)) != NULL) {
+        if (isSampling) {
+            walkBlockSamplingPairs(bc->mafFile2, mb, pairs, &sampler, bc->legitSequences, chooseTwoArray,
+                                   &verifiedNumberOfPairs, sequenceLengthHash);
+        }
+        blockTests_add(&bt, mb);
+    }
+    blockTests_finish(&bt);
+    maf_destroyMfa(mfa);
+    blockTests_destruct(&bt);
+    free(chooseTwoArray);
+    pairStore_sort(pairs);
+    if (isSampling) {
+        checkNumberOfPairs(bc->mafFile2, &(bc->numPairs2), verifiedNumberOfPairs, isCached,
+                           bc->legitSequences, options);
+    }
+    if (pairStore_size(pairs) == 0) {
+        pairStore_destruct(pairs);
+        return NULL;
+    }
+    return pairs;
+}
+static bool isSameSet(stSet *a, stSet *b) {
+    if (stSet_size(a) != stSet_size(b)) {
+        return false;
+    }
+    stSetIterator *it = stSet_getIterator(a);
+    char *name = NULL;
+    bool isSame = true;
+    while (isSame && (name = stSet_getNext(it)) != NULL) {
+        isSame = stSet_search(b, name) != NULL;
+    }
+    stSet_destructIterator(it);
+    return isSame;
+}
+static stList* groupBySharedSequences(stList *batch) {
+    // the distinct legitSequences of the batch, in order of first use, and sets each comparison's
+    // truthSample to the index of its own. the sets belong to the comparisons.
+    stList *truthSequences = stList_construct();
+    for (int64_t i = 0; i < stList_length(batch); ++i) {
+        BatchComparison *bc = stList_get(batch, i);
+        int64_t g = 0;
+        while (g < stList_length(truthSequences) && !isSameSet(stList_get(truthSequences, g), bc->legitSequences)) {
+            ++g;
+        }
+        if (g == stList_length(truthSequences)) {
+            stList_append(truthSequences, bc->legitSequences);
+        }
+        bc->truthSample = (uint64_t) g;
+    }
+    return truthSequences;
+}
+static PairStore* sampleTruth(Options *options, stSet *truthSequences, const char *truthPairsFile,
+                              uint64_t *numPairs1, stHash *sequenceLengthHash) {
+    // the sample of the truth over truthSequences, the one a single comparison with the same seed
+    // takes, read from or kept in truthPairsFile if it is not NULL. NULL if there are no pairs.
+    PairStore *truthPairs = NULL;
+    *numPairs1 = 0;
+    if (truthPairsFile == NULL
+        || !readTruthPairs(truthPairsFile, options, truthSequences, &truthPairs, numPairs1)) {
+        bool isCached = lookUpNumberOfPairs(options->mafFile1, NULL, numPairs1, truthSequences, options);
+        truthPairs = samplePairsForComparison(options->mafFile1, NULL, numPairs1, isCached,
+                                              truthSequences, options, comparisonSeed(options, true),
+                                              sequenceLengthHash);
+        if (truthPairsFile != NULL) {
+            writeTruthPairs(truthPairsFile, options, truthSequences, truthPairs, *numPairs1);
+        }
+    }
+    if (truthPairs != NULL && options->near > 0) {
+        pairStore_indexByPos1(truthPairs);
+    }
+    return truthPairs;
+}
+void compareMAFsInBatch(Options *options, stList *batch, stHash *intervalsHash, stHash *sequenceLengthHash) {
+    /* Sample the truth once for each distinct set of sequences it shares with a prediction, or read
+     * the samples from --truthPairs, then make one pass over each prediction, sampling it and testing
+     * its truth sample on it, and a last pass over the truth testing every prediction's sample. Each
+     * prediction's sample is kept until that last pass, so memory grows with the number of predictions.
+     */
+    uint64_t n = (uint64_t) stList_length(batch);
+    stList *truthSequences = groupBySharedSequences(batch);
+    uint64_t numTruthSamples = (uint64_t) stList_length(truthSequences);
+    PairStore **truthPairs = (PairStore **) st_calloc(numTruthSamples, sizeof(*truthPairs));
+    uint64_t *numPairs1 = (uint64_t *) st_calloc(numTruthSamples, sizeof(*numPairs1));
+    profileSpan_t span = profile_begin("sampleTruth");
+    for (uint64_t g = 0; g < numTruthSamples; ++g) {
+        char *truthPairsFile = NULL;
+        if (options->truthPairsFile != NULL) {
+            truthPairsFile = (g == 0) ? stString_copy(options->truthPairsFile)
+                : stString_print("%s.%" PRIu64, options->truthPairsFile, g);
+        }
+        truthPairs[g] = sampleTruth(options, stList_get(truthSequences, g), truthPairsFile, &(numPairs1[g]),
+                                    sequenceLengthHash);
+        free(truthPairsFile);
+    }
+    profile_end(span);
+    BlockTests bt;
+    blockTests_init(&bt, n, options->numThreads, options->near);
+    bool **truthPositives = (bool **) st_malloc(sizeof(*truthPositives) * n);
+    for (uint64_t i = 0; i < n; ++i) {
+        BatchComparison *bc = stList_get(batch, i);
+        PairStore *sample = truthPairs[bc->truthSample];
+        bc->numPairs1 = numPairs1[bc->truthSample];
+        truthPositives[i] = (bool *) st_calloc(((sample == NULL) ? 0 : pairStore_size(sample)) + 1,
+                                               sizeof(**truthPositives));
+        span = profile_begin("samplePredictionTestingTruth");
+        bt.stores[i] = samplePredictionTestingTruth(options, bc, sample, truthPositives[i], sequenceLengthHash);
+        profile_end(span);
+        bt.legitSequences[i] = bc->legitSequences;
+        if (bt.stores[i] != NULL) {
+            if (options->near > 0) {
+                pairStore_indexByPos1(bt.stores[i]);
+            }
+            bt.positivePairs[i] = (bool *) st_calloc(pairStore_size(bt.stores[i]) + 1,
+                                                     sizeof(**(bt.positivePairs)));
+        }
+    }
+    span = profile_begin("performHomologyTests");
+    mafFileApi_t *mfa = maf_newMfa(options->mafFile1, "r");
+    mafBlock_t *mb = NULL;
+    while ((mb = maf_readBlock(mfa)) != NULL) {
+        blockTests_add(&bt, mb);
+    }
+    blockTests_finish(&bt);
+    maf_destroyMfa(mfa);
+    profile_end(span);
+    span = profile_begin("enumerateHomologyResults");
+    for (uint64_t i = 0; i < n; ++i) {
+        BatchComparison *bc = stList_get(batch, i);
+        bc->results_12 = stSortedSet_construct3((int(*)(const void *, const void *)) aPair_cmpFunction_seqsOnly,
+                                                (void(*)(void *)) aPair_destruct);
+        bc->results_21 = stSortedSet_construct3((int(*)(const void *, const void *)) aPair_cmpFunction_seqsOnly,
+                                                (void(*)(void *)) aPair_destruct);
+        if (truthPairs[bc->truthSample] != NULL) {
+            if (g_isVerboseFailures) {
+                fprintf(stderr, "# Sampling from %s, comparing to %s\n", options->mafFile1, bc->mafFile2);
+                fprintf(stderr, "# seq1\tabsPos1\torigPos1\tseq2\tabsPos2\torigPos2\n");
+            }
+            enumerateHomologyResults(truthPairs[bc->truthSample], bc->results_12, intervalsHash, truthPositives[i],
+                                     bc->wigglePairHash, true, options->wiggleBinLength);
+        }
+        if (bt.stores[i] != NULL) {
+            if (g_isVerboseFailures) {
+                fprintf(stderr, "# Sampling from %s, comparing to %s\n", bc->mafFile2, options->mafFile1);
+                fprintf(stderr, "# seq1\tabsPos1\torigPos1\tseq2\tabsPos2\torigPos2\n");
+            }
+            enumerateHomologyResults(bt.stores[i], bc->results_21, intervalsHash, bt.positivePairs[i],
+                                     bc->wigglePairHash, false, options->wiggleBinLength);
+            pairStore_destruct(bt.stores[i]);
+            free(bt.positivePairs[i]);
+        }
+        free(truthPositives[i]);
+    }
+    profile_end(span);
+    // clean up
+    free(truthPositives);
+    blockTests_destruct(&bt);
+    for (uint64_t g = 0; g < numTruthSamples; ++g) {
+        pairStore_destruct(truthPairs[g]);
+    }
+    free(truthPairs);
+    free(numPairs1);
+    stList_destruct(truthSequences);
+}
@@ -0,0 +1,72 @@
+/*
+ * Copyright (C) 2012 by
+ * Dent Earl (dearl@soe.ucsc.edu, dentearl@gmail.com)
+ * ... and other members of the Reconstruction Team of David Haussler's
+ * lab (BME Dept. UCSC).
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef _COMPARATOR_BATCH_H_
+#define _COMPARATOR_BATCH_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "sonLib.h"
+#include "comparatorAPI.h"
+#include "comparatorPairStore.h"
+
+// With --batch FILE one truth maf, --maf1, is compared to every prediction listed in FILE, one
+// per line as <prediction maf> <report xml>, and a report is written for each. The truth is
+// sampled once for each distinct set of sequences it shares with a prediction, predictions that
+// share the same sequences sharing a sample, and each prediction is read once, sampling its pairs
+// and testing its truth sample on it in the same pass. One last pass over the truth tests every
+// prediction's sample. The truth and the predictions are sampled with the random numbers of a
+// single comparison, see comparisonSeed(), so a prediction's report is that of a single comparison
+// with the same seed, whatever the other predictions and whether the truth sample was read from
+// --truthPairs.
+typedef struct _batchComparison {
+    // one prediction of a --batch run
+    char *mafFile2;
+    char *outputFile;
+    stSet *legitSequences; // the sequences shared by the truth and mafFile2
+    stHash *wigglePairHash;
+    uint64_t numPairs1; // of the truth, over legitSequences
+    uint64_t numPairs2;
+    uint64_t truthSample; // the index of the truth sample tested, shared by equal legitSequences
+    stSortedSet *results_12; // NULL until compareMAFsInBatch()
+    stSortedSet *results_21;
+} BatchComparison;
+
+BatchComparison* batchComparison_construct(const char *mafFile2, const char *outputFile);
+void batchComparison_destruct(BatchComparison *bc);
+stList* readBatchFile(const char *filename); // of BatchComparison, exits on a malformed line
+// fills in each comparison's legitSequences and wigglePairHash, as buildSeqNamesSet() does for a
+// single comparison, and sets truthSequences to the union of the legitSequences.
+void buildBatchSeqNamesSets(Options *options, stList *batch, stSet *truthSequences,
+                            stHash *sequenceLengthHash, stList *wigglePairPatternList);
+// --truthPairs. the first truth sample is kept in FILE and the g'th after it in FILE.g. a file is only
+// used while --maf1, the sequences sampled and the sampling options match those it was written
+// with, readTruthPairs() returns false otherwise. *pairs is NULL when the truth has no pairs.
+bool readTruthPairs(const char *path, Options *options, stSet *truthSequences, PairStore **pairs,
+                    uint64_t *numPairs1);
+void writeTruthPairs(const char *path, Options *options, stSet *truthSequences, PairStore *pairs,
+                     uint64_t numPairs1);
+void compareMAFsInBatch(Options *options, stList *batch, stHash *intervalsHash, stHash *sequenceLengthHash);
+
+#endif // _COMPARATOR_BATCH_H_
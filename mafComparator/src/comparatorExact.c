@@ -0,0 +1,686 @@
+/*
+ * Copyright (C) 2012 by
+ * Dent Earl (dearl@soe.ucsc.edu, dentearl@gmail.com)
+ * ... and other members of the Reconstruction Team of David Haussler's
+ * lab (BME Dept. UCSC).
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#define _POSIX_C_SOURCE 200809L // mkstemp(), fdopen()
+#include <assert.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "sonLib.h"
+#include "common.h"
+#include "sharedMaf.h"
+#include "parallel.h"
+#include "profile.h"
+#include "comparatorAPI.h"
+#include "comparatorPairStore.h"
+#include "comparatorExact.h"
+
+static const uint64_t kPairSorterMinRecords = 4096; // smallest read buffer of a run being merged
+static const uint64_t kPairSorterMaxFanIn = 128; // runs merged at once, bounds the open files
+static const uint64_t kPairSorterMinSlice = 65536; // records per worker when sorting a run
+static const uint64_t kPairFilterBitsPerPair = 16; // of a Bloom filter, about 0.05% false positives
+static const unsigned kPairFilterHashes = 8;
+
+typedef struct _pairRun {
+    // a sorted run of records, either a slice of the sorter's buffer or a temporary file
+    // read back through a buffer of its own
+    FILE *fp; // NULL for a run in memory
+    PackedPair *buffer;
+    uint64_t capacity; // of buffer, file runs only
+    uint64_t length;
+    uint64_t next;
+} PairRun;
+typedef struct _pairMerger {
+    // k-way merge of sorted runs into one sorted stream with the duplicates dropped
+    PairRun *runs;
+    uint64_t *heap; // indices of the runs that are not used up, a min heap on their next records
+    uint64_t heapLength;
+    PackedPair last;
+    bool hasLast;
+} PairMerger;
+struct _pairSorter {
+    char *tmpDir;
+    uint64_t memoryRecords;
+    unsigned numThreads;
+    PackedPair *buffer; // records not yet sorted into a run
+    uint64_t length;
+    uint64_t capacity;
+    PairRun *runs;
+    uint64_t numRuns;
+    uint64_t numSpilled;
+    PairMerger merger;
+    bool isFinished;
+};
+typedef struct _pairFilter {
+    // a Bloom filter of records, no false negatives
+    uint64_t *words;
+    uint64_t mask; // the number of bits, a power of two, less one
+} PairFilter;
+
+static int cmpPair(const PackedPair *p1, const PackedPair *p2) {
+    if (p1->key1 != p2->key1) {
+        return (p1->key1 < p2->key1) ? -1 : 1;
+    }
+    if (p1->key2 != p2->key2) {
+        return (p1->key2 < p2->key2) ? -1 : 1;
+    }
+    return 0;
+}
+static int cmpPairVoid(const void *a, const void *b) {
+    return cmpPair((const PackedPair *) a, (const PackedPair *) b);
+}
+static FILE* openRunFile(const char *tmpDir) {
+    // an anonymous file, it is unlinked right away and so goes when it is closed
+    char *path = stString_print("%s/mafComparator.XXXXXX", tmpDir);
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        fprintf(stderr, "Error, unable to create a temporary file in %s\n", tmpDir);
+        exit(EXIT_FAILURE);
+    }
+    unlink(path);
+    free(path);
+    FILE *fp = fdopen(fd, "w+b");
+    if (fp == NULL) {
+        fprintf(stderr, "Error, unable to open a temporary file in %s\n", tmpDir);
+        exit(EXIT_FAILURE);
+    }
+    return fp;
+}
+static PackedPair* pairRun_peek(PairRun *run) {
+    // the next record of the run, NULL once it is used up
+    if (run->next == run->length) {
+        if (run->fp == NULL) {
+            return NULL;
+        }
+        run->length = fread(run->buffer, sizeof(*(run->buffer)), run->capacity, run->fp);
+        run->next = 0;
+        if (run->length == 0) {
+            return NULL;
+        }
+    }
+    return run->buffer + run->next;
+}
+static bool pairMerger_lessThan(PairMerger *m, uint64_t i, uint64_t j) {
+    return cmpPair(pairRun_peek(m->runs + m->heap[i]), pairRun_peek(m->runs + m->heap[j])) < 0;
+}
+static void pairMerger_siftDown(PairMerger *m, uint64_t i) {
+    for (;;) {
+        uint64_t smallest = i;
+        uint64_t l = 2 * i + 1;
+        uint64_t r = l + 1;
+        if (l < m->heapLength && pairMerger_lessThan(m, l, smallest)) {
+            smallest = l;
+        }
+        if (r < m->heapLength && pairMerger_lessThan(m, r, smallest)) {
+            smallest = r;
+        }
+        if (smallest == i) {
+            return;
+        }
+        uint64_t t = m->heap[i];
+        m->heap[i] = m->heap[smallest];
+        m->heap[smallest] = t;
+        i = smallest;
+    }
+}
+static void pairMerger_init(PairMerger *m, PairRun *runs, uint64_t numRuns) {
+    m->runs = runs;
+    m->heap = (uint64_t *) st_malloc(sizeof(*(m->heap)) * (numRuns + 1));
+    m->heapLength = 0;
+    for (uint64_t i = 0; i < numRuns; ++i) {
+        if (pairRun_peek(runs + i) != NULL) {
+            m->heap[m->heapLength++] = i;
+        }
+    }
+    for (uint64_t i = m->heapLength / 2; i > 0; --i) {
+        pairMerger_siftDown(m, i - 1);
+    }
+    m->hasLast = false;
+}
+static void pairMerger_clear(PairMerger *m) {
+    free(m->heap);
+    m->heap = NULL;
+    m->heapLength = 0;
+}
+static bool pairMerger_next(PairMerger *m, PackedPair *pair) {
+    while (m->heapLength > 0) {
+        PairRun *run = m->runs + m->heap[0];
+        *pair = *pairRun_peek(run);
+        ++(run->next);
+        if (pairRun_peek(run) == NULL) {
+            m->heap[0] = m->heap[--(m->heapLength)];
+        }
+        pairMerger_siftDown(m, 0);
+        if (!m->hasLast || cmpPair(&(m->last), pair) != 0) {
+            m->last = *pair;
+            m->hasLast = true;
+            return true;
+        }
+    }
+    return false;
+}
+PairSorter* pairSorter_construct(const char *tmpDir, uint64_t memoryBytes, unsigned numThreads) {
+    PairSorter *sorter = (PairSorter *) st_calloc(1, sizeof(*sorter));
+    sorter->tmpDir = stString_copy(tmpDir);
+    sorter->memoryRecords = memoryBytes / sizeof(PackedPair);
+    if (sorter->memoryRecords < 2 * kPairSorterMinRecords) {
+        sorter->memoryRecords = 2 * kPairSorterMinRecords;
+    }
+    sorter->numThreads = numThreads;
+    return sorter;
+}
+void pairSorter_destruct(PairSorter *sorter) {
+    if (sorter == NULL) {
+        return;
+    }
+    for (uint64_t i = 0; i < sorter->numRuns; ++i) {
+        if (sorter->runs[i].fp != NULL) {
+            fclose(sorter->runs[i].fp);
+            free(sorter->runs[i].buffer);
+        }
+    }
+    pairMerger_clear(&(sorter->merger));
+    free(sorter->runs);
+    free(sorter->buffer);
+    free(sorter->tmpDir);
+    free(sorter);
+}
+typedef struct _sliceSort {
+    PackedPair *buffer;
+    uint64_t length;
+    uint64_t numSlices;
+} SliceSort;
+static uint64_t sliceStart(SliceSort *s, uint64_t i) {
+    return (s->length / s->numSlices) * i + ((i < s->length % s->numSlices) ? i : s->length % s->numSlices);
+}
+static void sortSlice(uint64_t i, unsigned worker, void *data) {
+    SliceSort *s = (SliceSort *) data;
+    uint64_t start = sliceStart(s, i);
+    if (sliceStart(s, i + 1) - start < 2) {
+        return;
+    }
+    qsort(s->buffer + start, sliceStart(s, i + 1) - start, sizeof(*(s->buffer)), cmpPairVoid);
+}
+static PairRun* sortBuffer(PairSorter *sorter, uint64_t *numSlices) {
+    // sort the buffer in slices, one per worker, and return the slices as runs in memory
+    SliceSort s;
+    s.buffer = sorter->buffer;
+    s.length = sorter->length;
+    s.numSlices = parallel_numberOfWorkers(sorter->numThreads, s.length / kPairSorterMinSlice);
+    parallel_for(s.numSlices, s.numSlices, sortSlice, &s);
+    PairRun *slices = (PairRun *) st_calloc(s.numSlices, sizeof(*slices));
+    for (uint64_t i = 0; i < s.numSlices; ++i) {
+        slices[i].buffer = sorter->buffer + sliceStart(&s, i);
+        slices[i].length = sliceStart(&s, i + 1) - sliceStart(&s, i);
+    }
+    *numSlices = s.numSlices;
+    return slices;
+}
+static void appendRun(PairSorter *sorter, PairRun *run) {
+    sorter->runs = (PairRun *) realloc(sorter->runs, sizeof(*(sorter->runs)) * (sorter->numRuns + 1));
+    if (sorter->runs == NULL) {
+        fprintf(stderr, "Error, unable to grow the list of sorted runs.\n");
+        exit(EXIT_FAILURE);
+    }
+    sorter->runs[sorter->numRuns++] = *run;
+}
+static void spillRuns(PairSorter *sorter, PairRun *runs, uint64_t numRuns) {
+    // merge runs into a new run in a temporary file, which is appended to the sorter's runs
+    PairRun run;
+    memset(&run, 0, sizeof(run));
+    run.fp = openRunFile(sorter->tmpDir);
+    PairMerger m;
+    PackedPair pair;
+    pairMerger_init(&m, runs, numRuns);
+    while (pairMerger_next(&m, &pair)) {
+        fwrite(&pair, sizeof(pair), 1, run.fp);
+    }
+    pairMerger_clear(&m);
+    if (fflush(run.fp) != 0 || ferror(run.fp)) {
+        fprintf(stderr, "Error, unable to write a sorted run to a temporary file in %s\n", sorter->tmpDir);
+        exit(EXIT_FAILURE);
+    }
+    rewind(run.fp);
+    appendRun(sorter, &run);
+    ++(sorter->numSpilled);
+}
+static void spillBuffer(PairSorter *sorter) {
+    uint64_t numSlices;
+    PairRun *slices = sortBuffer(sorter, &numSlices);
+    spillRuns(sorter, slices, numSlices);
+    free(slices);
+    sorter->length = 0;
+}
+void pairSorter_add(PairSorter *sorter, uint64_t key1, uint64_t key2) {
+    assert(!sorter->isFinished);
+    if (sorter->length == sorter->capacity) {
+        if (sorter->capacity == sorter->memoryRecords) {
+            spillBuffer(sorter);
+        } else {
+            // grow up to the memory bound, small inputs never take all of it
+            sorter->capacity = (sorter->capacity == 0) ? kPairSorterMinRecords : 2 * sorter->capacity;
+            if (sorter->capacity > sorter->memoryRecords) {
+                sorter->capacity = sorter->memoryRecords;
+            }
+            sorter->buffer = (PackedPair *) realloc(sorter->buffer, sizeof(*(sorter->buffer)) * sorter->capacity);
+            if (sorter->buffer == NULL) {
+                fprintf(stderr, "Error, unable to grow the pair sort buffer to %" PRIu64 " pairs.\n",
+                        sorter->capacity);
+                exit(EXIT_FAILURE);
+            }
+        }
+    }
+    sorter->buffer[sorter->length].key1 = key1;
+    sorter->buffer[sorter->length].key2 = key2;
+    ++(sorter->length);
+}
+static void giveRunsBuffers(PairSorter *sorter, PairRun *runs, uint64_t numRuns) {
+    // split the memory bound between the file runs about to be merged
+    uint64_t capacity = sorter->memoryRecords / (numRuns + 1);
+    if (capacity < kPairSorterMinRecords) {
+        capacity = kPairSorterMinRecords;
+    }
+    for (uint64_t i = 0; i < numRuns; ++i) {
+        runs[i].capacity = capacity;
+        runs[i].buffer = (PackedPair *) st_malloc(sizeof(*(runs[i].buffer)) * capacity);
+        runs[i].length = 0;
+        runs[i].next = 0;
+    }
+}
+static void closeRuns(PairRun *runs, uint64_t numRuns) {
+    for (uint64_t i = 0; i < numRuns; ++i) {
+        fclose(runs[i].fp);
+        free(runs[i].buffer);
+    }
+}
+void pairSorter_finish(PairSorter *sorter) {
+    assert(!sorter->isFinished);
+    sorter->isFinished = true;
+    if (sorter->numSpilled == 0) {
+        // everything fit, merge straight out of the sorted buffer
+        free(sorter->runs);
+        sorter->runs = sortBuffer(sorter, &(sorter->numRuns));
+        pairMerger_init(&(sorter->merger), sorter->runs, sorter->numRuns);
+        return;
+    }
+    if (sorter->length > 0) {
+        spillBuffer(sorter);
+    }
+    free(sorter->buffer);
+    sorter->buffer = NULL;
+    sorter->capacity = 0;
+    // merge passes until the remaining runs can be merged at once
+    uint64_t fanIn = sorter->memoryRecords / kPairSorterMinRecords - 1;
+    if (fanIn > kPairSorterMaxFanIn) {
+        fanIn = kPairSorterMaxFanIn;
+    }
+    if (fanIn < 2) {
+        fanIn = 2;
+    }
+    while (sorter->numRuns > fanIn) {
+        giveRunsBuffers(sorter, sorter->runs, fanIn);
+        spillRuns(sorter, sorter->runs, fanIn);
+        closeRuns(sorter->runs, fanIn);
+        sorter->numRuns -= fanIn;
+        memmove(sorter->runs, sorter->runs + fanIn, sizeof(*(sorter->runs)) * sorter->numRuns);
+    }
+    giveRunsBuffers(sorter, sorter->runs, sorter->numRuns);
+    pairMerger_init(&(sorter->merger), sorter->runs, sorter->numRuns);
+}
+bool pairSorter_next(PairSorter *sorter, PackedPair *pair) {
+    assert(sorter->isFinished);
+    return pairMerger_next(&(sorter->merger), pair);
+}
+uint64_t pairSorter_getNumberOfSpilledRuns(PairSorter *sorter) {
+    return sorter->numSpilled;
+}
+static void pairFilter_init(PairFilter *f, uint64_t numPairs, uint64_t memoryBytes) {
+    // kPairFilterBitsPerPair bits for each of the numPairs records expected, as far as memoryBytes allows
+    uint64_t numBits = 64;
+    while (numBits < numPairs * kPairFilterBitsPerPair && numBits * 2 <= memoryBytes * 8) {
+        numBits *= 2;
+    }
+    f->words = (uint64_t *) st_calloc(numBits / 64, sizeof(*(f->words)));
+    f->mask = numBits - 1;
+}
+static void pairFilter_hash(PackedPair *p, uint64_t *h1, uint64_t *h2) {
+    // two mixes of the record (splitmix64's finalizer), the filter's bits are h1 + i * h2
+    uint64_t x = p->key1 * 0x9e3779b97f4a7c15ULL ^ p->key2;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    *h1 = x ^ (x >> 31);
+    x = *h1 + p->key2;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    *h2 = (x ^ (x >> 31)) | 1;
+}
+static void pairFilter_add(PairFilter *f, PackedPair *p) {
+    uint64_t h1, h2;
+    pairFilter_hash(p, &h1, &h2);
+    for (unsigned i = 0; i < kPairFilterHashes; ++i) {
+        uint64_t bit = (h1 + i * h2) & f->mask;
+        f->words[bit >> 6] |= (uint64_t) 1 << (bit & 63);
+    }
+}
+static bool pairFilter_mayContain(PairFilter *f, PackedPair *p) {
+    uint64_t h1, h2;
+    pairFilter_hash(p, &h1, &h2);
+    for (unsigned i = 0; i < kPairFilterHashes; ++i) {
+        uint64_t bit = (h1 + i * h2) & f->mask;
+        if ((f->words[bit >> 6] & ((uint64_t) 1 << (bit & 63))) == 0) {
+            return false;
+        }
+    }
+    return true;
+}
+static uint64_t streamPairsFromBlock(const char *filename, mafBlock_t *mb, PairStore *names,
+                                     stSet *legitSequences, stHash *sequenceLengthHash, PairFilter *filter,
+                                     PairSorter *sorter) {
+    // filter, if not NULL, passes the pairs added to sorter, every pair is counted
+    uint64_t numSeqs = maf_mafBlock_getNumberOfSequences(mb);
+    uint64_t numPairs = 0;
+    if (numSeqs < 2) {
+        return 0;
+    }
+    validateMafBlockSourceLengths(filename, mb, sequenceLengthHash);
+    uint64_t seqFieldLength = maf_mafBlock_getSequenceFieldLength(mb);
+    char **seqNames = maf_mafBlock_getSpeciesArray(mb);
+    bool *legitRows = getLegitRows(seqNames, numSeqs, legitSequences);
+    if (sumBoolArray(legitRows, numSeqs) >= 2) {
+        char **mat = maf_mafBlock_getSequenceMatrix(mb, numSeqs, seqFieldLength);
+        uint64_t *allPositions = maf_mafBlock_getPosCoordStartArray(mb);
+        int *allStrandInts = maf_mafBlock_getStrandIntArray(mb);
+        int64_t *rowNameIds = (int64_t *) st_malloc(sizeof(*rowNameIds) * numSeqs);
+        uint64_t *keys = (uint64_t *) st_malloc(sizeof(*keys) * numSeqs);
+        for (uint64_t r = 0; r < numSeqs; ++r) {
+            rowNameIds[r] = legitRows[r] ? pairStore_getNameId(names, seqNames[r]) : -1;
+        }
+        for (uint64_t c = 0; c < seqFieldLength; ++c) {
+            uint64_t n = 0;
+            for (uint64_t r = 0; r < numSeqs; ++r) {
+                if (rowNameIds[r] < 0 || mat[r][c] == '-') {
+                    continue;
+                }
+                if (!pairStore_isStorablePosition(allPositions[r])) {
+                    fprintf(stderr, "Error, position %" PRIu64 " of %s is too large to compare.\n",
+                            allPositions[r], seqNames[r]);
+                    exit(EXIT_FAILURE);
+                }
+                keys[n++] = pairStore_packPosition((uint64_t) rowNameIds[r], allPositions[r]);
+            }
+            // records are stored in seq1 <= seq2 order, as pairStore_add() does
+            PackedPair p;
+            for (uint64_t i = 0; i < n; ++i) {
+                for (uint64_t j = i + 1; j < n; ++j) {
+                    p.key1 = (keys[i] <= keys[j]) ? keys[i] : keys[j];
+                    p.key2 = (keys[i] <= keys[j]) ? keys[j] : keys[i];
+                    if (filter == NULL || pairFilter_mayContain(filter, &p)) {
+                        pairSorter_add(sorter, p.key1, p.key2);
+                    }
+                }
+            }
+            numPairs += chooseTwo(n);
+            updatePositions(mat, c, allPositions, allStrandInts, numSeqs);
+        }
+        free(keys);
+        free(rowNameIds);
+        free(allPositions);
+        free(allStrandInts);
+        maf_mafBlock_destroySequenceMatrix(mat, numSeqs);
+    }
+    // clean up
+    for (uint64_t i = 0; i < numSeqs; ++i) {
+        free(seqNames[i]);
+    }
+    free(seqNames);
+    free(legitRows);
+    return numPairs;
+}
+static uint64_t streamFilteredPairsFromMaf(const char *filename, PairStore *names, stSet *legitSequences,
+                                           stHash *sequenceLengthHash, PairFilter *filter, PairSorter *sorter) {
+    mafFileApi_t *mfa = maf_newMfa(filename, "r");
+    mafBlock_t *mb = NULL;
+    uint64_t numPairs = 0;
+    while ((mb = maf_readBlock(mfa)) != NULL) {
+        numPairs += streamPairsFromBlock(filename, mb, names, legitSequences, sequenceLengthHash, filter, sorter);
+        maf_destroyMafBlockList(mb);
+    }
+    maf_destroyMfa(mfa);
+    return numPairs;
+}
+uint64_t streamPairsFromMaf(const char *filename, PairStore *names, stSet *legitSequences,
+                            stHash *sequenceLengthHash, PairSorter *sorter) {
+    return streamFilteredPairsFromMaf(filename, names, legitSequences, sequenceLengthHash, NULL, sorter);
+}
+typedef struct _exactTally {
+    // one direction of the comparison. the stream is sorted so consecutive pairs mostly share
+    // their sequences, the last ResultPair and wiggle container looked up are kept.
+    stSortedSet *results;
+    bool isAtoB;
+    uint64_t id1;
+    uint64_t id2;
+    ResultPair *resultPair;
+    WiggleContainer *wc;
+    bool isSeq1Ref;
+    PairIntervals *intervals;
+    PairWiggles *wiggles;
+} ExactTally;
+static void exactTally_init(ExactTally *t, bool isAtoB, PairStore *names, stHash *intervalsHash,
+                            stHash *wigglePairHash) {
+    t->results = stSortedSet_construct3((int(*)(const void *, const void *)) aPair_cmpFunction_seqsOnly,
+                                        (void(*)(void *)) aPair_destruct);
+    t->isAtoB = isAtoB;
+    t->id1 = UINT64_MAX;
+    t->id2 = UINT64_MAX;
+    t->intervals = pairIntervals_construct(names, intervalsHash);
+    t->wiggles = pairWiggles_construct(names, wigglePairHash);
+}
+static void exactTally_add(ExactTally *t, PairStore *names, PackedPair *p, bool isFound,
+                           uint64_t wiggleBinLength) {
+    APair pair;
+    uint64_t id1, id2;
+    bool isInInterval1, isInInterval2;
+    pairStore_unpackPosition(p->key1, &id1, &(pair.pos1));
+    pairStore_unpackPosition(p->key2, &id2, &(pair.pos2));
+    pair.seq1 = pairStore_getName(names, id1);
+    pair.seq2 = pairStore_getName(names, id2);
+    if (id1 != t->id1 || id2 != t->id2) {
+        t->id1 = id1;
+        t->id2 = id2;
+        t->resultPair = getResultPair(t->results, pair.seq1, pair.seq2);
+        t->wc = pairWiggles_get(t->wiggles, id1, id2, &(t->isSeq1Ref));
+    }
+    pairIntervals_locate(t->intervals, id1, pair.pos1, id2, pair.pos2, &isInInterval1, &isInInterval2);
+    tallyHomologyResult(t->resultPair, t->wc, t->isSeq1Ref ? pair.pos1 : pair.pos2,
+                        isInInterval1, isInInterval2, &pair, isFound, t->isAtoB, wiggleBinLength);
+}
+static PairSorter* sortPairsOfMaf(const char *filename, uint64_t *numberOfPairs, PairStore *names,
+                                  stSet *legitSequences, stHash *sequenceLengthHash, Options *options,
+                                  const char *tmpDir) {
+    // each maf gets half of the memory, both are merged at the same time in the join
+    PairSorter *sorter = pairSorter_construct(tmpDir, options->exactMemory / 2, options->numThreads);
+    profileSpan_t span = profile_begin("streamPairsFromMaf");
+    uint64_t n = streamPairsFromMaf(filename, names, legitSequences, sequenceLengthHash, sorter);
+    profile_end(span);
+    if (*numberOfPairs != 0 && n != *numberOfPairs) {
+        fprintf(stderr, "Error, differing numberOfPairs values, %" PRIu64 " != %" PRIu64 "\n", n, *numberOfPairs);
+        exit(EXIT_FAILURE);
+    }
+    *numberOfPairs = n;
+    span = profile_begin("pairSorter_finish");
+    pairSorter_finish(sorter);
+    profile_end(span);
+    st_logInfo("Sorted the %" PRIu64 " pairs of %s, %" PRIu64 " runs spilled\n", n, filename,
+               pairSorter_getNumberOfSpilledRuns(sorter));
+    return sorter;
+}
+static const char* getTmpDir(Options *options) {
+    const char *tmpDir = options->tmpDir;
+    if (tmpDir == NULL) {
+        tmpDir = getenv("TMPDIR");
+    }
+    if (tmpDir == NULL || tmpDir[0] == '\0') {
+        tmpDir = "/tmp";
+    }
+    return tmpDir;
+}
+void compareMAFsExactly(Options *options, stSet *legitSequences, stHash *intervalsHash,
+                        stHash *wigglePairHash, stHash *sequenceLengthHash,
+                        stSortedSet **results_12, stSortedSet **results_21) {
+    /* The maf1 -> maf2 and maf2 -> maf1 comparisons over every pair of both mafs. The two sorted
+     * streams of distinct pairs are walked side by side, a pair on only one side is a negative
+     * test of that side, a pair on both a positive test of each.
+     */
+    const char *tmpDir = getTmpDir(options);
+    PairStore *names = pairStore_construct(legitSequences);
+    PairSorter *sorter1 = sortPairsOfMaf(options->mafFile1, &(options->numPairs1), names, legitSequences,
+                                         sequenceLengthHash, options, tmpDir);
+    PairSorter *sorter2 = sortPairsOfMaf(options->mafFile2, &(options->numPairs2), names, legitSequences,
+                                         sequenceLengthHash, options, tmpDir);
+    ExactTally t12, t21;
+    exactTally_init(&t12, true, names, intervalsHash, wigglePairHash);
+    exactTally_init(&t21, false, names, intervalsHash, wigglePairHash);
+    profileSpan_t span = profile_begin("joinPairs");
+    PackedPair p1, p2;
+    bool has1 = pairSorter_next(sorter1, &p1);
+    bool has2 = pairSorter_next(sorter2, &p2);
+    while (has1 || has2) {
+        int c = !has1 ? 1 : (!has2 ? -1 : cmpPair(&p1, &p2));
+        if (c <= 0) {
+            exactTally_add(&t12, names, &p1, c == 0, options->wiggleBinLength);
+            has1 = pairSorter_next(sorter1, &p1);
+        }
+        if (c >= 0) {
+            exactTally_add(&t21, names, &p2, c == 0, options->wiggleBinLength);
+            has2 = pairSorter_next(sorter2, &p2);
+        }
+    }
+    profile_end(span);
+    *results_12 = t12.results;
+    *results_21 = t21.results;
+    // clean up
+    pairIntervals_destruct(t12.intervals);
+    pairIntervals_destruct(t21.intervals);
+    pairWiggles_destruct(t12.wiggles);
+    pairWiggles_destruct(t21.wiggles);
+    pairSorter_destruct(sorter1);
+    pairSorter_destruct(sorter2);
+    pairStore_destruct(names);
+}
+static PairSorter* sortSampleOfMaf(const char *mafFileA, uint64_t *numberOfPairs, bool isCached,
+                                   PairStore *names, stSet *legitSequences, stHash *sequenceLengthHash,
+                                   Options *options, uint64_t seed, PairFilter *filter, const char *tmpDir) {
+    // samplePairsForComparison() with the sample sorted by a PairSorter and added to filter. names
+    // is scratch space for the pairs of a block.
+    PairSampler sampler;
+    pairSampler_initBernoulli(&sampler, ((double) options->numberOfSamples) / (double) *numberOfPairs, seed);
+    PairSorter *sorter = pairSorter_construct(tmpDir, options->sampleMemory / 3, options->numThreads);
+    bool *isShardName = (bool *) st_malloc(sizeof(*isShardName) * (names->numNames + 1));
+    for (uint64_t id = 0; id < names->numNames; ++id) {
+        isShardName[id] = options->shardSequences == NULL
+            || stSet_search(options->shardSequences, pairStore_getName(names, id)) != NULL;
+    }
+    uint64_t *chooseTwoArray = buildChooseTwoArray();
+    uint64_t verifiedNumberOfPairs = 0;
+    profileSpan_t span = profile_begin("samplePairsFromMaf");
+    mafFileApi_t *mfa = maf_newMfa(mafFileA, "r");
+    mafBlock_t *mb = NULL;
+    while ((mb = maf_readBlock(mfa)) != NULL) {
+        pairStore_clear(names);
+        walkBlockSamplingPairs(mafFileA, mb, names, &sampler, legitSequences, chooseTwoArray,
+                               &verifiedNumberOfPairs, sequenceLengthHash);
+        for (uint64_t i = 0; i < names->length; ++i) {
+            PackedPair *p = names->pairs + i;
+            uint64_t id1, pos1;
+            pairStore_unpackPosition(p->key1, &id1, &pos1);
+            if (isShardName[id1]) {
+                pairSorter_add(sorter, p->key1, p->key2);
+                pairFilter_add(filter, p);
+            }
+        }
+        maf_destroyMafBlockList(mb);
+    }
+    maf_destroyMfa(mfa);
+    pairStore_clear(names);
+    profile_end(span);
+    checkNumberOfPairs(mafFileA, numberOfPairs, verifiedNumberOfPairs, isCached, legitSequences, options);
+    span = profile_begin("pairSorter_finish");
+    pairSorter_finish(sorter);
+    profile_end(span);
+    st_logInfo("Sorted the sample of %s, %" PRIu64 " runs spilled\n", mafFileA,
+               pairSorter_getNumberOfSpilledRuns(sorter));
+    free(chooseTwoArray);
+    free(isShardName);
+    return sorter;
+}
+stSortedSet* compareMAFsInBoundedMemory(const char *mafFileA, const char *mafFileB, uint64_t *numberOfPairs,
+                                        stSet *legitSequences, stHash *intervalsHash, stHash *wigglePairHash,
+                                        bool isAtoB, Options *options, stHash *sequenceLengthHash) {
+    // compareMAFs_AB() holding no more than options->sampleMemory bytes of pairs
+    const char *tmpDir = getTmpDir(options);
+    ExactTally t;
+    PairStore *names = pairStore_construct(legitSequences);
+    exactTally_init(&t, isAtoB, names, intervalsHash, wigglePairHash);
+    bool isCached = lookUpNumberOfPairs(mafFileA, NULL, numberOfPairs, legitSequences, options);
+    if (*numberOfPairs == 0) {
+        // nothing to sample
+        pairIntervals_destruct(t.intervals);
+        pairWiggles_destruct(t.wiggles);
+        pairStore_destruct(names);
+        return t.results;
+    }
+    PairFilter filter;
+    pairFilter_init(&filter, options->numberOfSamples, options->sampleMemory / 3);
+    PairSorter *sample = sortSampleOfMaf(mafFileA, numberOfPairs, isCached, names, legitSequences,
+                                         sequenceLengthHash, options, comparisonSeed(options, isAtoB),
+                                         &filter, tmpDir);
+    // the pairs of mafFileB that may have been sampled
+    PairSorter *other = pairSorter_construct(tmpDir, options->sampleMemory / 3, options->numThreads);
+    profileSpan_t span = profile_begin("streamPairsFromMaf");
+    streamFilteredPairsFromMaf(mafFileB, names, legitSequences, sequenceLengthHash, &filter, other);
+    profile_end(span);
+    free(filter.words);
+    span = profile_begin("pairSorter_finish");
+    pairSorter_finish(other);
+    profile_end(span);
+    span = profile_begin("joinPairs");
+    PackedPair p, q;
+    bool hasOther = pairSorter_next(other, &q);
+    while (pairSorter_next(sample, &p)) {
+        while (hasOther && cmpPair(&q, &p) < 0) {
+            hasOther = pairSorter_next(other, &q);
+        }
+        exactTally_add(&t, names, &p, hasOther && cmpPair(&q, &p) == 0, options->wiggleBinLength);
+    }
+    profile_end(span);
+    // clean up
+    pairIntervals_destruct(t.intervals);
+    pairWiggles_destruct(t.wiggles);
+    pairSorter_destruct(sample);
+    pairSorter_destruct(other);
+    pairStore_destruct(names);
+    return t.results;
+}
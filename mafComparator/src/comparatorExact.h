@@ -0,0 +1,70 @@
+/*
+ * Copyright (C) 2012 by
+ * Dent Earl (dearl@soe.ucsc.edu, dentearl@gmail.com)
+ * ... and other members of the Reconstruction Team of David Haussler's
+ * lab (BME Dept. UCSC).
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef _COMPARATOR_EXACT_H_
+#define _COMPARATOR_EXACT_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "sonLib.h"
+#include "comparatorAPI.h"
+#include "comparatorPairStore.h"
+
+// With --exact every pair of aligned positions in each maf is tested, rather than a sample.
+// The pairs of a maf are streamed out as the packed records of comparatorPairStore.h into a
+// PairSorter, which sorts them in runs of bounded size, spills the runs to temporary files
+// once they no longer fit in memory and k-way merges them back into one sorted stream of
+// distinct pairs. The two streams are then merge joined, which makes both comparisons in a
+// single pass: a pair of one maf is found in the other when it is equal to one of its pairs,
+// so --near is not supported.
+typedef struct _pairSorter PairSorter;
+
+// memoryBytes bounds the records held in memory, run files are made in tmpDir. runs are sorted
+// with up to numThreads workers, 0 for one per processor.
+PairSorter* pairSorter_construct(const char *tmpDir, uint64_t memoryBytes, unsigned numThreads);
+void pairSorter_destruct(PairSorter *sorter);
+void pairSorter_add(PairSorter *sorter, uint64_t key1, uint64_t key2);
+void pairSorter_finish(PairSorter *sorter); // no more adds, pairSorter_next() may be called
+bool pairSorter_next(PairSorter *sorter, PackedPair *pair); // false once the pairs run out
+uint64_t pairSorter_getNumberOfSpilledRuns(PairSorter *sorter);
+// add every pair of aligned positions of the legit sequences in filename to sorter, names gives
+// the name ids. returns the number of pairs, counted as countPairsInMaf() does.
+uint64_t streamPairsFromMaf(const char *filename, PairStore *names, stSet *legitSequences,
+                            stHash *sequenceLengthHash, PairSorter *sorter);
+void compareMAFsExactly(Options *options, stSet *legitSequences, stHash *intervalsHash,
+                        stHash *wigglePairHash, stHash *sequenceLengthHash,
+                        stSortedSet **results_12, stSortedSet **results_21);
+
+// With --sampleMemory a Bernoulli sample too large to hold in memory is drawn as usual, block by
+// block, but fed to a PairSorter bounded by a third of --sampleMemory rather than kept in a
+// PairStore. A Bloom filter of the sample, in another third, lets through only the pairs of the
+// other maf that may be in the sample, which a second PairSorter sorts in the last third, and the
+// two sorted streams are merge joined as --exact does. With --near 0 a sampled pair is found in the
+// other maf exactly when one of its pairs is equal to it, so the results are those of
+// compareMAFs_AB().
+stSortedSet* compareMAFsInBoundedMemory(const char *mafFileA, const char *mafFileB, uint64_t *numberOfPairs,
+                                        stSet *legitSequences, stHash *intervalsHash, stHash *wigglePairHash,
+                                        bool isAtoB, Options *options, stHash *sequenceLengthHash);
+
+#endif // _COMPARATOR_EXACT_H_
@@ -0,0 +1,168 @@
+/*
+ * Copyright (C) 2012 by
+ * Dent Earl (dearl@soe.ucsc.edu, dentearl@gmail.com)
+ * ... and other members of the Reconstruction Team of David Haussler's
+ * lab (BME Dept. UCSC).
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#define _POSIX_C_SOURCE 200809L // stat()
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include "sonLib.h"
+#include "common.h"
+#include "sharedMaf.h"
+#include "comparatorPairCount.h"
+
+static const char *kPairCountHeader = "##mafComparator pairCount version=1";
+
+typedef struct _pairCountEntry {
+    uint64_t mafSize;
+    int64_t mafTime;
+    uint64_t namesHash;
+    uint64_t numPairs;
+} PairCountEntry;
+
+char* pairCount_getCachePath(const char *filename) {
+    return stString_print("%s.pairCount", filename);
+}
+static int cmpNames(const void *a, const void *b) {
+    return strcmp(*(char * const *) a, *(char * const *) b);
+}
+uint64_t pairCount_hashNames(stSet *names) {
+    // de_fnv1a() over the names in strcmp order, each name terminated by its nul
+    uint64_t h = kFnv1aOffsetBasis;
+    if (names == NULL) {
+        return h;
+    }
+    uint64_t n = stSet_size(names);
+    char **sorted = (char **) st_malloc(sizeof(*sorted) * (n + 1));
+    stSetIterator *sit = stSet_getIterator(names);
+    uint64_t i = 0;
+    char *name;
+    while ((name = stSet_getNext(sit)) != NULL) {
+        sorted[i++] = name;
+    }
+    stSet_destructIterator(sit);
+    qsort(sorted, n, sizeof(*sorted), cmpNames);
+    for (i = 0; i < n; ++i) {
+        h = de_fnv1a(h, sorted[i], strlen(sorted[i]) + 1);
+    }
+    free(sorted);
+    return h;
+}
+bool pairCount_statMaf(const char *filename, uint64_t *mafSize, int64_t *mafTime) {
+    struct stat st;
+    if (maf_isStdStream(filename) || maf_isShardSpec(filename) || stat(filename, &st) != 0
+        || !S_ISREG(st.st_mode)) {
+        return false;
+    }
+    *mafSize = (uint64_t) st.st_size;
+    *mafTime = (int64_t) st.st_mtime;
+    return true;
+}
+static bool statMaf(const char *filename, PairCountEntry *e) {
+    // fills in the maf half of a cache entry, false if the maf can not be cached
+    return pairCount_statMaf(filename, &(e->mafSize), &(e->mafTime));
+}
+static stList* readEntries(const char *path) {
+    // every well formed line of the sidecar at path, empty if there is none
+    stList *entries = stList_construct3(0, free);
+    FILE *fp = fopen(path, "r");
+    if (fp == NULL) {
+        return entries;
+    }
+    char line[256];
+    if (fgets(line, sizeof(line), fp) == NULL || strncmp(line, kPairCountHeader, strlen(kPairCountHeader)) != 0) {
+        fclose(fp);
+        return entries;
+    }
+    PairCountEntry e;
+    while (fgets(line, sizeof(line), fp) != NULL) {
+        if (sscanf(line, "%" SCNu64 " %" SCNd64 " %" SCNx64 " %" SCNu64,
+                   &e.mafSize, &e.mafTime, &e.namesHash, &e.numPairs) == 4) {
+            PairCountEntry *copy = (PairCountEntry *) st_malloc(sizeof(*copy));
+            *copy = e;
+            stList_append(entries, copy);
+        }
+    }
+    fclose(fp);
+    return entries;
+}
+bool pairCount_readCache(const char *filename, stSet *names, uint64_t *numPairs) {
+    PairCountEntry current;
+    if (!statMaf(filename, &current)) {
+        return false;
+    }
+    current.namesHash = pairCount_hashNames(names);
+    char *path = pairCount_getCachePath(filename);
+    stList *entries = readEntries(path);
+    bool isFound = false;
+    for (int64_t i = 0; i < stList_length(entries); ++i) {
+        PairCountEntry *e = stList_get(entries, i);
+        if (e->mafSize == current.mafSize && e->mafTime == current.mafTime
+            && e->namesHash == current.namesHash) {
+            *numPairs = e->numPairs;
+            isFound = true;
+            break;
+        }
+    }
+    stList_destruct(entries);
+    free(path);
+    return isFound;
+}
+void pairCount_writeCache(const char *filename, stSet *names, uint64_t numPairs) {
+    // entries for other sets of names survive, entries for an older version of the maf do
+    // not. the sidecar is replaced with rename() so a reader never sees half of it.
+    PairCountEntry current;
+    if (!statMaf(filename, &current)) {
+        return;
+    }
+    current.namesHash = pairCount_hashNames(names);
+    current.numPairs = numPairs;
+    char *path = pairCount_getCachePath(filename);
+    char *tmpPath = NULL;
+    FILE *fp = de_openAtomic(path, &tmpPath);
+    if (fp == NULL) {
+        fprintf(stderr, "Warning, unable to write the pair count cache %s\n", path);
+        free(path);
+        return;
+    }
+    fprintf(fp, "%s\n", kPairCountHeader);
+    stList *entries = readEntries(path);
+    for (int64_t i = 0; i < stList_length(entries); ++i) {
+        PairCountEntry *e = stList_get(entries, i);
+        if (e->mafSize == current.mafSize && e->mafTime == current.mafTime
+            && e->namesHash != current.namesHash) {
+            fprintf(fp, "%" PRIu64 " %" PRId64 " %016" PRIx64 " %" PRIu64 "\n",
+                    e->mafSize, e->mafTime, e->namesHash, e->numPairs);
+        }
+    }
+    fprintf(fp, "%" PRIu64 " %" PRId64 " %016" PRIx64 " %" PRIu64 "\n",
+            current.mafSize, current.mafTime, current.namesHash, current.numPairs);
+    if (!de_closeAtomic(fp, tmpPath, path, ferror(fp) == 0)) {
+        fprintf(stderr, "Warning, unable to write the pair count cache %s\n", path);
+    }
+    stList_destruct(entries);
+    free(path);
+}
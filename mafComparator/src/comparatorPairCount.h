@@ -0,0 +1,45 @@
+/*
+ * Copyright (C) 2012 by
+ * Dent Earl (dearl@soe.ucsc.edu, dentearl@gmail.com)
+ * ... and other members of the Reconstruction Team of David Haussler's
+ * lab (BME Dept. UCSC).
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef _COMPARATOR_PAIR_COUNT_H_
+#define _COMPARATOR_PAIR_COUNT_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "sonLib.h"
+
+// The number of pairs in a maf (see countPairsInMaf()) depends on the maf and on the set of
+// sequences pairs are drawn from. With --pairCountCache it is remembered in a sidecar file,
+// FILE.pairCount, next to the maf. Each line of the sidecar is one count:
+//     <maf size in bytes> <maf mtime> <hash of the sorted sequence names, hex> <number of pairs>
+// and a line only counts while the maf's size and mtime still match. Standard input and
+// sharded mafs are never cached.
+char* pairCount_getCachePath(const char *filename);
+uint64_t pairCount_hashNames(stSet *names); // names may be NULL, meaning every sequence
+bool pairCount_readCache(const char *filename, stSet *names, uint64_t *numPairs);
+void pairCount_writeCache(const char *filename, stSet *names, uint64_t numPairs);
+// the size and mtime that identify a version of a maf, false for stdin and sharded mafs
+bool pairCount_statMaf(const char *filename, uint64_t *mafSize, int64_t *mafTime);
+
+#endif // _COMPARATOR_PAIR_COUNT_H_
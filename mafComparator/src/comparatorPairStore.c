@@ -0,0 +1,455 @@
+/*
+ * Copyright (C) 2012 by
+ * Dent Earl (dearl@soe.ucsc.edu, dentearl@gmail.com)
+ * ... and other members of the Reconstruction Team of David Haussler's
+ * lab (BME Dept. UCSC).
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <assert.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sonLib.h"
+#include "comparatorPairStore.h"
+
+const unsigned kPairStoreIdBits = 24;
+const unsigned kPairStorePosBits = 40;
+const uint64_t kPairStoreStride = 16;
+const uint64_t kPairStoreInitialCapacity = 1024;
+
+static int cmpName(const void *a, const void *b) {
+    return strcmp(*(char * const *) a, *(char * const *) b);
+}
+static int cmpPackedPair(const void *a, const void *b) {
+    const PackedPair *p1 = (const PackedPair *) a;
+    const PackedPair *p2 = (const PackedPair *) b;
+    if (p1->key1 != p2->key1) {
+        return (p1->key1 < p2->key1) ? -1 : 1;
+    }
+    if (p1->key2 != p2->key2) {
+        return (p1->key2 < p2->key2) ? -1 : 1;
+    }
+    return 0;
+}
+static bool packedPair_lessThan(const PackedPair *p, uint64_t key1, uint64_t key2) {
+    return (p->key1 < key1) || (p->key1 == key1 && p->key2 < key2);
+}
+static uint64_t packKey(uint64_t id, uint64_t pos) {
+    return (id << kPairStorePosBits) | pos;
+}
+static bool fitsKey(uint64_t pos) {
+    return pos < ((uint64_t) 1 << kPairStorePosBits);
+}
+static PackedPair packByPos1(uint64_t id1, uint64_t pos1, uint64_t id2, uint64_t pos2) {
+    // id1, id2 and the high bits of pos2 in key1, the low bits of pos2 and pos1 in key2
+    const unsigned split = kPairStorePosBits - kPairStoreIdBits;
+    PackedPair p;
+    p.key1 = (id1 << kPairStorePosBits) | (id2 << split) | (pos2 >> kPairStoreIdBits);
+    p.key2 = ((pos2 & (((uint64_t) 1 << kPairStoreIdBits) - 1)) << kPairStorePosBits) | pos1;
+    return p;
+}
+uint64_t pairStore_packPosition(uint64_t id, uint64_t pos) {
+    return packKey(id, pos);
+}
+void pairStore_unpackPosition(uint64_t key, uint64_t *id, uint64_t *pos) {
+    *id = key >> kPairStorePosBits;
+    *pos = key & (((uint64_t) 1 << kPairStorePosBits) - 1);
+}
+bool pairStore_isStorablePosition(uint64_t pos) {
+    return fitsKey(pos);
+}
+PairStore* pairStore_construct(stSet *names) {
+    PairStore *ps = (PairStore *) st_malloc(sizeof(*ps));
+    ps->numNames = stSet_size(names);
+    if (ps->numNames > ((uint64_t) 1 << kPairStoreIdBits)) {
+        fprintf(stderr, "Error, too many sequences (%" PRIu64 ") to sample pairs from, at most %" PRIu64
+                " are supported.\n", ps->numNames, (uint64_t) 1 << kPairStoreIdBits);
+        exit(EXIT_FAILURE);
+    }
+    ps->names = (char **) st_malloc(sizeof(*(ps->names)) * (ps->numNames + 1));
+    stSetIterator *sit = stSet_getIterator(names);
+    char *name = NULL;
+    uint64_t i = 0;
+    while ((name = stSet_getNext(sit)) != NULL) {
+        ps->names[i++] = stString_copy(name);
+    }
+    stSet_destructIterator(sit);
+    qsort(ps->names, ps->numNames, sizeof(*(ps->names)), cmpName);
+    ps->capacity = kPairStoreInitialCapacity;
+    ps->pairs = (PackedPair *) st_malloc(sizeof(*(ps->pairs)) * ps->capacity);
+    ps->length = 0;
+    ps->isSorted = true;
+    ps->heads = NULL;
+    ps->headRanks = NULL;
+    ps->numHeads = 0;
+    ps->byPos1 = NULL;
+    ps->isFirstName = (bool *) st_calloc(ps->numNames + 1, sizeof(*(ps->isFirstName)));
+    return ps;
+}
+void pairStore_destruct(PairStore *ps) {
+    if (ps == NULL) {
+        return;
+    }
+    for (uint64_t i = 0; i < ps->numNames; ++i) {
+        free(ps->names[i]);
+    }
+    free(ps->names);
+    free(ps->pairs);
+    free(ps->heads);
+    free(ps->headRanks);
+    free(ps->byPos1);
+    free(ps->isFirstName);
+    free(ps);
+}
+void pairStore_clear(PairStore *ps) {
+    // drop the records but keep the name table and the allocation
+    ps->length = 0;
+    ps->isSorted = true;
+    ps->numHeads = 0;
+    free(ps->byPos1);
+    ps->byPos1 = NULL;
+    memset(ps->isFirstName, 0, sizeof(*(ps->isFirstName)) * ps->numNames);
+}
+int64_t pairStore_getNameId(PairStore *ps, const char *name) {
+    uint64_t lo = 0, hi = ps->numNames;
+    while (lo < hi) {
+        uint64_t mid = lo + (hi - lo) / 2;
+        int i = strcmp(ps->names[mid], name);
+        if (i == 0) {
+            return (int64_t) mid;
+        } else if (i < 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return -1;
+}
+char* pairStore_getName(PairStore *ps, uint64_t id) {
+    assert(id < ps->numNames);
+    return ps->names[id];
+}
+void pairStore_set(PairStore *ps, uint64_t i, uint64_t id1, uint64_t pos1, uint64_t id2, uint64_t pos2) {
+    // records are stored so that id1 < id2 || id1 == id2 and pos1 <= pos2, as aPair_fillOut() does
+    if (id1 > id2 || (id1 == id2 && pos1 > pos2)) {
+        pairStore_set(ps, i, id2, pos2, id1, pos1);
+        return;
+    }
+    assert(i < ps->length);
+    assert(id2 < ps->numNames);
+    if (!fitsKey(pos1) || !fitsKey(pos2)) {
+        fprintf(stderr, "Error, position %" PRIu64 " is too large to sample, positions must be less than %"
+                PRIu64 ".\n", fitsKey(pos1) ? pos2 : pos1, (uint64_t) 1 << kPairStorePosBits);
+        exit(EXIT_FAILURE);
+    }
+    ps->pairs[i].key1 = packKey(id1, pos1);
+    ps->pairs[i].key2 = packKey(id2, pos2);
+    ps->isSorted = false;
+}
+void pairStore_add(PairStore *ps, uint64_t id1, uint64_t pos1, uint64_t id2, uint64_t pos2) {
+    if (ps->length == ps->capacity) {
+        ps->capacity *= 2;
+        ps->pairs = (PackedPair *) realloc(ps->pairs, sizeof(*(ps->pairs)) * ps->capacity);
+        if (ps->pairs == NULL) {
+            fprintf(stderr, "Error, unable to grow the sampled pair store to %" PRIu64 " pairs.\n", ps->capacity);
+            exit(EXIT_FAILURE);
+        }
+    }
+    ++(ps->length);
+    pairStore_set(ps, ps->length - 1, id1, pos1, id2, pos2);
+}
+static uint64_t getSampledNameId(PairStore *ps, const char *name) {
+    int64_t id = pairStore_getNameId(ps, name);
+    if (id < 0) {
+        fprintf(stderr, "Error, sequence %s is not one of the sequences pairs are sampled from.\n", name);
+        exit(EXIT_FAILURE);
+    }
+    return (uint64_t) id;
+}
+void pairStore_addNamed(PairStore *ps, const char *seq1, uint64_t pos1, const char *seq2, uint64_t pos2) {
+    pairStore_add(ps, getSampledNameId(ps, seq1), pos1, getSampledNameId(ps, seq2), pos2);
+}
+void pairStore_append(PairStore *ps, PairStore *other) {
+    // the records of other added to ps, the two stores numbering the names alike
+    assert(ps->numNames == other->numNames);
+    if (ps->length + other->length > ps->capacity) {
+        ps->capacity = ps->length + other->length;
+        ps->pairs = (PackedPair *) realloc(ps->pairs, sizeof(*(ps->pairs)) * ps->capacity);
+        if (ps->pairs == NULL) {
+            fprintf(stderr, "Error, unable to grow the sampled pair store to %" PRIu64 " pairs.\n", ps->capacity);
+            exit(EXIT_FAILURE);
+        }
+    }
+    memcpy(ps->pairs + ps->length, other->pairs, sizeof(*(ps->pairs)) * other->length);
+    ps->length += other->length;
+    ps->isSorted = false;
+}
+void pairStore_setNamed(PairStore *ps, uint64_t i, const char *seq1, uint64_t pos1, const char *seq2, uint64_t pos2) {
+    pairStore_set(ps, i, getSampledNameId(ps, seq1), pos1, getSampledNameId(ps, seq2), pos2);
+}
+static uint64_t buildHeads(PairStore *ps, uint64_t rank, uint64_t k) {
+    // in-order walk of the implicit tree rooted at k hands out the heads in sorted order
+    if (k <= ps->numHeads) {
+        rank = buildHeads(ps, rank, 2 * k);
+        ps->heads[k] = ps->pairs[rank * kPairStoreStride];
+        ps->headRanks[k] = rank;
+        rank = buildHeads(ps, rank + 1, 2 * k + 1);
+    }
+    return rank;
+}
+void pairStore_sort(PairStore *ps) {
+    // sort, drop duplicates and build the search index. the store is read only
+    // (and so safe to search from several threads) until the next pairStore_add()
+    qsort(ps->pairs, ps->length, sizeof(*(ps->pairs)), cmpPackedPair);
+    uint64_t n = 0;
+    for (uint64_t i = 0; i < ps->length; ++i) {
+        if (n == 0 || cmpPackedPair(ps->pairs + n - 1, ps->pairs + i) != 0) {
+            ps->pairs[n++] = ps->pairs[i];
+        }
+    }
+    ps->length = n;
+    memset(ps->isFirstName, 0, sizeof(*(ps->isFirstName)) * ps->numNames);
+    for (uint64_t i = 0; i < n; ++i) {
+        ps->isFirstName[ps->pairs[i].key1 >> kPairStorePosBits] = true;
+    }
+    ps->numHeads = (n + kPairStoreStride - 1) / kPairStoreStride;
+    free(ps->heads);
+    free(ps->headRanks);
+    ps->heads = (PackedPair *) st_malloc(sizeof(*(ps->heads)) * (ps->numHeads + 1));
+    ps->headRanks = (uint64_t *) st_malloc(sizeof(*(ps->headRanks)) * (ps->numHeads + 1));
+    buildHeads(ps, 0, 1);
+    free(ps->byPos1);
+    ps->byPos1 = NULL;
+    ps->isSorted = true;
+}
+bool pairStore_isFirstName(PairStore *ps, uint64_t id) {
+    assert(ps->isSorted && id < ps->numNames);
+    return ps->isFirstName[id];
+}
+void pairStore_retainFirstNames(PairStore *ps, stSet *names) {
+    bool *isKept = (bool *) st_malloc(sizeof(*isKept) * (ps->numNames + 1));
+    for (uint64_t id = 0; id < ps->numNames; ++id) {
+        isKept[id] = stSet_search(names, ps->names[id]) != NULL;
+    }
+    uint64_t n = 0;
+    for (uint64_t i = 0; i < ps->length; ++i) {
+        if (isKept[ps->pairs[i].key1 >> kPairStorePosBits]) {
+            ps->pairs[n++] = ps->pairs[i];
+        }
+    }
+    ps->length = n;
+    free(isKept);
+    // already in order, this rebuilds the search index
+    pairStore_sort(ps);
+}
+uint64_t pairStore_size(PairStore *ps) {
+    return ps->length;
+}
+bool pairStore_writeRecords(PairStore *ps, FILE *fp) {
+    assert(ps->isSorted);
+    if (fprintf(fp, "%" PRIu64 "\n", ps->length) < 0) {
+        return false;
+    }
+    return fwrite(ps->pairs, sizeof(*(ps->pairs)), ps->length, fp) == ps->length;
+}
+bool pairStore_readRecords(PairStore *ps, FILE *fp) {
+    uint64_t n;
+    pairStore_clear(ps);
+    if (fscanf(fp, "%" SCNu64, &n) != 1 || fgetc(fp) != '\n') {
+        return false;
+    }
+    if (n > ps->capacity) {
+        free(ps->pairs);
+        ps->capacity = n;
+        ps->pairs = (PackedPair *) st_malloc(sizeof(*(ps->pairs)) * ps->capacity);
+    }
+    if (fread(ps->pairs, sizeof(*(ps->pairs)), n, fp) != n) {
+        return false;
+    }
+    for (uint64_t i = 0; i < n; ++i) {
+        // records written for some other set of names would point past the name table
+        if ((ps->pairs[i].key1 >> kPairStorePosBits) >= ps->numNames
+            || (ps->pairs[i].key2 >> kPairStorePosBits) >= ps->numNames
+            || ps->pairs[i].key1 > ps->pairs[i].key2) {
+            return false;
+        }
+    }
+    ps->length = n;
+    pairStore_sort(ps);
+    return true;
+}
+void pairStore_get(PairStore *ps, uint64_t i, uint64_t *id1, uint64_t *pos1, uint64_t *id2, uint64_t *pos2) {
+    assert(i < ps->length);
+    const uint64_t posMask = ((uint64_t) 1 << kPairStorePosBits) - 1;
+    *id1 = ps->pairs[i].key1 >> kPairStorePosBits;
+    *pos1 = ps->pairs[i].key1 & posMask;
+    *id2 = ps->pairs[i].key2 >> kPairStorePosBits;
+    *pos2 = ps->pairs[i].key2 & posMask;
+}
+static uint64_t lowerBound(PairStore *ps, uint64_t key1, uint64_t key2) {
+    // find the first head that is not less than the key by walking down the
+    // Eytzinger tree, then binary search the run of records just before it.
+    assert(ps->isSorted);
+    uint64_t k = 1;
+    while (k <= ps->numHeads) {
+        k = 2 * k + (packedPair_lessThan(ps->heads + k, key1, key2) ? 1 : 0);
+    }
+    // strip the right turns taken after the last left turn, k is then that head
+    while (k & 1) {
+        k >>= 1;
+    }
+    k >>= 1;
+    uint64_t rank = (k == 0) ? ps->numHeads : ps->headRanks[k];
+    if (rank == 0) {
+        return 0;
+    }
+    uint64_t lo = (rank - 1) * kPairStoreStride + 1;
+    uint64_t hi = rank * kPairStoreStride;
+    if (hi > ps->length) {
+        hi = ps->length;
+    }
+    while (lo < hi) {
+        uint64_t mid = lo + (hi - lo) / 2;
+        if (packedPair_lessThan(ps->pairs + mid, key1, key2)) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+uint64_t pairStore_lowerBound(PairStore *ps, uint64_t id1, uint64_t pos1, uint64_t id2, uint64_t pos2) {
+    // index of the first record not less than (id1, pos1, id2, pos2), the size of the store if none
+    if (!fitsKey(pos1)) {
+        return lowerBound(ps, packKey(id1 + 1, 0), 0);
+    }
+    if (!fitsKey(pos2)) {
+        return lowerBound(ps, packKey(id1, pos1 + 1), 0);
+    }
+    return lowerBound(ps, packKey(id1, pos1), packKey(id2, pos2));
+}
+bool pairStore_find(PairStore *ps, uint64_t id1, uint64_t pos1, uint64_t id2, uint64_t pos2, uint64_t *i) {
+    // true if (id1, pos1, id2, pos2), exactly as given, is in the store. *i is set to its index
+    if (!fitsKey(pos1) || !fitsKey(pos2) || id1 >= ps->numNames || id2 >= ps->numNames) {
+        return false;
+    }
+    uint64_t key1 = packKey(id1, pos1);
+    uint64_t key2 = packKey(id2, pos2);
+    uint64_t j = lowerBound(ps, key1, key2);
+    if (j < ps->length && ps->pairs[j].key1 == key1 && ps->pairs[j].key2 == key2) {
+        *i = j;
+        return true;
+    }
+    return false;
+}
+void pairStore_indexByPos1(PairStore *ps) {
+    assert(ps->isSorted);
+    uint64_t id1, pos1, id2, pos2;
+    free(ps->byPos1);
+    ps->byPos1 = (PackedPair *) st_malloc(sizeof(*(ps->byPos1)) * (ps->length + 1));
+    for (uint64_t i = 0; i < ps->length; ++i) {
+        pairStore_get(ps, i, &id1, &pos1, &id2, &pos2);
+        ps->byPos1[i] = packByPos1(id1, pos1, id2, pos2);
+    }
+    qsort(ps->byPos1, ps->length, sizeof(*(ps->byPos1)), cmpPackedPair);
+}
+static bool clampRange(uint64_t *lo, uint64_t *hi) {
+    // false if no storable position is in [lo, hi]
+    if (*lo > *hi || !fitsKey(*lo)) {
+        return false;
+    }
+    if (!fitsKey(*hi)) {
+        *hi = ((uint64_t) 1 << kPairStorePosBits) - 1;
+    }
+    return true;
+}
+void pairStore_appendPos1Range(PairStore *ps, uint64_t id1, uint64_t lo, uint64_t hi,
+                               uint64_t id2, uint64_t pos2, PairIndexList *list) {
+    uint64_t i;
+    if (!clampRange(&lo, &hi) || !fitsKey(pos2) || id1 >= ps->numNames || id2 >= ps->numNames) {
+        return;
+    }
+    if (ps->byPos1 == NULL) {
+        // not indexed, one search per position
+        for (uint64_t p = lo; p <= hi; ++p) {
+            if (pairStore_find(ps, id1, p, id2, pos2, &i)) {
+                pairIndexList_append(list, i);
+            }
+        }
+        return;
+    }
+    PackedPair first = packByPos1(id1, lo, id2, pos2);
+    PackedPair last = packByPos1(id1, hi, id2, pos2);
+    uint64_t a = 0, b = ps->length;
+    while (a < b) {
+        uint64_t mid = a + (b - a) / 2;
+        if (packedPair_lessThan(ps->byPos1 + mid, first.key1, first.key2)) {
+            a = mid + 1;
+        } else {
+            b = mid;
+        }
+    }
+    // the scan stays within one (id1, id2, pos2) so key1 is fixed and key2 ends in pos1
+    const uint64_t posMask = ((uint64_t) 1 << kPairStorePosBits) - 1;
+    for (; a < ps->length && ps->byPos1[a].key1 == last.key1 && ps->byPos1[a].key2 <= last.key2; ++a) {
+        if (pairStore_find(ps, id1, ps->byPos1[a].key2 & posMask, id2, pos2, &i)) {
+            pairIndexList_append(list, i);
+        }
+    }
+}
+void pairStore_appendPos2Range(PairStore *ps, uint64_t id1, uint64_t pos1,
+                               uint64_t id2, uint64_t lo, uint64_t hi, PairIndexList *list) {
+    // records differing only in pos2 are adjacent in the store itself
+    if (!clampRange(&lo, &hi) || !fitsKey(pos1) || id1 >= ps->numNames || id2 >= ps->numNames) {
+        return;
+    }
+    uint64_t key1 = packKey(id1, pos1);
+    uint64_t last = packKey(id2, hi);
+    for (uint64_t i = lowerBound(ps, key1, packKey(id2, lo));
+         i < ps->length && ps->pairs[i].key1 == key1 && ps->pairs[i].key2 <= last; ++i) {
+        pairIndexList_append(list, i);
+    }
+}
+PairIndexList* pairIndexList_construct(void) {
+    PairIndexList *list = (PairIndexList *) st_malloc(sizeof(*list));
+    list->capacity = kPairStoreInitialCapacity;
+    list->indices = (uint64_t *) st_malloc(sizeof(*(list->indices)) * list->capacity);
+    list->length = 0;
+    return list;
+}
+void pairIndexList_destruct(PairIndexList *list) {
+    if (list == NULL) {
+        return;
+    }
+    free(list->indices);
+    free(list);
+}
+void pairIndexList_append(PairIndexList *list, uint64_t i) {
+    if (list->length == list->capacity) {
+        list->capacity *= 2;
+        list->indices = (uint64_t *) realloc(list->indices, sizeof(*(list->indices)) * list->capacity);
+        if (list->indices == NULL) {
+            fprintf(stderr, "Error, unable to grow a pair index list to %" PRIu64 " entries.\n", list->capacity);
+            exit(EXIT_FAILURE);
+        }
+    }
+    list->indices[list->length++] = i;
+}
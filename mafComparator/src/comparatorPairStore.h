@@ -0,0 +1,108 @@
+/*
+ * Copyright (C) 2012 by
+ * Dent Earl (dearl@soe.ucsc.edu, dentearl@gmail.com)
+ * ... and other members of the Reconstruction Team of David Haussler's
+ * lab (BME Dept. UCSC).
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef _COMPARATOR_PAIR_STORE_H_
+#define _COMPARATOR_PAIR_STORE_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "sonLib.h"
+
+// The sampled pairs of aligned positions are kept as packed fixed width records in
+// one sorted array instead of a tree of individually allocated APairs. A record is
+// two keys, each holding a sequence name id in its top kPairStoreIdBits bits and a
+// position below that. Name ids are handed out in strcmp order so that records sort
+// exactly as aPair_cmpFunction() sorts APairs: seq1, pos1, seq2, pos2.
+typedef struct _packedPair {
+    uint64_t key1;
+    uint64_t key2;
+} PackedPair;
+typedef struct _pairStore {
+    char **names; // sorted, the name id of a sequence is its index in this array
+    uint64_t numNames;
+    PackedPair *pairs;
+    uint64_t length;
+    uint64_t capacity;
+    bool isSorted; // set by pairStore_sort(), searching requires it
+    // every kPairStoreStride'th record copied out in Eytzinger (bfs) order, 1 based,
+    // with the record's index / kPairStoreStride alongside. small enough to stay in
+    // cache and narrows a search down to a run of kPairStoreStride records.
+    PackedPair *heads;
+    uint64_t *headRanks;
+    uint64_t numHeads;
+    // the records again with their fields reordered to id1, id2, pos2, pos1 and sorted, so that
+    // the records differing only in pos1 are adjacent. NULL until pairStore_indexByPos1().
+    PackedPair *byPos1;
+    // isFirstName[id] is set when some record has id as its id1, filled in by pairStore_sort().
+    // a column without such a name can not hold a record.
+    bool *isFirstName;
+} PairStore;
+typedef struct _pairIndexList {
+    // indices of records in a PairStore, may hold duplicates
+    uint64_t *indices;
+    uint64_t length;
+    uint64_t capacity;
+} PairIndexList;
+
+// a (name id, position) packed into one key of a record, keys sort by id then position.
+// positions that are not storable can not be in any record.
+uint64_t pairStore_packPosition(uint64_t id, uint64_t pos);
+void pairStore_unpackPosition(uint64_t key, uint64_t *id, uint64_t *pos);
+bool pairStore_isStorablePosition(uint64_t pos);
+PairStore* pairStore_construct(stSet *names);
+void pairStore_destruct(PairStore *ps);
+void pairStore_clear(PairStore *ps);
+int64_t pairStore_getNameId(PairStore *ps, const char *name); // -1 if name is not in the store
+char* pairStore_getName(PairStore *ps, uint64_t id);
+void pairStore_add(PairStore *ps, uint64_t id1, uint64_t pos1, uint64_t id2, uint64_t pos2);
+void pairStore_addNamed(PairStore *ps, const char *seq1, uint64_t pos1, const char *seq2, uint64_t pos2);
+void pairStore_append(PairStore *ps, PairStore *other); // other built from the same names
+void pairStore_set(PairStore *ps, uint64_t i, uint64_t id1, uint64_t pos1, uint64_t id2, uint64_t pos2);
+void pairStore_setNamed(PairStore *ps, uint64_t i, const char *seq1, uint64_t pos1, const char *seq2, uint64_t pos2);
+void pairStore_sort(PairStore *ps);
+bool pairStore_isFirstName(PairStore *ps, uint64_t id); // after pairStore_sort()
+// drop, and keep the store sorted, the records whose id1 is not the id of one of names
+void pairStore_retainFirstNames(PairStore *ps, stSet *names);
+uint64_t pairStore_size(PairStore *ps);
+void pairStore_get(PairStore *ps, uint64_t i, uint64_t *id1, uint64_t *pos1, uint64_t *id2, uint64_t *pos2);
+uint64_t pairStore_lowerBound(PairStore *ps, uint64_t id1, uint64_t pos1, uint64_t id2, uint64_t pos2);
+bool pairStore_find(PairStore *ps, uint64_t id1, uint64_t pos1, uint64_t id2, uint64_t pos2, uint64_t *i);
+void pairStore_indexByPos1(PairStore *ps); // after pairStore_sort(), which drops the index
+// the records of a sorted store as a line holding their number followed by the raw records, in
+// the byte order of the machine. reading them back needs a store made from the same names and
+// returns false, leaving the store empty, on a short or malformed file.
+bool pairStore_writeRecords(PairStore *ps, FILE *fp);
+bool pairStore_readRecords(PairStore *ps, FILE *fp);
+// append the index of every record (id1, pos1, id2, pos2), exactly as given, with pos1 (pos2) in
+// [lo, hi] to list in order. the pos1 range is one scan if the store is indexed by pos1.
+void pairStore_appendPos1Range(PairStore *ps, uint64_t id1, uint64_t lo, uint64_t hi,
+                               uint64_t id2, uint64_t pos2, PairIndexList *list);
+void pairStore_appendPos2Range(PairStore *ps, uint64_t id1, uint64_t pos1,
+                               uint64_t id2, uint64_t lo, uint64_t hi, PairIndexList *list);
+PairIndexList* pairIndexList_construct(void);
+void pairIndexList_destruct(PairIndexList *list);
+void pairIndexList_append(PairIndexList *list, uint64_t i);
+
+#endif // _COMPARATOR_PAIR_STORE_H_
@@ -42,20 +42,21 @@ enum STATE {
     correctPvalue
 };
 typedef struct btpeCalc {
-    uint64_t n, nsave;
-    double p, psave, r, q, fm, p1, xm, xl, xr, c, laml, lamr, p2, p3, p4, u, v, A;
+    uint64_t n;
+    double p, r, q, fm, p1, xm, xl, xr, c, laml, lamr, p2, p3, p4, u, v, A;
     enum STATE nextStep; // used to traverse the inner subroutines
     enum STATE prevStep; // debugging
     uint64_t result; 
     int64_t y, k, m;
+    RandomStream *random;
 } btpeCalc_t;
 static char*stateStrings[] = {"done", "initilaization", "selectRegion", "parallelograms", "leftExponentialTail", "rightExponentialTail", "acceptRejectTest", "acceptRejectRecursive", "acceptRejectSqueeze", "acceptRejectFinal", "correctPvalue"};
 
 static double dmin(double a, double b);
-static uint64_t rbinom_smallNaive(const uint64_t n, const double p);
-static uint64_t rbinom_smallamlog(const uint64_t n, const double p);
-static uint64_t rbinom_smallCdf(const uint64_t n, const double p);
-static btpeCalc_t* newBtpeCalc(const uint64_t n, const double p);
+static uint64_t rbinom_smallNaive(RandomStream *r, const uint64_t n, const double p);
+static uint64_t rbinom_smallamlog(RandomStream *r, const uint64_t n, const double p);
+static uint64_t rbinom_smallCdf(RandomStream *r, const uint64_t n, const double p);
+static void initBtpeCalc(btpeCalc_t *b, RandomStream *r, const uint64_t n, const double p);
 static void rbinom_btpe_selectRegion_1(btpeCalc_t *b);
 static void rbinom_btpe_parallelograms_2(btpeCalc_t *b);
 static void rbinom_btpe_leftExponentialTail_3(btpeCalc_t *b);
@@ -65,11 +66,72 @@ static void rbinom_btpe_acceptRejectRecursive_5_1(btpeCalc_t *b);
 static void rbinom_btpe_acceptRejectSqueeze_5_2(btpeCalc_t *b);
 static void rbinom_btpe_acceptRejectFinal_5_3(btpeCalc_t *b);
 static void rbinom_btpe_correctPvalue_6(btpeCalc_t *b);
-static uint64_t rbinom_btpe(uint64_t n, double p);
+static uint64_t rbinom_btpe(RandomStream *r, uint64_t n, double p);
     // BTPE (Binomial, Trinagle, Parallelogram, Exponential)
     // Kachitvichyanukul, Voratas and Schmeiser, Bruce W. (1988)
     // Binomial Random Variate Generation, Communications of the ACM, 31(2): 216-222
-uint64_t rbinom(const uint64_t n, const double p) {
+static const uint32_t kPhiloxM0 = 0xD2511F53;
+static const uint32_t kPhiloxM1 = 0xCD9E8D57;
+static const uint32_t kPhiloxW0 = 0x9E3779B9; // golden ratio
+static const uint32_t kPhiloxW1 = 0xBB67AE85; // sqrt(3) - 1
+void philox4x32(const uint32_t counter[4], const uint32_t key[2], uint32_t out[4]) {
+    // ten rounds of Philox4x32, the key bumped by the Weyl sequence between rounds
+    uint32_t c0 = counter[0], c1 = counter[1], c2 = counter[2], c3 = counter[3];
+    uint32_t k0 = key[0], k1 = key[1];
+    for (int round = 0; round < 10; ++round) {
+        uint64_t prod0 = (uint64_t) kPhiloxM0 * c0;
+        uint64_t prod1 = (uint64_t) kPhiloxM1 * c2;
+        uint32_t n0 = (uint32_t) (prod1 >> 32) ^ c1 ^ k0;
+        uint32_t n2 = (uint32_t) (prod0 >> 32) ^ c3 ^ k1;
+        c0 = n0;
+        c1 = (uint32_t) prod1;
+        c2 = n2;
+        c3 = (uint32_t) prod0;
+        k0 += kPhiloxW0;
+        k1 += kPhiloxW1;
+    }
+    out[0] = c0;
+    out[1] = c1;
+    out[2] = c2;
+    out[3] = c3;
+}
+void randomStream_init(RandomStream *r, uint64_t seed, uint64_t stream) {
+    r->seed = seed;
+    r->stream = stream;
+    r->counter = 0;
+    r->numWords = 0;
+}
+uint64_t randomStream_next64(RandomStream *r) {
+    if (r->numWords == 0) {
+        uint32_t counter[4] = {(uint32_t) r->counter, (uint32_t) (r->counter >> 32),
+                               (uint32_t) r->stream, (uint32_t) (r->stream >> 32)};
+        uint32_t key[2] = {(uint32_t) r->seed, (uint32_t) (r->seed >> 32)};
+        philox4x32(counter, key, r->words);
+        ++(r->counter);
+        r->numWords = 4;
+    }
+    r->numWords -= 2;
+    return ((uint64_t) r->words[r->numWords + 1] << 32) | r->words[r->numWords];
+}
+double randomStream_unit(RandomStream *r) {
+    // the top 53 bits, every double in [0, 1) that is a multiple of 2^-53
+    return (double) (randomStream_next64(r) >> 11) * (1.0 / 9007199254740992.0);
+}
+double randomStream_openUnit(RandomStream *r) {
+    // as randomStream_unit(), shifted by half a step off 0
+    return ((double) (randomStream_next64(r) >> 11) + 0.5) * (1.0 / 9007199254740992.0);
+}
+uint64_t randomStream_uniformInt(RandomStream *r, uint64_t n) {
+    // rejection of the top, incomplete, run of n values keeps every value equally likely
+    assert(n > 0);
+    uint64_t limit = UINT64_MAX - UINT64_MAX % n;
+    uint64_t x;
+    do {
+        x = randomStream_next64(r);
+    } while (x >= limit);
+    return x % n;
+}
+uint64_t rbinom(RandomStream *r, const uint64_t n, const double p) {
     // make a draw from a binomial distribution with parameters n and p
     (void) (rbinom_smallNaive);
     (void) (rbinom_smallamlog);
@@ -95,24 +157,24 @@ uint64_t rbinom(const uint64_t n, const double p) {
         return n;
     }
     if (n * q <= 30) {
-        result = rbinom_smallCdf(n, p);
+        result = rbinom_smallCdf(r, n, p);
     } else {
-        result = rbinom_btpe(n, p);
+        result = rbinom_btpe(r, n, p);
     }
     assert(result <= n);
     return result;
 }
-static uint64_t rbinom_smallNaive(const uint64_t n, const double p) {
+static uint64_t rbinom_smallNaive(RandomStream *r, const uint64_t n, const double p) {
     // speed proportional to n
     uint64_t x = 0;
     for (uint64_t i = 0; i < n; ++i) {
-        if (st_random() <= p) {
+        if (randomStream_unit(r) <= p) {
             ++x;
         }
     }
     return x;
 }
-static uint64_t rbinom_smallamlog(const uint64_t n, const double p) {
+static uint64_t rbinom_smallamlog(RandomStream *r, const uint64_t n, const double p) {
     // Binomial via Geometric, a la Devroye
     // speed proportional to n * p
     uint64_t x = 0, y = 0;
@@ -121,10 +183,7 @@ static uint64_t rbinom_smallamlog(const uint64_t n, const double p) {
         return x;
     }
     while (true) {
-        u = st_random();
-        while (u == 0.0) {
-            u = st_random();
-        }
+        u = randomStream_openUnit(r);
         y += floor(log(u) / c) + 1;
         if (y <= n) {
             // note that this is incorrectly (y < n) in K&S 1988.
@@ -135,78 +194,64 @@ static uint64_t rbinom_smallamlog(const uint64_t n, const double p) {
     }
     return x;
 }
-static uint64_t rbinom_smallCdf(const uint64_t n, const double p) {
+static uint64_t rbinom_smallCdf(RandomStream *r, const uint64_t n, const double p) {
     // Binomial via inverse
     // speed proportional to n * p
     uint64_t x = 0;
-    double q, s, a, r, u;
+    double q, s, a, f, u;
     q = 1.0 - p;
     s = p / q;
     a = (n + 1.0) * s;
-    r = pow(q, (double) n);
-    u = st_random();
-    while(u > r) {
-        u -= r;
+    f = pow(q, (double) n);
+    u = randomStream_unit(r);
+    while(u > f) {
+        u -= f;
         ++x;
-        r *= (a / (double)x) - s;
+        f *= (a / (double)x) - s;
     }
     return x;
 }
-static btpeCalc_t* emptyBtpeCalc(void) {
-    btpeCalc_t *b = (btpeCalc_t*) st_malloc(sizeof(*b));
-    b->nsave = 0;
-    b->psave = -1.0;
-    return b;
-}
 static double dmin(double a, double b) {
     if (a < b)
         return a;
     else
         return b;
 }
-static btpeCalc_t* newBtpeCalc(uint64_t n, double p) {
+static void initBtpeCalc(btpeCalc_t *b, RandomStream *r, uint64_t n, double p) {
     /* step 0. 
-       Set-up constants as functions of n and p. Execute whenever the value of n or p change
+       Set-up constants as functions of n and p. The calculation is kept on the caller's stack,
+       rather than reused between calls, so that draws on different streams may run at once.
      */
-    //////////////////////////////////////////////////
-    // not multithread safe due to use of static pointer here
-    //////////////////////////////////////////////////
-    static btpeCalc_t *b;
-    if (b == NULL) {
-         b = emptyBtpeCalc();
-    }
-    if ((b->nsave != n) | (b->psave != p)) {
-        double a;
-        b->n = n;
-        b->p = p;
-        b->r = dmin(b->p, 1.0 - b->p);
-        b->q = 1.0 - b->r;
-        b->fm = b->n * b->r + b->r;
-        b->m = (int64_t) floor(b->fm);
-        b->p1 = floor(2.195 * sqrt(b->n * b->r * b->q) - 4.6 * b->q) + 0.5;
-        b->xm = b->m + 0.5;
-        b->xl = b->xm - b->p1;
-        b->xr = b->xm + b->p1;
-        b->c = 0.134 + 20.5 / (15.3 + b->m);
-        a = (b->fm - b->xl) / (b->fm - b->xl * b->r);
-        b->laml = a * (1.0 + a / 2.0);
-        a = (b->xr - b->fm) / (b->xr * b->q);
-        b->lamr = a * (1.0 + a / 2.0);
-        b->p2 = b->p1 * (1.0 + 2.0 * b->c);
-        b->p3 = b->p2 + b->c / b->laml;
-        b->p4 = b->p3 + b->c / b->lamr;
-    }
+    double a;
+    b->random = r;
+    b->n = n;
+    b->p = p;
+    b->r = dmin(b->p, 1.0 - b->p);
+    b->q = 1.0 - b->r;
+    b->fm = b->n * b->r + b->r;
+    b->m = (int64_t) floor(b->fm);
+    b->p1 = floor(2.195 * sqrt(b->n * b->r * b->q) - 4.6 * b->q) + 0.5;
+    b->xm = b->m + 0.5;
+    b->xl = b->xm - b->p1;
+    b->xr = b->xm + b->p1;
+    b->c = 0.134 + 20.5 / (15.3 + b->m);
+    a = (b->fm - b->xl) / (b->fm - b->xl * b->r);
+    b->laml = a * (1.0 + a / 2.0);
+    a = (b->xr - b->fm) / (b->xr * b->q);
+    b->lamr = a * (1.0 + a / 2.0);
+    b->p2 = b->p1 * (1.0 + 2.0 * b->c);
+    b->p3 = b->p2 + b->c / b->laml;
+    b->p4 = b->p3 + b->c / b->lamr;
     b->prevStep = initialization;
     b->nextStep = selectRegion;
-    return b;
 }
 static void rbinom_btpe_selectRegion_1(btpeCalc_t *b) {
     /* step 1.
        Generate u ~ U(0, p4) for selecting the region. If region 1 is selected, generate 
        a triangularly distributed variate.
      */
-    b->u = st_random() * b->p4;
-    b->v = st_random();
+    b->u = randomStream_unit(b->random) * b->p4;
+    b->v = randomStream_unit(b->random);
     if (b->u > b->p1) {
         b->nextStep = parallelograms;
     } else {
@@ -365,11 +410,13 @@ static void rbinom_btpe_correctPvalue_6(btpeCalc_t *b) {
     b->nextStep = done;
     b->prevStep = correctPvalue;
 }
-static uint64_t rbinom_btpe(uint64_t n, double p) {
+static uint64_t rbinom_btpe(RandomStream *r, uint64_t n, double p) {
     // BTPE (Binomial, Trinagle, Parallelogram, Exponential)
     // Kachitvichyanukul, Voratas and Schmeiser, Bruce W. (1988)
     // Binomial Random Variate Generation, Communications of the ACM, 31(2): 216-222
-    btpeCalc_t *b = newBtpeCalc(n, p);
+    btpeCalc_t calc;
+    btpeCalc_t *b = &calc;
+    initBtpeCalc(b, r, n, p);
     while (b->nextStep != done) {
         switch (b->nextStep) {
         case selectRegion:
@@ -406,7 +453,5 @@ static uint64_t rbinom_btpe(uint64_t n, double p) {
         }
     }
     assert(b->y <= b->n); // unsigned wrap around
-    uint64_t result = (uint64_t) b->y;
-    // free(b); // don't do this now that b is a local static pointer.
-    return result;
+    return (uint64_t) b->y;
 }
@@ -29,12 +29,30 @@
 #include <stdint.h>
 #include "sonLib.h"
 
+typedef struct _randomStream {
+    // a counter based random number stream, Philox4x32-10 (Salmon et al., Parallel random
+    // numbers: as easy as 1, 2, 3, SC 2011). the i-th number of the stream is a function of
+    // (seed, stream, i) alone, so a stream per block of a maf gives the same numbers however,
+    // and in whichever order, the blocks are handed out.
+    uint64_t seed; // the key
+    uint64_t stream; // high half of the counter
+    uint64_t counter; // low half of the counter, the number of Philox blocks used
+    uint32_t words[4]; // the last Philox block
+    unsigned numWords; // words of the last block not yet used
+} RandomStream;
+
+void philox4x32(const uint32_t counter[4], const uint32_t key[2], uint32_t out[4]);
+void randomStream_init(RandomStream *r, uint64_t seed, uint64_t stream);
+uint64_t randomStream_next64(RandomStream *r);
+double randomStream_unit(RandomStream *r); // uniform on [0, 1)
+double randomStream_openUnit(RandomStream *r); // uniform on (0, 1)
+uint64_t randomStream_uniformInt(RandomStream *r, uint64_t n); // uniform on [0, n), n > 0
+
 // Makes a draw from a random binomial with parameters n, p 
 // Uses 
 // BTPE (Binomial, Trinagle, Parallelogram, Exponential)
 // Kachitvichyanukul, Voratas and Schmeiser, Bruce W. (1988)
 // Binomial Random Variate Generation, Communications of the ACM, 31(2): 216-222
-uint64_t rbinom(const uint64_t n, const double p);
-// NOT MULTITHREAD SAFE.
+uint64_t rbinom(RandomStream *r, const uint64_t n, const double p);
 
 #endif // _COMPARATOR_RANDOM_H_
@@ -0,0 +1,493 @@
+/*
+ * Copyright (C) 2012 by
+ * Dent Earl (dearl@soe.ucsc.edu, dentearl@gmail.com)
+ * ... and other members of the Reconstruction Team of David Haussler's
+ * lab (BME Dept. UCSC).
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <assert.h>
+#include <ctype.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sonLib.h"
+#include "common.h"
+#include "comparatorAPI.h"
+#include "comparatorShard.h"
+
+static const char *kPartialHeader = "mafComparatorPartial 1";
+
+static bool parseShardIndex(const char *spec, uint64_t *i, uint64_t *n) {
+    // true if spec is i/n with i < n
+    const char *p = spec;
+    if (!isdigit((unsigned char) *p)) {
+        return false;
+    }
+    while (isdigit((unsigned char) *p)) {
+        ++p;
+    }
+    if (*p++ != '/' || !isdigit((unsigned char) *p)) {
+        return false;
+    }
+    while (isdigit((unsigned char) *p)) {
+        ++p;
+    }
+    if (*p != '\0' || sscanf(spec, "%" SCNu64 "/%" SCNu64, i, n) != 2) {
+        return false;
+    }
+    return *i < *n;
+}
+bool isShardSpecValid(const char *spec) {
+    uint64_t i, n;
+    if (parseShardIndex(spec, &i, &n)) {
+        return true;
+    }
+    if (strchr(spec, '/') != NULL && strchr(spec, ',') == NULL && isdigit((unsigned char) spec[0])) {
+        // looks like i/n but is not one, e.g. 3/3
+        return false;
+    }
+    // a list of names, none of them empty
+    size_t length = strlen(spec);
+    if (length == 0 || spec[0] == ',' || spec[length - 1] == ',' || strstr(spec, ",,") != NULL) {
+        return false;
+    }
+    for (const char *p = spec; *p != '\0'; ++p) {
+        if (isspace((unsigned char) *p)) {
+            return false;
+        }
+    }
+    return true;
+}
+stSet* getShardSequences(const char *spec, stSet *legitSequences) {
+    stSet *shard = stSet_construct3(stHash_stringKey, stHash_stringEqualKey, free);
+    uint64_t i, n;
+    bool isIndex = parseShardIndex(spec, &i, &n);
+    stSet *listed = NULL;
+    if (!isIndex) {
+        listed = stSet_construct3(stHash_stringKey, stHash_stringEqualKey, free);
+        char *names = stringReplace(spec, ',', ' ');
+        char *p = names;
+        char *name = NULL;
+        while ((name = stString_getNextWord(&p)) != NULL) {
+            stSet_insert(listed, name);
+        }
+        free(names);
+    }
+    stSetIterator *sit = stSet_getIterator(legitSequences);
+    char *name = NULL;
+    while ((name = stSet_getNext(sit)) != NULL) {
+        if (isIndex ? (de_fnv1a(kFnv1aOffsetBasis, name, strlen(name)) % n == i) : (stSet_search(listed, name) != NULL)) {
+            stSet_insert(shard, stString_copy(name));
+        }
+    }
+    stSet_destructIterator(sit);
+    if (listed != NULL) {
+        stSet_destruct(listed);
+    }
+    return shard;
+}
+static stList* getSortedNames(stSet *set) {
+    // the names of set in strcmp order, not to be freed separately
+    stList *names = stSet_getList(set);
+    stList_sort(names, (int(*)(const void *, const void *)) strcmp);
+    return names;
+}
+static void writeResults(FILE *fp, const char *direction, stSortedSet *results) {
+    stSortedSetIterator *it = stSortedSet_getIterator(results);
+    ResultPair *rp = NULL;
+    while ((rp = stSortedSet_getNext(it)) != NULL) {
+        fprintf(fp, "result %s %s %s %" PRIu64 " %" PRIu64 " %" PRIu64 " %" PRIu64 " %" PRIu64
+                " %" PRIu64 " %" PRIu64 " %" PRIu64 " %" PRIu64 " %" PRIu64 "\n",
+                direction, rp->seq1, rp->seq2, rp->inAll, rp->inBoth, rp->inA, rp->inB, rp->inNeither,
+                rp->total, rp->totalBoth, rp->totalA, rp->totalB, rp->totalNeither);
+    }
+    stSortedSet_destructIterator(it);
+}
+static void writeBins(FILE *fp, const char *name, uint64_t *bins, uint64_t numBins) {
+    fprintf(fp, "bins %s ", name);
+    for (uint64_t i = 0; i < numBins; ++i) {
+        fprintf(fp, (i == 0) ? "%" PRIu64 : ",%" PRIu64, bins[i]);
+    }
+    fprintf(fp, "\n");
+}
+void writePartialResults(const char *filename, Options *options, stSet *legitSequences,
+                         stSortedSet *results_12, stSortedSet *results_21, stHash *wigglePairHash) {
+    FILE *fp = de_fopen(filename, "w");
+    fprintf(fp, "%s\n", kPartialHeader);
+    // the settings writeReport() prints, so only partial results of one comparison are merged
+    fprintf(fp, "option numberOfSamples %" PRIu64 "\n", options->numberOfSamples);
+    fprintf(fp, "option near %" PRIu64 "\n", options->near);
+    fprintf(fp, "option seed %" PRIu64 "\n", options->randomSeed);
+    fprintf(fp, "option sampling %s\n", options->isReservoirSampling ? "reservoir" : "bernoulli");
+    fprintf(fp, "option maf1 %s\n", options->mafFile1);
+    fprintf(fp, "option maf2 %s\n", options->mafFile2);
+    fprintf(fp, "option numberOfPairsInMaf1 %" PRIu64 "\n", options->numPairs1);
+    fprintf(fp, "option numberOfPairsInMaf2 %" PRIu64 "\n", options->numPairs2);
+    if (options->bedFiles != NULL) {
+        fprintf(fp, "option bedFiles %s\n", options->bedFiles);
+    }
+    if (options->wigglePairs != NULL) {
+        fprintf(fp, "option wigglePairs %s\n", options->wigglePairs);
+        fprintf(fp, "option wiggleBinLength %" PRIu64 "\n", options->wiggleBinLength);
+    }
+    if (options->wiggleRegionStop != 0) {
+        fprintf(fp, "option wiggleRegionStart %" PRIu64 "\n", options->wiggleRegionStart);
+        fprintf(fp, "option wiggleRegionStop %" PRIu64 "\n", options->wiggleRegionStop);
+    }
+    uint64_t i, n;
+    if (parseShardIndex(options->shardSpec, &i, &n)) {
+        fprintf(fp, "shard %" PRIu64 " %" PRIu64 "\n", i, n);
+    } else {
+        stList *names = getSortedNames(options->shardSequences);
+        fprintf(fp, "shard list ");
+        for (int64_t j = 0; j < stList_length(names); ++j) {
+            fprintf(fp, (j == 0) ? "%s" : ",%s", (char *) stList_get(names, j));
+        }
+        fprintf(fp, "\n");
+        stList_destruct(names);
+    }
+    stList *names = getSortedNames(legitSequences);
+    for (int64_t j = 0; j < stList_length(names); ++j) {
+        fprintf(fp, "sequence %s\n", (char *) stList_get(names, j));
+    }
+    stList_destruct(names);
+    writeResults(fp, "12", results_12);
+    writeResults(fp, "21", results_21);
+    stList *keys = stHash_getKeys(wigglePairHash);
+    stList_sort(keys, (int(*)(const void *, const void *)) strcmp);
+    for (int64_t j = 0; j < stList_length(keys); ++j) {
+        WiggleContainer *wc = stHash_search(wigglePairHash, stList_get(keys, j));
+        fprintf(fp, "wiggle %s %s %" PRIu64 " %" PRIu64 " %" PRIu64 " %" PRIu64 "\n",
+                wc->ref, wc->partner, wc->refStart, wc->refLength, wc->numBins, wc->binLength);
+        writeBins(fp, "presentAtoB", wc->presentAtoB, wc->numBins);
+        writeBins(fp, "presentBtoA", wc->presentBtoA, wc->numBins);
+        writeBins(fp, "absentAtoB", wc->absentAtoB, wc->numBins);
+        writeBins(fp, "absentBtoA", wc->absentBtoA, wc->numBins);
+    }
+    stList_destruct(keys);
+    fprintf(fp, "end\n");
+    fclose(fp);
+}
+typedef struct _partialMerge {
+    // the state of mergePartialResults() carried from one partial results file to the next
+    stList *optionLines; // of the first file, every other file has to have the same
+    stSet *legitSequences;
+    stHash *wigglePairHash;
+    stSortedSet *results_12;
+    stSortedSet *results_21;
+    uint64_t numShards; // of i/n shards, 0 for shard lists
+    bool *isShardSeen; // i/n shards only
+    stSet *shardSequences; // shard lists only, the sequences of the shards merged so far
+    const char *firstFilename;
+} PartialMerge;
+
+static void partialError(const char *filename, uint64_t lineNumber, const char *message) {
+    fprintf(stderr, "Error, line %" PRIu64 " of %s, %s.\n", lineNumber, filename, message);
+    exit(EXIT_FAILURE);
+}
+static uint64_t parseCount(const char *filename, uint64_t lineNumber, char *word) {
+    char *end = NULL;
+    if (word == NULL || !isdigit((unsigned char) word[0])) {
+        partialError(filename, lineNumber, "expected a count");
+    }
+    uint64_t x = strtoull(word, &end, 10);
+    if (*end != '\0') {
+        partialError(filename, lineNumber, "expected a count");
+    }
+    free(word);
+    return x;
+}
+static void mergeShard(PartialMerge *pm, const char *filename, uint64_t lineNumber, char *rest,
+                       bool isFirst) {
+    char *word = stString_getNextWord(&rest);
+    if (word != NULL && strcmp(word, "list") == 0) {
+        if (!isFirst && pm->shardSequences == NULL) {
+            partialError(filename, lineNumber, "shards of i/n and shards of listed sequences can not be merged");
+        }
+        if (pm->shardSequences == NULL) {
+            pm->shardSequences = stSet_construct3(stHash_stringKey, stHash_stringEqualKey, free);
+        }
+        char *names = stringReplace(rest, ',', ' ');
+        char *p = names;
+        char *name = NULL;
+        while ((name = stString_getNextWord(&p)) != NULL) {
+            if (stSet_search(pm->shardSequences, name) != NULL) {
+                fprintf(stderr, "Error, %s is in more than one of the shards merged.\n", name);
+                exit(EXIT_FAILURE);
+            }
+            stSet_insert(pm->shardSequences, name);
+        }
+        free(names);
+    } else {
+        uint64_t i = parseCount(filename, lineNumber, word);
+        uint64_t n = parseCount(filename, lineNumber, stString_getNextWord(&rest));
+        word = NULL;
+        if (isFirst && i < n) {
+            pm->numShards = n;
+            pm->isShardSeen = (bool *) st_calloc(n, sizeof(*(pm->isShardSeen)));
+        }
+        if (pm->numShards == 0 || n != pm->numShards || i >= n) {
+            partialError(filename, lineNumber, "the shard is not one of the shards of the first file");
+        }
+        if (pm->isShardSeen[i]) {
+            fprintf(stderr, "Error, shard %" PRIu64 "/%" PRIu64 " is merged more than once.\n", i, n);
+            exit(EXIT_FAILURE);
+        }
+        pm->isShardSeen[i] = true;
+    }
+    free(word);
+}
+static void mergeResult(PartialMerge *pm, const char *filename, uint64_t lineNumber, char *rest) {
+    char *direction = stString_getNextWord(&rest);
+    char *seq1 = stString_getNextWord(&rest);
+    char *seq2 = stString_getNextWord(&rest);
+    if (direction == NULL || seq2 == NULL || (strcmp(direction, "12") != 0 && strcmp(direction, "21") != 0)) {
+        partialError(filename, lineNumber, "expected a result of 12 or 21 and two sequences");
+    }
+    uint64_t counts[10];
+    for (unsigned i = 0; i < 10; ++i) {
+        counts[i] = parseCount(filename, lineNumber, stString_getNextWord(&rest));
+    }
+    ResultPair *rp = getResultPair((direction[0] == '1') ? pm->results_12 : pm->results_21, seq1, seq2);
+    rp->inAll += counts[0];
+    rp->inBoth += counts[1];
+    rp->inA += counts[2];
+    rp->inB += counts[3];
+    rp->inNeither += counts[4];
+    rp->total += counts[5];
+    rp->totalBoth += counts[6];
+    rp->totalA += counts[7];
+    rp->totalB += counts[8];
+    rp->totalNeither += counts[9];
+    free(direction);
+    free(seq1);
+    free(seq2);
+}
+static WiggleContainer* mergeWiggle(PartialMerge *pm, const char *filename, uint64_t lineNumber, char *rest,
+                                    bool isFirst) {
+    char *ref = stString_getNextWord(&rest);
+    char *partner = stString_getNextWord(&rest);
+    if (partner == NULL) {
+        partialError(filename, lineNumber, "expected a wiggle pair");
+    }
+    uint64_t refStart = parseCount(filename, lineNumber, stString_getNextWord(&rest));
+    uint64_t refLength = parseCount(filename, lineNumber, stString_getNextWord(&rest));
+    uint64_t numBins = parseCount(filename, lineNumber, stString_getNextWord(&rest));
+    uint64_t binLength = parseCount(filename, lineNumber, stString_getNextWord(&rest));
+    char *key = stString_print("%s-%s", ref, partner);
+    WiggleContainer *wc = stHash_search(pm->wigglePairHash, key);
+    if (wc == NULL && isFirst && binLength > 0) {
+        wc = wiggleContainer_construct(ref, partner, refStart, refLength, binLength);
+        stHash_insert(pm->wigglePairHash, key, wc);
+        key = NULL;
+    }
+    if (wc == NULL || wc->refStart != refStart || wc->refLength != refLength || wc->numBins != numBins
+        || wc->binLength != binLength) {
+        partialError(filename, lineNumber, "the wiggle pair is not one of the first file's");
+    }
+    free(key);
+    free(ref);
+    free(partner);
+    return wc;
+}
+static void mergeBins(WiggleContainer *wc, const char *filename, uint64_t lineNumber, char *rest) {
+    char *name = stString_getNextWord(&rest);
+    uint64_t *bins = NULL;
+    if (wc == NULL || name == NULL) {
+        partialError(filename, lineNumber, "bins have to follow a wiggle pair");
+    } else if (strcmp(name, "presentAtoB") == 0) {
+        bins = wc->presentAtoB;
+    } else if (strcmp(name, "presentBtoA") == 0) {
+        bins = wc->presentBtoA;
+    } else if (strcmp(name, "absentAtoB") == 0) {
+        bins = wc->absentAtoB;
+    } else if (strcmp(name, "absentBtoA") == 0) {
+        bins = wc->absentBtoA;
+    } else {
+        partialError(filename, lineNumber, "unknown bins");
+    }
+    free(name);
+    while (isspace((unsigned char) *rest)) {
+        ++rest;
+    }
+    for (uint64_t i = 0; i < wc->numBins; ++i) {
+        char *end = NULL;
+        if (!isdigit((unsigned char) *rest)) {
+            partialError(filename, lineNumber, "too few bins");
+        }
+        bins[i] += strtoull(rest, &end, 10);
+        rest = end;
+        if (*rest == ',' && i + 1 < wc->numBins) {
+            ++rest;
+        } else if (*rest != '\0' || i + 1 != wc->numBins) {
+            partialError(filename, lineNumber, "the bins do not match the wiggle pair");
+        }
+    }
+}
+static void mergePartialFile(PartialMerge *pm, const char *filename, bool isFirst) {
+    FILE *fp = de_fopen(filename, "r");
+    int64_t nBytes = 100;
+    char *line = st_malloc(nBytes + 1);
+    uint64_t lineNumber = 0;
+    uint64_t numOptions = 0;
+    uint64_t numSequences = 0;
+    uint64_t numWiggles = 0;
+    bool isEnded = false;
+    WiggleContainer *wc = NULL;
+    while (!isEnded && benLine(&line, &nBytes, fp) != -1) {
+        char *rest = line;
+        char *type = stString_getNextWord(&rest);
+        if (++lineNumber == 1) {
+            if (strcmp(line, kPartialHeader) != 0) {
+                fprintf(stderr, "Error, %s is not a mafComparator --shard partial results file.\n", filename);
+                exit(EXIT_FAILURE);
+            }
+        } else if (type == NULL) {
+            partialError(filename, lineNumber, "blank line");
+        } else if (strcmp(type, "option") == 0) {
+            if (isFirst) {
+                stList_append(pm->optionLines, stString_copy(line));
+            } else if (numOptions >= (uint64_t) stList_length(pm->optionLines)
+                       || strcmp(line, stList_get(pm->optionLines, numOptions)) != 0) {
+                partialError(filename, lineNumber, "the comparison is not the comparison of the first file");
+            }
+            ++numOptions;
+        } else if (strcmp(type, "shard") == 0) {
+            mergeShard(pm, filename, lineNumber, rest, isFirst);
+        } else if (strcmp(type, "sequence") == 0) {
+            char *name = stString_getNextWord(&rest);
+            if (name == NULL) {
+                partialError(filename, lineNumber, "expected a sequence");
+            }
+            if (isFirst) {
+                stSet_insert(pm->legitSequences, name);
+            } else {
+                if (stSet_search(pm->legitSequences, name) == NULL) {
+                    partialError(filename, lineNumber, "the sequence is not one of the first file's");
+                }
+                free(name);
+            }
+            ++numSequences;
+        } else if (strcmp(type, "result") == 0) {
+            mergeResult(pm, filename, lineNumber, rest);
+        } else if (strcmp(type, "wiggle") == 0) {
+            wc = mergeWiggle(pm, filename, lineNumber, rest, isFirst);
+            ++numWiggles;
+        } else if (strcmp(type, "bins") == 0) {
+            mergeBins(wc, filename, lineNumber, rest);
+        } else if (strcmp(type, "end") == 0) {
+            isEnded = true;
+        } else {
+            partialError(filename, lineNumber, "unknown line");
+        }
+        free(type);
+    }
+    free(line);
+    fclose(fp);
+    if (!isEnded) {
+        fprintf(stderr, "Error, %s is truncated.\n", filename);
+        exit(EXIT_FAILURE);
+    }
+    if (numOptions != (uint64_t) stList_length(pm->optionLines)
+        || numSequences != (uint64_t) stSet_size(pm->legitSequences)
+        || numWiggles != (uint64_t) stHash_size(pm->wigglePairHash)) {
+        fprintf(stderr, "Error, %s is not a shard of the comparison of %s.\n", filename, pm->firstFilename);
+        exit(EXIT_FAILURE);
+    }
+}
+static void applyOptionLine(Options *options, char *line) {
+    // line is "option NAME VALUE", VALUE running to the end of the line
+    char *name = line + strlen("option ");
+    char *value = strchr(name, ' ');
+    assert(value != NULL);
+    *value++ = '\0';
+    if (strcmp(name, "numberOfSamples") == 0) {
+        sscanf(value, "%" SCNu64, &(options->numberOfSamples));
+    } else if (strcmp(name, "near") == 0) {
+        sscanf(value, "%" SCNu64, &(options->near));
+    } else if (strcmp(name, "seed") == 0) {
+        sscanf(value, "%" SCNu64, &(options->randomSeed));
+    } else if (strcmp(name, "sampling") == 0) {
+        options->isReservoirSampling = strcmp(value, "reservoir") == 0;
+    } else if (strcmp(name, "maf1") == 0) {
+        options->mafFile1 = stString_copy(value);
+    } else if (strcmp(name, "maf2") == 0) {
+        options->mafFile2 = stString_copy(value);
+    } else if (strcmp(name, "numberOfPairsInMaf1") == 0) {
+        sscanf(value, "%" SCNu64, &(options->numPairs1));
+    } else if (strcmp(name, "numberOfPairsInMaf2") == 0) {
+        sscanf(value, "%" SCNu64, &(options->numPairs2));
+    } else if (strcmp(name, "bedFiles") == 0) {
+        options->bedFiles = stString_copy(value);
+    } else if (strcmp(name, "wigglePairs") == 0) {
+        options->wigglePairs = stString_copy(value);
+    } else if (strcmp(name, "wiggleBinLength") == 0) {
+        sscanf(value, "%" SCNu64, &(options->wiggleBinLength));
+    } else if (strcmp(name, "wiggleRegionStart") == 0) {
+        sscanf(value, "%" SCNu64, &(options->wiggleRegionStart));
+    } else if (strcmp(name, "wiggleRegionStop") == 0) {
+        sscanf(value, "%" SCNu64, &(options->wiggleRegionStop));
+    }
+}
+void mergePartialResults(char **filenames, unsigned n, Options *options, stSet *legitSequences,
+                         stHash *wigglePairHash, stSortedSet **results_12, stSortedSet **results_21) {
+    PartialMerge pm;
+    pm.optionLines = stList_construct3(0, free);
+    pm.legitSequences = legitSequences;
+    pm.wigglePairHash = wigglePairHash;
+    pm.results_12 = stSortedSet_construct3((int(*)(const void *, const void *)) aPair_cmpFunction_seqsOnly,
+                                           (void(*)(void *)) aPair_destruct);
+    pm.results_21 = stSortedSet_construct3((int(*)(const void *, const void *)) aPair_cmpFunction_seqsOnly,
+                                           (void(*)(void *)) aPair_destruct);
+    pm.numShards = 0;
+    pm.isShardSeen = NULL;
+    pm.shardSequences = NULL;
+    pm.firstFilename = filenames[0];
+    for (unsigned i = 0; i < n; ++i) {
+        mergePartialFile(&pm, filenames[i], i == 0);
+    }
+    // every shard, once
+    for (uint64_t i = 0; i < pm.numShards; ++i) {
+        if (!pm.isShardSeen[i]) {
+            fprintf(stderr, "Error, shard %" PRIu64 "/%" PRIu64 " is missing.\n", i, pm.numShards);
+            exit(EXIT_FAILURE);
+        }
+    }
+    if (pm.shardSequences != NULL) {
+        stSetIterator *sit = stSet_getIterator(legitSequences);
+        char *name = NULL;
+        while ((name = stSet_getNext(sit)) != NULL) {
+            if (stSet_search(pm.shardSequences, name) == NULL) {
+                fprintf(stderr, "Error, %s is in none of the shards merged.\n", name);
+                exit(EXIT_FAILURE);
+            }
+        }
+        stSet_destructIterator(sit);
+        stSet_destruct(pm.shardSequences);
+    }
+    for (int64_t i = 0; i < stList_length(pm.optionLines); ++i) {
+        applyOptionLine(options, stList_get(pm.optionLines, i));
+    }
+    free(pm.isShardSeen);
+    stList_destruct(pm.optionLines);
+    *results_12 = pm.results_12;
+    *results_21 = pm.results_21;
+}
@@ -0,0 +1,60 @@
+/*
+ * Copyright (C) 2012 by
+ * Dent Earl (dearl@soe.ucsc.edu, dentearl@gmail.com)
+ * ... and other members of the Reconstruction Team of David Haussler's
+ * lab (BME Dept. UCSC).
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef _COMPARATOR_SHARD_H_
+#define _COMPARATOR_SHARD_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "sonLib.h"
+#include "comparatorAPI.h"
+
+// With --shard SPEC a comparison only keeps the sampled pairs whose first sequence, in strcmp
+// order, is one of the shard's sequences, and writes its counts to --out as partial results
+// rather than as the XML report. SPEC is either i/n, the i'th (from 0) of n shards that the
+// sequences are spread over by a hash of their names, or a comma separated list of sequences.
+// Every shard samples the whole of each maf with the random numbers of --seed and drops the pairs of
+// the other shards, so the union of the shards' samples is the sample of an unsharded run and
+// `mafComparator merge` adds the partial results up into the same report, whatever the number
+// of shards. A partial results file is lines of text:
+//     mafComparatorPartial 1
+//     option <name> <value>       the settings the report is written with, equal across shards
+//     shard <i> <n> | shard list <sequence>,...
+//     sequence <name>             the sequences compared
+//     result <12|21> <seq1> <seq2> <the ten ResultPair counters, inAll first>
+//     wiggle <key> <ref> <partner> <refStart> <refLength> <numBins> <binLength>
+//     bins <presentAtoB|presentBtoA|absentAtoB|absentBtoA> <numBins comma separated counts>
+//     end
+bool isShardSpecValid(const char *spec);
+// the sequences of legitSequences in the shard, which must be freed
+stSet* getShardSequences(const char *spec, stSet *legitSequences);
+void writePartialResults(const char *filename, Options *options, stSet *legitSequences,
+                         stSortedSet *results_12, stSortedSet *results_21, stHash *wigglePairHash);
+// add up the partial results of every shard, exits unless they are the shards of one comparison,
+// each exactly once. fills in the report settings of options and legitSequences, and returns the
+// results of the two comparisons.
+void mergePartialResults(char **filenames, unsigned n, Options *options, stSet *legitSequences,
+                         stHash *wigglePairHash, stSortedSet **results_12, stSortedSet **results_21);
+
+#endif // _COMPARATOR_SHARD_H_
@@ -39,11 +39,15 @@
 
 #include "sonLib.h"
 #include "comparatorAPI.h"
+#include "comparatorExact.h"
+#include "comparatorBatch.h"
+#include "comparatorShard.h"
 #include "common.h"
+#include "sharedMaf.h"
+#include "profile.h"
 #include "buildVersion.h"
 
 const char *g_version = "version 0.9 May 2013";
-bool g_isVerboseFailures = false;
 
 /*
  * The script takes two MAF files and for each ordered pair of sequences
@@ -76,8 +80,13 @@ void listifercatePairs(char *s, stList *list);
 void listifercateKeyValuePairs(char *s, stList *list);
 void hashifercateList(stList *list, stHash *hash);
 void usage(void);
+void usageMerge(void);
 void version(void);
 int parseOptions(int argc, char **argv, Options* options);
+int mergeMain(int argc, char **argv);
+void writeReport(Options *options, const char *mafFile2, const char *outputFile, uint64_t numPairs1,
+                 uint64_t numPairs2, stSortedSet *results_12, stSortedSet *results_21, stSet *seqNamesSet,
+                 stHash *wigglePairHash);
 
 void parseBedFiles(const char *commaSepFiles, stHash *bedFileHash) {
     /*
@@ -118,46 +127,32 @@ void parseBedFile(const char *filepath, stHash *intervalsHash) {
             char *cA3 = stString_copy(cA2);
             int64_t i = sscanf(cA2, "%s %" PRIi64 " %" PRIi64 "", cA3, &start, &stop);
             assert(i == 3);
-            stSortedSet *intervals = stHash_search(intervalsHash, cA3);
+            if (start < 0 || stop < start) {
+                st_errAbort("Found a bad interval in the bed file %s: %s %" PRIi64 " %" PRIi64 "",
+                            filepath, cA3, start, stop);
+            }
+            intervals_t *intervals = stHash_search(intervalsHash, cA3);
             if (intervals == NULL) {
-                intervals = stSortedSet_construct3(
-                        (int(*)(const void *, const void *)) stIntTuple_cmpFn,
-                        (void(*)(void *)) stIntTuple_destruct);
+                intervals = intervals_new();
                 stHash_insert(intervalsHash, stString_copy(cA3), intervals);
             }
-            stIntTuple *j = stIntTuple_construct2( start, stop);
-            stIntTuple *k = stSortedSet_searchLessThanOrEqual(intervals,
-                    j);
-            if (k != NULL) {
-                if (stIntTuple_get(k, 1) > start) {
-                    st_errAbort(
-                            "Found an overlapping interval in the bed file: %s %" PRIi64 " "
-                            "%" PRIi64 " overlaps %s %" PRIi64 " %" PRIi64 "",
-                            cA3, start, stop, cA2,
-                            stIntTuple_get(k, 0),
-                            stIntTuple_get(k, 1));
-                }
-            }
-            k = stSortedSet_searchGreaterThanOrEqual(intervals, j);
-            if (k != NULL) {
-                if (stIntTuple_get(k, 1) < stop) {
-                    st_errAbort(
-                            "Found an overlapping interval in the bed file: %s %" PRIi64 " "
-                            "%" PRIi64 " overlaps %s %" PRIi64 " %" PRIi64 "",
-                            cA3, start, stop, cA2,
-                            stIntTuple_get(k, 0),
-                            stIntTuple_get(k, 1));
-                }
-            }
-            assert(stSortedSet_search(intervals, j) == NULL);
             st_logDebug("Adding in an interval: %s %" PRIi64 " %" PRIi64 "\n", cA3, start, stop);
-            stSortedSet_insert(intervals, j);
+            intervals_add(intervals, start, stop);
             free(cA3);
         }
         bytesRead = benLine(&cA2, &nBytes, fileHandle);
     }
     free(cA2);
     fclose(fileHandle);
+    // sorted and merged for lookups, overlaps with the intervals of earlier files are errors too
+    stHashIterator *hit = stHash_getIterator(intervalsHash);
+    char *seq = NULL;
+    while ((seq = stHash_getNext(hit)) != NULL) {
+        if (!intervals_finish(stHash_search(intervalsHash, seq))) {
+            st_errAbort("Found an overlapping interval in the bed file: %s, on %s", filepath, seq);
+        }
+    }
+    stHash_destructIterator(hit);
     st_logDebug("Finished parsing the bed file: %s\n", filepath);
 }
 void listifercatePairs(char *s, stList *list) {
@@ -230,7 +225,10 @@ void version(void) {
 }
 void usage(void) {
     version();
-    fprintf(stderr, "Usage: $ mafComparator --maf1=FILE1 --maf2=FILE2 --out=OUT.xml [options]\n\n");
+    fprintf(stderr, "Usage: $ mafComparator --maf1=FILE1 --maf2=FILE2 --out=OUT.xml [options]\n"
+            "       $ mafComparator --maf1=FILE1 --batch=BATCH [options]\n"
+            "       $ mafComparator --maf1=FILE1 --maf2=FILE2 --shard=SPEC --out=PARTIAL [options]\n"
+            "       $ mafComparator merge --out=OUT.xml PARTIAL1 PARTIAL2 ...\n\n");
     fprintf(stderr, "This program takes two MAF files and compares them to one another.\n"
             "Specifically, for each ordered pair of sequences in the first MAF it \n"
             "samples a predefined number of sample homology tests (see below), then \n"
@@ -241,18 +239,47 @@ void usage(void) {
     usageMessage('h', "help", "Print this help screen.");
     usageMessage('\0', "maf1", "The location of the first MAF file. "
                  "If comparing true to predicted "
-                 "alignments, this is the truth.");
+                 "alignments, this is the truth. May be - to read from stdin, or a sharded "
+                 "maf, either @FILE where FILE lists one maf per line or a quoted glob "
+                 "pattern such as 'aln.chr*.maf'.");
     usageMessage('\0', "maf2", "The location of the second MAF file. "
                  "If comparing true to predicted "
-                 "alignments, this is the prediction.");
+                 "alignments, this is the prediction. May be - to read from stdin, or a "
+                 "sharded maf, as for --maf1.");
     usageMessage('\0', "out", "The output XML formatted results file.");
+    usageMessage('\0', "batch", "Compare --maf1 to many predictions in one run, in place of --maf2 and "
+                 "--out. Each line of FILE is a prediction maf and the XML file to write its results to, "
+                 "separated by white space. The truth is sampled once for each distinct set of sequences "
+                 "it shares with a prediction, and every file is read once to sample and test pairs. "
+                 "Every sample uses the random numbers of a single comparison, derived from --seed, so "
+                 "each report is that of a single comparison. Not with --numberOfPairs, --concurrent or "
+                 "--exact.");
+    usageMessage('\0', "truthPairs", "With --batch, keep the sample of --maf1 in FILE, and any further "
+                 "samples in FILE.1, FILE.2 and so on, and reuse them on later runs with the same --maf1, "
+                 "sequences, --samples, --seed and sampling. Not used for stdin or sharded mafs.");
+    usageMessage('\0', "shard", "Run one share of the comparison, for spreading it over many machines, "
+                 "and write its partial results to --out for `mafComparator merge`. SPEC is i/n, the "
+                 "i'th (counting from 0) of n shares of the sequences, split by a hash of their names, "
+                 "or a comma separated list of sequences. A shard tests the sampled pairs whose first "
+                 "sequence, in sort order, is one of its own. Every shard samples the whole of each "
+                 "maf with the same --seed, so the merged report is the report of the run without "
+                 "--shard, whatever the number of shards. Not with --batch or --exact.");
     usageMessage('\0', "samples", "The ideal number of sample homology tests to perform for the "
                  "two comparisons (i.e. file1 -> file and file2 -> file1). This "
                  "number is an ideal because pairs are sampled and thus the "
                  "actual number may be slightly higher or slightly lower than "
-                 "this value. If this value is equal to or greater than the "
+                 "this value, unless --reservoir is used. If this value is equal to or greater than the "
                  "total number of pairs in a file, then all pairs will be "
                  "tested. [default: 1000000]");
+    usageMessage('\0', "reservoir", "Test exactly --samples pairs of each maf, drawn uniformly in a "
+                 "single pass over the file, instead of sampling each pair independently with "
+                 "probability samples / pairs. Saves the pass that counts the pairs of each maf "
+                 "ahead of sampling. Per pair the two samplers are equivalent, though the pairs "
+                 "drawn for a given --seed differ.");
+    usageMessage('\0', "pairCountCache", "Remember the number of pairs in a maf in a FILE.pairCount "
+                 "file next to it and reuse it on later runs with the same maf and sequences. "
+                 "Saves the pass that counts them, with --reservoir the count is checked instead. "
+                 "Not used for stdin or sharded mafs.");
     usageMessage('\0', "near", "The number of bases in either sequence to allow a match "
                  "to slip by. I.e. --near=n (where _n_ is a non-negative integer) "
                  "will consider a homology test for a given pair (S1:_x_, S2:_y_) "
@@ -280,7 +307,8 @@ void usage(void) {
                  "the total number of pairs in maf1 and maf2 (in that order). These numbers are double "
                  "checked by mafComparator as it runs, a discrpency will cause an error. If these values "
                  "are known prior to the analysis (either because the analysis has been run before or by "
-                 "use of the mafPairCounter program) this option provides about a 15% speedup. Example: "
+                 "use of the mafPairCounter program) this option saves a pass over each maf. "
+                 "Example: "
                  "--numberOfPairs 2847390129,228470192212");
     usageMessage('\0', "legitSequences", "A list of comma separated key value pairs, which themselves "
                  "are colon (:) separated. Each pair is a sequence name and source length. These values "
@@ -297,6 +325,26 @@ void usage(void) {
     usageMessage('\0', "seed", "an integer used to seed the random number generator "
                  "used to perform sampling. If omitted a seed is pseudorandomly "
                  "generated. The seed value is always stored in the output xml.");
+    usageMessage('\0', "threads", "The number of threads used to count pairs (one shard of a "
+                 "sharded maf per thread) and to test sampled pairs for homology, 0 for one per "
+                 "processor. Results do not depend on the number of threads. [default: 0]");
+    usageMessage('\0', "concurrent", "Read each maf into memory once, instead of streaming it once "
+                 "per pass, and run the maf1 -> maf2 and maf2 -> maf1 comparisons side by side, each "
+                 "with half of the --threads workers. Needs enough memory to hold both mafs. Results "
+                 "are the same as without this option.");
+    usageMessage('\0', "exact", "Test every pair of aligned positions of each maf instead of a sample. "
+                 "The pairs are sorted in bounded memory, spilling to --tmpDir, and the two mafs' pairs "
+                 "merge joined, so both comparisons take one pass. Not with --near or --concurrent.");
+    usageMessage('\0', "exactMemory", "The memory, in MiB, --exact sorts pairs in before spilling "
+                 "them to disk, split between the two mafs. [default: 1024]");
+    usageMessage('\0', "sampleMemory", "Hold the pairs sampled from each maf in this many MiB, "
+                 "spilling sorted runs to --tmpDir, for samples too large for memory. Needs --near 0, "
+                 "not with --reservoir, --concurrent, --batch or --exact. Results are the same as "
+                 "without this option. [default: the sample is held in memory]");
+    usageMessage('\0', "tmpDir", "The directory for the temporary files of --exact and "
+                 "--sampleMemory. [default: $TMPDIR, or /tmp]");
+    usageMessage('\0', "profile", "Record the time spent in each phase of the comparison "
+                 "and write it to FILE in the Chrome trace event format.");
     usageMessage('v', "version", "Print current version number.");
 }
 int parseOptions(int argc, char **argv, Options* options) {
@@ -323,6 +371,18 @@ int parseOptions(int argc, char **argv, Options* options) {
         {"bedFiles", required_argument, 0, 'f'},
         {"near", required_argument, 0, 'g'},
         {"seed", required_argument, 0, 's'},
+        {"profile", required_argument, 0, 0},
+        {"threads", required_argument, 0, 0},
+        {"concurrent", no_argument, 0, 0},
+        {"reservoir", no_argument, 0, 0},
+        {"pairCountCache", no_argument, 0, 0},
+        {"exact", no_argument, 0, 0},
+        {"exactMemory", required_argument, 0, 0},
+        {"sampleMemory", required_argument, 0, 0},
+        {"tmpDir", required_argument, 0, 0},
+        {"batch", required_argument, 0, 0},
+        {"truthPairs", required_argument, 0, 0},
+        {"shard", required_argument, 0, 0},
         {0, 0, 0, 0 }};
     int longIndex = 0;
     size_t i;
@@ -379,6 +439,59 @@ int parseOptions(int argc, char **argv, Options* options) {
                 options->numPairsString = stString_copy(optarg);
                 break;
             }
+            if (strcmp("profile", longOptions[longIndex].name) == 0) {
+                options->profileFile = stString_copy(optarg);
+                break;
+            }
+            if (strcmp("threads", longOptions[longIndex].name) == 0) {
+                i = sscanf(optarg, "%u", &(options->numThreads));
+                assert(i == 1);
+                break;
+            }
+            if (strcmp("concurrent", longOptions[longIndex].name) == 0) {
+                options->isConcurrent = true;
+                break;
+            }
+            if (strcmp("reservoir", longOptions[longIndex].name) == 0) {
+                options->isReservoirSampling = true;
+                break;
+            }
+            if (strcmp("pairCountCache", longOptions[longIndex].name) == 0) {
+                options->isPairCountCached = true;
+                break;
+            }
+            if (strcmp("exact", longOptions[longIndex].name) == 0) {
+                options->isExact = true;
+                break;
+            }
+            if (strcmp("exactMemory", longOptions[longIndex].name) == 0) {
+                i = sscanf(optarg, "%" PRIu64, &(options->exactMemory));
+                assert(i == 1);
+                options->exactMemory <<= 20;
+                break;
+            }
+            if (strcmp("sampleMemory", longOptions[longIndex].name) == 0) {
+                i = sscanf(optarg, "%" PRIu64, &(options->sampleMemory));
+                assert(i == 1);
+                options->sampleMemory <<= 20;
+                break;
+            }
+            if (strcmp("tmpDir", longOptions[longIndex].name) == 0) {
+                options->tmpDir = stString_copy(optarg);
+                break;
+            }
+            if (strcmp("batch", longOptions[longIndex].name) == 0) {
+                options->batchFile = stString_copy(optarg);
+                break;
+            }
+            if (strcmp("truthPairs", longOptions[longIndex].name) == 0) {
+                options->truthPairsFile = stString_copy(optarg);
+                break;
+            }
+            if (strcmp("shard", longOptions[longIndex].name) == 0) {
+                options->shardSpec = stString_copy(optarg);
+                break;
+            }
         case 'a':
             options->logLevelString = stString_copy(optarg);
             break;
@@ -428,15 +541,31 @@ int parseOptions(int argc, char **argv, Options* options) {
         fprintf(stderr, "\nError, specify --maf1\n");
         exit(2);
     }
-    if (options->mafFile2 == NULL) {
-        usage();
-        fprintf(stderr, "\nError, specify --maf2\n");
-        exit(2);
-    }
-    if (options->outputFile == NULL) {
-        usage();
-        fprintf(stderr, "\nError, specify --out\n");
-        exit(2);
+    if (options->batchFile != NULL) {
+        if (options->mafFile2 != NULL || options->outputFile != NULL) {
+            fprintf(stderr, "\nError, --batch lists the predictions and reports, drop --maf2 and --out.\n");
+            exit(2);
+        }
+        if (options->numPairsString != NULL || options->isConcurrent || options->isExact) {
+            fprintf(stderr, "\nError, --batch can not be combined with --numberOfPairs, --concurrent "
+                    "or --exact.\n");
+            exit(2);
+        }
+    } else {
+        if (options->truthPairsFile != NULL) {
+            fprintf(stderr, "\nError, --truthPairs is only used with --batch.\n");
+            exit(2);
+        }
+        if (options->mafFile2 == NULL) {
+            usage();
+            fprintf(stderr, "\nError, specify --maf2\n");
+            exit(2);
+        }
+        if (options->outputFile == NULL) {
+            usage();
+            fprintf(stderr, "\nError, specify --out\n");
+            exit(2);
+        }
     }
     if (options->wigglePairs != NULL) {
         if (!countChars(options->wigglePairs, ':') % 2) {
@@ -471,65 +600,63 @@ int parseOptions(int argc, char **argv, Options* options) {
         assert(i == 1);
         stList_destruct(numbers);
     }
-    FILE *fileHandle = de_fopen(options->mafFile1, "r");
-    fclose(fileHandle);
-    fileHandle = de_fopen(options->mafFile2, "r");
-    fclose(fileHandle);
-    return optind;
-}
-int main(int argc, char **argv) {
-    Options *options = options_construct();
+    if (options->isExact && options->near != 0) {
+        fprintf(stderr, "\nError, --exact matches pairs exactly and can not be combined with --near.\n");
+        exit(2);
+    }
+    if (options->isExact && options->isConcurrent) {
+        fprintf(stderr, "\nError, --exact streams each maf once already, drop --concurrent.\n");
+        exit(2);
+    }
+    if (options->sampleMemory != 0) {
+        if (options->isReservoirSampling || options->near != 0) {
+            fprintf(stderr, "\nError, --sampleMemory can not be combined with --reservoir or --near.\n");
+            exit(2);
+        }
+        if (options->isConcurrent || options->batchFile != NULL || options->isExact) {
+            fprintf(stderr, "\nError, --sampleMemory can not be combined with --concurrent, --batch or --exact.\n");
+            exit(2);
+        }
+    }
+    if (options->shardSpec != NULL) {
+        if (!isShardSpecValid(options->shardSpec)) {
+            fprintf(stderr, "\nError, --shard must be i/n with i < n, or a comma separated list of "
+                    "sequences.\n");
+            exit(2);
+        }
+        if (options->batchFile != NULL || options->isExact) {
+            fprintf(stderr, "\nError, --shard can not be combined with --batch or --exact.\n");
+            exit(2);
+        }
+    }
+    if (options->batchFile != NULL) {
+        if (!maf_isStdStream(options->mafFile1) && !maf_isShardSpec(options->mafFile1)) {
+            fclose(de_fopen(options->mafFile1, "r"));
+        }
+        // the predictions are checked as the batch file is read
+        return optind;
+    }
+    if (maf_isStdStream(options->mafFile1) && maf_isStdStream(options->mafFile2)) {
+        fprintf(stderr, "\nError, only one of --maf1 and --maf2 may be read from stdin.\n");
+        exit(2);
+    }
     FILE *fileHandle = NULL;
-    stHash *intervalsHash = stHash_construct3(stHash_stringKey, stHash_stringEqualKey, free,
-                                              (void(*)(void *)) stSortedSet_destruct);
-    // (0) Parse the inputs
-    parseOptions(argc, argv, options);
-    stList *wigglePairPatternList = stList_construct3(0, free);
-    listifercateKeyValuePairs(options->wigglePairs, wigglePairPatternList);
-    // Set up logging
-    st_setLogLevelFromString(options->logLevelString);
-    st_logDebug("Seeding the random number generator with the value %lo\n", options->randomSeed);
-    st_randomSeed(options->randomSeed);
-    // Check the inputs.
-    // Parse the bed file hashes
-    if(options->bedFiles != NULL) {
-        parseBedFiles(options->bedFiles, intervalsHash);
-    } else {
-        st_logDebug("No bed files specified\n");
+    // shards are checked as they are opened
+    if (!maf_isStdStream(options->mafFile1) && !maf_isShardSpec(options->mafFile1)) {
+        fileHandle = de_fopen(options->mafFile1, "r");
+        fclose(fileHandle);
     }
-    // Log (some of) the inputs
-    st_logInfo("MAF file 1 name : %s\n", options->mafFile1);
-    st_logInfo("MAF file 2 name : %s\n", options->mafFile2);
-    st_logInfo("Output stats file : %s\n", options->outputFile);
-    st_logInfo("Bed files parsed : %" PRIi64 "\n", stHash_size(intervalsHash));
-    st_logInfo("Number of samples %" PRIu64 "\n", options->numberOfSamples);
-    // note that random seed has already been logged.
-    // Create sequence name hashtable from the first MAF file.
-    stHash *sequenceLengthHash = stHash_construct3(stHash_stringKey, stHash_stringEqualKey, free, free);
-    stSet *seqNamesSet = stSet_construct3(stHash_stringKey, stHash_stringEqualKey, free);
-    buildSeqNamesSet(options, seqNamesSet, sequenceLengthHash);
-    // build final wiggle things
-    stHash *wigglePairHash = stHash_construct3(stHash_stringKey, stHash_stringEqualKey,
-                                               free, (void(*)(void *))wiggleContainer_destruct);
-    buildWigglePairHash(sequenceLengthHash, wigglePairPatternList, wigglePairHash, options->wiggleBinLength,
-                        options->wiggleRegionStart, options->wiggleRegionStop);
-    // Do comparisons.
-    if (g_isVerboseFailures) {
-        fprintf(stderr, "# Sampling from %s, comparing to %s\n", options->mafFile1, options->mafFile2);
-        fprintf(stderr, "# seq1\tabsPos1\torigPos1\tseq2\tabsPos2\torigPos2\n");
-    }
-    stSortedSet *results_12 = compareMAFs_AB(options->mafFile1, options->mafFile2, &(options->numPairs1),
-                                             seqNamesSet, intervalsHash, wigglePairHash, true, options,
-                                             sequenceLengthHash);
-    if (g_isVerboseFailures) {
-        fprintf(stderr, "# Sampling from %s, comparing to %s\n", options->mafFile2, options->mafFile1);
-        fprintf(stderr, "# seq1\tabsPos1\torigPos1\tseq2\tabsPos2\torigPos2\n");
-    }
-    stSortedSet *results_21 = compareMAFs_AB(options->mafFile2, options->mafFile1, &(options->numPairs2),
-                                             seqNamesSet, intervalsHash, wigglePairHash, false, options,
-                                             sequenceLengthHash);
-    fileHandle = de_fopen(options->outputFile, "w");
-    // Report results.
+    if (!maf_isStdStream(options->mafFile2) && !maf_isShardSpec(options->mafFile2)) {
+        fileHandle = de_fopen(options->mafFile2, "r");
+        fclose(fileHandle);
+    }
+    return optind;
+}
+void writeReport(Options *options, const char *mafFile2, const char *outputFile, uint64_t numPairs1,
+                 uint64_t numPairs2, stSortedSet *results_12, stSortedSet *results_21, stSet *seqNamesSet,
+                 stHash *wigglePairHash) {
+    // the XML report of the comparisons of options->mafFile1 and mafFile2
+    FILE *fileHandle = de_fopen(outputFile, "w");
     writeXMLHeader(fileHandle);
     char bedString[kMaxStringLength];
     if (options->bedFiles != NULL) {
@@ -551,29 +678,232 @@ int main(int argc, char **argv) {
     } else {
         wiggleRegionString[0] = '\0';
     }
+    // the default, independent sampling, is not named so that its report is as it always was
+    const char *samplingString = "";
+    if (options->isExact) {
+        samplingString = " sampling=\"exact\"";
+    } else if (options->isReservoirSampling) {
+        samplingString = " sampling=\"reservoir\"";
+    }
+    char batchString[kMaxStringLength];
+    if (options->batchFile != NULL) {
+        sprintf(batchString, " batch=\"%s\"", options->batchFile);
+    } else {
+        batchString[0] = '\0';
+    }
     fprintf(fileHandle, "<alignmentComparisons numberOfSamples=\"%" PRIu64 "\" "
-            "near=\"%" PRIu64 "\" seed=\"%" PRIu64 "\" maf1=\"%s\" maf2=\"%s\" "
+            "near=\"%" PRIu64 "\" seed=\"%" PRIu64 "\"%s maf1=\"%s\" maf2=\"%s\" "
             "numberOfPairsInMaf1=\"%" PRIu64 "\" "
-            "numberOfPairsInMaf2=\"%" PRIu64 "\"%s%s%s version=\"%s\" "
+            "numberOfPairsInMaf2=\"%" PRIu64 "\"%s%s%s%s version=\"%s\" "
             "buildDate=\"%s\" buildBranch=\"%s\" buildCommit=\"%s\">\n",
-            options->numberOfSamples, options->near, options->randomSeed, options->mafFile1, options->mafFile2,
-            options->numPairs1, options->numPairs2, bedString, wiggleString, wiggleRegionString,
+            options->numberOfSamples, options->near, options->randomSeed,
+            samplingString, options->mafFile1, mafFile2,
+            numPairs1, numPairs2, bedString, wiggleString, wiggleRegionString, batchString,
             g_version, g_build_date, g_build_git_branch, g_build_git_sha);
-    reportResults(results_12, options->mafFile1, options->mafFile2, fileHandle, options->near,
+    reportResults(results_12, options->mafFile1, mafFile2, fileHandle, options->near,
                   seqNamesSet, options->bedFiles);
-    reportResults(results_21, options->mafFile2, options->mafFile1, fileHandle, options->near,
+    reportResults(results_21, mafFile2, options->mafFile1, fileHandle, options->near,
                   seqNamesSet, options->bedFiles);
     reportResultsForWiggles(wigglePairHash, fileHandle);
     fprintf(fileHandle, "</alignmentComparisons>\n");
     fclose(fileHandle);
-    // Clean up.
+}
+void usageMerge(void) {
+    version();
+    fprintf(stderr, "Usage: $ mafComparator merge --out=OUT.xml PARTIAL1 PARTIAL2 ...\n\n");
+    fprintf(stderr, "Adds up the partial results that the shards of a mafComparator --shard run "
+            "wrote and\nwrites the XML report of the whole comparison. Every shard has to be "
+            "given, once.\n\n");
+    fprintf(stderr, "Options:\n");
+    usageMessage('h', "help", "Print this help screen.");
+    usageMessage('\0', "out", "The output XML formatted results file.");
+}
+int mergeMain(int argc, char **argv) {
+    // mafComparator merge, argv[0] is "merge"
+    static const struct option longOptions[] = {
+        {"out", required_argument, 0, 'o'},
+        {"help", no_argument, 0, 'h'},
+        {0, 0, 0, 0 }};
+    char *outputFile = NULL;
+    int longIndex = 0;
+    int key;
+    while ((key = getopt_long(argc, argv, "o:h", longOptions, &longIndex)) != -1) {
+        switch (key) {
+        case 'o':
+            free(outputFile);
+            outputFile = stString_copy(optarg);
+            break;
+        case 'h':
+            usageMerge();
+            fprintf(stderr, "\nHelp printed.\n");
+            exit(EXIT_SUCCESS);
+        default:
+            usageMerge();
+            exit(2);
+        }
+    }
+    if (outputFile == NULL || optind >= argc) {
+        usageMerge();
+        fprintf(stderr, "\nError, specify --out and at least one partial results file.\n");
+        exit(2);
+    }
+    Options *options = options_construct();
+    stSet *seqNamesSet = stSet_construct3(stHash_stringKey, stHash_stringEqualKey, free);
+    stHash *wigglePairHash = stHash_construct3(stHash_stringKey, stHash_stringEqualKey,
+                                               free, (void(*)(void *))wiggleContainer_destruct);
+    stSortedSet *results_12 = NULL;
+    stSortedSet *results_21 = NULL;
+    mergePartialResults(argv + optind, argc - optind, options, seqNamesSet, wigglePairHash,
+                        &results_12, &results_21);
+    writeReport(options, options->mafFile2, outputFile, options->numPairs1, options->numPairs2, results_12,
+                results_21, seqNamesSet, wigglePairHash);
     stSortedSet_destruct(results_12);
     stSortedSet_destruct(results_21);
+    stHash_destruct(wigglePairHash);
+    stSet_destruct(seqNamesSet);
+    options_destruct(options);
+    free(outputFile);
+    return(EXIT_SUCCESS);
+}
+int main(int argc, char **argv) {
+    if (argc > 1 && strcmp(argv[1], "merge") == 0) {
+        return mergeMain(argc - 1, argv + 1);
+    }
+    Options *options = options_construct();
+    stHash *intervalsHash = stHash_construct3(stHash_stringKey, stHash_stringEqualKey, free,
+                                              (void(*)(void *)) intervals_destroy);
+    // (0) Parse the inputs
+    parseOptions(argc, argv, options);
+    profile_init(options->profileFile);
+    // every maf is read several times, so stdin is copied once up front. with
+    // --concurrent each maf is read once, only stdin given twice needs the copy.
+    if (options->batchFile != NULL ? maf_isStdStream(options->mafFile1)
+        : (options->isConcurrent ? (maf_isStdStream(options->mafFile1) && maf_isStdStream(options->mafFile2))
+           : (maf_isStdStream(options->mafFile1) || maf_isStdStream(options->mafFile2)))) {
+        maf_spoolStdin();
+    }
+    stList *wigglePairPatternList = stList_construct3(0, free);
+    listifercateKeyValuePairs(options->wigglePairs, wigglePairPatternList);
+    // Set up logging
+    st_setLogLevelFromString(options->logLevelString);
+    st_logDebug("Seeding the random number generator with the value %lo\n", options->randomSeed);
+    st_randomSeed(options->randomSeed);
+    // Check the inputs.
+    // Parse the bed file hashes
+    if(options->bedFiles != NULL) {
+        profileSpan_t span = profile_begin("parseBedFiles");
+        parseBedFiles(options->bedFiles, intervalsHash);
+        profile_end(span);
+    } else {
+        st_logDebug("No bed files specified\n");
+    }
+    // Log (some of) the inputs
+    st_logInfo("MAF file 1 name : %s\n", options->mafFile1);
+    if (options->batchFile != NULL) {
+        st_logInfo("Batch file : %s\n", options->batchFile);
+    } else {
+        st_logInfo("MAF file 2 name : %s\n", options->mafFile2);
+        st_logInfo("Output stats file : %s\n", options->outputFile);
+    }
+    st_logInfo("Bed files parsed : %" PRIi64 "\n", stHash_size(intervalsHash));
+    st_logInfo("Number of samples %" PRIu64 "\n", options->numberOfSamples);
+    // note that random seed has already been logged.
+    // Create sequence name hashtable from the first MAF file.
+    stHash *sequenceLengthHash = stHash_construct3(stHash_stringKey, stHash_stringEqualKey, free, free);
+    stSet *seqNamesSet = stSet_construct3(stHash_stringKey, stHash_stringEqualKey, free);
+    profileSpan_t span;
+    if (options->batchFile != NULL) {
+        // one truth, many predictions, one report per prediction
+        stList *batch = readBatchFile(options->batchFile);
+        buildBatchSeqNamesSets(options, batch, seqNamesSet, sequenceLengthHash, wigglePairPatternList);
+        span = profile_begin("compareMAFsInBatch");
+        compareMAFsInBatch(options, batch, intervalsHash, sequenceLengthHash);
+        profile_end(span);
+        span = profile_begin("reportResults");
+        for (int64_t i = 0; i < stList_length(batch); ++i) {
+            BatchComparison *bc = stList_get(batch, i);
+            writeReport(options, bc->mafFile2, bc->outputFile, bc->numPairs1, bc->numPairs2, bc->results_12,
+                        bc->results_21, bc->legitSequences, bc->wigglePairHash);
+        }
+        profile_end(span);
+        stList_destruct(batch);
+    } else {
+        mafBlock_t *blocks1 = NULL;
+        mafBlock_t *blocks2 = NULL;
+        if (options->isConcurrent) {
+            readMafsConcurrently(options->mafFile1, options->mafFile2, &blocks1, &blocks2);
+        }
+        buildSeqNamesSetFromBlocks(options, seqNamesSet, sequenceLengthHash, blocks1, blocks2);
+        if (options->shardSpec != NULL) {
+            options->shardSequences = getShardSequences(options->shardSpec, seqNamesSet);
+            st_logInfo("Shard %s holds %" PRIi64 " of %" PRIi64 " sequences\n", options->shardSpec,
+                       stSet_size(options->shardSequences), stSet_size(seqNamesSet));
+        }
+        // build final wiggle things
+        stHash *wigglePairHash = stHash_construct3(stHash_stringKey, stHash_stringEqualKey,
+                                                   free, (void(*)(void *))wiggleContainer_destruct);
+        buildWigglePairHash(sequenceLengthHash, wigglePairPatternList, wigglePairHash, options->wiggleBinLength,
+                            options->wiggleRegionStart, options->wiggleRegionStop);
+        // Do comparisons.
+        stSortedSet *results_12 = NULL;
+        stSortedSet *results_21 = NULL;
+        if (options->isExact) {
+            span = profile_begin("compareMAFsExactly");
+            compareMAFsExactly(options, seqNamesSet, intervalsHash, wigglePairHash, sequenceLengthHash,
+                               &results_12, &results_21);
+            profile_end(span);
+        } else if (options->isConcurrent) {
+            span = profile_begin("compareMAFsConcurrently");
+            compareMAFsConcurrently(blocks1, blocks2, seqNamesSet, intervalsHash, wigglePairHash, options,
+                                    sequenceLengthHash, &results_12, &results_21);
+            profile_end(span);
+            maf_destroyMafBlockList(blocks1);
+            maf_destroyMafBlockList(blocks2);
+        } else {
+            if (g_isVerboseFailures) {
+                fprintf(stderr, "# Sampling from %s, comparing to %s\n", options->mafFile1, options->mafFile2);
+                fprintf(stderr, "# seq1\tabsPos1\torigPos1\tseq2\tabsPos2\torigPos2\n");
+            }
+            stSortedSet* (*compareMAFs)(const char *, const char *, uint64_t *, stSet *, stHash *, stHash *,
+                                        bool, Options *, stHash *) = compareMAFs_AB;
+            if (options->sampleMemory != 0) {
+                compareMAFs = compareMAFsInBoundedMemory;
+            }
+            span = profile_begin("compareMAFs_AB maf1 -> maf2");
+            results_12 = compareMAFs(options->mafFile1, options->mafFile2, &(options->numPairs1),
+                                     seqNamesSet, intervalsHash, wigglePairHash, true, options,
+                                     sequenceLengthHash);
+            profile_end(span);
+            if (g_isVerboseFailures) {
+                fprintf(stderr, "# Sampling from %s, comparing to %s\n", options->mafFile2, options->mafFile1);
+                fprintf(stderr, "# seq1\tabsPos1\torigPos1\tseq2\tabsPos2\torigPos2\n");
+            }
+            span = profile_begin("compareMAFs_AB maf2 -> maf1");
+            results_21 = compareMAFs(options->mafFile2, options->mafFile1, &(options->numPairs2),
+                                     seqNamesSet, intervalsHash, wigglePairHash, false, options,
+                                     sequenceLengthHash);
+            profile_end(span);
+        }
+        // Report results.
+        span = profile_begin("reportResults");
+        if (options->shardSpec != NULL) {
+            writePartialResults(options->outputFile, options, seqNamesSet, results_12, results_21,
+                                wigglePairHash);
+        } else {
+            writeReport(options, options->mafFile2, options->outputFile, options->numPairs1, options->numPairs2,
+                        results_12, results_21, seqNamesSet, wigglePairHash);
+        }
+        profile_end(span);
+        stSortedSet_destruct(results_12);
+        stSortedSet_destruct(results_21);
+        stHash_destruct(wigglePairHash);
+    }
+    // Clean up.
     options_destruct(options);
     stSet_destruct(seqNamesSet);
     stHash_destruct(intervalsHash);
-    stHash_destruct(wigglePairHash);
     stHash_destruct(sequenceLengthHash);
     stList_destruct(wigglePairPatternList);
+    profile_finish();
     return(EXIT_SUCCESS);
 }
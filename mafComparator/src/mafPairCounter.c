@@ -28,14 +28,16 @@
 #include <getopt.h>
 #include "sonLib.h"
 #include "common.h"
+#include "sharedMaf.h"
 #include "comparatorAPI.h"
+#include "profile.h"
 #include "buildVersion.h"
 
 const char *g_version = "version 0.1 July 2012";
 
 void version(void);
 void usage(void);
-int parseOptions(int argc, char **argv, char **maf, char **maf2, char **seqList);
+int parseOptions(int argc, char **argv, char **maf, char **maf2, char **seqList, unsigned *numThreads);
 stSet* buildSet(char *listOfLegitSequences);
 
 void version(void) {
@@ -51,7 +53,9 @@ void usage(void) {
             "of the sequences present in --maf and present in --maf2.\n\n");
     fprintf(stderr, "Options:\n");
     usageMessage('h', "help", "Show this help message and exit.");
-    usageMessage('\0', "maf", "The location of the MAF file. "
+    usageMessage('\0', "maf", "The location of the MAF file, or - to read from stdin, or a "
+                 "sharded maf, either @FILE where FILE lists one maf per line or a quoted glob "
+                 "pattern such as 'aln.chr*.maf'. "
                  "The number of pairs contained in the file will be counted and "
                  "reported in stdout.");
     usageMessage('\0', "sequences", "Comma separated list of sequences allowed to be in pairs. " 
@@ -61,14 +65,20 @@ void usage(void) {
                  "Using this option causes --sequences option to be ignored. Sequences will "
                  "be discovered by intersection of sequences present in both maf files, pairs "
                  "reported will be from the --maf option.");
+    usageMessage('\0', "threads", "The number of shards of a sharded maf to count at once, "
+                 "0 for one per processor. [default: 0]");
+    usageMessage('\0', "profile", "Record the time spent in each phase of the program and "
+                 "write it to FILE in the Chrome trace event format.");
     usageMessage('v', "version", "Print current version number.");
 }
-int parseOptions(int argc, char **argv, char **maf, char **maf2, char **seqList) {
+int parseOptions(int argc, char **argv, char **maf, char **maf2, char **seqList, unsigned *numThreads) {
     static const char *optString = "v:h:";
     static const struct option longOpts[] = {
         {"maf", required_argument, 0, 0},
         {"maf2", required_argument, 0, 0},
         {"sequences", required_argument, 0, 0},
+        {"profile", required_argument, 0, 0},
+        {"threads", required_argument, 0, 0},
         {"version", no_argument, 0, 'v'},
         {"help", no_argument, 0, 'h'},
         {0, 0, 0, 0 }};
@@ -89,6 +99,17 @@ int parseOptions(int argc, char **argv, char **maf, char **maf2, char **seqList)
                 *seqList = stString_copy(optarg);
                 break;
             }
+            if (strcmp("profile", longOpts[longIndex].name) == 0) {
+                profile_init(optarg);
+                break;
+            }
+            if (strcmp("threads", longOpts[longIndex].name) == 0) {
+                if (sscanf(optarg, "%u", numThreads) != 1) {
+                    fprintf(stderr, "\nError, --threads must be a non-negative integer\n");
+                    exit(2);
+                }
+                break;
+            }
         case 'v':
             version();
             exit(EXIT_SUCCESS);
@@ -109,14 +130,23 @@ int parseOptions(int argc, char **argv, char **maf, char **maf2, char **seqList)
         fprintf(stderr, "\nError, specify --maf\n");
         exit(2);
     }
-    FILE *fileHandle = de_fopen(*maf, "r");
-    fclose(fileHandle);
-    if (*maf2 != NULL) {
-        fileHandle = de_fopen(*maf2, "r");
+    FILE *fileHandle = NULL;
+    if (!maf_isStdStream(*maf) && !maf_isShardSpec(*maf)) {
+        fileHandle = de_fopen(*maf, "r");
         fclose(fileHandle);
+    }
+    if (*maf2 != NULL) {
+        if (maf_isStdStream(*maf) && maf_isStdStream(*maf2)) {
+            fprintf(stderr, "\nError, only one of --maf and --maf2 may be read from stdin.\n");
+            exit(2);
+        }
+        if (!maf_isStdStream(*maf2) && !maf_isShardSpec(*maf2)) {
+            fileHandle = de_fopen(*maf2, "r");
+            fclose(fileHandle);
+        }
         if (*seqList != NULL) {
-            free(seqList);
-            seqList = NULL;
+            free(*seqList);
+            *seqList = NULL;
         }
     }
     return optind;
@@ -141,19 +171,27 @@ int main(int argc, char **argv) {
     stSet *maf1SeqSet = NULL;
     stSet *maf2SeqSet = NULL;
     stHash *sequenceLengthHash = stHash_construct3(stHash_stringKey, stHash_stringEqualKey, free, free);
-    parseOptions(argc, argv, &maf, &maf2, &listOfLegitSequences);
+    unsigned numThreads = 0;
+    parseOptions(argc, argv, &maf, &maf2, &listOfLegitSequences, &numThreads);
     if (listOfLegitSequences != NULL) {
         legitSeqsSet = buildSet(listOfLegitSequences);
     }
     if (maf2 != NULL) {
-        // build legitHash by intersection
+        // build legitHash by intersection, which reads --maf twice.
+        if (maf_isStdStream(maf) || maf_isStdStream(maf2)) {
+            maf_spoolStdin();
+        }
         maf1SeqSet = stSet_construct3(stHash_stringKey, stHash_stringEqualKey, free);
         maf2SeqSet = stSet_construct3(stHash_stringKey, stHash_stringEqualKey, free);
+        profileSpan_t span = profile_begin("populateNames");
         populateNames(maf, maf1SeqSet, sequenceLengthHash);
         populateNames(maf2, maf2SeqSet, sequenceLengthHash);
         legitSeqsSet = stSet_getIntersection(maf1SeqSet, maf2SeqSet);
+        profile_end(span);
     }
-    uint64_t numberOfPairs = countPairsInMaf(maf, legitSeqsSet);
+    profileSpan_t span = profile_begin("countPairsInMaf");
+    uint64_t numberOfPairs = countPairsInMaf(maf, legitSeqsSet, numThreads);
+    profile_end(span);
     printf("%"PRIu64"\n", numberOfPairs);
     // clean up
     if (legitSeqsSet != NULL) {
@@ -167,5 +205,6 @@ int main(int argc, char **argv) {
     free(maf2);
     free(listOfLegitSequences);
     stHash_destruct(sequenceLengthHash);
+    profile_finish();
     return(EXIT_SUCCESS);
 }
@@ -23,6 +23,7 @@
  * THE SOFTWARE. 
  */
 #include <assert.h>
+#include <math.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -109,10 +110,9 @@ static void test_mappingRoundTrip_0(CuTest *testCase) {
     }
 }
 static void pairTest(CuTest *testCase, const char *block, uint64_t expected, stSet *legitPairs) {
-    uint64_t *chooseTwoArray = buildChooseTwoArray();
     uint64_t observed;
     mafBlock_t *mb = maf_newMafBlockFromString(block, 3);
-    observed = walkBlockCountingPairs(mb, legitPairs, chooseTwoArray);
+    observed = walkBlockCountingPairs(mb, legitPairs);
     // printf("observed: %" PRIu64 " expected:%" PRIu64 "\n", observed, expected);
     CuAssertTrue(testCase, observed == expected);
     // clean up
@@ -243,12 +243,13 @@ static void test_columnSampling_timing_0(CuTest *testCase) {
     double timeClever, timeNaive, p;
     time_t t1;
     uint64_t colLength = 2000;
-    stSortedSet *pairs = NULL;
+    PairStore *pairs = NULL;
+    stSet *nameSet = NULL;
     char **nameArray = NULL;
+    RandomStream random;
+    randomStream_init(&random, 0, 0);
     printf("#Rows        p      n*p clever naive\n");
     for (uint64_t i = 0; i < 9; ++i) {
-        pairs = stSortedSet_construct3((int(*)(const void *, const void *)) aPair_cmpFunction, 
-                                       (void(*)(void *)) aPair_destruct);
         n = 2 << i;
         p = 2.0 / (n * (n - 1));
         mat = createRandomColumn(n, colLength, 0.1);
@@ -259,29 +260,34 @@ static void test_columnSampling_timing_0(CuTest *testCase) {
         strandInts = (int*) st_malloc(sizeof(*strandInts) * n);
         intset(strandInts, 1, n);
         nameArray = createNameArray(n);
+        nameSet = stSet_construct3(stHash_stringKey, stHash_stringEqualKey, NULL);
+        for (uint64_t j = 0; j < n; ++j) {
+            stSet_insert(nameSet, nameArray[j]);
+        }
+        pairs = pairStore_construct(nameSet);
         timeClever = 0.0;
         timeNaive = 0.0;
         t1 = time(NULL);
         for (uint64_t c = 0; c < colLength; ++c) {
-            samplePairsFromColumn(0.01, pairs, m, chooseTwoArray, nameArray, positions);
+            samplePairsFromColumn(&random, 0.01, pairs, m, chooseTwoArray, nameArray, positions);
             updatePositions(mat, c, positions, strandInts, n);
         }
         timeClever = difftime(time(NULL), t1);
         free(positions);
-        stSortedSet_destruct(pairs);
+        pairStore_clear(pairs);
         positions = (uint64_t*) st_malloc(sizeof(*positions) * n);
         memset(positions, 0, sizeof(*positions) * n);
-        pairs = stSortedSet_construct3((int(*)(const void *, const void *)) aPair_cmpFunction, 
-                                       (void(*)(void *)) aPair_destruct);
         t1 = time(NULL);
         for (uint64_t c = 0; c < colLength; ++c) {
-            samplePairsFromColumnNaive(mat, c, legitRows, 0.01, pairs, chooseTwoArray, 
+            samplePairsFromColumnNaive(&random, mat, c, legitRows, 0.01, pairs, chooseTwoArray, 
                                        nameArray, positions, n, chooseTwo(n));
             updatePositions(mat, c, positions, strandInts, n);
         }
         timeNaive = difftime(time(NULL), t1);
         printf("%5" PRIu64 " %6.2e %6f %4.0fs %4.0fs\n", n, p, p * n, timeClever, timeNaive);
         // clean up
+        pairStore_destruct(pairs);
+        stSet_destruct(nameSet);
         for (uint64_t j = 0; j < n; ++j) {
             free(mat[j]);
             free(nameArray[j]); // we ONLY do this in this test example, not in production code.
@@ -405,6 +411,387 @@ static void test_pairSortComparison_0(CuTest *testCase) {
     stSortedSet_destruct(pairs);
     
 }
+static void writeHomologyTestMaf(const char *filename, bool shift) {
+    // enough blocks to span several batches of performHomologyTests. when shift is
+    // set every third block has its last row moved over by one position.
+    const char *seqs[] = {"ACGTACGT-ACGTAC", "ACG-ACGTTACGTAC", "AC--ACGTTACG-AC"};
+    uint64_t pos[] = {0, 0, 0};
+    FILE *f = de_fopen(filename, "w");
+    fprintf(f, "##maf version=1\n\n");
+    for (unsigned b = 0; b < 1500; ++b) {
+        fprintf(f, "a score=0\n");
+        for (unsigned r = 0; r < 3; ++r) {
+            uint64_t len = countNonGaps((char *) seqs[r]);
+            uint64_t start = pos[r] + ((shift && r == 2 && b % 3 == 0) ? 1 : 0);
+            fprintf(f, "s seq%u %" PRIu64 " %" PRIu64 " + 100000 %s\n", r, start, len, seqs[r]);
+            pos[r] += len + 2;
+        }
+        fprintf(f, "\n");
+    }
+    fclose(f);
+}
+static void test_homologyTestsThreaded_0(CuTest *testCase) {
+    // the positive pairs found must not depend on the number of threads
+    const char *mafA = "test/homologyA.maf";
+    const char *mafB = "test/homologyB.maf";
+    writeHomologyTestMaf(mafA, false);
+    writeHomologyTestMaf(mafB, true);
+    stSet *legitSequences = stSet_construct3(stHash_stringKey, stHash_stringEqualKey, free);
+    stSet_insert(legitSequences, stString_copy("seq0"));
+    stSet_insert(legitSequences, stString_copy("seq1"));
+    stSet_insert(legitSequences, stString_copy("seq2"));
+    stHash *sequenceLengthHash = stHash_construct3(stHash_stringKey, stHash_stringEqualKey, free, free);
+    PairStore *pairs = pairStore_construct(legitSequences);
+    uint64_t numPairs = 0;
+    PairSampler sampler;
+    pairSampler_initBernoulli(&sampler, 1.0, 0);
+    samplePairsFromMaf(mafA, pairs, &sampler, legitSequences, &numPairs, sequenceLengthHash);
+    uint64_t n = pairStore_size(pairs);
+    CuAssertTrue(testCase, numPairs == n);
+    bool *serial = (bool *) st_calloc(n, sizeof(*serial));
+    performHomologyTests(mafB, pairs, serial, legitSequences, 0, 1);
+    uint64_t numPositive = 0;
+    for (uint64_t i = 0; i < n; ++i) {
+        numPositive += serial[i] ? 1 : 0;
+    }
+    CuAssertTrue(testCase, numPositive > 0);
+    CuAssertTrue(testCase, numPositive < n);
+    unsigned threads[] = {2, 3, 8};
+    for (unsigned t = 0; t < sizeof(threads) / sizeof(threads[0]); ++t) {
+        bool *threaded = (bool *) st_calloc(n, sizeof(*threaded));
+        performHomologyTests(mafB, pairs, threaded, legitSequences, 0, threads[t]);
+        CuAssertTrue(testCase, memcmp(serial, threaded, n * sizeof(*serial)) == 0);
+        free(threaded);
+    }
+    // clean up
+    free(serial);
+    pairStore_destruct(pairs);
+    stHash_destruct(sequenceLengthHash);
+    stSet_destruct(legitSequences);
+    remove(mafA);
+    remove(mafB);
+}
+static const char *kSyntheticNames[] = {"s0", "s1", "s2", "s3"};
+static const uint64_t kSyntheticSeqs = 4, kSyntheticColumns = 100;
+static void sampleSyntheticColumns(PairSampler *sampler, PairStore *pairs) {
+    // kSyntheticColumns columns of kSyntheticSeqs rows, the position of row r in column c is 10 * c + r
+    // so that each sampled pair can be traced back to its index with syntheticPairIndex()
+    char *nameArray[4];
+    uint64_t positions[4];
+    uint64_t numPairs = chooseTwo(kSyntheticSeqs);
+    for (uint64_t c = 0; c < kSyntheticColumns; ++c) {
+        if (!pairSampler_isInColumn(sampler, c * numPairs, numPairs)) {
+            continue;
+        }
+        for (uint64_t r = 0; r < kSyntheticSeqs; ++r) {
+            nameArray[r] = (char *) kSyntheticNames[r];
+            positions[r] = 10 * c + r;
+        }
+        samplePairsFromColumnBySkipping(sampler, pairs, kSyntheticSeqs, c * numPairs, nameArray, positions);
+    }
+    pairStore_sort(pairs);
+}
+static uint64_t syntheticPairIndex(PairStore *pairs, uint64_t j) {
+    uint64_t id1, pos1, id2, pos2, i;
+    pairStore_get(pairs, j, &id1, &pos1, &id2, &pos2);
+    assert(pos1 / 10 == pos2 / 10);
+    pairIndicesToArrayIndex(pos1 % 10, pos2 % 10, kSyntheticSeqs, &i);
+    return (pos1 / 10) * chooseTwo(kSyntheticSeqs) + i;
+}
+static stSet* createSyntheticNameSet(void) {
+    stSet *names = stSet_construct3(stHash_stringKey, stHash_stringEqualKey, free);
+    for (uint64_t r = 0; r < kSyntheticSeqs; ++r) {
+        stSet_insert(names, stString_copy(kSyntheticNames[r]));
+    }
+    return names;
+}
+static void test_reservoirSampling_0(CuTest *testCase) {
+    // a reservoir keeps exactly its size in pairs, and every pair of the stream, early or late
+    // in it, ends up in the sample about size / total of the time
+    const uint64_t size = 60, numTrials = 2000;
+    uint64_t numPairs = chooseTwo(kSyntheticSeqs) * kSyntheticColumns;
+    stSet *names = createSyntheticNameSet();
+    uint64_t *counts = (uint64_t *) st_calloc(numPairs, sizeof(*counts));
+    for (uint64_t t = 0; t < numTrials; ++t) {
+        PairStore *pairs = pairStore_construct(names);
+        PairSampler sampler;
+        pairSampler_initReservoir(&sampler, size, 7 * numTrials + t);
+        sampleSyntheticColumns(&sampler, pairs);
+        CuAssertTrue(testCase, pairStore_size(pairs) == size);
+        for (uint64_t j = 0; j < pairStore_size(pairs); ++j) {
+            ++counts[syntheticPairIndex(pairs, j)];
+        }
+        pairStore_destruct(pairs);
+    }
+    double expected = (double) numTrials * size / numPairs;
+    for (uint64_t i = 0; i < numPairs; ++i) {
+        CuAssertTrue(testCase, fabs(counts[i] - expected) < 0.35 * expected);
+    }
+    // a reservoir at least as large as the stream keeps all of it
+    PairStore *pairs = pairStore_construct(names);
+    PairSampler sampler;
+    pairSampler_initReservoir(&sampler, numPairs, 7);
+    sampleSyntheticColumns(&sampler, pairs);
+    CuAssertTrue(testCase, pairStore_size(pairs) == numPairs);
+    // clean up
+    pairStore_destruct(pairs);
+    free(counts);
+    stSet_destruct(names);
+}
+static void test_bernoulliSampling_0(CuTest *testCase) {
+    // skipping ahead by geometric gaps samples every pair independently with the accept
+    // probability: each pair is in about p of the samples and the sample size varies
+    const double p = 0.1;
+    const uint64_t numTrials = 2000;
+    uint64_t numPairs = chooseTwo(kSyntheticSeqs) * kSyntheticColumns;
+    stSet *names = createSyntheticNameSet();
+    uint64_t *counts = (uint64_t *) st_calloc(numPairs, sizeof(*counts));
+    uint64_t minSize = UINT64_MAX, maxSize = 0;
+    double sumSize = 0.0, sumSquaredSize = 0.0;
+    for (uint64_t t = 0; t < numTrials; ++t) {
+        PairStore *pairs = pairStore_construct(names);
+        PairSampler sampler;
+        pairSampler_initBernoulli(&sampler, p, 11 * numTrials + t);
+        sampleSyntheticColumns(&sampler, pairs);
+        uint64_t n = pairStore_size(pairs);
+        minSize = (n < minSize) ? n : minSize;
+        maxSize = (n > maxSize) ? n : maxSize;
+        sumSize += n;
+        sumSquaredSize += (double) n * n;
+        for (uint64_t j = 0; j < n; ++j) {
+            ++counts[syntheticPairIndex(pairs, j)];
+        }
+        pairStore_destruct(pairs);
+    }
+    double expected = numTrials * p;
+    for (uint64_t i = 0; i < numPairs; ++i) {
+        CuAssertTrue(testCase, fabs(counts[i] - expected) < 0.35 * expected);
+    }
+    // binomial(numPairs, p) sample sizes
+    double mean = sumSize / numTrials;
+    double variance = sumSquaredSize / numTrials - mean * mean;
+    CuAssertTrue(testCase, fabs(mean - numPairs * p) < 1.0);
+    CuAssertTrue(testCase, fabs(variance - numPairs * p * (1.0 - p)) < 0.15 * numPairs * p * (1.0 - p));
+    CuAssertTrue(testCase, minSize < maxSize);
+    // a probability of one takes every pair, zero takes none
+    PairSampler sampler;
+    PairStore *pairs = pairStore_construct(names);
+    pairSampler_initBernoulli(&sampler, 1.0, 11);
+    sampleSyntheticColumns(&sampler, pairs);
+    CuAssertTrue(testCase, pairStore_size(pairs) == numPairs);
+    pairStore_clear(pairs);
+    pairSampler_initBernoulli(&sampler, 0.0, 11);
+    sampleSyntheticColumns(&sampler, pairs);
+    CuAssertTrue(testCase, pairStore_size(pairs) == 0);
+    // clean up
+    pairStore_destruct(pairs);
+    free(counts);
+    stSet_destruct(names);
+}
+static void test_reservoirSamplingMaf_0(CuTest *testCase) {
+    // sampling a maf into a reservoir counts every pair of the maf in the same pass
+    const char *mafA = "test/reservoirA.maf";
+    writeHomologyTestMaf(mafA, false);
+    stSet *legitSequences = stSet_construct3(stHash_stringKey, stHash_stringEqualKey, free);
+    stSet_insert(legitSequences, stString_copy("seq0"));
+    stSet_insert(legitSequences, stString_copy("seq1"));
+    stSet_insert(legitSequences, stString_copy("seq2"));
+    stHash *sequenceLengthHash = stHash_construct3(stHash_stringKey, stHash_stringEqualKey, free, free);
+    uint64_t total = countPairsInMaf(mafA, legitSequences, 1);
+    PairStore *pairs = pairStore_construct(legitSequences);
+    PairSampler sampler;
+    pairSampler_initReservoir(&sampler, total / 3, 0);
+    uint64_t numPairs = 0;
+    samplePairsFromMaf(mafA, pairs, &sampler, legitSequences, &numPairs, sequenceLengthHash);
+    CuAssertTrue(testCase, numPairs == total);
+    CuAssertTrue(testCase, pairStore_size(pairs) == total / 3);
+    // clean up
+    pairStore_destruct(pairs);
+    stHash_destruct(sequenceLengthHash);
+    stSet_destruct(legitSequences);
+    remove(mafA);
+}
+static bool pairStoresAreEqual(PairStore *a, PairStore *b) {
+    return a->length == b->length && memcmp(a->pairs, b->pairs, sizeof(*(a->pairs)) * a->length) == 0;
+}
+static PairStore* sampleBlocksInBernoulli(const char *maf, mafBlock_t *blocks, stSet *legitSequences,
+                                          uint64_t seed, unsigned numThreads, uint64_t *numPairs) {
+    // a p = 0.05 sample of maf, from blocks if not NULL and from the file with numThreads ignored if NULL
+    PairStore *pairs = pairStore_construct(legitSequences);
+    stHash *sequenceLengthHash = stHash_construct3(stHash_stringKey, stHash_stringEqualKey, free, free);
+    PairSampler sampler;
+    pairSampler_initBernoulli(&sampler, 0.05, seed);
+    *numPairs = 0;
+    if (blocks == NULL) {
+        samplePairsFromMaf(maf, pairs, &sampler, legitSequences, numPairs, sequenceLengthHash);
+    } else {
+        samplePairsFromBlocks(maf, blocks, pairs, &sampler, legitSequences, numPairs, sequenceLengthHash,
+                              numThreads);
+    }
+    stHash_destruct(sequenceLengthHash);
+    return pairs;
+}
+static void test_samplingIsDeterministic_0(CuTest *testCase) {
+    // the random numbers of a block are keyed by the seed and the block's index, so the sample
+    // of a maf does not depend on how, or by how many threads, its blocks are walked
+    const char *maf = "test/deterministic.maf";
+    writeHomologyTestMaf(maf, false);
+    stSet *legitSequences = stSet_construct3(stHash_stringKey, stHash_stringEqualKey, free);
+    stSet_insert(legitSequences, stString_copy("seq0"));
+    stSet_insert(legitSequences, stString_copy("seq1"));
+    stSet_insert(legitSequences, stString_copy("seq2"));
+    mafFileApi_t *mfa = maf_newMfa(maf, "r");
+    mafBlock_t *blocks = maf_readAll(mfa);
+    maf_destroyMfa(mfa);
+    uint64_t numPairs, numPairsFromFile;
+    PairStore *fromFile = sampleBlocksInBernoulli(maf, NULL, legitSequences, 3, 0, &numPairsFromFile);
+    CuAssertTrue(testCase, pairStore_size(fromFile) > 0);
+    CuAssertTrue(testCase, pairStore_size(fromFile) < numPairsFromFile);
+    unsigned threads[] = {1, 2, 3, 8};
+    for (unsigned t = 0; t < sizeof(threads) / sizeof(threads[0]); ++t) {
+        PairStore *pairs = sampleBlocksInBernoulli(maf, blocks, legitSequences, 3, threads[t], &numPairs);
+        CuAssertTrue(testCase, numPairs == numPairsFromFile);
+        CuAssertTrue(testCase, pairStoresAreEqual(pairs, fromFile));
+        pairStore_destruct(pairs);
+    }
+    // another seed, another sample
+    PairStore *pairs = sampleBlocksInBernoulli(maf, blocks, legitSequences, 4, 2, &numPairs);
+    CuAssertTrue(testCase, !pairStoresAreEqual(pairs, fromFile));
+    // clean up
+    pairStore_destruct(pairs);
+    pairStore_destruct(fromFile);
+    maf_destroyMafBlockList(blocks);
+    stSet_destruct(legitSequences);
+    remove(maf);
+}
+static void test_homologyOnColumn_0(CuTest *testCase) {
+    // a column is collected into distinct sorted keys, gapped and non legit rows left out,
+    // and only the sampled pairs with both positions in the column are positive
+    stSet *names = createSyntheticNameSet();
+    PairStore *pairs = pairStore_construct(names);
+    pairStore_addNamed(pairs, "s0", 5, "s1", 7); // 0, aligned
+    pairStore_addNamed(pairs, "s0", 5, "s2", 9); // 1, s2 is gapped
+    pairStore_addNamed(pairs, "s0", 5, "s3", 11); // 2, s3 is not legit
+    pairStore_addNamed(pairs, "s1", 7, "s2", 8); // 3, s2 is elsewhere
+    pairStore_sort(pairs);
+    char *mat[] = {"A", "C", "-", "A", "A"};
+    bool legitRows[] = {true, true, true, true, false};
+    uint64_t allPositions[] = {5, 7, 9, 7, 11};
+    int64_t rowNameIds[5];
+    const char *rowNames[] = {"s0", "s1", "s2", "s1", "s3"};
+    for (uint64_t r = 0; r < 5; ++r) {
+        rowNameIds[r] = pairStore_getNameId(pairs, rowNames[r]);
+    }
+    uint64_t columnKeys[5];
+    uint64_t n = collectColumnPositions(mat, 0, 5, legitRows, rowNameIds, allPositions, columnKeys);
+    CuAssertTrue(testCase, n == 2);
+    CuAssertTrue(testCase, columnKeys[0] == pairStore_packPosition(rowNameIds[0], 5));
+    CuAssertTrue(testCase, columnKeys[1] == pairStore_packPosition(rowNameIds[1], 7));
+    PairIndexList *positive = pairIndexList_construct();
+    testHomologyOnColumn(mat, 0, 5, legitRows, rowNameIds, pairs, positive, allPositions, columnKeys, 0);
+    // recordNearPair() may list a pair more than once
+    CuAssertTrue(testCase, positive->length > 0);
+    uint64_t id1, pos1, id2, pos2;
+    for (uint64_t i = 0; i < positive->length; ++i) {
+        pairStore_get(pairs, positive->indices[i], &id1, &pos1, &id2, &pos2);
+        CuAssertTrue(testCase, pos1 == 5 && pos2 == 7);
+    }
+    // clean up
+    pairIndexList_destruct(positive);
+    pairStore_destruct(pairs);
+    stSet_destruct(names);
+}
+static void test_pairCountingRows_0(CuTest *testCase) {
+    // the bit parallel count agrees with counting column by column, for any number of rows and
+    // columns, any density of gaps and rows shorter than the block
+    uint64_t *chooseTwoArray = buildChooseTwoArray();
+    st_randomSeed(5);
+    for (unsigned t = 0; t < 300; ++t) {
+        uint64_t numRows = st_randomInt(1, (t % 3 == 0) ? 300 : 20);
+        uint64_t numColumns = st_randomInt(1, 200);
+        double gapRate = st_random();
+        char **mat = (char **) st_malloc(sizeof(*mat) * numRows);
+        uint64_t *lengths = (uint64_t *) st_malloc(sizeof(*lengths) * numRows);
+        bool *legitRows = (bool *) st_malloc(sizeof(*legitRows) * numRows);
+        for (uint64_t r = 0; r < numRows; ++r) {
+            lengths[r] = (st_random() < 0.1) ? st_randomInt(0, numColumns) : numColumns;
+            mat[r] = (char *) st_calloc(numColumns + 1, sizeof(char));
+            for (uint64_t c = 0; c < lengths[r]; ++c) {
+                mat[r][c] = (st_random() < gapRate) ? '-' : "ACGTacgtN"[st_randomInt(0, 9)];
+            }
+            legitRows[r] = true;
+        }
+        uint64_t expected = 0;
+        for (uint64_t c = 0; c < numColumns; ++c) {
+            expected += countPairsInColumn(mat, c, numRows, legitRows, chooseTwoArray);
+        }
+        CuAssertTrue(testCase, countPairsInRows(mat, lengths, numRows, numColumns) == expected);
+        for (uint64_t r = 0; r < numRows; ++r) {
+            free(mat[r]);
+        }
+        free(mat);
+        free(lengths);
+        free(legitRows);
+    }
+    free(chooseTwoArray);
+}
+static void test_pairWiggles_0(CuTest *testCase) {
+    // containers are found by name id in either order, preferring the one with the first name as
+    // reference, and only the region of interest of the reference is binned
+    stSet *names = stSet_construct3(stHash_stringKey, stHash_stringEqualKey, free);
+    stSet_insert(names, stString_copy("a"));
+    stSet_insert(names, stString_copy("b"));
+    stSet_insert(names, stString_copy("c"));
+    stSet_insert(names, stString_copy("d"));
+    PairStore *pairs = pairStore_construct(names);
+    stHash *wigglePairHash = stHash_construct3(stHash_stringKey, stHash_stringEqualKey, free,
+                                               (void(*)(void *)) wiggleContainer_destruct);
+    WiggleContainer *ab = wiggleContainer_construct("a", "b", 10, 20, 5);
+    WiggleContainer *ba = wiggleContainer_construct("b", "a", 0, 100, 5);
+    WiggleContainer *ca = wiggleContainer_construct("c", "a", 0, 100, 5);
+    stHash_insert(wigglePairHash, stString_copy("a-b"), ab);
+    stHash_insert(wigglePairHash, stString_copy("b-a"), ba);
+    stHash_insert(wigglePairHash, stString_copy("c-a"), ca);
+    stHash_insert(wigglePairHash, stString_copy("e-a"), wiggleContainer_construct("e", "a", 0, 100, 5));
+    PairWiggles *wiggles = pairWiggles_construct(pairs, wigglePairHash);
+    uint64_t a = pairStore_getNameId(pairs, "a"), b = pairStore_getNameId(pairs, "b");
+    uint64_t c = pairStore_getNameId(pairs, "c"), d = pairStore_getNameId(pairs, "d");
+    bool isSeq1Ref;
+    CuAssertTrue(testCase, pairWiggles_get(wiggles, a, b, &isSeq1Ref) == ab && isSeq1Ref);
+    CuAssertTrue(testCase, pairWiggles_get(wiggles, b, a, &isSeq1Ref) == ba && isSeq1Ref);
+    CuAssertTrue(testCase, pairWiggles_get(wiggles, a, c, &isSeq1Ref) == ca && !isSeq1Ref);
+    CuAssertTrue(testCase, pairWiggles_get(wiggles, c, a, &isSeq1Ref) == ca && isSeq1Ref);
+    CuAssertTrue(testCase, pairWiggles_get(wiggles, b, c, &isSeq1Ref) == NULL && !isSeq1Ref);
+    CuAssertTrue(testCase, pairWiggles_get(wiggles, d, a, &isSeq1Ref) == NULL);
+    // the region of ab is [10, 30), in bins of 5
+    ResultPair *rp = resultPair_construct("a", "b");
+    APair pair;
+    aPair_fillOut(&pair, "a", "b", 0, 0);
+    uint64_t refPos[] = {9, 10, 14, 15, 29, 30};
+    for (unsigned i = 0; i < sizeof(refPos) / sizeof(*refPos); ++i) {
+        tallyHomologyResult(rp, ab, refPos[i], false, false, &pair, i % 2 == 0, true, 5);
+    }
+    tallyHomologyResult(rp, ab, 12, false, false, &pair, true, false, 5);
+    CuAssertTrue(testCase, rp->total == 7 && rp->inAll == 4);
+    CuAssertTrue(testCase, ab->numBins == 4);
+    CuAssertTrue(testCase, ab->presentAtoB[0] == 1 && ab->absentAtoB[0] == 1);
+    CuAssertTrue(testCase, ab->presentAtoB[1] == 0 && ab->absentAtoB[1] == 1);
+    CuAssertTrue(testCase, ab->presentAtoB[2] == 0 && ab->absentAtoB[2] == 0);
+    CuAssertTrue(testCase, ab->presentAtoB[3] == 1 && ab->absentAtoB[3] == 0);
+    CuAssertTrue(testCase, ab->presentBtoA[0] == 1 && ab->absentBtoA[0] == 0);
+    // no wiggle pairs, no containers
+    stHash *empty = stHash_construct();
+    PairWiggles *none = pairWiggles_construct(pairs, empty);
+    CuAssertTrue(testCase, pairWiggles_get(none, a, b, &isSeq1Ref) == NULL && !isSeq1Ref);
+    // clean up
+    pairWiggles_destruct(none);
+    stHash_destruct(empty);
+    resultPair_destruct(rp);
+    pairWiggles_destruct(wiggles);
+    stHash_destruct(wigglePairHash);
+    pairStore_destruct(pairs);
+    stSet_destruct(names);
+}
 CuSuite* comparatorAPI_TestSuite(void) {
     // listing the tests as void allows us to quickly comment out certain tests
     // when trying to isolate bugs highlighted by one particular test
@@ -417,6 +804,13 @@ CuSuite* comparatorAPI_TestSuite(void) {
     (void) test_columnSampling_timing_0;
     (void) test_mappingRoundTrip_0;
     (void) test_pairSortComparison_0;
+    (void) test_homologyTestsThreaded_0;
+    (void) test_reservoirSampling_0;
+    (void) test_bernoulliSampling_0;
+    (void) test_reservoirSamplingMaf_0;
+    (void) test_homologyOnColumn_0;
+    (void) test_pairWiggles_0;
+    (void) test_pairCountingRows_0;
     CuSuite* suite = CuSuiteNew();
     SUITE_ADD_TEST(suite, test_mappingMatrixToArray_0);
     SUITE_ADD_TEST(suite, test_mappingArrayToMatrix_0);
@@ -424,5 +818,13 @@ CuSuite* comparatorAPI_TestSuite(void) {
     SUITE_ADD_TEST(suite, test_pairCounting_0);
     SUITE_ADD_TEST(suite, test_chooseTwoValues_0);
     SUITE_ADD_TEST(suite, test_pairSortComparison_0);
+    SUITE_ADD_TEST(suite, test_homologyTestsThreaded_0);
+    SUITE_ADD_TEST(suite, test_reservoirSampling_0);
+    SUITE_ADD_TEST(suite, test_bernoulliSampling_0);
+    SUITE_ADD_TEST(suite, test_reservoirSamplingMaf_0);
+    SUITE_ADD_TEST(suite, test_samplingIsDeterministic_0);
+    SUITE_ADD_TEST(suite, test_homologyOnColumn_0);
+    SUITE_ADD_TEST(suite, test_pairWiggles_0);
+    SUITE_ADD_TEST(suite, test_pairCountingRows_0);
     return suite;
 }
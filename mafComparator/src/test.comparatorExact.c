@@ -0,0 +1,139 @@
+/*
+ * Copyright (C) 2012 by
+ * Dent Earl (dearl@soe.ucsc.edu, dentearl@gmail.com)
+ * ... and other members of the Reconstruction Team of David Haussler's
+ * lab (BME Dept. UCSC).
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "CuTest.h"
+#include "sonLib.h"
+#include "comparatorAPI.h"
+#include "comparatorPairStore.h"
+#include "comparatorExact.h"
+#include "test.comparatorExact.h"
+
+static int cmpPackedPairs(const void *a, const void *b) {
+    const PackedPair *p1 = (const PackedPair *) a;
+    const PackedPair *p2 = (const PackedPair *) b;
+    if (p1->key1 != p2->key1) {
+        return (p1->key1 < p2->key1) ? -1 : 1;
+    }
+    if (p1->key2 != p2->key2) {
+        return (p1->key2 < p2->key2) ? -1 : 1;
+    }
+    return 0;
+}
+static void checkSorter(CuTest *testCase, uint64_t memoryBytes, unsigned numThreads, uint64_t n,
+                        bool isSpilled) {
+    // n random records with many duplicates come back out sorted and distinct
+    PairSorter *sorter = pairSorter_construct("test", memoryBytes, numThreads);
+    PackedPair *expected = (PackedPair *) st_malloc(sizeof(*expected) * n);
+    for (uint64_t i = 0; i < n; ++i) {
+        expected[i].key1 = st_randomInt(0, 1000);
+        expected[i].key2 = st_randomInt(0, 100);
+        pairSorter_add(sorter, expected[i].key1, expected[i].key2);
+    }
+    pairSorter_finish(sorter);
+    CuAssertTrue(testCase, (pairSorter_getNumberOfSpilledRuns(sorter) > 0) == isSpilled);
+    qsort(expected, n, sizeof(*expected), cmpPackedPairs);
+    PackedPair pair;
+    uint64_t i = 0;
+    while (pairSorter_next(sorter, &pair)) {
+        CuAssertTrue(testCase, i < n);
+        CuAssertTrue(testCase, cmpPackedPairs(&pair, expected + i) == 0);
+        while (i < n && cmpPackedPairs(&pair, expected + i) == 0) {
+            ++i;
+        }
+    }
+    CuAssertTrue(testCase, i == n);
+    // clean up
+    free(expected);
+    pairSorter_destruct(sorter);
+}
+static void test_pairSorter_0(CuTest *testCase) {
+    st_randomSeed(4);
+    // in memory, the buffer is sorted in slices by several workers
+    checkSorter(testCase, 64 << 20, 3, 300000, false);
+    // spilled to many runs with a small enough fan in to take several merge passes
+    checkSorter(testCase, 0, 2, 300000, true);
+    checkSorter(testCase, 1 << 20, 1, 300000, true);
+    // nothing at all
+    checkSorter(testCase, 0, 1, 0, false);
+}
+static void writeExactTestMaf(const char *filename) {
+    // a repeated block makes duplicate pairs, and the gaps and the reverse strand row
+    // vary the number of rows in a column
+    FILE *f = fopen(filename, "w");
+    fprintf(f, "##maf version=1\n\n");
+    for (unsigned i = 0; i < 2; ++i) {
+        fprintf(f, "a score=0\n"
+                "s seq0 0 6 + 100 ACG-TAC\n"
+                "s seq1 10 5 - 100 AC--TAC\n"
+                "s seq2 3 7 + 100 ACGGTAC\n"
+                "s seq0 50 6 + 100 A-GGTAC\n\n");
+    }
+    fprintf(f, "a score=0\ns seq1 40 3 + 100 ACG\ns seq2 40 3 + 100 A-G\ns seq3 40 3 + 100 ACG\n\n");
+    fclose(f);
+}
+static void test_exactPairs_0(CuTest *testCase) {
+    // the pairs streamed from a maf are the distinct pairs of sampling every pair of it
+    const char *maf = "test/exact.maf";
+    writeExactTestMaf(maf);
+    stSet *legitSequences = stSet_construct3(stHash_stringKey, stHash_stringEqualKey, free);
+    stSet_insert(legitSequences, stString_copy("seq0"));
+    stSet_insert(legitSequences, stString_copy("seq1"));
+    stSet_insert(legitSequences, stString_copy("seq2"));
+    stHash *sequenceLengthHash = stHash_construct3(stHash_stringKey, stHash_stringEqualKey, free, free);
+    PairStore *pairs = pairStore_construct(legitSequences);
+    PairSampler sampler;
+    pairSampler_initReservoir(&sampler, 1000, 0);
+    uint64_t numPairs = 0;
+    samplePairsFromMaf(maf, pairs, &sampler, legitSequences, &numPairs, sequenceLengthHash);
+    PairSorter *sorter = pairSorter_construct("test", 0, 1);
+    uint64_t n = streamPairsFromMaf(maf, pairs, legitSequences, sequenceLengthHash, sorter);
+    CuAssertTrue(testCase, n == numPairs);
+    CuAssertTrue(testCase, n == countPairsInMaf(maf, legitSequences, 1));
+    pairSorter_finish(sorter);
+    PackedPair pair;
+    uint64_t i = 0, id1, pos1, id2, pos2;
+    while (pairSorter_next(sorter, &pair)) {
+        CuAssertTrue(testCase, i < pairStore_size(pairs));
+        pairStore_get(pairs, i++, &id1, &pos1, &id2, &pos2);
+        CuAssertTrue(testCase, pair.key1 == pairStore_packPosition(id1, pos1));
+        CuAssertTrue(testCase, pair.key2 == pairStore_packPosition(id2, pos2));
+    }
+    CuAssertTrue(testCase, i == pairStore_size(pairs));
+    CuAssertTrue(testCase, i < n);
+    // clean up
+    pairSorter_destruct(sorter);
+    pairStore_destruct(pairs);
+    stHash_destruct(sequenceLengthHash);
+    stSet_destruct(legitSequences);
+    remove(maf);
+}
+CuSuite* comparatorExact_TestSuite(void) {
+    CuSuite* suite = CuSuiteNew();
+    SUITE_ADD_TEST(suite, test_pairSorter_0);
+    SUITE_ADD_TEST(suite, test_exactPairs_0);
+    return suite;
+}
@@ -0,0 +1,107 @@
+/*
+ * Copyright (C) 2012 by
+ * Dent Earl (dearl@soe.ucsc.edu, dentearl@gmail.com)
+ * ... and other members of the Reconstruction Team of David Haussler's
+ * lab (BME Dept. UCSC).
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "CuTest.h"
+#include "sonLib.h"
+#include "comparatorPairCount.h"
+#include "test.comparatorPairCount.h"
+
+static stSet* createNameSet(const char *a, const char *b, const char *c) {
+    stSet *names = stSet_construct3(stHash_stringKey, stHash_stringEqualKey, free);
+    stSet_insert(names, stString_copy(a));
+    stSet_insert(names, stString_copy(b));
+    if (c != NULL) {
+        stSet_insert(names, stString_copy(c));
+    }
+    return names;
+}
+static void writeMaf(const char *filename, const char *extra) {
+    FILE *f = fopen(filename, "w");
+    fprintf(f, "##maf version=1\n\na score=0\ns seq0 0 4 + 10 ACGT\ns seq1 0 4 + 10 ACGT\n\n%s", extra);
+    fclose(f);
+}
+static void test_hashNames_0(CuTest *testCase) {
+    // the hash depends on the names, not on the order they were inserted in
+    stSet *abc = createNameSet("a", "b", "c");
+    stSet *cba = createNameSet("c", "b", "a");
+    stSet *ab = createNameSet("a", "b", NULL);
+    stSet *abd = createNameSet("a", "b", "d");
+    CuAssertTrue(testCase, pairCount_hashNames(abc) == pairCount_hashNames(cba));
+    CuAssertTrue(testCase, pairCount_hashNames(abc) != pairCount_hashNames(ab));
+    CuAssertTrue(testCase, pairCount_hashNames(abc) != pairCount_hashNames(abd));
+    CuAssertTrue(testCase, pairCount_hashNames(ab) != pairCount_hashNames(NULL));
+    stSet_destruct(abc);
+    stSet_destruct(cba);
+    stSet_destruct(ab);
+    stSet_destruct(abd);
+}
+static void test_cacheRoundTrip_0(CuTest *testCase) {
+    const char *maf = "test/pairCount.maf";
+    writeMaf(maf, "");
+    char *path = pairCount_getCachePath(maf);
+    remove(path);
+    stSet *ab = createNameSet("seq0", "seq1", NULL);
+    stSet *abc = createNameSet("seq0", "seq1", "seq2");
+    uint64_t n = 0;
+    CuAssertTrue(testCase, !pairCount_readCache(maf, ab, &n));
+    // one count per set of names
+    pairCount_writeCache(maf, ab, 17);
+    pairCount_writeCache(maf, abc, 23);
+    CuAssertTrue(testCase, pairCount_readCache(maf, ab, &n));
+    CuAssertTrue(testCase, n == 17);
+    CuAssertTrue(testCase, pairCount_readCache(maf, abc, &n));
+    CuAssertTrue(testCase, n == 23);
+    CuAssertTrue(testCase, !pairCount_readCache(maf, NULL, &n));
+    // rewriting a count replaces it
+    pairCount_writeCache(maf, ab, 19);
+    CuAssertTrue(testCase, pairCount_readCache(maf, ab, &n));
+    CuAssertTrue(testCase, n == 19);
+    CuAssertTrue(testCase, pairCount_readCache(maf, abc, &n));
+    CuAssertTrue(testCase, n == 23);
+    // a changed maf invalidates every count
+    writeMaf(maf, "a score=1\ns seq0 4 4 + 10 ACGT\ns seq1 4 4 + 10 ACGT\n\n");
+    CuAssertTrue(testCase, !pairCount_readCache(maf, ab, &n));
+    pairCount_writeCache(maf, ab, 35);
+    CuAssertTrue(testCase, pairCount_readCache(maf, ab, &n));
+    CuAssertTrue(testCase, n == 35);
+    CuAssertTrue(testCase, !pairCount_readCache(maf, abc, &n));
+    // standard input is never cached
+    pairCount_writeCache("-", ab, 3);
+    CuAssertTrue(testCase, !pairCount_readCache("-", ab, &n));
+    // clean up
+    stSet_destruct(ab);
+    stSet_destruct(abc);
+    remove(path);
+    remove(maf);
+    free(path);
+}
+CuSuite* comparatorPairCount_TestSuite(void) {
+    CuSuite* suite = CuSuiteNew();
+    SUITE_ADD_TEST(suite, test_hashNames_0);
+    SUITE_ADD_TEST(suite, test_cacheRoundTrip_0);
+    return suite;
+}
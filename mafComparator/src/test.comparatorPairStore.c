@@ -0,0 +1,318 @@
+/*
+ * Copyright (C) 2012 by
+ * Dent Earl (dearl@soe.ucsc.edu, dentearl@gmail.com)
+ * ... and other members of the Reconstruction Team of David Haussler's
+ * lab (BME Dept. UCSC).
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <assert.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "CuTest.h"
+#include "common.h"
+#include "sonLib.h"
+#include "comparatorAPI.h"
+#include "comparatorPairStore.h"
+#include "test.comparatorPairStore.h"
+
+static const char *kNames[] = {"hg19.chr1", "mm9.chr2", "rn4.chr3", "canFam2.chr4", "bosTau4.chr5", "a", "B"};
+static const uint64_t kNumNames = sizeof(kNames) / sizeof(kNames[0]);
+
+static stSet* createNameSet(void) {
+    stSet *names = stSet_construct3(stHash_stringKey, stHash_stringEqualKey, free);
+    for (uint64_t i = 0; i < kNumNames; ++i) {
+        stSet_insert(names, stString_copy(kNames[i]));
+    }
+    return names;
+}
+static void fillRandomPairs(PairStore *ps, stSortedSet *pairs, uint64_t n, uint64_t maxPos) {
+    // add the same n random pairs to the store and to the sorted set
+    for (uint64_t i = 0; i < n; ++i) {
+        const char *seq1 = kNames[st_randomInt(0, kNumNames)];
+        const char *seq2 = kNames[st_randomInt(0, kNumNames)];
+        uint64_t pos1 = st_randomInt(0, maxPos);
+        uint64_t pos2 = st_randomInt(0, maxPos);
+        pairStore_addNamed(ps, seq1, pos1, seq2, pos2);
+        APair *pair = aPair_init();
+        aPair_fillOut(pair, stString_copy(seq1), stString_copy(seq2), pos1, pos2);
+        if (stSortedSet_search(pairs, pair) == NULL) {
+            stSortedSet_insert(pairs, pair);
+        } else {
+            aPair_destruct(pair);
+        }
+    }
+}
+static void test_pairStoreOrder_0(CuTest *testCase) {
+    // the store must hold the same pairs, in the same order, as a sorted set of APairs
+    st_randomSeed(1);
+    stSet *names = createNameSet();
+    PairStore *ps = pairStore_construct(names);
+    stSortedSet *pairs = stSortedSet_construct3((int(*)(const void *, const void *)) aPair_cmpFunction,
+                                                (void(*)(void *)) aPair_destruct);
+    fillRandomPairs(ps, pairs, 5000, 200);
+    pairStore_sort(ps);
+    CuAssertTrue(testCase, pairStore_size(ps) == (uint64_t) stSortedSet_size(pairs));
+    stSortedSetIterator *sit = stSortedSet_getIterator(pairs);
+    APair *pair = NULL;
+    uint64_t i = 0, id1, pos1, id2, pos2;
+    while ((pair = stSortedSet_getNext(sit)) != NULL) {
+        pairStore_get(ps, i++, &id1, &pos1, &id2, &pos2);
+        CuAssertStrEquals(testCase, pair->seq1, pairStore_getName(ps, id1));
+        CuAssertStrEquals(testCase, pair->seq2, pairStore_getName(ps, id2));
+        CuAssertTrue(testCase, pair->pos1 == pos1);
+        CuAssertTrue(testCase, pair->pos2 == pos2);
+    }
+    stSortedSet_destructIterator(sit);
+    // clean up
+    stSortedSet_destruct(pairs);
+    pairStore_destruct(ps);
+    stSet_destruct(names);
+}
+static void test_pairStoreSearch_0(CuTest *testCase) {
+    // find and lowerBound against a linear scan, for stored and absent keys
+    st_randomSeed(2);
+    stSet *names = createNameSet();
+    PairStore *ps = pairStore_construct(names);
+    stSortedSet *pairs = stSortedSet_construct3((int(*)(const void *, const void *)) aPair_cmpFunction,
+                                                (void(*)(void *)) aPair_destruct);
+    fillRandomPairs(ps, pairs, 3000, 50);
+    pairStore_sort(ps);
+    uint64_t n = pairStore_size(ps);
+    uint64_t i, j, id1, pos1, id2, pos2, qid1, qpos1, qid2, qpos2;
+    for (uint64_t t = 0; t < 5000; ++t) {
+        qid1 = st_randomInt(0, kNumNames);
+        qpos1 = st_randomInt(0, 55);
+        qid2 = st_randomInt(0, kNumNames);
+        qpos2 = st_randomInt(0, 55);
+        for (j = 0; j < n; ++j) {
+            pairStore_get(ps, j, &id1, &pos1, &id2, &pos2);
+            if (id1 > qid1 || (id1 == qid1 && (pos1 > qpos1 || (pos1 == qpos1 &&
+                (id2 > qid2 || (id2 == qid2 && pos2 >= qpos2)))))) {
+                break;
+            }
+        }
+        CuAssertTrue(testCase, pairStore_lowerBound(ps, qid1, qpos1, qid2, qpos2) == j);
+        bool isThere = false;
+        if (j < n) {
+            pairStore_get(ps, j, &id1, &pos1, &id2, &pos2);
+            isThere = (id1 == qid1 && pos1 == qpos1 && id2 == qid2 && pos2 == qpos2);
+        }
+        CuAssertTrue(testCase, pairStore_find(ps, qid1, qpos1, qid2, qpos2, &i) == isThere);
+        if (isThere) {
+            CuAssertTrue(testCase, i == j);
+        }
+    }
+    // clean up
+    stSortedSet_destruct(pairs);
+    pairStore_destruct(ps);
+    stSet_destruct(names);
+}
+static void test_pairStoreAdd_0(CuTest *testCase) {
+    // pairs are put in seq1 <= seq2 order and stored once
+    stSet *names = createNameSet();
+    PairStore *ps = pairStore_construct(names);
+    CuAssertTrue(testCase, pairStore_getNameId(ps, "B") == 0);
+    CuAssertTrue(testCase, pairStore_getNameId(ps, "a") == 1);
+    CuAssertTrue(testCase, pairStore_getNameId(ps, "panTro2.chr1") == -1);
+    pairStore_addNamed(ps, "mm9.chr2", 10, "hg19.chr1", 20);
+    pairStore_addNamed(ps, "hg19.chr1", 20, "mm9.chr2", 10);
+    pairStore_addNamed(ps, "a", 7, "a", 3);
+    pairStore_sort(ps);
+    CuAssertTrue(testCase, pairStore_size(ps) == 2);
+    uint64_t i, id1, pos1, id2, pos2;
+    pairStore_get(ps, 0, &id1, &pos1, &id2, &pos2);
+    CuAssertStrEquals(testCase, "a", pairStore_getName(ps, id1));
+    CuAssertTrue(testCase, pos1 == 3 && pos2 == 7);
+    pairStore_get(ps, 1, &id1, &pos1, &id2, &pos2);
+    CuAssertStrEquals(testCase, "hg19.chr1", pairStore_getName(ps, id1));
+    CuAssertStrEquals(testCase, "mm9.chr2", pairStore_getName(ps, id2));
+    CuAssertTrue(testCase, pos1 == 20 && pos2 == 10);
+    // searches are by exact orientation
+    CuAssertTrue(testCase, pairStore_find(ps, id1, 20, id2, 10, &i) && i == 1);
+    CuAssertTrue(testCase, !pairStore_find(ps, id2, 10, id1, 20, &i));
+    // overwriting a record canonicalizes it as adding does
+    pairStore_setNamed(ps, 1, "mm9.chr2", 5, "hg19.chr1", 30);
+    pairStore_sort(ps);
+    CuAssertTrue(testCase, pairStore_find(ps, id1, 30, id2, 5, &i));
+    pairStore_clear(ps);
+    CuAssertTrue(testCase, pairStore_size(ps) == 0);
+    CuAssertTrue(testCase, !pairStore_find(ps, id1, 20, id2, 10, &i));
+    // clean up
+    pairStore_destruct(ps);
+    stSet_destruct(names);
+}
+static void test_pairStoreRanges_0(CuTest *testCase) {
+    // range scans over pos1 and over pos2 against per position searches,
+    // with and without the pos1 index
+    st_randomSeed(3);
+    stSet *names = createNameSet();
+    PairStore *ps = pairStore_construct(names);
+    stSortedSet *pairs = stSortedSet_construct3((int(*)(const void *, const void *)) aPair_cmpFunction,
+                                                (void(*)(void *)) aPair_destruct);
+    fillRandomPairs(ps, pairs, 3000, 30);
+    pairStore_sort(ps);
+    PairIndexList *expected = pairIndexList_construct();
+    PairIndexList *unindexed = pairIndexList_construct();
+    PairIndexList *indexed = pairIndexList_construct();
+    uint64_t i, id1, pos1, id2, pos2, lo, hi;
+    for (unsigned isPos1 = 0; isPos1 < 2; ++isPos1) {
+        for (uint64_t t = 0; t < 2000; ++t) {
+            id1 = st_randomInt(0, kNumNames);
+            pos1 = st_randomInt(0, 35);
+            id2 = st_randomInt(0, kNumNames);
+            pos2 = st_randomInt(0, 35);
+            lo = st_randomInt(0, 35);
+            hi = lo + st_randomInt(0, 8);
+            expected->length = unindexed->length = indexed->length = 0;
+            for (uint64_t p = lo; p <= hi; ++p) {
+                if (isPos1 ? pairStore_find(ps, id1, p, id2, pos2, &i) : pairStore_find(ps, id1, pos1, id2, p, &i)) {
+                    pairIndexList_append(expected, i);
+                }
+            }
+            if (isPos1) {
+                pairStore_appendPos1Range(ps, id1, lo, hi, id2, pos2, unindexed);
+                pairStore_indexByPos1(ps);
+                pairStore_appendPos1Range(ps, id1, lo, hi, id2, pos2, indexed);
+                pairStore_sort(ps);
+            } else {
+                pairStore_appendPos2Range(ps, id1, pos1, id2, lo, hi, unindexed);
+                pairStore_appendPos2Range(ps, id1, pos1, id2, lo, hi, indexed);
+            }
+            CuAssertTrue(testCase, unindexed->length == expected->length);
+            CuAssertTrue(testCase, indexed->length == expected->length);
+            for (uint64_t k = 0; k < expected->length; ++k) {
+                CuAssertTrue(testCase, unindexed->indices[k] == expected->indices[k]);
+                CuAssertTrue(testCase, indexed->indices[k] == expected->indices[k]);
+            }
+        }
+    }
+    // a range past the largest storable position is clamped, not wrapped
+    pairStore_indexByPos1(ps);
+    indexed->length = 0;
+    pairStore_appendPos1Range(ps, 0, 0, UINT64_MAX, 0, 0, indexed);
+    pairStore_appendPos1Range(ps, 0, UINT64_MAX - 1, UINT64_MAX, 0, 0, indexed);
+    for (uint64_t k = 0; k < indexed->length; ++k) {
+        pairStore_get(ps, indexed->indices[k], &id1, &pos1, &id2, &pos2);
+        CuAssertTrue(testCase, id1 == 0 && id2 == 0 && pos2 == 0);
+    }
+    // clean up
+    pairIndexList_destruct(expected);
+    pairIndexList_destruct(unindexed);
+    pairIndexList_destruct(indexed);
+    stSortedSet_destruct(pairs);
+    pairStore_destruct(ps);
+    stSet_destruct(names);
+}
+static void test_pairStoreRetainFirstNames_0(CuTest *testCase) {
+    // the pairs whose first name is kept, in the same order, and nothing else
+    stSet *names = createNameSet();
+    PairStore *ps = pairStore_construct(names);
+    PairStore *all = pairStore_construct(names);
+    stSortedSet *pairs = stSortedSet_construct3((int(*)(const void *, const void *)) aPair_cmpFunction,
+                                                (void(*)(void *)) aPair_destruct);
+    fillRandomPairs(ps, pairs, 1000, 1000);
+    pairStore_sort(ps);
+    uint64_t id1, pos1, id2, pos2, i;
+    for (i = 0; i < pairStore_size(ps); ++i) {
+        pairStore_get(ps, i, &id1, &pos1, &id2, &pos2);
+        pairStore_add(all, id1, pos1, id2, pos2);
+    }
+    pairStore_sort(all);
+    stSet *kept = stSet_construct3(stHash_stringKey, stHash_stringEqualKey, free);
+    stSet_insert(kept, stString_copy(kNames[1]));
+    stSet_insert(kept, stString_copy(kNames[4]));
+    pairStore_retainFirstNames(ps, kept);
+    uint64_t n = 0;
+    for (i = 0; i < pairStore_size(all); ++i) {
+        pairStore_get(all, i, &id1, &pos1, &id2, &pos2);
+        uint64_t j;
+        bool isKept = stSet_search(kept, pairStore_getName(all, id1)) != NULL;
+        CuAssertTrue(testCase, pairStore_find(ps, id1, pos1, id2, pos2, &j) == isKept);
+        CuAssertTrue(testCase, !isKept || j == n);
+        n += isKept ? 1 : 0;
+    }
+    CuAssertTrue(testCase, n == pairStore_size(ps));
+    for (i = 0; i < kNumNames; ++i) {
+        int64_t id = pairStore_getNameId(ps, kNames[i]);
+        if (pairStore_isFirstName(ps, id)) {
+            CuAssertTrue(testCase, stSet_search(kept, (void *) kNames[i]) != NULL);
+        }
+    }
+    // clean up
+    pairStore_destruct(all);
+    pairStore_destruct(ps);
+    stSortedSet_destruct(pairs);
+    stSet_destruct(kept);
+    stSet_destruct(names);
+}
+static void test_pairStoreRecords_0(CuTest *testCase) {
+    // records written out read back into a store with the same names, not into one with fewer
+    stSet *names = createNameSet();
+    PairStore *ps = pairStore_construct(names);
+    stSortedSet *pairs = stSortedSet_construct3((int(*)(const void *, const void *)) aPair_cmpFunction,
+                                                (void(*)(void *)) aPair_destruct);
+    fillRandomPairs(ps, pairs, 500, 1000);
+    pairStore_sort(ps);
+    FILE *fp = tmpfile();
+    CuAssertTrue(testCase, fp != NULL);
+    CuAssertTrue(testCase, pairStore_writeRecords(ps, fp));
+    rewind(fp);
+    PairStore *copy = pairStore_construct(names);
+    CuAssertTrue(testCase, pairStore_readRecords(copy, fp));
+    CuAssertTrue(testCase, pairStore_size(copy) == pairStore_size(ps));
+    uint64_t id1, pos1, id2, pos2, id1b, pos1b, id2b, pos2b, i;
+    for (i = 0; i < pairStore_size(ps); ++i) {
+        pairStore_get(ps, i, &id1, &pos1, &id2, &pos2);
+        pairStore_get(copy, i, &id1b, &pos1b, &id2b, &pos2b);
+        CuAssertTrue(testCase, id1 == id1b && pos1 == pos1b && id2 == id2b && pos2 == pos2b);
+    }
+    CuAssertTrue(testCase, pairStore_find(copy, id1, pos1, id2, pos2, &i));
+    // the largest name id is out of range of a store of one name
+    stSet *fewerNames = stSet_construct3(stHash_stringKey, stHash_stringEqualKey, free);
+    stSet_insert(fewerNames, stString_copy(kNames[0]));
+    PairStore *small = pairStore_construct(fewerNames);
+    rewind(fp);
+    CuAssertTrue(testCase, !pairStore_readRecords(small, fp));
+    CuAssertTrue(testCase, pairStore_size(small) == 0);
+    // a truncated file
+    rewind(fp);
+    fprintf(fp, "%" PRIu64 "\n", pairStore_size(ps) + 1);
+    rewind(fp);
+    CuAssertTrue(testCase, !pairStore_readRecords(copy, fp));
+    // clean up
+    fclose(fp);
+    pairStore_destruct(small);
+    pairStore_destruct(copy);
+    pairStore_destruct(ps);
+    stSortedSet_destruct(pairs);
+    stSet_destruct(fewerNames);
+    stSet_destruct(names);
+}
+CuSuite* comparatorPairStore_TestSuite(void) {
+    CuSuite* suite = CuSuiteNew();
+    SUITE_ADD_TEST(suite, test_pairStoreOrder_0);
+    SUITE_ADD_TEST(suite, test_pairStoreSearch_0);
+    SUITE_ADD_TEST(suite, test_pairStoreAdd_0);
+    SUITE_ADD_TEST(suite, test_pairStoreRanges_0);
+    SUITE_ADD_TEST(suite, test_pairStoreRecords_0);
+    SUITE_ADD_TEST(suite, test_pairStoreRetainFirstNames_0);
+    return suite;
+}
@@ -33,95 +33,176 @@
 #include "comparatorRandom.h"
 
 static int cmpu64(const void *a, const void *b);
+static void test_philox_0(CuTest *testCase) {
+    // the known answers of the Random123 distribution for Philox4x32-10
+    uint32_t out[4];
+    uint32_t zeros[4] = {0, 0, 0, 0}, zeroKey[2] = {0, 0};
+    philox4x32(zeros, zeroKey, out);
+    CuAssertTrue(testCase, out[0] == 0x6627e8d5 && out[1] == 0xe169c58d
+                 && out[2] == 0xbc57ac4c && out[3] == 0x9b00dbd8);
+    uint32_t ones[4] = {0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff}, onesKey[2] = {0xffffffff, 0xffffffff};
+    philox4x32(ones, onesKey, out);
+    CuAssertTrue(testCase, out[0] == 0x408f276d && out[1] == 0x41c83b0e
+                 && out[2] == 0xa20bc7c6 && out[3] == 0x6d5451fd);
+    uint32_t pi[4] = {0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344}, piKey[2] = {0xa4093822, 0x299f31d0};
+    philox4x32(pi, piKey, out);
+    CuAssertTrue(testCase, out[0] == 0xd16cfe09 && out[1] == 0x94fdcceb
+                 && out[2] == 0x5001e420 && out[3] == 0x24126ea1);
+}
+static void test_randomStream_0(CuTest *testCase) {
+    // a stream is a function of (seed, stream) alone, and streams differing in either differ
+    RandomStream a, b, c, d;
+    randomStream_init(&a, 42, 7);
+    randomStream_init(&b, 42, 7);
+    randomStream_init(&c, 42, 8);
+    randomStream_init(&d, 43, 7);
+    uint64_t numSame = 0;
+    for (uint64_t i = 0; i < 1000; ++i) {
+        uint64_t x = randomStream_next64(&a);
+        CuAssertTrue(testCase, x == randomStream_next64(&b));
+        numSame += (x == randomStream_next64(&c)) ? 1 : 0;
+        numSame += (x == randomStream_next64(&d)) ? 1 : 0;
+    }
+    CuAssertTrue(testCase, numSame == 0);
+    // two 64 bit numbers per Philox block, in counter order
+    uint32_t counter[4] = {0, 0, 7, 0}, key[2] = {42, 0}, out[4];
+    philox4x32(counter, key, out);
+    randomStream_init(&a, 42, 7);
+    CuAssertTrue(testCase, randomStream_next64(&a) == (((uint64_t) out[3] << 32) | out[2]));
+    CuAssertTrue(testCase, randomStream_next64(&a) == (((uint64_t) out[1] << 32) | out[0]));
+}
+static void test_randomStream_uniform_0(CuTest *testCase) {
+    // uniform draws stay in range and fill it evenly
+    RandomStream random;
+    randomStream_init(&random, 5, 0);
+    const uint64_t n = 10, N = 100000;
+    uint64_t counts[10] = {0};
+    double sum = 0.0;
+    for (uint64_t i = 0; i < N; ++i) {
+        double u = randomStream_unit(&random);
+        double v = randomStream_openUnit(&random);
+        CuAssertTrue(testCase, u >= 0.0 && u < 1.0);
+        CuAssertTrue(testCase, v > 0.0 && v < 1.0);
+        sum += u;
+        uint64_t k = randomStream_uniformInt(&random, n);
+        CuAssertTrue(testCase, k < n);
+        ++counts[k];
+    }
+    CuAssertTrue(testCase, fabs(sum / N - 0.5) < 0.01);
+    for (uint64_t k = 0; k < n; ++k) {
+        CuAssertTrue(testCase, fabs((double) counts[k] - (double) N / n) < 0.05 * N / n);
+    }
+    CuAssertTrue(testCase, randomStream_uniformInt(&random, 1) == 0);
+    uint64_t big = randomStream_uniformInt(&random, UINT64_MAX);
+    CuAssertTrue(testCase, big < UINT64_MAX);
+}
 static void test_rbinom_zero_0(CuTest *testCase) {
+    RandomStream random;
+    randomStream_init(&random, 1, 0);
     // small n*p means using one of the small algorithms
     uint64_t a;
     uint64_t N = 100000;
     uint64_t n = 10;
     for (uint64_t i = 0; i < N; ++i) {
-        a = rbinom(n, 0.0);
+        a = rbinom(&random, n, 0.0);
         CuAssertTrue(testCase, a == 0);
     }
 }
 static void test_rbinom_zero_1(CuTest *testCase) {
+    RandomStream random;
+    randomStream_init(&random, 2, 0);
     // large n*p means using the btpe algorithm
     uint64_t a;
     uint64_t N = 100000;
     uint64_t n = 100;
     for (uint64_t i = 0; i < N; ++i) {
-        a = rbinom(n, 0.0);
+        a = rbinom(&random, n, 0.0);
         CuAssertTrue(testCase, a == 0);
     }
 }
 static void test_rbinom_one_0(CuTest *testCase) {
+    RandomStream random;
+    randomStream_init(&random, 3, 0);
     // small n*p means using one of the small algorithms
     uint64_t a;
     uint64_t N = 100000;
     uint64_t n = 10;
     for (uint64_t i = 0; i < N; ++i) {
-        a = rbinom(n, 1.0);
+        a = rbinom(&random, n, 1.0);
         CuAssertTrue(testCase, a == n);
     }
 }
 static void test_rbinom_one_1(CuTest *testCase) {
+    RandomStream random;
+    randomStream_init(&random, 4, 0);
     // large n*p means using the btpe algorithm
     uint64_t a;
     uint64_t N = 100000;
     uint64_t n = 100;
     for (uint64_t i = 0; i < N; ++i) {
-        a = rbinom(n, 1.0);
+        a = rbinom(&random, n, 1.0);
         CuAssertTrue(testCase, a == n);
     }
 }
 static void test_rbinom_one_2(CuTest *testCase) {
+    RandomStream random;
+    randomStream_init(&random, 5, 0);
     // small n*p means using one of the small algorithms
     uint64_t a;
     uint64_t N = 100000;
     uint64_t n = 10;
     for (uint64_t i = 0; i < N; ++i) {
-        a = rbinom(n, 100.0);
+        a = rbinom(&random, n, 100.0);
         CuAssertTrue(testCase, a == n);
     }
 }
 static void test_rbinom_one_3(CuTest *testCase) {
+    RandomStream random;
+    randomStream_init(&random, 6, 0);
     // large n*p means using the btpe algorithm
     uint64_t a;
     uint64_t N = 100000;
     uint64_t n = 100;
     for (uint64_t i = 0; i < N; ++i) {
-        a = rbinom(n, 1.0);
+        a = rbinom(&random, n, 1.0);
         CuAssertTrue(testCase, a == n);
     }
 }
 static void test_rbinom_one_4(CuTest *testCase) {
+    RandomStream random;
+    randomStream_init(&random, 7, 0);
     // large n*p means using the btpe algorithm
     uint64_t a;
     uint64_t N = 100000;
     uint64_t n = INT32_MAX;
     n *= 2;
     for (uint64_t i = 0; i < N; ++i) {
-        a = rbinom(n, 1.0);
+        a = rbinom(&random, n, 1.0);
         CuAssertTrue(testCase, a == n);
     }
 }
 static void test_rbinom_ranges_0(CuTest *testCase) {
+    RandomStream random;
+    randomStream_init(&random, 8, 0);
     // ranges for small n*p
     uint64_t N = 1000000;
     uint64_t n = 10;
     uint64_t *array = (uint64_t*) st_malloc(sizeof(*array) * N);
     for (uint64_t i = 0; i < N; ++i) {
-        array[i] = rbinom(n, 0.01);
+        array[i] = rbinom(&random, n, 0.01);
         CuAssertTrue(testCase, array[i] <= n);
     }
     free(array);
 }
 static void test_rbinom_ranges_1(CuTest *testCase) {
+    RandomStream random;
+    randomStream_init(&random, 9, 0);
     // ranges for large n*p
     uint64_t N = 1000000;
     uint64_t n = 10000;
     uint64_t *array = (uint64_t*) st_malloc(sizeof(*array) * N);
     for (uint64_t i = 0; i < N; ++i) {
-        array[i] = rbinom(n, 0.01);
+        array[i] = rbinom(&random, n, 0.01);
         CuAssertTrue(testCase, array[i] <= n);
     }
     free(array);
@@ -143,6 +224,8 @@ static void tailarray(uint64_t *a, uint64_t N, uint64_t n) {
     printf("\n");
 }
 static void test_rbinom_ranges_2(CuTest *testCase) {
+    RandomStream random;
+    randomStream_init(&random, 10, 0);
     // ranges for large n*p
     (void) (headarray);
     (void) (tailarray);
@@ -150,7 +233,7 @@ static void test_rbinom_ranges_2(CuTest *testCase) {
     uint64_t n = 10;
     uint64_t *array = (uint64_t*) st_malloc(sizeof(*array) * N);
     for (uint64_t i = 0; i < N; ++i) {
-        array[i] = rbinom(n, 0.5);
+        array[i] = rbinom(&random, n, 0.5);
         CuAssertTrue(testCase, array[i] <= n);
     }
     qsort(array, N, sizeof(uint64_t), cmpu64);
@@ -159,18 +242,22 @@ static void test_rbinom_ranges_2(CuTest *testCase) {
     free(array);
 }
 static void test_rbinom_ranges_3(CuTest *testCase) {
+    RandomStream random;
+    randomStream_init(&random, 11, 0);
     // ranges for large n*p
     uint64_t N = 1000000;
     uint64_t n = INT64_MAX;
     n *= 3;
     uint64_t *array = (uint64_t*) st_malloc(sizeof(*array) * N);
     for (uint64_t i = 0; i < N; ++i) {
-        array[i] = rbinom(n, 0.01);
+        array[i] = rbinom(&random, n, 0.01);
         CuAssertTrue(testCase, array[i] <= n);
     }
     free(array);
 }
 static void test_rbinom_ranges_4(CuTest *testCase) {
+    RandomStream random;
+    randomStream_init(&random, 12, 0);
     // ranges for large n*p
     uint64_t N = 1000000;
     uint64_t n = INT64_MAX;
@@ -178,7 +265,7 @@ static void test_rbinom_ranges_4(CuTest *testCase) {
     n *=  3;
     uint64_t *array = (uint64_t*) st_malloc(sizeof(*array) * N);
     for (uint64_t i = 0; i < N; ++i) {
-        array[i] = rbinom(n, 0.99);
+        array[i] = rbinom(&random, n, 0.99);
         CuAssertTrue(testCase, array[i] > m);
     }
     free(array);
@@ -188,23 +275,27 @@ static double runningAverage(double m, uint64_t x, uint64_t i) {
     return m;
 }
 static void test_rbinom_clt_0(CuTest *testCase) {
+    RandomStream random;
+    randomStream_init(&random, 13, 0);
     // central limit theorm for small n*p
     double m = 0.0, p = 0.5;
     uint64_t N = 1000000;
     uint64_t n = 10;
     for (uint64_t i = 0; i < N; ++i) {
-        m = runningAverage(m, rbinom(n, p), i);
+        m = runningAverage(m, rbinom(&random, n, p), i);
     }
     CuAssertTrue(testCase, m < n * (p + 0.001));
     CuAssertTrue(testCase, m > n * (p - 0.001));
 }
 static void test_rbinom_clt_1(CuTest *testCase) {
+    RandomStream random;
+    randomStream_init(&random, 14, 0);
     // central limit theorm for large n*p
     double m = 0.0, p = 0.5;
     uint64_t N = 1000000;
     uint64_t n = 100;
     for (uint64_t i = 0; i < N; ++i) {
-        m = runningAverage(m, rbinom(n, p), i);
+        m = runningAverage(m, rbinom(&random, n, p), i);
     }
     CuAssertTrue(testCase, m < n * (p + 0.001));
     CuAssertTrue(testCase, m > n * (p - 0.001));
@@ -245,6 +336,8 @@ static double sv(uint64_t *array, uint64_t n, double mu) {
     return sv;
 }
 static void test_rbinom_distribution_0(CuTest *testCase) {
+    RandomStream random;
+    randomStream_init(&random, 15, 0);
     // central limit theorm for small n*p
     double mu, var, med, p = 0.5;
     uint64_t N = 100000;
@@ -254,7 +347,7 @@ static void test_rbinom_distribution_0(CuTest *testCase) {
         mu = 0.0;
         array = (uint64_t*) st_malloc(sizeof(*array) * N);
         for (uint64_t i = 0; i < N; ++i) {
-            array[i] = rbinom(n, p);
+            array[i] = rbinom(&random, n, p);
             mu = runningAverage(mu, array[i], i);
         }
         var = sv(array, N, mu);
@@ -279,6 +372,8 @@ static void parray(uint64_t *array, uint64_t n) {
     printf("\n");
 }
 static void test_rbinom_distribution_1(CuTest *testCase) {
+    RandomStream random;
+    randomStream_init(&random, 16, 0);
     // central limit theorm for large n*p
     (void) (parray);
     double mu, med, var, p = 0.5;
@@ -289,7 +384,7 @@ static void test_rbinom_distribution_1(CuTest *testCase) {
         mu = 0.0;
         array = (uint64_t*) st_malloc(sizeof(*array) * N);
         for (uint64_t i = 0; i < N; ++i) {
-            array[i] = rbinom(n, p);
+            array[i] = rbinom(&random, n, p);
             mu = runningAverage(mu, array[i], i);
         }
         var = sv(array, N, mu);
@@ -306,6 +401,8 @@ static void test_rbinom_distribution_1(CuTest *testCase) {
     }
 }
 static void test_rbinom_distribution_2(CuTest *testCase) {
+    RandomStream random;
+    randomStream_init(&random, 17, 0);
     // central limit theorm for small-ish n*p
     (void) (parray);
     double mu, var, p, med;
@@ -317,7 +414,7 @@ static void test_rbinom_distribution_2(CuTest *testCase) {
         mu = 0.0;
         array = (uint64_t*) st_malloc(sizeof(*array) * N);
         for (uint64_t i = 0; i < N; ++i) {
-            array[i] = rbinom(n, p);
+            array[i] = rbinom(&random, n, p);
             mu = runningAverage(mu, array[i], i);
         }
         var = sv(array, N, mu);
@@ -336,6 +433,8 @@ static void test_rbinom_distribution_2(CuTest *testCase) {
     }
 }
 static void test_rbinom_distribution_3(CuTest *testCase) {
+    RandomStream random;
+    randomStream_init(&random, 18, 0);
     // central limit theorm for large-ish n*p
     (void) (parray);
     double mu, med, var, p;
@@ -347,7 +446,7 @@ static void test_rbinom_distribution_3(CuTest *testCase) {
         mu = 0.0;
         array = (uint64_t*) st_malloc(sizeof(*array) * N);
         for (uint64_t i = 0; i < N; ++i) {
-            array[i] = rbinom(n, p);
+            array[i] = rbinom(&random, n, p);
             mu = runningAverage(mu, array[i], i);
         }
         var = sv(array, N, mu);
@@ -421,6 +520,9 @@ CuSuite* comparatorRandom_TestSuite(void) {
     CuSuite* suite = CuSuiteNew();
     SUITE_ADD_TEST(suite, test_median_0);
     SUITE_ADD_TEST(suite, test_sampleVariance_0);
+    SUITE_ADD_TEST(suite, test_philox_0);
+    SUITE_ADD_TEST(suite, test_randomStream_0);
+    SUITE_ADD_TEST(suite, test_randomStream_uniform_0);
     SUITE_ADD_TEST(suite, test_rbinom_zero_0);
     SUITE_ADD_TEST(suite, test_rbinom_zero_1);
     SUITE_ADD_TEST(suite, test_rbinom_one_0);
@@ -880,6 +880,123 @@ class KnownValuesTest(unittest.TestCase):
                 print 'knownValues Test failed on test %d' % i
             self.assertTrue(passedTT and passedTF)
         mtt.removeDir(tmpDir)
+    def test_knownValuesExact(self):
+        """ mafComparator --exact should return correct results for hand-calculable problems, in memory or not
+        """
+        mtt.makeTempDirParent()
+        tmpDir = os.path.abspath(mtt.makeTempDir('knownValuesExact'))
+        parent = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+        for maf1, maf2, totalTrue, totalFalse in knownValues:
+            testMaf1 = mtt.testFile(os.path.abspath(os.path.join(tmpDir, 'maf1.maf')), 
+                                    maf1, g_headers)
+            testMaf2 = mtt.testFile(os.path.abspath(os.path.join(tmpDir, 'maf2.maf')), 
+                                    maf2, g_headers)
+            for extra in [[], ['--exactMemory=0']]:
+                cmd = [os.path.abspath(os.path.join(parent, 'test', 'mafComparator')),
+                       '--maf1', os.path.abspath(os.path.join(tmpDir, 'maf1.maf')),
+                       '--maf2', os.path.abspath(os.path.join(tmpDir, 'maf2.maf')),
+                       '--out', os.path.abspath(os.path.join(tmpDir, 'output.xml')),
+                       '--exact', '--tmpDir', tmpDir, '--logLevel=critical',
+                       ] + extra
+                mtt.recordCommands([cmd], tmpDir)
+                mtt.runCommandsS([cmd], tmpDir)
+                output = os.path.abspath(os.path.join(tmpDir, 'output.xml'))
+                self.assertEqual(totalTrue, getAggregateResult(output, 'totalTrue'))
+                self.assertEqual(totalFalse, getAggregateResult(output, 'totalFalse'))
+        mtt.removeDir(tmpDir)
+    def test_knownValuesBatch(self):
+        """ mafComparator --batch should write every prediction's known values, with or without --truthPairs
+        """
+        mtt.makeTempDirParent()
+        tmpDir = os.path.abspath(mtt.makeTempDir('knownValuesBatch'))
+        parent = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+        batch = os.path.join(tmpDir, 'batch.txt')
+        outputs = [os.path.join(tmpDir, 'output%d.xml' % i) for i in range(2)]
+        f = open(batch, 'w')
+        f.write('# prediction report\n')
+        for output in outputs:
+            f.write('%s %s\n' % (os.path.join(tmpDir, 'maf2.maf'), output))
+        f.close()
+        for maf1, maf2, totalTrue, totalFalse in knownValues:
+            testMaf1 = mtt.testFile(os.path.abspath(os.path.join(tmpDir, 'maf1.maf')),
+                                    maf1, g_headers)
+            testMaf2 = mtt.testFile(os.path.abspath(os.path.join(tmpDir, 'maf2.maf')),
+                                    maf2, g_headers)
+            truthPairs = os.path.join(tmpDir, 'truth.pairs')
+            if os.path.exists(truthPairs):
+                os.remove(truthPairs)
+            for extra in [[], ['--truthPairs', truthPairs], ['--truthPairs', truthPairs]]:
+                cmd = [os.path.abspath(os.path.join(parent, 'test', 'mafComparator')),
+                       '--maf1', os.path.abspath(os.path.join(tmpDir, 'maf1.maf')),
+                       '--batch', batch, '--logLevel=critical',
+                       ] + extra
+                mtt.recordCommands([cmd], tmpDir)
+                mtt.runCommandsS([cmd], tmpDir)
+                for output in outputs:
+                    self.assertEqual(totalTrue, getAggregateResult(output, 'totalTrue'))
+                    self.assertEqual(totalFalse, getAggregateResult(output, 'totalFalse'))
+        mtt.removeDir(tmpDir)
+    def test_batchSharedSequences(self):
+        """ mafComparator --batch should report predictions holding different sequences as single runs do
+        """
+        mtt.makeTempDirParent()
+        tmpDir = os.path.abspath(mtt.makeTempDir('batchSharedSequences'))
+        parent = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+        prog = os.path.abspath(os.path.join(parent, 'test', 'mafComparator'))
+        maf1 = ('a score=0\n'
+                's A 0 20 + 100 ACGTACGTACGTACGTACGT\n'
+                's B 0 20 + 100 ACGTACGTACGTACGTACGT\n'
+                's C 0 20 + 100 ACGTACGTACGTACGTACGT\n'
+                '\n'
+                'a score=0\n'
+                's C 40 20 + 100 ACGTACGTACGTACGTACGT\n'
+                's D 40 20 + 100 ACGTACGTACGTACGTACGT\n')
+        predictions = [('a score=0\n'
+                        's A 0 20 + 100 ACGTACGTACGTACGTACGT\n'
+                        's B 0 20 + 100 ACGTACGTACGTACGTACGT\n'),
+                       ('a score=0\n'
+                        's A 0 20 + 100 ACGTACGTACGTACGTACGT\n'
+                        's C 0 20 + 100 ACGTACGTACGTACGTACGT\n'
+                        '\n'
+                        'a score=0\n'
+                        's C 40 20 + 100 ACGTACGTACGTACGTACGT\n'
+                        's D 50 20 + 100 ACGTACGTACGTACGTACGT\n'),
+                       ('a score=0\n'
+                        's A 10 20 + 100 ACGTACGTACGTACGTACGT\n'
+                        's B 10 20 + 100 ACGTACGTACGTACGTACGT\n'),
+                       ]
+        testMaf1 = mtt.testFile(os.path.join(tmpDir, 'maf1.maf'), maf1, g_headers)
+        batch = os.path.join(tmpDir, 'batch.txt')
+        f = open(batch, 'w')
+        expected = []
+        for i, prediction in enumerate(predictions):
+            maf2 = os.path.join(tmpDir, 'maf2.%d.maf' % i)
+            mtt.testFile(maf2, prediction, g_headers)
+            f.write('%s %s\n' % (maf2, os.path.join(tmpDir, 'output%d.xml' % i)))
+            cmd = [prog, '--maf1', os.path.join(tmpDir, 'maf1.maf'), '--maf2', maf2,
+                   '--out', os.path.join(tmpDir, 'single.xml'),
+                   '--samples=10', '--seed=1', '--logLevel=critical']
+            mtt.recordCommands([cmd], tmpDir)
+            mtt.runCommandsS([cmd], tmpDir)
+            tree = ET.parse(os.path.join(tmpDir, 'single.xml'))
+            expected.append([tree.getroot().attrib['numberOfPairsInMaf1'],
+                             tree.getroot().attrib['numberOfPairsInMaf2']]
+                            + [ET.tostring(e) for e in tree.findall('homologyTests')])
+        f.close()
+        truthPairs = os.path.join(tmpDir, 'truth.pairs')
+        # the second --truthPairs run reads the samples the first one kept
+        for extra in [[], ['--truthPairs', truthPairs], ['--truthPairs', truthPairs]]:
+            cmd = [prog, '--maf1', os.path.join(tmpDir, 'maf1.maf'), '--batch', batch,
+                   '--samples=10', '--seed=1', '--logLevel=critical'] + extra
+            mtt.recordCommands([cmd], tmpDir)
+            mtt.runCommandsS([cmd], tmpDir)
+            for i in xrange(len(predictions)):
+                tree = ET.parse(os.path.join(tmpDir, 'output%d.xml' % i))
+                self.assertEqual(expected[i], [tree.getroot().attrib['numberOfPairsInMaf1'],
+                                               tree.getroot().attrib['numberOfPairsInMaf2']]
+                                 + [ET.tostring(e) for e in tree.findall('homologyTests')])
+        self.assertTrue(os.path.exists(truthPairs + '.1'))
+        mtt.removeDir(tmpDir)
     def test_memory_2(self):
         """ mafComparator should be memory clean for known values
         """
@@ -1005,6 +1122,142 @@ class randomSeedTests(unittest.TestCase):
                     self.assertEqual(homTests[1].find('aggregateResults').find('all').attrib[elm],
                                      origHomTests[1].find('aggregateResults').find('all').attrib[elm])
         mtt.removeDir(tmpDir)
+    def test_concurrentTesting(self):
+        """ mafComparator --concurrent should give the same results as a default run with the same seed
+        """
+        mtt.makeTempDirParent()
+        tmpDir = os.path.abspath(mtt.makeTempDir('concurrentTesting'))
+        parent = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+        for maf1, maf2  in knownValuesSeed:
+            testMaf1 = mtt.testFile(os.path.abspath(os.path.join(tmpDir, 'maf1.maf')), 
+                                    maf1, g_headers)
+            testMaf2 = mtt.testFile(os.path.abspath(os.path.join(tmpDir, 'maf2.maf')), 
+                                    maf2, g_headers)
+            results = []
+            for extra in [[], ['--concurrent'], ['--concurrent', '--threads=3']]:
+                cmd = [os.path.abspath(os.path.join(parent, 'test', 'mafComparator')),
+                       '--maf1', os.path.abspath(os.path.join(tmpDir, 'maf1.maf')), 
+                       '--maf2', os.path.abspath(os.path.join(tmpDir, 'maf2.maf')),
+                       '--out', os.path.join(tmpDir, 'output.xml'),
+                       '--samples=10', '--seed=1', '--logLevel=critical'] + extra
+                mtt.recordCommands([cmd], tmpDir)
+                mtt.runCommandsS([cmd], tmpDir)
+                tree = ET.parse(os.path.join(tmpDir, 'output.xml'))
+                results.append([ET.tostring(e) for e in tree.findall('homologyTests')])
+            self.assertEqual(results[0], results[1])
+            self.assertEqual(results[0], results[2])
+        mtt.removeDir(tmpDir)
+    def test_shardMerge(self):
+        """ mafComparator merge of --shard runs should give the results of one run, whatever the shards
+        """
+        mtt.makeTempDirParent()
+        tmpDir = os.path.abspath(mtt.makeTempDir('shardMerge'))
+        parent = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+        prog = os.path.abspath(os.path.join(parent, 'test', 'mafComparator'))
+        for maf1, maf2  in knownValuesSeed:
+            testMaf1 = mtt.testFile(os.path.abspath(os.path.join(tmpDir, 'maf1.maf')),
+                                    maf1, g_headers)
+            testMaf2 = mtt.testFile(os.path.abspath(os.path.join(tmpDir, 'maf2.maf')),
+                                    maf2, g_headers)
+            cmd = [prog,
+                   '--maf1', os.path.abspath(os.path.join(tmpDir, 'maf1.maf')),
+                   '--maf2', os.path.abspath(os.path.join(tmpDir, 'maf2.maf')),
+                   '--samples=10', '--seed=1', '--logLevel=critical']
+            mtt.recordCommands([cmd + ['--out', os.path.join(tmpDir, 'output.xml')]], tmpDir)
+            mtt.runCommandsS([cmd + ['--out', os.path.join(tmpDir, 'output.xml')]], tmpDir)
+            tree = ET.parse(os.path.join(tmpDir, 'output.xml'))
+            expected = [ET.tostring(e) for e in tree.findall('homologyTests')]
+            for shards in [['0/1'], ['0/2', '1/2'], ['0/3', '1/3', '2/3'],
+                           ['A,C,test2.chr0', 'B,D,test1.chr0']]:
+                partials = [os.path.join(tmpDir, 'partial%d' % i) for i in xrange(len(shards))]
+                cmds = [cmd + ['--shard', s, '--out', p] for s, p in zip(shards, partials)]
+                cmds.append([prog, 'merge', '--out', os.path.join(tmpDir, 'merged.xml')] + partials)
+                mtt.recordCommands(cmds, tmpDir)
+                mtt.runCommandsS(cmds, tmpDir)
+                tree = ET.parse(os.path.join(tmpDir, 'merged.xml'))
+                self.assertEqual(expected, [ET.tostring(e) for e in tree.findall('homologyTests')])
+        mtt.removeDir(tmpDir)
+    def test_pairCountCache(self):
+        """ mafComparator should give the same results with and without a pair count cache
+        """
+        mtt.makeTempDirParent()
+        tmpDir = os.path.abspath(mtt.makeTempDir('pairCountCache'))
+        parent = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+        for maf1, maf2  in knownValuesSeed:
+            testMaf1 = mtt.testFile(os.path.abspath(os.path.join(tmpDir, 'maf1.maf')), 
+                                    maf1, g_headers)
+            testMaf2 = mtt.testFile(os.path.abspath(os.path.join(tmpDir, 'maf2.maf')), 
+                                    maf2, g_headers)
+            for sampler in [[], ['--reservoir']]:
+                for f in ['maf1.maf.pairCount', 'maf2.maf.pairCount']:
+                    if os.path.exists(os.path.join(tmpDir, f)):
+                        os.remove(os.path.join(tmpDir, f))
+                results = []
+                # the first cached run writes the sidecars, the second reads them
+                for extra in [[], ['--pairCountCache'], ['--pairCountCache'], ['--pairCountCache', '--concurrent']]:
+                    cmd = [os.path.abspath(os.path.join(parent, 'test', 'mafComparator')),
+                           '--maf1', os.path.abspath(os.path.join(tmpDir, 'maf1.maf')), 
+                           '--maf2', os.path.abspath(os.path.join(tmpDir, 'maf2.maf')),
+                           '--out', os.path.join(tmpDir, 'output.xml'),
+                           '--samples=10', '--seed=1', '--logLevel=critical'] + sampler + extra
+                    mtt.recordCommands([cmd], tmpDir)
+                    mtt.runCommandsS([cmd], tmpDir)
+                    tree = ET.parse(os.path.join(tmpDir, 'output.xml'))
+                    results.append([ET.tostring(e) for e in tree.findall('homologyTests')])
+                self.assertTrue(os.path.exists(os.path.join(tmpDir, 'maf1.maf.pairCount')))
+                for r in results[1:]:
+                    self.assertEqual(results[0], r)
+        mtt.removeDir(tmpDir)
+    def test_reservoir(self):
+        """ mafComparator --reservoir should test exactly --samples pairs, and only it is named in the report
+        """
+        mtt.makeTempDirParent()
+        tmpDir = os.path.abspath(mtt.makeTempDir('reservoir'))
+        parent = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+        for maf1, maf2  in knownValuesSeed:
+            testMaf1 = mtt.testFile(os.path.abspath(os.path.join(tmpDir, 'maf1.maf')),
+                                    maf1, g_headers)
+            testMaf2 = mtt.testFile(os.path.abspath(os.path.join(tmpDir, 'maf2.maf')),
+                                    maf2, g_headers)
+            for sampler, sampling in [([], None), (['--reservoir'], 'reservoir')]:
+                cmd = [os.path.abspath(os.path.join(parent, 'test', 'mafComparator')),
+                       '--maf1', os.path.abspath(os.path.join(tmpDir, 'maf1.maf')),
+                       '--maf2', os.path.abspath(os.path.join(tmpDir, 'maf2.maf')),
+                       '--out', os.path.join(tmpDir, 'output.xml'),
+                       '--samples=10', '--seed=1', '--logLevel=critical'] + sampler
+                mtt.recordCommands([cmd], tmpDir)
+                mtt.runCommandsS([cmd], tmpDir)
+                tree = ET.parse(os.path.join(tmpDir, 'output.xml'))
+                self.assertEqual(sampling, tree.getroot().attrib.get('sampling'))
+                if sampling is None:
+                    continue
+                for ht in tree.findall('homologyTests'):
+                    self.assertEqual('10', ht.find('aggregateResults/all').attrib['totalTests'])
+        mtt.removeDir(tmpDir)
+    def test_sampleMemory(self):
+        """ mafComparator should give the same results with the sample held on disk
+        """
+        mtt.makeTempDirParent()
+        tmpDir = os.path.abspath(mtt.makeTempDir('sampleMemory'))
+        parent = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+        for maf1, maf2  in knownValuesSeed:
+            testMaf1 = mtt.testFile(os.path.abspath(os.path.join(tmpDir, 'maf1.maf')),
+                                    maf1, g_headers)
+            testMaf2 = mtt.testFile(os.path.abspath(os.path.join(tmpDir, 'maf2.maf')),
+                                    maf2, g_headers)
+            results = []
+            for extra in [[], ['--sampleMemory=1', '--tmpDir', tmpDir]]:
+                cmd = [os.path.abspath(os.path.join(parent, 'test', 'mafComparator')),
+                       '--maf1', os.path.abspath(os.path.join(tmpDir, 'maf1.maf')),
+                       '--maf2', os.path.abspath(os.path.join(tmpDir, 'maf2.maf')),
+                       '--out', os.path.join(tmpDir, 'output.xml'),
+                       '--samples=1000', '--seed=1', '--logLevel=critical'] + extra
+                mtt.recordCommands([cmd], tmpDir)
+                mtt.runCommandsS([cmd], tmpDir)
+                tree = ET.parse(os.path.join(tmpDir, 'output.xml'))
+                results.append([ET.tostring(e) for e in tree.findall('homologyTests')])
+            self.assertEqual(results[0], results[1])
+        mtt.removeDir(tmpDir)
     def test_memory_1(self):
         """ mafComparator should be memory clean for seed testing examples
         """
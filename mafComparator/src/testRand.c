@@ -30,10 +30,11 @@
 #include "comparatorRandom.h"
 
 int main(int argc, char **argv) {
+    RandomStream random;
     if (argc == 5) {
-        st_randomSeed(atoi(argv[4]));
+        randomStream_init(&random, strtoull(argv[4], NULL, 10), 0);
     } else if (argc == 4) {
-        st_randomSeed(time(NULL));
+        randomStream_init(&random, time(NULL), 0);
     } else {
         fprintf(stderr, "Usage: %s numberOfSamples n p [optional: randomSeed]\n", argv[0]);
         return EXIT_FAILURE;
@@ -42,7 +43,7 @@ int main(int argc, char **argv) {
     uint64_t n = atoi(argv[2]);
     double p = atof(argv[3]);
     for (uint64_t i = 0; i < numSamples; ++i) {
-        printf("%" PRIu64 "\n", rbinom(n, p));
+        printf("%" PRIu64 "\n", rbinom(&random, n, p));
     }
     return EXIT_SUCCESS;
 }
@@ -34,12 +34,14 @@
 #include "sharedMaf.h"
 #include "mafCoverage.h"
 #include "mafCoverageAPI.h"
+#include "profile.h"
 #include "buildVersion.h"
 #include "sonLib.h"
 
 static char *mafFileName = NULL;
 static stSet *speciesOrChromosomeNames = NULL;
 static bool nCoverage = 0, identity = 0, ignoreSpecies = 0;
+static unsigned numThreads = 0;
 
 const char *g_version = "version 0.1 May 2013";
 uint64_t getRegionSize(char *seq1, stHash *intervalsHash);
@@ -57,7 +59,8 @@ void usage(void) {
         "The n-coverage of B on A is the proportion of sites in A that align to n or more sites in B.\n");
     fprintf(stderr, "Options: \n");
     usageMessage('h', "help", "show this help message and exit.");
-    usageMessage('m', "maf", "path to maf file.");
+    usageMessage('m', "maf", "path to maf file, or - to read from stdin. May also be a sharded maf, either @FILE where "
+            "FILE lists one maf per line or a quoted glob pattern such as 'aln.chr*.maf'.");
     usageMessage('s', "speciesOrChr",
             "species or species.chromosome name, e.g. `hg19' or 'hg19.chr1', if not specified reports results for every possible species."
                 "wildcard at the end.");
@@ -65,6 +68,9 @@ void usage(void) {
     usageMessage('i', "identity", "report coverage of identical bases.");
     usageMessage('l', "logLevel", "Set logging level, either 'CRITICAL'/'INFO'/'DEBUG'.");
     usageMessage('a', "ignoreSpecies", "Do all chromosomes-against-all-chromosomes coverage.");
+    usageMessage('p', "profile", "Record the time spent in each phase of the program and write it to FILE "
+                 "in the Chrome trace event format.");
+    usageMessage('t', "threads", "Number of shards of a sharded maf to read at once, 0 (the default) for one per processor.");
     exit(EXIT_FAILURE);
 }
 
@@ -74,9 +80,10 @@ static void parseOptions(int argc, char **argv) {
     while (1) {
         static struct option longOptions[] = { { "help", no_argument, 0, 'h' }, { "maf", required_argument, 0, 'm' }, { "speciesOrChr",
                 required_argument, 0, 's' }, { "nCoverage", no_argument, 0, 'n' }, { "identity", no_argument, 0, 'i' }, { "logLevel",
-                required_argument, 0, 'l' }, { "ignoreSpecies", no_argument, 0, 'a' }, { 0, 0, 0, 0 } };
+                required_argument, 0, 'l' }, { "ignoreSpecies", no_argument, 0, 'a' }, { "profile",
+                required_argument, 0, 'p' }, { "threads", required_argument, 0, 't' }, { 0, 0, 0, 0 } };
         int longIndex = 0;
-        c = getopt_long(argc, argv, "m:s:hnl:a", longOptions, &longIndex);
+        c = getopt_long(argc, argv, "m:s:hnl:ap:t:", longOptions, &longIndex);
         if (c == -1)
             break;
         switch (c) {
@@ -101,6 +108,14 @@ static void parseOptions(int argc, char **argv) {
             case 'a':
                 ignoreSpecies = 1;
                 break;
+            case 'p':
+                profile_init(optarg);
+                break;
+            case 't':
+                if (sscanf(optarg, "%u", &numThreads) != 1) {
+                    st_errAbort("--threads must be a non-negative integer, not %s\n", optarg);
+                }
+                break;
             default:
                 abort();
         }
@@ -119,8 +134,16 @@ static void parseOptions(int argc, char **argv) {
 
 int main(int argc, char **argv) {
     parseOptions(argc, argv);
+    // the maf is read once for the sequence sizes and once per species, so copy stdin up front.
+    if (maf_isStdStream(mafFileName)) {
+        maf_spoolStdin();
+    }
+    unsigned numShards;
+    char **shards = maf_getShardList(mafFileName, &numShards);
     //Work out the structure of the chromosomes of the query sequence
+    profileSpan_t span = profile_begin("getMapOfSequenceNamesToSizesFromMaf");
     stHash *sequenceNamesToSequenceSizes = getMapOfSequenceNamesToSizesFromMaf(mafFileName);
+    profile_end(span);
     stHashIterator *sequenceNameIt = stHash_getIterator(sequenceNamesToSequenceSizes);
     char *sequenceName;
     while ((sequenceName = stHash_getNext(sequenceNameIt)) != NULL) {
@@ -161,9 +184,13 @@ int main(int argc, char **argv) {
         st_logInfo("Computing the coverages for species/chr: %s\n", speciesOrChrName);
         //Build the coverage data structure
         NGenomeCoverage *nGC = nGenomeCoverage_construct(sequenceNamesToSequenceSizes, speciesOrChrName, ignoreSpecies);
-        nGenomeCoverage_populate(nGC, mafFileName, identity);
+        span = profile_begin("nGenomeCoverage_populate");
+        nGenomeCoverage_populateFromShards(nGC, sequenceNamesToSequenceSizes, shards, numShards, numThreads, identity);
+        profile_end(span);
         //Report
+        span = profile_begin("nGenomeCoverage_report");
         nGenomeCoverage_report(nGC, stdout, nCoverage);
+        profile_end(span);
         //cleanup loop
         nGenomeCoverage_destruct(nGC);
     }
@@ -172,7 +199,9 @@ int main(int argc, char **argv) {
     stSet_destructIterator(speciesOrChrNamesIt);
     stHash_destruct(sequenceNamesToSequenceSizes);
     stSet_destruct(speciesOrChromosomeNames);
+    maf_destroyShardList(shards, numShards);
     free(mafFileName);
+    profile_finish();
     // while(1);
     return EXIT_SUCCESS;
 }
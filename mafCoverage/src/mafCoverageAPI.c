@@ -35,6 +35,7 @@
 #include <ctype.h>
 #include "common.h"
 #include "sharedMaf.h"
+#include "parallel.h"
 #include "mafCoverageAPI.h"
 #include "bioioC.h" // benLine()
 #include "sonLib.h"
@@ -186,6 +187,38 @@ bool pairwiseCoverageArray_increase(char *sequenceCoverageArray, int64_t positio
     return 0;
 }
 
+bool pairwiseCoverage_merge(PairwiseCoverage *pC, PairwiseCoverage *other) {
+    bool saturated = 0;
+    stHashIterator *it = stHash_getIterator((stHash *)pC->sequenceNamesToSequenceSizeForGivenSpecies);
+    char *sequenceName;
+    while ((sequenceName = stHash_getNext(it)) != NULL) {
+        int64_t chromosomeLength = stIntTuple_get(stHash_search((stHash *)pC->sequenceNamesToSequenceSizeForGivenSpecies, sequenceName), 0);
+        char *coverage = pairwiseCoverage_getCoverageArrayForSequence(pC, sequenceName);
+        char *otherCoverage = pairwiseCoverage_getCoverageArrayForSequence(other, sequenceName);
+        for (int64_t i = 0; i < chromosomeLength; i++) {
+            //Saturating, as pairwiseCoverageArray_increase() is
+            int64_t n = (int64_t) coverage[i] + otherCoverage[i];
+            if (n >= SCHAR_MAX) {
+                n = SCHAR_MAX;
+                saturated = 1;
+            }
+            coverage[i] = n;
+        }
+    }
+    stHash_destructIterator(it);
+    return saturated;
+}
+
+static void pairwiseCoverage_clear(PairwiseCoverage *pC) {
+    stHashIterator *it = stHash_getIterator((stHash *)pC->sequenceNamesToSequenceSizeForGivenSpecies);
+    char *sequenceName;
+    while ((sequenceName = stHash_getNext(it)) != NULL) {
+        int64_t chromosomeLength = stIntTuple_get(stHash_search((stHash *)pC->sequenceNamesToSequenceSizeForGivenSpecies, sequenceName), 0);
+        memset(pairwiseCoverage_getCoverageArrayForSequence(pC, sequenceName), 0, chromosomeLength);
+    }
+    stHash_destructIterator(it);
+}
+
 double *pairwiseCoverage_calculateNCoverages(PairwiseCoverage *pC) {
     stHashIterator *it = stHash_getIterator((stHash *)pC->sequenceNamesToSequenceSizeForGivenSpecies);
     double *nCoverages = st_calloc(SCHAR_MAX + 1, sizeof(double));
@@ -333,6 +366,80 @@ void nGenomeCoverage_populate(NGenomeCoverage *nGC, char *mafFileName, bool requ
     maf_destroyMfa(mfa);
 }
 
+bool nGenomeCoverage_merge(NGenomeCoverage *nGC, NGenomeCoverage *other) {
+    bool saturated = 0;
+    stHashIterator *it = stHash_getIterator(nGC->pairwiseCoverages);
+    char *speciesName;
+    while ((speciesName = stHash_getNext(it)) != NULL) {
+        PairwiseCoverage *otherPC = stHash_search(other->pairwiseCoverages, speciesName);
+        assert(otherPC != NULL);
+        if (pairwiseCoverage_merge(stHash_search(nGC->pairwiseCoverages, speciesName), otherPC)) {
+            saturated = 1;
+        }
+    }
+    stHash_destructIterator(it);
+    return saturated;
+}
+
+static void nGenomeCoverage_clear(NGenomeCoverage *nGC) {
+    stHashIterator *it = stHash_getIterator(nGC->pairwiseCoverages);
+    char *speciesName;
+    while ((speciesName = stHash_getNext(it)) != NULL) {
+        pairwiseCoverage_clear(stHash_search(nGC->pairwiseCoverages, speciesName));
+    }
+    stHash_destructIterator(it);
+}
+
+/*
+ * Shards are populated side by side, each worker into a coverage structure of its own. Worker 0 uses the
+ * caller's structure, the others are merged into it at the end.
+ *
+ * Once a position's count saturates nGenomeCoverage_populate() stops early, skipping the remaining lines
+ * of the block for that query line, so what it counts depends on what was read before. While no merged
+ * count reaches SCHAR_MAX nothing saturated in any order and the sum is exactly the count of a serial
+ * read. Otherwise the shards are read again one after the other, as the serial read would.
+ */
+
+typedef struct _shardCoverage {
+    char **shards;
+    NGenomeCoverage **workerCoverages;
+    bool requireIdentityForMatch;
+} ShardCoverage;
+
+static void populateShard(uint64_t i, unsigned worker, void *data) {
+    ShardCoverage *sC = data;
+    nGenomeCoverage_populate(sC->workerCoverages[worker], sC->shards[i], sC->requireIdentityForMatch);
+}
+
+void nGenomeCoverage_populateFromShards(NGenomeCoverage *nGC, stHash *sequenceNamesToSequenceSizes, char **shards,
+        unsigned numShards, unsigned numThreads, bool requireIdentityForMatch) {
+    unsigned numWorkers = parallel_numberOfWorkers(numThreads, numShards);
+    ShardCoverage sC;
+    sC.shards = shards;
+    sC.requireIdentityForMatch = requireIdentityForMatch;
+    sC.workerCoverages = st_malloc(sizeof(NGenomeCoverage *) * numWorkers);
+    sC.workerCoverages[0] = nGC;
+    for (unsigned w = 1; w < numWorkers; w++) {
+        sC.workerCoverages[w] = nGenomeCoverage_construct(sequenceNamesToSequenceSizes, nGC->speciesOrChrName, nGC->ignoreSpeciesNames);
+    }
+    parallel_for(numShards, numWorkers, populateShard, &sC);
+    bool saturated = 0;
+    for (unsigned w = 1; w < numWorkers; w++) {
+        if (nGenomeCoverage_merge(nGC, sC.workerCoverages[w])) {
+            saturated = 1;
+        }
+        nGenomeCoverage_destruct(sC.workerCoverages[w]);
+    }
+    free(sC.workerCoverages);
+    if (saturated) {
+        st_logInfo("Coverage saturated, reading the shards again one at a time\n");
+        nGenomeCoverage_clear(nGC);
+        for (unsigned i = 0; i < numShards; i++) {
+            nGenomeCoverage_populate(nGC, shards[i], requireIdentityForMatch);
+        }
+    }
+}
+
 void nGenomeCoverage_destruct(NGenomeCoverage *nGC) {
     stHash_destruct(nGC->pairwiseCoverages);
     stHash_destruct(nGC->sequenceNamesToSequenceSizeForGivenSpeciesOrChr);
@@ -91,6 +91,12 @@ char *pairwiseCoverage_getCoverageArrayForSequence(PairwiseCoverage *pC, char *s
  */
 bool pairwiseCoverageArray_increase(char *sequenceCoverageArray, int64_t position);
 
+/*
+ * Adds the coverage counts of other, which must cover the same sequences, to those of pC. Returns non-zero
+ * if any count reached the maximum coverage.
+ */
+bool pairwiseCoverage_merge(PairwiseCoverage *pC, PairwiseCoverage *other);
+
 /*
  * An all-against-a-given-species object.
  */
@@ -106,6 +112,19 @@ NGenomeCoverage *nGenomeCoverage_construct(stHash *sequenceSizes, char *speciesN
  */
 void nGenomeCoverage_populate(NGenomeCoverage *nGC, char *mafFileName, bool requireIdentityForMatch);
 
+/*
+ * As nGenomeCoverage_populate, for a maf split into shards, reading up to numThreads (0 for one per
+ * processor) shards at once. sequenceSizes must be the hash nGC was constructed from.
+ */
+void nGenomeCoverage_populateFromShards(NGenomeCoverage *nGC, stHash *sequenceSizes, char **shards,
+        unsigned numShards, unsigned numThreads, bool requireIdentityForMatch);
+
+/*
+ * Adds the coverage counts of other, which must be for the same species and sequences, to those of nGC.
+ * Returns non-zero if any count reached the maximum coverage.
+ */
+bool nGenomeCoverage_merge(NGenomeCoverage *nGC, NGenomeCoverage *other);
+
 /*
  * Reports stats in tab delimited format.
  */
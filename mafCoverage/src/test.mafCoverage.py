@@ -220,6 +220,50 @@ class CoverageTest(unittest.TestCase):
     mtt.removeDir(tmpDir)
 
 
+def shardBlocks(rows, n):
+  block = 'a score=0.0 status=test.input\n'
+  block += ''.join(['s %s 0 10 + 10 ACGTACGTAC\n' % r for r in rows])
+  return (block + '\n') * n
+
+
+class ShardTest(unittest.TestCase):
+  def testShards(self):
+    """ mafCoverage of a sharded maf should be that of the concatenation of its shards.
+    """
+    mtt.makeTempDirParent()
+    tmpDir = os.path.abspath(mtt.makeTempDir('shards'))
+    parent = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+    prog = os.path.abspath(os.path.join(parent, 'test', 'mafCoverage'))
+    # the known good mafs, then one where target saturates against seqB, in
+    # the concatenation, before seqC is ever seen.
+    shardSets = [[mafSeq, mafSeq] for target, mafSeq, solutionDict in g_knownGood]
+    shardSets.append([shardBlocks(['target.chr1', 'seqB.chr1'], 64),
+                      shardBlocks(['target.chr1', 'seqB.chr1'], 64),
+                      shardBlocks(['target.chr1', 'seqB.chr1', 'seqC.chr1'], 3)])
+    for shards in shardSets:
+      for i, s in enumerate(shards):
+        mtt.testFile(os.path.join(tmpDir, 'shard.%d.maf' % i), s, g_headers)
+      f = open(os.path.join(tmpDir, 'cat.maf'), 'w')
+      for i in xrange(len(shards)):
+        f.write(open(os.path.join(tmpDir, 'shard.%d.maf' % i)).read())
+      f.close()
+      cmd = [prog, '--maf', os.path.join(tmpDir, 'cat.maf'), '--nCoverage']
+      outpipes = [os.path.join(tmpDir, 'expected.txt')]
+      mtt.recordCommands([cmd], tmpDir, outPipes=outpipes)
+      mtt.runCommandsS([cmd], tmpDir, outPipes=outpipes)
+      expected = open(os.path.join(tmpDir, 'expected.txt')).read()
+      for threads in ['1', '2', '3', '0', '3', '3']:
+        cmd = [prog, '--maf', os.path.join(tmpDir, 'shard.*.maf'), '--nCoverage',
+               '--threads', threads]
+        outpipes = [os.path.join(tmpDir, 'output.txt')]
+        mtt.recordCommands([cmd], tmpDir, outPipes=outpipes)
+        mtt.runCommandsS([cmd], tmpDir, outPipes=outpipes)
+        self.assertEqual(expected, open(os.path.join(tmpDir, 'output.txt')).read())
+      for i in xrange(len(shards)):
+        os.remove(os.path.join(tmpDir, 'shard.%d.maf' % i))
+    mtt.removeDir(tmpDir)
+
+
 class CuTestMemory(unittest.TestCase):
   def test_CuTestMemory(self):
     """ If valgrind is installed on the system, check for memory related errors in CuTests.
@@ -31,6 +31,7 @@
 #include <string.h>
 #include "common.h"
 #include "sharedMaf.h"
+#include "profile.h"
 #include "buildVersion.h"
 
 const char *g_version = "version 0.1 September 2012";
@@ -90,6 +91,7 @@ void parseOptions(int argc, char **argv, char *filename) {
             {"help", no_argument, 0, 'h'},
             {"version", no_argument, 0, 0},
             {"maf",  required_argument, 0, 'm'},
+            {"profile", required_argument, 0, 0},
             {0, 0, 0, 0}
         };
         int longIndex = 0;
@@ -103,6 +105,10 @@ void parseOptions(int argc, char **argv, char *filename) {
                 version();
                 exit(EXIT_SUCCESS);
             }
+            if (strcmp("profile", longOptions[longIndex].name) == 0) {
+                profile_init(optarg);
+                break;
+            }
             break;
         case 'm':
             setMName = 1;
@@ -158,8 +164,10 @@ void usage(void) {
             "earliest in the file. \n\n");
     fprintf(stderr, "Options: \n");
     usageMessage('h', "help", "show this help message and exit.");
-    usageMessage('m', "maf", "path to maf file.");
+    usageMessage('m', "maf", "path to maf file, or - to read from stdin.");
     usageMessage('v', "verbose", "turns on verbose output.");
+    usageMessage('\0', "profile", "record the time spent in each phase of the program "
+                 "and write it to FILE in the Chrome trace event format.");
     exit(EXIT_FAILURE);
 }
 scoredMafLine_t* newScoredMafLine(void) {
@@ -626,7 +634,10 @@ int main(int argc, char **argv) {
     char filename[kMaxStringLength];
     parseOptions(argc, argv, filename);
     mafFileApi_t *mfa = maf_newMfa(filename, "r");
+    profileSpan_t span = profile_begin("processBody");
     processBody(mfa);
+    profile_end(span);
     maf_destroyMfa(mfa);
+    profile_finish();
     return EXIT_SUCCESS;
 }
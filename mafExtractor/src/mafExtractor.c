@@ -30,6 +30,7 @@
 #include <string.h>
 #include "common.h"
 #include "sharedMaf.h"
+#include "profile.h"
 #include "mafExtractor.h"
 #include "mafExtractorAPI.h"
 #include "buildVersion.h"
@@ -50,12 +51,14 @@ void usage(void) {
             "containing the querry will be printed to standard out.\n\n");
     fprintf(stderr, "Options: \n");
     usageMessage('h', "help", "show this help message and exit.");
-    usageMessage('m', "maf", "path to maf file.");
+    usageMessage('m', "maf", "path to maf file, or - to read from stdin.");
     usageMessage('s', "seq", "sequence name, e.g. `hg18.chr2'.");
     usageMessage('\0', "start", "start of region, inclusive, 0 based.");
     usageMessage('\0', "stop", "end of region, inclusive, 0 based.");
     usageMessage('\0', "soft", "include entire block even if it has gaps or over-hangs. default=false.");
     usageMessage('v', "verbose", "turns on verbose output.");
+    usageMessage('\0', "profile", "record the time spent in each phase of the program "
+                 "and write it to FILE in the Chrome trace event format.");
     exit(EXIT_FAILURE);
 }
 void parseOptions(int argc, char **argv, char *filename, char *seqName, uint64_t *start, 
@@ -76,6 +79,7 @@ void parseOptions(int argc, char **argv, char *filename, char *seqName, uint64_t
             {"start", required_argument, 0, 0},
             {"stop", required_argument, 0, 0},
             {"soft", no_argument, 0, 0},
+            {"profile", required_argument, 0, 0},
             {0, 0, 0, 0}
         };
         int longIndex = 0;
@@ -106,6 +110,8 @@ void parseOptions(int argc, char **argv, char *filename, char *seqName, uint64_t
             } else if (strcmp("version", longOptions[longIndex].name) == 0) {
                 version();
                 exit(EXIT_SUCCESS);
+            } else if (strcmp("profile", longOptions[longIndex].name) == 0) {
+                profile_init(optarg);
             }
             break;
         case 'm':
@@ -161,8 +167,11 @@ int main(int argc, char **argv) {
     parseOptions(argc, argv, filename, seq, &start, &stop, &isSoft);
     mafFileApi_t *mfa = maf_newMfa(filename, "r");
 
+    profileSpan_t span = profile_begin("processBody");
     processBody(mfa, seq, start, stop, isSoft);
+    profile_end(span);
     maf_destroyMfa(mfa);
+    profile_finish();
     
     return EXIT_SUCCESS;
 }
@@ -36,6 +36,7 @@
 #include <unistd.h>
 #include "common.h"
 #include "sharedMaf.h"
+#include "profile.h"
 #include "buildVersion.h"
 
 const char *g_version = "version 0.1 September 2012";
@@ -75,12 +76,14 @@ void usage(void) {
             "'mm9' and 'rn4' using --includeSeq.\n\n");
     fprintf(stderr, "Options: \n");
     usageMessage('h', "help", "show this help message and exit.");
-    usageMessage('m', "maf", "path to maf file.");
+    usageMessage('m', "maf", "path to maf file, or - to read from stdin.");
     usageMessage('i', "includeSeq", "comma separated list of sequence names to include.");
     usageMessage('e', "excludeSeq", "comma separated list of sequence names to exclude.");
     usageMessage('g', "noDegreeGT", "filter out all blocks with degree greater than this value.");
     usageMessage('l', "noDegreeLT", "filter out all blocks with degree less than this value.");
     usageMessage('v', "verbose", "turns on verbose output.");
+    usageMessage('\0', "profile", "record the time spent in each phase of the program "
+                 "and write it to FILE in the Chrome trace event format.");
     exit(EXIT_FAILURE);
 }
 void parseOptions(int argc, char **argv, char *filename, char *nameList, bool *isInclude, int64_t *blockDegGt, int64_t *blockDegLt) {
@@ -99,6 +102,7 @@ void parseOptions(int argc, char **argv, char *filename, char *nameList, bool *i
             {"excludeSeq",  required_argument, 0, 'e'},
             {"noDegreeGT", required_argument, 0, 'g'},
             {"noDegreeLT", required_argument, 0, 'l'},
+            {"profile", required_argument, 0, 0},
             {0, 0, 0, 0}
         };
         int longIndex = 0;
@@ -113,6 +117,9 @@ void parseOptions(int argc, char **argv, char *filename, char *nameList, bool *i
                 version();
                 exit(EXIT_SUCCESS);
             }
+            if (strcmp("profile", longOptions[longIndex].name) == 0) {
+                profile_init(optarg);
+            }
             break;
         case 'm':
             setMafName = true;
@@ -322,10 +329,13 @@ int main(int argc, char **argv) {
     char **names = extractNames(nameList, n);
     mafFileApi_t *mfa = maf_newMfa(filename, "r");
 
+    profileSpan_t span = profile_begin("filterInput");
     filterInput(mfa, names, n, isInclude, excludeBlockDegreeGT, excludeBlockDegreeLT);
+    profile_end(span);
 
     maf_destroyMfa(mfa);
     destroyNameList(names, n);
+    profile_finish();
 
     return EXIT_SUCCESS;
 }
@@ -433,6 +433,27 @@ class FilterTest(unittest.TestCase):
             self.assertTrue(filtered)
             if filtered:
                 mtt.removeDir(tmpDir)
+    def testFilterIncludesStdin(self):
+        """ mafFilter should read the maf from stdin when --maf is -.
+        """
+        global g_header
+        mtt.makeTempDirParent()
+        for i in xrange(0, len(g_knownIncludes)):
+            tmpDir = os.path.abspath(mtt.makeTempDir('filterIncludesStdin'))
+            testMafPath, g_header = mtt.testFile(os.path.abspath(os.path.join(tmpDir, 'test.maf')),
+                                                 g_knownIncludes[i][0], g_headers)
+            parent = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+            cmd = []
+            cmd.append(os.path.abspath(os.path.join(parent, 'test', 'mafFilter')))
+            cmd += ['--maf', '-', '--includeSeq', '%s' % g_sequenceList]
+            inpipes = [testMafPath]
+            outpipes = [os.path.abspath(os.path.join(tmpDir, 'filtered.maf'))]
+            mtt.recordCommands([cmd], tmpDir, inPipes=inpipes, outPipes=outpipes)
+            mtt.runCommandsS([cmd], tmpDir, inPipes=inpipes, outPipes=outpipes)
+            filtered = mafIsFiltered(os.path.join(tmpDir, 'filtered.maf'), g_knownIncludes[i][1], g_header)
+            self.assertTrue(filtered)
+            if filtered:
+                mtt.removeDir(tmpDir)
     def testFilterExcludes(self):
         """ mafFilter should report blocks that match the filter settings for --excludeSeq.
         """
@@ -34,6 +34,7 @@
 #include "sharedMaf.h"
 #include "mafPairCoverage.h"
 #include "mafPairCoverageAPI.h"
+#include "profile.h"
 #include "buildVersion.h"
 
 const char *g_version = "version 0.1 May 2013";
@@ -62,7 +63,9 @@ void usage(void) {
           "columns divided by the total size of genome B.\n\n");
   fprintf(stderr, "Options: \n");
   usageMessage('h', "help", "show this help message and exit.");
-  usageMessage('m', "maf", "path to maf file.");
+  usageMessage('m', "maf", "path to maf file, or - to read from stdin. May "
+               "also be a sharded maf, either @FILE where FILE lists one maf "
+               "per line or a quoted glob pattern such as 'aln.chr*.maf'.");
   usageMessage('\0', "seq1", "sequence name, e.g. `hg19*'. Accepts * "
                "wildcard at the end.");
   usageMessage('\0', "seq2", "sequence name, e.g. `mm9.chr9'. Accepts * "
@@ -75,14 +78,18 @@ void usage(void) {
                "region to analyze.");
   usageMessage('\0', "bin_length", "the length of each bin within the "
                "region. default=1000");
+  usageMessage('\0', "threads", "number of shards of a sharded maf to read "
+               "at once, 0 (the default) for one per processor.");
   usageMessage('v', "verbose", "turns on verbose output.");
+  usageMessage('\0', "profile", "record the time spent in each phase of the "
+               "program and write it to FILE in the Chrome trace event format.");
   exit(EXIT_FAILURE);
 }
 
 
 void parseOptions(int argc, char **argv, char *filename, char *seq1Name,
                   char *seq2Name, stHash *intervalsHash, int64_t *bin_start,
-                  int64_t *bin_end, int64_t *bin_length) {
+                  int64_t *bin_end, int64_t *bin_length, unsigned *numThreads) {
   extern int g_debug_flag;
   extern int g_verbose_flag;
   int c;
@@ -100,6 +107,8 @@ void parseOptions(int argc, char **argv, char *filename, char *seq1Name,
       {"bin_start", required_argument, 0, 0},
       {"bin_end", required_argument, 0, 0},
       {"bin_length", required_argument, 0, 0},
+      {"profile", required_argument, 0, 0},
+      {"threads", required_argument, 0, 0},
       {0, 0, 0, 0}
     };
     size_t i;
@@ -130,6 +139,11 @@ void parseOptions(int argc, char **argv, char *filename, char *seq1Name,
       } else if (strcmp("bin_length", longOptions[longIndex].name) == 0) {
         i = sscanf(optarg, "%" PRIi64, bin_length);
         assert(i == 1);
+      } else if (strcmp("profile", longOptions[longIndex].name) == 0) {
+        profile_init(optarg);
+      } else if (strcmp("threads", longOptions[longIndex].name) == 0) {
+        i = sscanf(optarg, "%u", numThreads);
+        assert(i == 1);
       }
       break;
     case 'm':
@@ -167,6 +181,17 @@ void parseOptions(int argc, char **argv, char *filename, char *seq1Name,
   }
 }
 
+static int cmpKeys(const void *a, const void *b) {
+  return strcmp((const char *) a, (const char *) b);
+}
+static stList* getSortedKeys(stHash *hash) {
+  // sequences are reported in name order so the output never depends on the
+  // order in which they were seen
+  stList *keys = stHash_getKeys(hash);
+  stList_sort(keys, cmpKeys);
+  return keys;
+}
+
 uint64_t getRegionSize(char *seq1, stHash *intervalsHash) {
   // go through intervalsHash and see if seq1 matches any of the keys we pull
   // out. if so, add up the size
@@ -174,16 +199,10 @@ uint64_t getRegionSize(char *seq1, stHash *intervalsHash) {
   stHashIterator *hit = stHash_getIterator(intervalsHash);
   char *key = NULL;
   while ((key = stHash_getNext(hit)) != NULL) {
-    stSortedSetIterator *sit = NULL;
     if (!searchMatched_(key, seq1)) {
       continue;
     }
-    sit = stSortedSet_getIterator(stHash_search(intervalsHash, key));
-    stIntTuple *inttup = NULL;
-    while ((inttup = stSortedSet_getNext(sit)) != NULL) {
-      n += stIntTuple_get(inttup, 1)  - stIntTuple_get(inttup, 0);
-    }
-    stSortedSet_destructIterator(sit);
+    n += intervals_getTotalLength(stHash_search(intervalsHash, key));
   }
   stHash_destructIterator(hit);
   return n;
@@ -228,8 +247,9 @@ void reportResultsRegion(char *seq1, char *seq2, stHash *seq1Hash,
 
   // print each seq1 on its own
   if (stHash_size(seq1Hash) > 0) {
-    hit = stHash_getIterator(seq1Hash);
-    while ((key = stHash_getNext(hit)) != NULL) {
+    stList *keys = getSortedKeys(seq1Hash);
+    for (int64_t k = 0; k < stList_length(keys); ++k) {
+      key = stList_get(keys, k);
       if (stHash_search(intervalsHash, key) == NULL) {
         // don't report sequences that do not show up in the bed region file
         continue;
@@ -246,12 +266,13 @@ void reportResultsRegion(char *seq1, char *seq2, stHash *seq1Hash,
              mafCoverageCount_getOutRegion(stHash_search(seq1Hash, key)),
              cov1in);
     }
-    stHash_destructIterator(hit);
+    stList_destruct(keys);
   }
   // print each seq2 on its own
   if (stHash_size(seq2Hash) > 0) {
-    hit = stHash_getIterator(seq2Hash);
-    while ((key = stHash_getNext(hit)) != NULL) {
+    stList *keys = getSortedKeys(seq2Hash);
+    for (int64_t k = 0; k < stList_length(keys); ++k) {
+      key = stList_get(keys, k);
       if (stHash_search(intervalsHash, key) == NULL) {
         // don't report sequences that do not show up in the bed region file
         continue;
@@ -269,7 +290,7 @@ void reportResultsRegion(char *seq1, char *seq2, stHash *seq1Hash,
              mafCoverageCount_getOutRegion(stHash_search(seq2Hash, key)),
              cov1in);
     }
-    stHash_destructIterator(hit);
+    stList_destruct(keys);
   }
 }
 
@@ -333,8 +354,9 @@ void reportResults(char *seq1, char *seq2, stHash *seq1Hash, stHash *seq2Hash,
          "Aligned Pos.", "Coverage", "Obs Coverage");
   // print each seq1 on its own
   if (stHash_size(seq1Hash) > 0) {
-    hit = stHash_getIterator(seq1Hash);
-    while ((key = stHash_getNext(hit)) != NULL) {
+    stList *keys = getSortedKeys(seq1Hash);
+    for (int64_t k = 0; k < stList_length(keys); ++k) {
+      key = stList_get(keys, k);
       if  (mafCoverageCount_getSourceLength(stHash_search(seq1Hash, key)) == 0) {
         cov1 = 0.;
       } else {
@@ -353,12 +375,13 @@ void reportResults(char *seq1, char *seq2, stHash *seq1Hash, stHash *seq2Hash,
              mafCoverageCount_getObservedLength(stHash_search(seq1Hash, key)),
              mafCoverageCount_getCount(stHash_search(seq1Hash, key)), cov1, obscov1);
     }
-    stHash_destructIterator(hit);
+    stList_destruct(keys);
   }
   // print each seq2 on its own
   if (stHash_size(seq2Hash) > 0) {
-    hit = stHash_getIterator(seq2Hash);
-    while ((key = stHash_getNext(hit)) != NULL) {
+    stList *keys = getSortedKeys(seq2Hash);
+    for (int64_t k = 0; k < stList_length(keys); ++k) {
+      key = stList_get(keys, k);
       if  (mafCoverageCount_getSourceLength(stHash_search(seq2Hash, key)) == 0){
         cov2 = 0.;
       } else {
@@ -376,7 +399,7 @@ void reportResults(char *seq1, char *seq2, stHash *seq1Hash, stHash *seq2Hash,
              mafCoverageCount_getObservedLength(stHash_search(seq2Hash, key)),
              mafCoverageCount_getCount(stHash_search(seq2Hash, key)), cov2, obscov2);
     }
-    stHash_destructIterator(hit);
+    stList_destruct(keys);
   }
 }
 
@@ -389,13 +412,14 @@ int main(int argc, char **argv) {
   int64_t bin_start = -1;  // sentinel value. real values > 0
   int64_t bin_end = -1;  // sentinel value. real values > 0
   int64_t bin_length = 1000;
+  unsigned numThreads = 0;
   BinContainer *bin_container = NULL;
   stHash *intervalsHash = stHash_construct3(stHash_stringKey,
                                             stHash_stringEqualKey, free,
                                             (void(*)(void *))
-                                            stSortedSet_destruct);
+                                            intervals_destroy);
   parseOptions(argc, argv, filename, seq1, seq2, intervalsHash,
-               &bin_start, &bin_end, &bin_length);
+               &bin_start, &bin_end, &bin_length, &numThreads);
   if ((bin_start != -1) && (bin_end != -1) && (bin_length > 0)) {
     bin_container = binContainer_construct(bin_start, bin_end,
                                                          bin_length);
@@ -407,22 +431,28 @@ int main(int argc, char **argv) {
   } else {
     bin_container = NULL;
   }
-  mafFileApi_t *mfa = maf_newMfa(filename, "r");
+  unsigned numShards;
+  char **shards = maf_getShardList(filename, &numShards);
   stHash *seq1Hash = stHash_construct3(stHash_stringKey, stHash_stringEqualKey,
                                        free, free);
   stHash *seq2Hash = stHash_construct3(stHash_stringKey, stHash_stringEqualKey,
                                        free, free);
   uint64_t alignedPositions = 0;
-  processBody(mfa, seq1, seq2, seq1Hash, seq2Hash, &alignedPositions,
-              intervalsHash, bin_container);
+  profileSpan_t span = profile_begin("processBody");
+  processShards(shards, numShards, numThreads, seq1, seq2, seq1Hash, seq2Hash,
+                &alignedPositions, intervalsHash, bin_container);
+  profile_end(span);
+  span = profile_begin("reportResults");
   reportResults(seq1, seq2, seq1Hash, seq2Hash, &alignedPositions);
   reportResultsRegion(seq1, seq2, seq1Hash, seq2Hash, &alignedPositions,
                       intervalsHash);
   reportResultsBins(seq1, seq2, bin_container);
-  maf_destroyMfa(mfa);
+  profile_end(span);
+  maf_destroyShardList(shards, numShards);
   stHash_destruct(seq1Hash);
   stHash_destruct(seq2Hash);
   stHash_destruct(intervalsHash);
   binContainer_destruct(bin_container);
+  profile_finish();
   return EXIT_SUCCESS;
 }
@@ -35,7 +35,7 @@ void version(void);
 void usage(void);
 void parseOptions(int argc, char **argv, char *filename, char *seq1Name,
                   char *seq2Name, stHash *intervalsHashn, int64_t *bin_start,
-                  int64_t *bin_end, int64_t *bin_length);
+                  int64_t *bin_end, int64_t *bin_length, unsigned *numThreads);
 void reportResults(char *seq1, char *seq2, stHash *seq1Hash, stHash *seq2Hash,
                    uint64_t *alignedPositions);
 void reportResultsRegion(char *seq1, char *seq2, stHash *seq1Hash,
@@ -33,6 +33,7 @@
 #include <string.h>
 #include "common.h"
 #include "sharedMaf.h"
+#include "parallel.h"
 #include "mafPairCoverageAPI.h"
 #include "bioioC.h" // benLine()
 
@@ -249,6 +250,11 @@ void compareLines(mafLine_t *ml1, mafLine_t *ml2, stHash *seq1Hash,
     uint64_t pos1, pos2;
     int strand1, strand2;
     quickSetup(ml1, ml2, &pos1, &pos2, &strand1, &strand2);
+    // positions only step by one down the line, so the cursors walk the
+    // intervals instead of searching them for every column
+    intervalsCursor_t cursor1, cursor2;
+    intervals_initCursor(&cursor1, stHash_search(intervalsHash, seqName1));
+    intervals_initCursor(&cursor2, stHash_search(intervalsHash, seqName2));
     uint64_t offset = 0;
     for (uint64_t i = 0; i < n; ++i) {
       pos1 += strand1;
@@ -259,14 +265,14 @@ void compareLines(mafLine_t *ml1, mafLine_t *ml2, stHash *seq1Hash,
         ++(mcct2->count);
         binContainer_incrementPosition(bin_container,
                                        s1_start + offset * strand);
-        if (inInterval(intervalsHash, seqName1, pos1)) {
+        if (intervals_cursorContains(&cursor1, pos1)) {
           // seq 1 is in the interval
           ++(mcct1->inRegion);
         } else {
           // seq 1 is not in the interval
           ++(mcct1->outRegion);
         }
-        if (inInterval(intervalsHash, seqName2, pos2)) {
+        if (intervals_cursorContains(&cursor2, pos2)) {
           // seq 2 is in the interval
           ++(mcct2->inRegion);
         } else {
@@ -382,6 +388,98 @@ void processBody(mafFileApi_t *mfa, char *seq1, char *seq2, stHash *seq1Hash,
   }
 }
 
+void mergeCoverageCounts(stHash *seqHash, stHash *other) {
+  // add the counts in other to those in seqHash, as if the alignment that
+  // produced other had been read after the one that produced seqHash.
+  stHashIterator *hit = stHash_getIterator(other);
+  char *key = NULL;
+  while ((key = stHash_getNext(hit)) != NULL) {
+    mafCoverageCount_t *from = stHash_search(other, key);
+    mafCoverageCount_t *mcct = stHash_search(seqHash, key);
+    if (mcct == NULL) {
+      mcct = createMafCoverageCount();
+      mcct->sourceLength = from->sourceLength;
+      stHash_insert(seqHash, stString_copy(key), mcct);
+    }
+    assert(mcct->sourceLength == from->sourceLength);
+    mcct->observedLength += from->observedLength;
+    mcct->count += from->count;
+    mcct->inRegion += from->inRegion;
+    mcct->outRegion += from->outRegion;
+  }
+  stHash_destructIterator(hit);
+}
+void binContainer_merge(BinContainer *bc, BinContainer *other) {
+  if (bc == NULL || bc->bins == NULL) {
+    return;
+  }
+  assert(bc->num_bins == other->num_bins);
+  for (int64_t i = 0; i < bc->num_bins; ++i) {
+    bc->bins[i] += other->bins[i];
+  }
+}
+typedef struct shardCoverage {
+  // per worker accumulators for processShards()
+  char **shards;
+  char *seq1;
+  char *seq2;
+  stHash *intervalsHash; // shared, only ever read
+  stHash **seq1Hashes;
+  stHash **seq2Hashes;
+  uint64_t *alignedPositions;
+  BinContainer **bcs;
+} shardCoverage_t;
+static void processShard(uint64_t i, unsigned worker, void *data) {
+  shardCoverage_t *sc = (shardCoverage_t *) data;
+  uint64_t alignedPositions = 0;
+  mafFileApi_t *mfa = maf_newMfa(sc->shards[i], "r");
+  processBody(mfa, sc->seq1, sc->seq2, sc->seq1Hashes[worker], sc->seq2Hashes[worker],
+              &alignedPositions, sc->intervalsHash, sc->bcs[worker]);
+  maf_destroyMfa(mfa);
+  sc->alignedPositions[worker] += alignedPositions;
+}
+void processShards(char **shards, unsigned numShards, unsigned numThreads,
+                   char *seq1, char *seq2, stHash *seq1Hash, stHash *seq2Hash,
+                   uint64_t *alignedPositions, stHash *intervalsHash,
+                   BinContainer *bin_container) {
+  // processBody() for a maf split into shards, up to numThreads shards at a
+  // time. Each worker counts into its own hashes and bins, which are summed
+  // into the caller's once every shard has been read.
+  unsigned numWorkers = parallel_numberOfWorkers(numThreads, numShards);
+  shardCoverage_t sc;
+  sc.shards = shards;
+  sc.seq1 = seq1;
+  sc.seq2 = seq2;
+  sc.intervalsHash = intervalsHash;
+  sc.seq1Hashes = (stHash **) st_malloc(sizeof(stHash *) * numWorkers);
+  sc.seq2Hashes = (stHash **) st_malloc(sizeof(stHash *) * numWorkers);
+  sc.alignedPositions = (uint64_t *) st_calloc(numWorkers, sizeof(uint64_t));
+  sc.bcs = (BinContainer **) st_malloc(sizeof(BinContainer *) * numWorkers);
+  for (unsigned w = 0; w < numWorkers; ++w) {
+    sc.seq1Hashes[w] = stHash_construct3(stHash_stringKey, stHash_stringEqualKey, free, free);
+    sc.seq2Hashes[w] = stHash_construct3(stHash_stringKey, stHash_stringEqualKey, free, free);
+    sc.bcs[w] = NULL;
+    if (bin_container != NULL && bin_container->bins != NULL) {
+      sc.bcs[w] = binContainer_construct(bin_container->bin_start, bin_container->bin_end,
+                                         bin_container->bin_length);
+    }
+  }
+  parallel_for(numShards, numWorkers, processShard, &sc);
+  *alignedPositions = 0;
+  for (unsigned w = 0; w < numWorkers; ++w) {
+    mergeCoverageCounts(seq1Hash, sc.seq1Hashes[w]);
+    mergeCoverageCounts(seq2Hash, sc.seq2Hashes[w]);
+    *alignedPositions += sc.alignedPositions[w];
+    binContainer_merge(bin_container, sc.bcs[w]);
+    stHash_destruct(sc.seq1Hashes[w]);
+    stHash_destruct(sc.seq2Hashes[w]);
+    binContainer_destruct(sc.bcs[w]);
+  }
+  free(sc.seq1Hashes);
+  free(sc.seq2Hashes);
+  free(sc.alignedPositions);
+  free(sc.bcs);
+}
 
 void parseBedFile(const char *filepath, stHash *intervalsHash) {
   /*
@@ -391,7 +489,7 @@ void parseBedFile(const char *filepath, stHash *intervalsHash) {
    * takes a filepath and the intervalsHash, opens and reads the file,
    * adding intervals taken from each bed line to the intervalsHash.
    * intervals hash is keyed with the name of the sequence and valued with
-   * a st_sortedset
+   * an intervals_t
    */
   FILE *fileHandle = fopen(filepath, "r");
   st_logDebug("Parsing the bed file: %s\n", filepath);
@@ -417,81 +515,42 @@ void parseBedFile(const char *filepath, stHash *intervalsHash) {
                 "sequence_name\tstart\tend\n", filepath);
         exit(EXIT_FAILURE);
       }
-      stSortedSet *intervals = stHash_search(intervalsHash, cA3);
+      if (start < 0 || stop < start) {
+        st_errAbort("Found a bad interval in the bed file %s: %s %" PRIi64
+                    " %" PRIi64 "", filepath, cA3, start, stop);
+      }
+      intervals_t *intervals = stHash_search(intervalsHash, cA3);
       if (intervals == NULL) {
-        intervals = stSortedSet_construct3(
-                                           (int(*)(const void *, const void *))
-                                           stIntTuple_cmpFn,
-                                           (void(*)(void *))
-                                           stIntTuple_destruct);
+        intervals = intervals_new();
         stHash_insert(intervalsHash, stString_copy(cA3), intervals);
       }
-      stIntTuple *j = stIntTuple_construct2(start, stop);
-      stIntTuple *k = stSortedSet_searchLessThanOrEqual(intervals, j);
-      if (k != NULL) {
-        if (stIntTuple_get(k, 1) > start) {
-          st_errAbort(
-                      "Found an overlapping interval in the bed file: %s "
-                      "%" PRIi64 " "
-                      "%" PRIi64 " overlaps %s %" PRIi64 " %" PRIi64 "",
-                      cA3, start, stop, cA2,
-                      stIntTuple_get(k, 0),
-                      stIntTuple_get(k, 1));
-        }
-      }
-      k = stSortedSet_searchGreaterThanOrEqual(intervals, j);
-      if (k != NULL) {
-        if (stIntTuple_get(k, 1) < stop) {
-          st_errAbort(
-                      "Found an overlapping interval in the bed file: %s "
-                      "%" PRIi64 " "
-                      "%" PRIi64 " overlaps %s %" PRIi64 " %" PRIi64 "",
-                      cA3, start, stop, cA2,
-                      stIntTuple_get(k, 0),
-                      stIntTuple_get(k, 1));
-        }
-      }
-      assert(stSortedSet_search(intervals, j) == NULL);
       st_logDebug("Adding in an interval: %s %" PRIi64 " %" PRIi64 "\n",
                   cA3, start, stop);
-      stSortedSet_insert(intervals, j);
+      intervals_add(intervals, start, stop);
       free(cA3);
     }
     bytesRead = benLine(&cA2, &nBytes, fileHandle);
   }
   free(cA2);
   fclose(fileHandle);
+  // sorted and merged for lookups, overlaps with the intervals of earlier
+  // files are errors too
+  stHashIterator *hit = stHash_getIterator(intervalsHash);
+  char *seq = NULL;
+  while ((seq = stHash_getNext(hit)) != NULL) {
+    if (!intervals_finish(stHash_search(intervalsHash, seq))) {
+      st_errAbort("Found an overlapping interval in the bed file: %s, on %s",
+                  filepath, seq);
+    }
+  }
+  stHash_destructIterator(hit);
   st_logDebug("Finished parsing the bed file: %s\n", filepath);
 }
 
 
 bool inInterval(stHash *intervalsHash, char *seq, uint64_t pos) {
-  /*
-   * WARNING WARNING WARNING WARNING WARNING WARNING WARNING WARNING WARNING
-   * This function is copy pasta from mafComparatator/src/comparatorAPI.c
-   * WARNING WARNING WARNING WARNING WARNING WARNING WARNING WARNING WARNING
-   * check to see if the sequence and position are within the intervals hash.
-   *
-   */
-  stSortedSet *intervals = stHash_search(intervalsHash, seq);
-  if (intervals == NULL) {
-    // printf("%s %" PRIu64 " is not in the region, bad seq.\n", seq, pos);
-    return false;
-  }
-  stIntTuple *i = stIntTuple_construct2( pos, INT64_MAX);
-  stIntTuple *j = stSortedSet_searchLessThanOrEqual(intervals, i);
-  stIntTuple_destruct(i);
-  if (j == NULL) {
-    // printf("%s %" PRIu64 " is not in the region, bad pos.\n", seq, pos);
-    return false;
-  }
-  assert(stIntTuple_length(j) == 2);
-  /* if (stIntTuple_get(j, 0) <= pos && pos < stIntTuple_get(j, 1)) { */
-  /*      printf("%s %" PRIu64 " IS in the region.\n", seq, pos); */
-  /* } else { */
-  /*     printf("%s %" PRIu64 " IS NOT in the region.\n", seq, pos); */
-  /* } */
-  return stIntTuple_get(j, 0) <= pos && pos < stIntTuple_get(j, 1);
+  // check to see if the sequence and position are within the intervals hash.
+  return intervals_contains(stHash_search(intervalsHash, seq), pos);
 }
 
 BinContainer* binContainer_init(void) {
@@ -30,6 +30,7 @@
 #include <inttypes.h>
 #include "common.h"
 #include "sharedMaf.h"
+#include "intervals.h"
 #include "sonLib.h"
 #include "mafPairCoverage.h"
 
@@ -73,6 +74,12 @@ void processBody(mafFileApi_t *mfa, char *seq1, char *seq2, stHash *seq1Hash,
                  stHash *seq2Hash,
                  uint64_t *alignedPositions, stHash *intervalsHash,
                  BinContainer *bc);
+void processShards(char **shards, unsigned numShards, unsigned numThreads,
+                   char *seq1, char *seq2, stHash *seq1Hash, stHash *seq2Hash,
+                   uint64_t *alignedPositions, stHash *intervalsHash,
+                   BinContainer *bc);
+void mergeCoverageCounts(stHash *seqHash, stHash *other);
+void binContainer_merge(BinContainer *bc, BinContainer *other);
 void parseBedFile(const char *filepath, stHash *intervalsHash);
 void reportResultsBins(char *seq1, char *seq2, BinContainer *bin_container);
 BinContainer* binContainer_init(void);
@@ -144,12 +144,11 @@ static void test_compareLines_1(CuTest *testCase) {
 static void test_intervalCheck_0(CuTest *testCase) {
   // make sure that the hash is being correctly populated
   // test case 0
-  stHash *intervalsHash = stHash_construct3(stHash_stringKey, stHash_stringEqualKey, free, (void(*)(void *)) stSortedSet_destruct);
-  stSortedSet *intervals = stSortedSet_construct3((int(*)(const void *, const void*)) stIntTuple_cmpFn,
-                                                  (void(*)(void *)) stIntTuple_destruct);
+  stHash *intervalsHash = stHash_construct3(stHash_stringKey, stHash_stringEqualKey, free, (void(*)(void *)) intervals_destroy);
+  intervals_t *intervals = intervals_new();
   stHash_insert(intervalsHash, stString_copy("hg19.chr19"), intervals);
-  stIntTuple *t = stIntTuple_construct2(123480, 123485);
-  stSortedSet_insert(intervals, t);
+  intervals_add(intervals, 123480, 123485);
+  intervals_finish(intervals);
   for (int i = 123480; i < 123485; ++i) {
     CuAssertTrue(testCase, inInterval(intervalsHash, "hg19.chr19", i) == true);
   }
@@ -159,18 +158,9 @@ static void test_intervalCheck_0(CuTest *testCase) {
   CuAssertTrue(testCase, inInterval(intervalsHash, "hg19", 123482) == false);
   stHash_destruct(intervalsHash);
 }
-static void displayIntTuple(stIntTuple *t) {
-  if (t != NULL) {
-    printf("%" PRIi64 " %" PRIi64 "\n", stIntTuple_get(t, 0), stIntTuple_get(t, 1));
-  } else {
-    printf("NULL\n");
-  }
-}
-static void displaySortedSet(stSortedSet *s) {
-  stSortedSetIterator *sit = stSortedSet_getIterator(s);
-  stIntTuple *t = NULL;
-  while ((t = stSortedSet_getNext(sit)) != NULL) {
-    displayIntTuple(t);
+static void displayIntervals(intervals_t *iv) {
+  for (uint64_t i = 0; i < intervals_getNumber(iv); ++i) {
+    printf("%" PRIu64 " %" PRIu64 "\n", iv->starts[i], iv->ends[i]);
   }
 }
 static void test_compareLines_region_0(CuTest *testCase) {
@@ -187,13 +177,11 @@ static void test_compareLines_region_0(CuTest *testCase) {
                                        stHash_stringEqualKey, free, free);
   stHash *intervalsHash = stHash_construct3(stHash_stringKey,
                                             stHash_stringEqualKey,
-                                            free, (void(*)(void *)) stSortedSet_destruct);
-  stSortedSet *intervals = stSortedSet_construct3((int(*)(const void *, const void*)) stIntTuple_cmpFn,
-                                                  (void(*)(void *)) stIntTuple_destruct);
+                                            free, (void(*)(void *)) intervals_destroy);
+  intervals_t *intervals = intervals_new();
   stHash_insert(intervalsHash, stString_copy("hg19.chr19"), intervals);
-  stIntTuple *t = stIntTuple_construct2(123480, 123485);
-  stIntTuple *q = stIntTuple_construct2(123482, 123484);
-  stSortedSet_insert(intervals, t);
+  intervals_add(intervals, 123480, 123485);
+  intervals_finish(intervals);
   uint64_t alignedPositions = 0;
   mafCoverageCount_t *mcct1 = createMafCoverageCount();
   mafCoverageCount_t *mcct2 = createMafCoverageCount();
@@ -207,11 +195,10 @@ static void test_compareLines_region_0(CuTest *testCase) {
   CuAssertTrue(testCase, stHash_search(seq1Hash, "hg19.chr19") != NULL);
   CuAssertTrue(testCase, stHash_search(seq2Hash, "mm9.chr1") != NULL);
   CuAssertTrue(testCase, stHash_search(seq2Hash, "bannana") == NULL);
-  stSortedSet *intSet = stHash_search(intervalsHash, "hg19.chr19");
+  intervals_t *intSet = stHash_search(intervalsHash, "hg19.chr19");
   CuAssertTrue(testCase, intSet != NULL);
-  stIntTuple *u = stSortedSet_search(intSet, q);
-  CuAssertTrue(testCase, u == NULL);
-  free(q);
+  CuAssertTrue(testCase, intervals_getNumber(intSet) == 1);
+  CuAssertTrue(testCase, intervals_getTotalLength(intSet) == 5);
   CuAssertTrue(testCase, mafCoverageCount_getInRegion(mcct1) == 4);
   CuAssertTrue(testCase, mafCoverageCount_getOutRegion(mcct1) == 9);
   CuAssertTrue(testCase, mafCoverageCount_getInRegion(mcct2) == 0);
@@ -238,12 +225,11 @@ static void test_binning_0(CuTest *testCase) {
                                        stHash_stringEqualKey, free, free);
   stHash *intervalsHash = stHash_construct3(stHash_stringKey,
                                             stHash_stringEqualKey,
-                                            free, (void(*)(void *)) stSortedSet_destruct);
-  stSortedSet *intervals = stSortedSet_construct3((int(*)(const void *, const void*)) stIntTuple_cmpFn,
-                                                  (void(*)(void *)) stIntTuple_destruct);
+                                            free, (void(*)(void *)) intervals_destroy);
+  intervals_t *intervals = intervals_new();
   stHash_insert(intervalsHash, stString_copy("hg19.chr19"), intervals);
-  stIntTuple *t = stIntTuple_construct2(123480, 123485);
-  stSortedSet_insert(intervals, t);
+  intervals_add(intervals, 123480, 123485);
+  intervals_finish(intervals);
   uint64_t alignedPositions = 0;
   mafCoverageCount_t *mcct1 = createMafCoverageCount();
   mafCoverageCount_t *mcct2 = createMafCoverageCount();
@@ -286,12 +272,11 @@ static void test_binning_1(CuTest *testCase) {
                                        stHash_stringEqualKey, free, free);
   stHash *intervalsHash = stHash_construct3(stHash_stringKey,
                                             stHash_stringEqualKey,
-                                            free, (void(*)(void *)) stSortedSet_destruct);
-  stSortedSet *intervals = stSortedSet_construct3((int(*)(const void *, const void*)) stIntTuple_cmpFn,
-                                                  (void(*)(void *)) stIntTuple_destruct);
+                                            free, (void(*)(void *)) intervals_destroy);
+  intervals_t *intervals = intervals_new();
   stHash_insert(intervalsHash, stString_copy("hg19.chr19"), intervals);
-  stIntTuple *t = stIntTuple_construct2(123480, 123485);
-  stSortedSet_insert(intervals, t);
+  intervals_add(intervals, 123480, 123485);
+  intervals_finish(intervals);
   uint64_t alignedPositions = 0;
   mafCoverageCount_t *mcct1 = createMafCoverageCount();
   mafCoverageCount_t *mcct2 = createMafCoverageCount();
@@ -329,12 +314,11 @@ static void test_binning_2(CuTest *testCase) {
                                        stHash_stringEqualKey, free, free);
   stHash *intervalsHash = stHash_construct3(stHash_stringKey,
                                             stHash_stringEqualKey,
-                                            free, (void(*)(void *)) stSortedSet_destruct);
-  stSortedSet *intervals = stSortedSet_construct3((int(*)(const void *, const void*)) stIntTuple_cmpFn,
-                                                  (void(*)(void *)) stIntTuple_destruct);
+                                            free, (void(*)(void *)) intervals_destroy);
+  intervals_t *intervals = intervals_new();
   stHash_insert(intervalsHash, stString_copy("hg19.chr19"), intervals);
-  stIntTuple *t = stIntTuple_construct2(123480, 123485);
-  stSortedSet_insert(intervals, t);
+  intervals_add(intervals, 123480, 123485);
+  intervals_finish(intervals);
   uint64_t alignedPositions = 0;
   mafCoverageCount_t *mcct1 = createMafCoverageCount();
   mafCoverageCount_t *mcct2 = createMafCoverageCount();
@@ -378,12 +362,11 @@ static void test_binning_3(CuTest *testCase) {
                                        stHash_stringEqualKey, free, free);
   stHash *intervalsHash = stHash_construct3(stHash_stringKey,
                                             stHash_stringEqualKey,
-                                            free, (void(*)(void *)) stSortedSet_destruct);
-  stSortedSet *intervals = stSortedSet_construct3((int(*)(const void *, const void*)) stIntTuple_cmpFn,
-                                                  (void(*)(void *)) stIntTuple_destruct);
+                                            free, (void(*)(void *)) intervals_destroy);
+  intervals_t *intervals = intervals_new();
   stHash_insert(intervalsHash, stString_copy("hg19.chr19"), intervals);
-  stIntTuple *t = stIntTuple_construct2(123480, 123485);
-  stSortedSet_insert(intervals, t);
+  intervals_add(intervals, 123480, 123485);
+  intervals_finish(intervals);
   uint64_t alignedPositions = 0;
   mafCoverageCount_t *mcct1 = createMafCoverageCount();
   mafCoverageCount_t *mcct2 = createMafCoverageCount();
@@ -428,12 +411,11 @@ static void test_binning_4(CuTest *testCase) {
                                        stHash_stringEqualKey, free, free);
   stHash *intervalsHash = stHash_construct3(stHash_stringKey,
                                             stHash_stringEqualKey,
-                                            free, (void(*)(void *)) stSortedSet_destruct);
-  stSortedSet *intervals = stSortedSet_construct3((int(*)(const void *, const void*)) stIntTuple_cmpFn,
-                                                  (void(*)(void *)) stIntTuple_destruct);
+                                            free, (void(*)(void *)) intervals_destroy);
+  intervals_t *intervals = intervals_new();
   stHash_insert(intervalsHash, stString_copy("hg19.chr19"), intervals);
-  stIntTuple *t = stIntTuple_construct2(123480, 123485);
-  stSortedSet_insert(intervals, t);
+  intervals_add(intervals, 123480, 123485);
+  intervals_finish(intervals);
   uint64_t alignedPositions = 0;
   mafCoverageCount_t *mcct1 = createMafCoverageCount();
   mafCoverageCount_t *mcct2 = createMafCoverageCount();
@@ -477,12 +459,11 @@ static void test_binning_5(CuTest *testCase) {
                                        stHash_stringEqualKey, free, free);
   stHash *intervalsHash = stHash_construct3(stHash_stringKey,
                                             stHash_stringEqualKey,
-                                            free, (void(*)(void *)) stSortedSet_destruct);
-  stSortedSet *intervals = stSortedSet_construct3((int(*)(const void *, const void*)) stIntTuple_cmpFn,
-                                                  (void(*)(void *)) stIntTuple_destruct);
+                                            free, (void(*)(void *)) intervals_destroy);
+  intervals_t *intervals = intervals_new();
   stHash_insert(intervalsHash, stString_copy("hg19.chr19"), intervals);
-  stIntTuple *t = stIntTuple_construct2(123480, 123485);
-  stSortedSet_insert(intervals, t);
+  intervals_add(intervals, 123480, 123485);
+  intervals_finish(intervals);
   uint64_t alignedPositions = 0;
   mafCoverageCount_t *mcct1 = createMafCoverageCount();
   mafCoverageCount_t *mcct2 = createMafCoverageCount();
@@ -523,12 +504,11 @@ static void test_binning_6(CuTest *testCase) {
                                        stHash_stringEqualKey, free, free);
   stHash *intervalsHash = stHash_construct3(stHash_stringKey,
                                             stHash_stringEqualKey,
-                                            free, (void(*)(void *)) stSortedSet_destruct);
-  stSortedSet *intervals = stSortedSet_construct3((int(*)(const void *, const void*)) stIntTuple_cmpFn,
-                                                  (void(*)(void *)) stIntTuple_destruct);
+                                            free, (void(*)(void *)) intervals_destroy);
+  intervals_t *intervals = intervals_new();
   stHash_insert(intervalsHash, stString_copy("hg19.chr19"), intervals);
-  stIntTuple *t = stIntTuple_construct2(123480, 123485);
-  stSortedSet_insert(intervals, t);
+  intervals_add(intervals, 123480, 123485);
+  intervals_finish(intervals);
   uint64_t alignedPositions = 0;
   mafCoverageCount_t *mcct1 = createMafCoverageCount();
   mafCoverageCount_t *mcct2 = createMafCoverageCount();
@@ -572,12 +552,11 @@ static void test_binning_7(CuTest *testCase) {
                                        stHash_stringEqualKey, free, free);
   stHash *intervalsHash = stHash_construct3(stHash_stringKey,
                                             stHash_stringEqualKey,
-                                            free, (void(*)(void *)) stSortedSet_destruct);
-  stSortedSet *intervals = stSortedSet_construct3((int(*)(const void *, const void*)) stIntTuple_cmpFn,
-                                                  (void(*)(void *)) stIntTuple_destruct);
+                                            free, (void(*)(void *)) intervals_destroy);
+  intervals_t *intervals = intervals_new();
   stHash_insert(intervalsHash, stString_copy("hg19.chr19"), intervals);
-  stIntTuple *t = stIntTuple_construct2(123480, 123485);
-  stSortedSet_insert(intervals, t);
+  intervals_add(intervals, 123480, 123485);
+  intervals_finish(intervals);
   uint64_t alignedPositions = 0;
   mafCoverageCount_t *mcct1 = createMafCoverageCount();
   mafCoverageCount_t *mcct2 = createMafCoverageCount();
@@ -624,12 +603,11 @@ static void test_binning_8(CuTest *testCase) {
                                        stHash_stringEqualKey, free, free);
   stHash *intervalsHash = stHash_construct3(stHash_stringKey,
                                             stHash_stringEqualKey,
-                                            free, (void(*)(void *)) stSortedSet_destruct);
-  stSortedSet *intervals = stSortedSet_construct3((int(*)(const void *, const void*)) stIntTuple_cmpFn,
-                                                  (void(*)(void *)) stIntTuple_destruct);
+                                            free, (void(*)(void *)) intervals_destroy);
+  intervals_t *intervals = intervals_new();
   stHash_insert(intervalsHash, stString_copy("hg19.chr19"), intervals);
-  stIntTuple *t = stIntTuple_construct2(123480, 123485);
-  stSortedSet_insert(intervals, t);
+  intervals_add(intervals, 123480, 123485);
+  intervals_finish(intervals);
   uint64_t alignedPositions = 0;
   mafCoverageCount_t *mcct1 = createMafCoverageCount();
   mafCoverageCount_t *mcct2 = createMafCoverageCount();
@@ -672,12 +650,11 @@ static void test_binning_9(CuTest *testCase) {
                                        stHash_stringEqualKey, free, free);
   stHash *intervalsHash = stHash_construct3(stHash_stringKey,
                                             stHash_stringEqualKey,
-                                            free, (void(*)(void *)) stSortedSet_destruct);
-  stSortedSet *intervals = stSortedSet_construct3((int(*)(const void *, const void*)) stIntTuple_cmpFn,
-                                                  (void(*)(void *)) stIntTuple_destruct);
+                                            free, (void(*)(void *)) intervals_destroy);
+  intervals_t *intervals = intervals_new();
   stHash_insert(intervalsHash, stString_copy("hg19.chr19"), intervals);
-  stIntTuple *t = stIntTuple_construct2(123480, 123485);
-  stSortedSet_insert(intervals, t);
+  intervals_add(intervals, 123480, 123485);
+  intervals_finish(intervals);
   uint64_t alignedPositions = 0;
   mafCoverageCount_t *mcct1 = createMafCoverageCount();
   mafCoverageCount_t *mcct2 = createMafCoverageCount();
@@ -722,12 +699,11 @@ static void test_binning_10(CuTest *testCase) {
                                        stHash_stringEqualKey, free, free);
   stHash *intervalsHash = stHash_construct3(stHash_stringKey,
                                             stHash_stringEqualKey,
-                                            free, (void(*)(void *)) stSortedSet_destruct);
-  stSortedSet *intervals = stSortedSet_construct3((int(*)(const void *, const void*)) stIntTuple_cmpFn,
-                                                  (void(*)(void *)) stIntTuple_destruct);
+                                            free, (void(*)(void *)) intervals_destroy);
+  intervals_t *intervals = intervals_new();
   stHash_insert(intervalsHash, stString_copy("hg19.chr19"), intervals);
-  stIntTuple *t = stIntTuple_construct2(123480, 123485);
-  stSortedSet_insert(intervals, t);
+  intervals_add(intervals, 123480, 123485);
+  intervals_finish(intervals);
   uint64_t alignedPositions = 0;
   mafCoverageCount_t *mcct1 = createMafCoverageCount();
   mafCoverageCount_t *mcct2 = createMafCoverageCount();
@@ -774,12 +750,11 @@ static void test_binning_11(CuTest *testCase) {
                                        stHash_stringEqualKey, free, free);
   stHash *intervalsHash = stHash_construct3(stHash_stringKey,
                                             stHash_stringEqualKey,
-                                            free, (void(*)(void *)) stSortedSet_destruct);
-  stSortedSet *intervals = stSortedSet_construct3((int(*)(const void *, const void*)) stIntTuple_cmpFn,
-                                                  (void(*)(void *)) stIntTuple_destruct);
+                                            free, (void(*)(void *)) intervals_destroy);
+  intervals_t *intervals = intervals_new();
   stHash_insert(intervalsHash, stString_copy("hg19.chr19"), intervals);
-  stIntTuple *t = stIntTuple_construct2(123480, 123485);
-  stSortedSet_insert(intervals, t);
+  intervals_add(intervals, 123480, 123485);
+  intervals_finish(intervals);
   uint64_t alignedPositions = 0;
   mafCoverageCount_t *mcct1 = createMafCoverageCount();
   mafCoverageCount_t *mcct2 = createMafCoverageCount();
@@ -832,12 +807,11 @@ static void test_binning_12(CuTest *testCase) {
                                        stHash_stringEqualKey, free, free);
   stHash *intervalsHash = stHash_construct3(stHash_stringKey,
                                             stHash_stringEqualKey,
-                                            free, (void(*)(void *)) stSortedSet_destruct);
-  stSortedSet *intervals = stSortedSet_construct3((int(*)(const void *, const void*)) stIntTuple_cmpFn,
-                                                  (void(*)(void *)) stIntTuple_destruct);
+                                            free, (void(*)(void *)) intervals_destroy);
+  intervals_t *intervals = intervals_new();
   stHash_insert(intervalsHash, stString_copy("hg19.chr19"), intervals);
-  stIntTuple *t = stIntTuple_construct2(123480, 123485);
-  stSortedSet_insert(intervals, t);
+  intervals_add(intervals, 123480, 123485);
+  intervals_finish(intervals);
   uint64_t alignedPositions = 0;
   mafCoverageCount_t *mcct1 = createMafCoverageCount();
   mafCoverageCount_t *mcct2 = createMafCoverageCount();
@@ -876,7 +850,7 @@ static void test_binning_12(CuTest *testCase) {
 CuSuite* pairCoverage_TestSuite(void) {
   CuSuite* suite = CuSuiteNew();
   (void) BinContents;
-  (void) displaySortedSet;
+  (void) displayIntervals;
   (void) test_is_wild_0;
   (void) test_searchMatched_0;
   (void) test_compareLines_0;
@@ -30,6 +30,10 @@
 #include "common.h"
 #include "blockTree.h"
 
+// Trees kept by a TreeCache before it starts over, bounding its memory
+// when nearly every block has a tree of its own.
+static const int64_t kTreeCacheMaxTrees = 1024;
+
 // Get the gene tree from the block start. If there is no species
 // tree in the line, raise an error.
 // Trees (at least for now) must be quoted.
@@ -108,51 +112,210 @@ stTree *getMRCA(stTree *node1, stTree *node2) {
     return ret;
 }
 
-// For use in a set containing rows from only one sequence, so
-// comparing sequence strings is not necessary.
-int BlockRow_cmp(const BlockRow *row1, const BlockRow *row2) {
-    assert(strcmp(row1->species, row2->species) == 0);
-    if (row2->start > row1->start) {
-        return -1;
-    } else if (row2->start == row1->start) {
-        return 0;
-    } else {
-        return 1;
+static int64_t countNodes(stTree *node) {
+    int64_t n = 1;
+    for (int64_t i = 0; i < stTree_getChildNumber(node); i++) {
+        n += countNodes(stTree_getChild(node, i));
     }
+    return n;
 }
 
-void BlockRow_destruct(BlockRow *row) {
-    free(row->species);
-    free(row);
+// Number the nodes below node in pre-order, walking the Euler tour and
+// listing them in post-order as we go.
+static int64_t visitNodes(ParsedTree *pt, stTree *node, int64_t *next, int64_t *tourPos, int64_t *postPos) {
+    int64_t index = (*next)++;
+    pt->nodes[index] = node;
+    stHash_insert(pt->nodeToIndex, node, pt->nodes + index);
+    pt->first[index] = *tourPos;
+    pt->sparse[0][(*tourPos)++] = (int32_t) index;
+    for (int64_t i = 0; i < stTree_getChildNumber(node); i++) {
+        visitNodes(pt, stTree_getChild(node, i), next, tourPos, postPos);
+        pt->sparse[0][(*tourPos)++] = (int32_t) index;
+    }
+    pt->subtreeEnd[index] = *next;
+    pt->postOrder[(*postPos)++] = index;
+    if (stTree_getChildNumber(node) == 0) {
+        pt->leafPostOrder[pt->numLeaves++] = index;
+    }
+    return index;
 }
 
-stTree *getNodeFromPosition(stHash *seqToBlockRows, const char *seq, uint64_t pos) {
-    stSortedSet *blockRows = stHash_search(seqToBlockRows, (void *) seq);
-    if (blockRows == NULL) {
-        return NULL;
+ParsedTree *parsedTree_construct(stTree *tree) {
+    ParsedTree *pt = st_malloc(sizeof(ParsedTree));
+    pt->tree = tree;
+    pt->numNodes = countNodes(tree);
+    pt->nodes = st_malloc(sizeof(stTree *) * pt->numNodes);
+    pt->subtreeEnd = st_malloc(sizeof(int64_t) * pt->numNodes);
+    pt->postOrder = st_malloc(sizeof(int64_t) * pt->numNodes);
+    pt->leafPostOrder = st_malloc(sizeof(int64_t) * pt->numNodes);
+    pt->numLeaves = 0;
+    pt->first = st_malloc(sizeof(int64_t) * pt->numNodes);
+    pt->tourLength = 2 * pt->numNodes - 1;
+    pt->numLevels = 64 - __builtin_clzll(pt->tourLength);
+    pt->sparse = st_malloc(sizeof(int32_t *) * pt->numLevels);
+    pt->sparse[0] = st_malloc(sizeof(int32_t) * pt->tourLength);
+    pt->nodeToIndex = stHash_construct();
+    pt->nameToNode = NULL;
+    int64_t next = 0, tourPos = 0, postPos = 0;
+    visitNodes(pt, tree, &next, &tourPos, &postPos);
+    assert(tourPos == pt->tourLength);
+    for (int64_t k = 1; k < pt->numLevels; k++) {
+        int64_t half = (int64_t) 1 << (k - 1);
+        int64_t n = pt->tourLength - 2 * half + 1;
+        pt->sparse[k] = st_malloc(sizeof(int32_t) * n);
+        for (int64_t i = 0; i < n; i++) {
+            int32_t a = pt->sparse[k - 1][i];
+            int32_t b = pt->sparse[k - 1][i + half];
+            pt->sparse[k][i] = (a < b) ? a : b;
+        }
+    }
+    return pt;
+}
+
+void parsedTree_destruct(ParsedTree *pt) {
+    for (int64_t k = 0; k < pt->numLevels; k++) {
+        free(pt->sparse[k]);
+    }
+    free(pt->sparse);
+    free(pt->nodes);
+    free(pt->subtreeEnd);
+    free(pt->postOrder);
+    free(pt->leafPostOrder);
+    free(pt->first);
+    stHash_destruct(pt->nodeToIndex);
+    if (pt->nameToNode != NULL) {
+        stHash_destruct(pt->nameToNode);
+    }
+    stTree_destruct(pt->tree);
+    free(pt);
+}
+
+int64_t parsedTree_getIndex(ParsedTree *pt, stTree *node) {
+    stTree **entry = stHash_search(pt->nodeToIndex, node);
+    assert(entry != NULL);
+    return entry - pt->nodes;
+}
+
+// The index of the MRCA of two nodes, by their indices.
+int64_t parsedTree_getMRCA(ParsedTree *pt, int64_t index1, int64_t index2) {
+    int64_t lo = pt->first[index1];
+    int64_t hi = pt->first[index2];
+    if (lo > hi) {
+        int64_t t = lo;
+        lo = hi;
+        hi = t;
+    }
+    int64_t k = 63 - __builtin_clzll(hi - lo + 1);
+    int32_t a = pt->sparse[k][lo];
+    int32_t b = pt->sparse[k][hi - ((int64_t) 1 << k) + 1];
+    return (a < b) ? a : b;
+}
+
+stHash *parsedTree_getNameToNode(ParsedTree *pt) {
+    if (pt->nameToNode == NULL) {
+        pt->nameToNode = buildNameToNodeHash(pt->tree);
+    }
+    return pt->nameToNode;
+}
+
+// returns true if name1 is an ancestor of name2, as isAncestor() does.
+bool parsedTree_isAncestor(ParsedTree *pt, char *name1, char *name2) {
+    stHash *nameToNode = parsedTree_getNameToNode(pt);
+    stTree *tree1 = stHash_search(nameToNode, name1);
+    assert(tree1 != NULL);
+    stTree *tree2 = stHash_search(nameToNode, name2);
+    assert(tree2 != NULL);
+    int64_t index1 = parsedTree_getIndex(pt, tree1);
+    int64_t index2 = parsedTree_getIndex(pt, tree2);
+    return index1 < index2 && index2 < pt->subtreeEnd[index1];
+}
+
+TreeCache *treeCache_construct(void) {
+    TreeCache *cache = st_malloc(sizeof(TreeCache));
+    cache->trees = stHash_construct3(stHash_stringKey, stHash_stringEqualKey, free, (void (*)(void *)) parsedTree_destruct);
+    return cache;
+}
+
+void treeCache_destruct(TreeCache *cache) {
+    stHash_destruct(cache->trees);
+    free(cache);
+}
+
+// The parsed tree of a Newick string, owned by the cache. It is good
+// until the next call, which may clear the cache.
+ParsedTree *treeCache_get(TreeCache *cache, const char *newick) {
+    ParsedTree *pt = stHash_search(cache->trees, (void *) newick);
+    if (pt == NULL) {
+        if (stHash_size(cache->trees) >= kTreeCacheMaxTrees) {
+            stHash_destruct(cache->trees);
+            cache->trees = stHash_construct3(stHash_stringKey, stHash_stringEqualKey, free, (void (*)(void *)) parsedTree_destruct);
+        }
+        pt = parsedTree_construct(stTree_parseNewickString(newick));
+        stHash_insert(cache->trees, stString_copy(newick), pt);
+    }
+    return pt;
+}
+
+// Order block rows by name id, then start.
+static int blockRow_cmp(const void *a, const void *b) {
+    const BlockRow *row1 = a;
+    const BlockRow *row2 = b;
+    if (row1->nameId != row2->nameId) {
+        return (row1->nameId < row2->nameId) ? -1 : 1;
+    }
+    if (row1->start != row2->start) {
+        return (row1->start < row2->start) ? -1 : 1;
     }
+    return 0;
+}
+
+BlockRows *blockRows_construct(PairStore *names) {
+    BlockRows *blockRows = st_malloc(sizeof(BlockRows));
+    blockRows->names = names;
+    blockRows->capacity = 16;
+    blockRows->rows = st_malloc(sizeof(BlockRow) * blockRows->capacity);
+    blockRows->numRows = 0;
+    blockRows->tree = NULL;
+    return blockRows;
+}
+
+void blockRows_destruct(BlockRows *blockRows) {
+    free(blockRows->rows);
+    free(blockRows);
+}
 
-    // Need to allocate a fake interval to search for an interval
-    // containing the position. Pretty hacky.
-    BlockRow *tmp = st_malloc(sizeof(BlockRow));
-    tmp->species = stString_copy(seq);
-    tmp->start = pos;
-    tmp->end = pos + 1;
-    BlockRow *blockRow = stSortedSet_searchLessThanOrEqual(blockRows, tmp);
-    free(tmp->species);
-    free(tmp);
-    if (blockRow == NULL) {
+// The row of the block holding the position, NULL if there is
+// none. Allocates nothing.
+BlockRow *getBlockRowFromPosition(BlockRows *blockRows, uint64_t nameId, uint64_t pos) {
+    // Find the last row at or before (nameId, pos).
+    uint64_t lo = 0, hi = blockRows->numRows;
+    while (lo < hi) {
+        uint64_t mid = lo + (hi - lo) / 2;
+        BlockRow *row = blockRows->rows + mid;
+        if (row->nameId < nameId || (row->nameId == nameId && row->start <= (int64_t) pos)) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    if (lo == 0) {
         return NULL;
     }
-    if (blockRow->end > pos) {
+    BlockRow *blockRow = blockRows->rows + lo - 1;
+    if (blockRow->nameId == nameId && blockRow->end > (int64_t) pos) {
         // Found a block row with an interval containing this position.
-        return blockRow->node;
+        return blockRow;
     } else {
         // The closest interval doesn't contain this position.
         return NULL;
     }
 }
 
+stTree *getNodeFromPosition(BlockRows *blockRows, uint64_t nameId, uint64_t pos) {
+    BlockRow *blockRow = getBlockRowFromPosition(blockRows, nameId, pos);
+    return (blockRow == NULL) ? NULL : blockRow->node;
+}
+
 // fill by reversed post-order (i.e. pre-order with the order we visit
 // the children in reversed), so we can pop off the end of the list
 // rather than the start.
@@ -165,19 +328,20 @@ void fillListByReversePostOrder(stTree *tree, stList *list, bool onlyLeaves) {
     }
 }
 
-// Get a hash from seq -> stSortedSet that contains BlockRow
-// structs. (kind of a poor man's map so that intervals can be mapped
-// to tree nodes.)  The tree should correspond to the rows in the
+// Fill blockRows with the rows of the block (kind of a poor man's map
+// so that intervals can be mapped to tree nodes), replacing the rows
+// of the block before. The tree should correspond to the rows in the
 // block in post-order, using only the leaves if onlyLeaves is true,
 // otherwise ancestors must be present.
-stHash *getSeqToBlockRows(mafBlock_t *block, stTree *tree, bool onlyLeaves) {
-    stHash *ret = stHash_construct3(stHash_stringKey, stHash_stringEqualKey, free, (void(*)(void *)) stSortedSet_destruct);
-    // Walk through the block and assign rows to nodes in a post-order fashion.
-    stList *nodes = stList_construct();
-    // Reverse post-order because we need to pop off the end of the
-    // list for efficiency reasons.
-    fillListByReversePostOrder(tree, nodes, onlyLeaves);
-    st_logDebug("Found %" PRIi64 " species in the block tree\n", stList_length(nodes));
+void getSeqToBlockRows(mafBlock_t *block, ParsedTree *tree, bool onlyLeaves, BlockRows *blockRows) {
+    blockRows->numRows = 0;
+    blockRows->tree = tree;
+    // Walk through the block and assign rows to nodes in a post-order
+    // fashion, using the order cached with the tree.
+    int64_t *order = onlyLeaves ? tree->leafPostOrder : tree->postOrder;
+    int64_t numNodes = onlyLeaves ? tree->numLeaves : tree->numNodes;
+    int64_t next = 0;
+    st_logDebug("Found %" PRIi64 " species in the block tree\n", numNodes);
     mafLine_t *line = maf_mafBlock_getHeadLine(block);
     for (;;) {
         st_logDebug("Processing line %" PRIi64 "\n", maf_mafLine_getLineNumber(line));
@@ -187,35 +351,37 @@ stHash *getSeqToBlockRows(mafBlock_t *block, stTree *tree, bool onlyLeaves) {
             continue;
         }
 
-        if (stList_length(nodes) == 0) {
+        if (next == numNodes) {
             st_errAbort("Error at line number %" PRIu64 ": block has more sequence rows than implied by the block tree.");
         }
-        stTree *node = stList_pop(nodes);
+        int64_t nodeIndex = order[next++];
+        stTree *node = tree->nodes[nodeIndex];
         char *header = maf_mafLine_getSpecies(line);
-        stSortedSet *sortedSet = stHash_search(ret, header);
-        if (sortedSet == NULL) {
-            // Initalize hash entry for this header.
-            sortedSet = stSortedSet_construct3((int (*)(const void *, const void *)) BlockRow_cmp, (void (*)(void *)) BlockRow_destruct);
-            stHash_insert(ret, stString_copy(header), sortedSet);
+        if (strcmp(header, stTree_getLabel(node)) != 0) {
+            st_errAbort("Error on maf line %" PRIu64 ": sequence header %s found, but %s expected. Check that the block is in post-order with respect to the tree, and use --onlyLeaves if there is no ancestral sequence in the MAF.", maf_mafLine_getLineNumber(line), header, stTree_getLabel(node));
         }
-
-        BlockRow *blockRow = st_malloc(sizeof(BlockRow));
-        blockRow->species = stString_copy(header);
-        if (maf_mafLine_getStrand(line) == '+') {
-            blockRow->start = maf_mafLine_getStart(line);
-            blockRow->end = blockRow->start + maf_mafLine_getLength(line);
-        } else {
-            // Reversed
-            blockRow->start = maf_mafLine_getSourceLength(line) - maf_mafLine_getStart(line) - maf_mafLine_getLength(line);
-            blockRow->end = blockRow->start + maf_mafLine_getLength(line);
-        }
-        assert(blockRow->start >= 0);
-        assert(blockRow->start < blockRow->end);
-        if (strcmp(blockRow->species, stTree_getLabel(node)) != 0) {
-            st_errAbort("Error on maf line %" PRIu64 ": sequence header %s found, but %s expected. Check that the block is in post-order with respect to the tree, and use --onlyLeaves if there is no ancestral sequence in the MAF.", maf_mafLine_getLineNumber(line), blockRow->species, stTree_getLabel(node));
+        // Rows of sequences that are not in the store can hold no pair.
+        int64_t nameId = pairStore_getNameId(blockRows->names, header);
+        if (nameId >= 0) {
+            if (blockRows->numRows == blockRows->capacity) {
+                blockRows->capacity *= 2;
+                blockRows->rows = realloc(blockRows->rows, sizeof(BlockRow) * blockRows->capacity);
+            }
+            BlockRow *blockRow = blockRows->rows + blockRows->numRows++;
+            blockRow->nameId = (uint64_t) nameId;
+            if (maf_mafLine_getStrand(line) == '+') {
+                blockRow->start = maf_mafLine_getStart(line);
+                blockRow->end = blockRow->start + maf_mafLine_getLength(line);
+            } else {
+                // Reversed
+                blockRow->start = maf_mafLine_getSourceLength(line) - maf_mafLine_getStart(line) - maf_mafLine_getLength(line);
+                blockRow->end = blockRow->start + maf_mafLine_getLength(line);
+            }
+            assert(blockRow->start >= 0);
+            assert(blockRow->start < blockRow->end);
+            blockRow->node = node;
+            blockRow->nodeIndex = nodeIndex;
         }
-        blockRow->node = node;
-        stSortedSet_insert(sortedSet, blockRow);
 
         if (line == maf_mafBlock_getTailLine(block)) {
             break;
@@ -223,10 +389,8 @@ stHash *getSeqToBlockRows(mafBlock_t *block, stTree *tree, bool onlyLeaves) {
             line = maf_mafLine_getNext(line);
         }
     }
-    assert(stList_length(nodes) == 0); // The # of nodes should = the
-                                       // # of rows
-    stList_destruct(nodes);
-    return ret;
+    assert(next == numNodes); // The # of nodes should = the # of rows
+    qsort(blockRows->rows, blockRows->numRows, sizeof(BlockRow), blockRow_cmp);
 }
 
 // Get a mapping from tree label to node.
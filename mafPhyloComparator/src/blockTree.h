@@ -2,24 +2,69 @@
 #define __BLOCKTREE_H_
 #include "sonLib.h"
 #include "sharedMaf.h"
+#include "comparatorPairStore.h"
 
+// A parsed tree prepared for constant time MRCA queries. Nodes are
+// numbered in pre-order, so an ancestor has a smaller index than its
+// descendants and the MRCA of two nodes is the smallest index on the
+// Euler tour between their first visits, a range minimum answered by a
+// sparse table.
+typedef struct {
+    stTree *tree;
+    int64_t numNodes;
+    stTree **nodes; // by pre-order index
+    int64_t *subtreeEnd; // one past the last pre-order index below each node
+    int64_t *postOrder; // node indices in post-order
+    int64_t *leafPostOrder; // the leaves in post-order
+    int64_t numLeaves;
+    int64_t *first; // first position of each node on the Euler tour
+    int64_t tourLength; // 2 * numNodes - 1
+    int32_t **sparse; // sparse[k][i], the smallest index on tour[i, i + 2^k)
+    int64_t numLevels;
+    stHash *nodeToIndex; // node -> its entry in nodes
+    stHash *nameToNode; // see parsedTree_getNameToNode()
+} ParsedTree;
+// Parsed trees by Newick string. Most blocks of an alignment share a
+// handful of trees, so each is parsed and prepared once.
+typedef struct {
+    stHash *trees;
+} TreeCache;
 // For mapping between sequence headers and block tree entries.
-// FIXME: don't like the name
 typedef struct {
-    char *species; // Sequence header, but want to use the same naming
-                   // convention as the rest of mafTools.
+    uint64_t nameId; // id of the sequence header in BlockRows.names
     int64_t start; // inclusive
     int64_t end; // exclusive
     stTree *node; // node in the block tree corresponding to this row
+    int64_t nodeIndex; // of node in BlockRows.tree
 } BlockRow;
+// The rows of one block as a flat array sorted by name id and start, so
+// that finding the row holding a position is a binary search. Filled
+// by getSeqToBlockRows() block after block into the same arrays.
+typedef struct {
+    PairStore *names; // hands out the name ids, rows of other names are left out. not owned
+    BlockRow *rows;
+    uint64_t numRows;
+    uint64_t capacity;
+    ParsedTree *tree; // of the block, not owned
+} BlockRows;
 
 char *parseTreeFromBlockStart(mafLine_t *line);
 stTree *getMRCA(stTree *node1, stTree *node2);
-stTree *getNodeFromPosition(stHash *seqToBlockRows, const char *seq, uint64_t pos);
-int BlockRow_cmp(const BlockRow *row1, const BlockRow *row2);
-void BlockRow_destruct(BlockRow *row);
+ParsedTree *parsedTree_construct(stTree *tree); // takes ownership of the tree
+void parsedTree_destruct(ParsedTree *pt);
+int64_t parsedTree_getIndex(ParsedTree *pt, stTree *node);
+int64_t parsedTree_getMRCA(ParsedTree *pt, int64_t index1, int64_t index2);
+stHash *parsedTree_getNameToNode(ParsedTree *pt); // built on first use, labels must be unique
+bool parsedTree_isAncestor(ParsedTree *pt, char *name1, char *name2);
+TreeCache *treeCache_construct(void);
+void treeCache_destruct(TreeCache *cache);
+ParsedTree *treeCache_get(TreeCache *cache, const char *newick);
+BlockRows *blockRows_construct(PairStore *names);
+void blockRows_destruct(BlockRows *blockRows);
+BlockRow *getBlockRowFromPosition(BlockRows *blockRows, uint64_t nameId, uint64_t pos);
+stTree *getNodeFromPosition(BlockRows *blockRows, uint64_t nameId, uint64_t pos);
 void fillListByReversePostOrder(stTree *tree, stList *list, bool onlyLeaves);
-stHash *getSeqToBlockRows(mafBlock_t *block, stTree *tree, bool onlyLeaves);
+void getSeqToBlockRows(mafBlock_t *block, ParsedTree *tree, bool onlyLeaves, BlockRows *blockRows);
 stHash *buildNameToNodeHash(stTree *tree);
 bool isAncestor(char *name1, char *name2, stHash *nameToNode);
 
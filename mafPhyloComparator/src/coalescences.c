@@ -28,166 +28,411 @@
 #include "sonLib.h"
 #include "common.h"
 #include "sharedMaf.h"
+#include "profile.h"
+#include "parallel.h"
 #include "comparatorAPI.h"
 #include "blockTree.h"
 #include "mafPhyloComparator.h"
 #include "coalescences.h"
 
-static void sampleCoalescences(char *mafFileName, stSortedSet *coalescences, double acceptProbability, stSet *legitSequences, stHash *sequenceLengthHash, bool onlyLeaves);
-static stSortedSet *sortedSetFromSet(stSet *set);
-static stSortedSet *pairsFromCoalescences(stSortedSet *coalescences);
-static stSortedSet *findMatchingCoalescences(char *mafFileName, stSortedSet *coalescences, stSet *legitSequences, bool onlyLeaves);
+static void sampleCoalescences(char *mafFileName, stSortedSet *coalescences, double acceptProbability, uint64_t seed, stSet *legitSequences, stHash *sequenceLengthHash, bool onlyLeaves, unsigned numThreads);
+static PairStore *pairsFromCoalescences(stSortedSet *coalescences, stSet *legitSequences);
+static stSortedSet *findMatchingCoalescences(char *mafFileName, stSortedSet *coalescences, stSet *legitSequences, bool onlyLeaves, unsigned numThreads);
 static CoalResult *coalResult_init(const char *seq);
 static void coalResult_destruct(CoalResult *coalResult);
 static CoalResult *getResultForSequence(stHash *seqResultsHash, char *seq);
 static void buildCoalescenceResults(stSortedSet *sampledCoalescences, stSortedSet *matchedCoalescences, stTree *speciesTree, CoalResult *aggregateResults, stHash *seqResults);
 static void reportCoalescenceResult(const char *tag, CoalResult *result, FILE *f);
 static void reportCoalescenceResults(CoalResult *aggregateResults, stHash *seqResults, const char *mafFile1, const char *mafFile2, FILE *f);
+static void reportComparison(stSortedSet *sampledCoalescences, stSortedSet *matchedCoalescences, stTree *speciesTree, const char *mafFile1, const char *mafFile2, FILE *f);
 
-// Get a set of coalescences from a sorted set of APairs given a gene
-// tree.
-void coalescencesFromPairs(stSortedSet *pairs, stHash *seqToBlockRows, stSortedSet *coalescences) {
-    stSortedSetIterator *pairsIt = stSortedSet_getIterator(pairs);
-    APair *pair;
-    while ((pair = stSortedSet_getNext(pairsIt)) != NULL) {
+static int cmpIndex(const void *a, const void *b) {
+    uint64_t i = *(const uint64_t *) a;
+    uint64_t j = *(const uint64_t *) b;
+    return (i < j) ? -1 : (i > j);
+}
+
+// Get the coalescences of the pairs in a pair store given the rows of
+// a block and its gene tree, or of only those pairs whose indices are
+// in the list if it is not NULL. The list is sorted and may hold an
+// index more than once, the pair giving one coalescence. A pair that
+// already has a coalescence in the set, from an earlier block, keeps
+// it. The block rows must have been built with the same names as the
+// store.
+void coalescencesFromPairs(PairStore *pairs, PairIndexList *list, BlockRows *blockRows, stSortedSet *coalescences) {
+    uint64_t n = (list == NULL) ? pairStore_size(pairs) : list->length;
+    if (list != NULL) {
+        qsort(list->indices, n, sizeof(*(list->indices)), cmpIndex);
+    }
+    uint64_t id1, pos1, id2, pos2;
+    for (uint64_t i = 0; i < n; ++i) {
+        if (list != NULL && i > 0 && list->indices[i] == list->indices[i - 1]) {
+            continue;
+        }
+        pairStore_get(pairs, (list == NULL) ? i : list->indices[i], &id1, &pos1, &id2, &pos2);
+        Coalescence key = {pairStore_getName(pairs, id1), pos1, pairStore_getName(pairs, id2), pos2, NULL};
+        if (stSortedSet_search(coalescences, &key) != NULL) {
+            continue;
+        }
         Coalescence *coalescence = st_malloc(sizeof(Coalescence));
-        stTree *node1 = getNodeFromPosition(seqToBlockRows, pair->seq1, pair->pos1);
-        stTree *node2 = getNodeFromPosition(seqToBlockRows, pair->seq2, pair->pos2);
-        stTree *mrca = getMRCA(node1, node2);
-        coalescence->seq1 = stString_copy(pair->seq1);
-        coalescence->pos1 = pair->pos1;
-        coalescence->seq2 = stString_copy(pair->seq2);
-        coalescence->pos2 = pair->pos2;
-        coalescence->mrca = stString_copy(stTree_getLabel(mrca));
+        BlockRow *row1 = getBlockRowFromPosition(blockRows, id1, pos1);
+        BlockRow *row2 = getBlockRowFromPosition(blockRows, id2, pos2);
+        int64_t mrca = parsedTree_getMRCA(blockRows->tree, row1->nodeIndex, row2->nodeIndex);
+        coalescence->seq1 = stString_copy(pairStore_getName(pairs, id1));
+        coalescence->pos1 = pos1;
+        coalescence->seq2 = stString_copy(pairStore_getName(pairs, id2));
+        coalescence->pos2 = pos2;
+        coalescence->mrca = stString_copy(stTree_getLabel(blockRows->tree->nodes[mrca]));
         stSortedSet_insert(coalescences, coalescence);
     }
-
-    stSortedSet_destructIterator(pairsIt);
 }
 
-// Sample coalescences from a block.
-void walkBlockSamplingCoalescences(char *mafFileName, mafBlock_t *block, stSortedSet *coalescences, double acceptProbability, stSet *legitSequences, stHash *sequenceLengthHash, uint64_t *chooseTwoArray, bool onlyLeaves) {
+// Sample coalescences from a block. The block's tree is looked up in
+// trees, so blocks sharing a tree parse it once.
+void walkBlockSamplingCoalescences(char *mafFileName, mafBlock_t *block, stSortedSet *coalescences, PairSampler *sampler, uint64_t *numPairs, stSet *legitSequences, stHash *sequenceLengthHash, uint64_t *chooseTwoArray, PairStore *blockPairs, BlockRows *blockRows, TreeCache *trees, bool onlyLeaves) {
     // Parse out tree header
     mafLine_t *line = maf_mafBlock_getHeadLine(block);
     assert(maf_mafLine_getType(line) == 'a');
     char *newickString = parseTreeFromBlockStart(line);
     st_logDebug("Got gene tree %s from block\n", newickString);
-    stTree *tree = stTree_parseNewickString(newickString);
-    stHash *seqToBlockRows = getSeqToBlockRows(block, tree, onlyLeaves);
+    getSeqToBlockRows(block, treeCache_get(trees, newickString), onlyLeaves, blockRows);
 
-    // Use existing mafComparator api to get pairs
-    stSortedSet *pairs = stSortedSet_construct3((int(*)(const void *, const void *)) aPair_cmpFunction, (void(*)(void *)) aPair_destruct);
-    uint64_t numPairs = 0;
-    walkBlockSamplingPairs(mafFileName, block, pairs, acceptProbability, legitSequences, chooseTwoArray, &numPairs, sequenceLengthHash);
-    st_logDebug("Sampled %" PRIi64 " of %" PRIi64 " pairs from block\n", stSortedSet_size(pairs), numPairs);
+    // Use existing mafComparator api to get pairs. blockPairs and
+    // blockRows are scratch space kept between blocks, numPairs and
+    // the sampler run over the whole file.
+    pairStore_clear(blockPairs);
+    uint64_t firstPair = *numPairs;
+    walkBlockSamplingPairs(mafFileName, block, blockPairs, sampler, legitSequences, chooseTwoArray, numPairs, sequenceLengthHash);
+    pairStore_sort(blockPairs);
+    st_logDebug("Sampled %" PRIu64 " of %" PRIu64 " pairs from block\n", pairStore_size(blockPairs), *numPairs - firstPair);
 
-    coalescencesFromPairs(pairs, seqToBlockRows, coalescences);
+    coalescencesFromPairs(blockPairs, NULL, blockRows, coalescences);
 
     free(newickString);
-    stTree_destruct(tree);
-    stHash_destruct(seqToBlockRows);
-    stSortedSet_destruct(pairs);    
 }
 
-// Walk through the given maf file, sampling pairs and recording where
-// in the tree they coalesce.
-static void sampleCoalescences(char *mafFileName, stSortedSet *coalescences, double acceptProbability, stSet *legitSequences, stHash *sequenceLengthHash, bool onlyLeaves) {
-    mafFileApi_t *mafFile = maf_newMfa(mafFileName, "r");
-    uint64_t *chooseTwoArray = buildChooseTwoArray();
-    mafBlock_t *block;
-    while ((block = maf_readBlock(mafFile)) != NULL) {
-        mafLine_t *line = maf_mafBlock_getHeadLine(block);
-        if (maf_mafLine_getType(line) == 'h') {
-            // header line, we should just skip this block
-            maf_destroyMafBlockList(block);
-            continue;
-        }
+// Blocks are taken on the calling thread and handed out to the workers
+// this many at a time.
+static const uint64_t kCoalescenceBatchBlocksPerWorker = 256;
+
+struct coalescenceBatch;
+
+// One of the two buffers of blocks a walk alternates between: the
+// calling thread reads blocks into one while the workers walk the
+// other.
+typedef struct {
+    struct coalescenceBatch *cb;
+    mafBlock_t **blocks;
+    uint64_t numBlocks;
+    uint64_t firstBlock; // index over the maf of blocks[0]
+    bool ownsBlocks; // blocks read from a file are destroyed once walked
+    stSortedSet **blockSampled; // [block]
+    stSortedSet **blockMatched; // [block]
+} CoalescenceBuffer;
+
+// The blocks of a maf walked side by side by a pool of workers,
+// sampling coalescences from them, finding the coalescences of pairs
+// sampled before, or both. Every worker has scratch space and a tree
+// cache of its own, and each block's coalescences go to sets of their
+// own that are merged into the results in block order once the batch
+// is done, so the results are the same for any number of workers. With
+// one worker the blocks add to the results directly, which keeps the
+// first block's coalescence of a pair just as merging in block order
+// does.
+typedef struct coalescenceBatch {
+    char *mafFileName;
+    unsigned numWorkers;
+    CoalescenceBuffer buffers[2];
+    stSet *legitSequences;
+    bool onlyLeaves;
+    TreeCache **trees; // [worker]
+    // Sampling, when sampled is not NULL.
+    stSortedSet *sampled;
+    PairSampler *samplers; // [worker]
+    PairStore **blockPairs; // [worker]
+    BlockRows **sampledRows; // [worker]
+    uint64_t *numPairs; // [worker]
+    stHash *sequenceLengthHash;
+    uint64_t *chooseTwoArray;
+    // Matching, when matched is not NULL. pairs is only read while a
+    // batch runs.
+    stSortedSet *matched;
+    PairStore *pairs;
+    PairIndexList **matchingBlockPairs; // [worker]
+    BlockRows **matchedRows; // [worker]
+} CoalescenceBatch;
+
+// The per-block sets a batch collects coalescences in before they are
+// merged into results.
+static stSortedSet **constructBlockSets(CoalescenceBatch *cb, stSortedSet *results) {
+    uint64_t batchLength = kCoalescenceBatchBlocksPerWorker * cb->numWorkers;
+    stSortedSet **sets = st_malloc(sizeof(stSortedSet *) * batchLength);
+    for (uint64_t i = 0; i < batchLength; i++) {
+        sets[i] = (cb->numWorkers == 1) ? results : stSortedSet_construct3((int (*)(const void *, const void *)) coalescence_cmp, NULL);
+    }
+    return sets;
+}
 
-        walkBlockSamplingCoalescences(mafFileName, block, coalescences, acceptProbability, legitSequences, sequenceLengthHash, chooseTwoArray, onlyLeaves);
-        maf_destroyMafBlockList(block);
+static void destructBlockSets(CoalescenceBatch *cb, stSortedSet **sets) {
+    if (cb->numWorkers > 1) {
+        for (uint64_t i = 0; i < kCoalescenceBatchBlocksPerWorker * cb->numWorkers; i++) {
+            stSortedSet_destruct(sets[i]);
+        }
     }
+    free(sets);
+}
 
-    free(chooseTwoArray);
-    maf_destroyMfa(mafFile);
+static CoalescenceBatch *coalescenceBatch_construct(char *mafFileName, unsigned numThreads, stSet *legitSequences, bool onlyLeaves) {
+    CoalescenceBatch *cb = st_calloc(1, sizeof(CoalescenceBatch));
+    cb->mafFileName = mafFileName;
+    cb->numWorkers = parallel_numberOfWorkers(numThreads, UINT64_MAX);
+    for (unsigned b = 0; b < 2; b++) {
+        cb->buffers[b].cb = cb;
+        cb->buffers[b].blocks = st_malloc(sizeof(mafBlock_t *) * kCoalescenceBatchBlocksPerWorker * cb->numWorkers);
+    }
+    cb->legitSequences = legitSequences;
+    cb->onlyLeaves = onlyLeaves;
+    cb->trees = st_malloc(sizeof(TreeCache *) * cb->numWorkers);
+    for (unsigned w = 0; w < cb->numWorkers; w++) {
+        cb->trees[w] = treeCache_construct();
+    }
+    return cb;
 }
 
-// Convenience function to get a sorted set (keyed by pointer) from a
-// stSet. Not ideal to use very often since it is O(n).
-static stSortedSet *sortedSetFromSet(stSet *set) {
-    stSetIterator *setIt = stSet_getIterator(set);
-    stSortedSet *ret = stSortedSet_construct();
+// Sample coalescences into sampled as the batch walks the maf.
+static void coalescenceBatch_sample(CoalescenceBatch *cb, stSortedSet *sampled, double acceptProbability, uint64_t seed, stHash *sequenceLengthHash) {
+    cb->sampled = sampled;
+    for (unsigned b = 0; b < 2; b++) {
+        cb->buffers[b].blockSampled = constructBlockSets(cb, sampled);
+    }
+    cb->samplers = st_malloc(sizeof(PairSampler) * cb->numWorkers);
+    cb->blockPairs = st_malloc(sizeof(PairStore *) * cb->numWorkers);
+    cb->sampledRows = st_malloc(sizeof(BlockRows *) * cb->numWorkers);
+    cb->numPairs = st_calloc(cb->numWorkers, sizeof(uint64_t));
+    for (unsigned w = 0; w < cb->numWorkers; w++) {
+        pairSampler_initBernoulli(cb->samplers + w, acceptProbability, seed);
+        cb->blockPairs[w] = pairStore_construct(cb->legitSequences);
+        cb->sampledRows[w] = blockRows_construct(cb->blockPairs[w]);
+    }
+    cb->sequenceLengthHash = sequenceLengthHash;
+    cb->chooseTwoArray = buildChooseTwoArray();
+}
 
-    void *item;
-    while((item = stSet_getNext(setIt)) != NULL) {
-        stSortedSet_insert(ret, item);
+// Find the coalescences of the pairs in the sorted store into matched
+// as the batch walks the maf.
+static void coalescenceBatch_match(CoalescenceBatch *cb, stSortedSet *matched, PairStore *pairs) {
+    cb->matched = matched;
+    for (unsigned b = 0; b < 2; b++) {
+        cb->buffers[b].blockMatched = constructBlockSets(cb, matched);
     }
+    cb->pairs = pairs;
+    cb->matchingBlockPairs = st_malloc(sizeof(PairIndexList *) * cb->numWorkers);
+    cb->matchedRows = st_malloc(sizeof(BlockRows *) * cb->numWorkers);
+    for (unsigned w = 0; w < cb->numWorkers; w++) {
+        cb->matchingBlockPairs[w] = pairIndexList_construct();
+        cb->matchedRows[w] = blockRows_construct(pairs);
+    }
+}
 
-    stSet_destructIterator(setIt);
-    return ret;
+static void coalescenceBatch_destruct(CoalescenceBatch *cb) {
+    for (unsigned w = 0; w < cb->numWorkers; w++) {
+        treeCache_destruct(cb->trees[w]);
+        if (cb->sampled != NULL) {
+            blockRows_destruct(cb->sampledRows[w]);
+            pairStore_destruct(cb->blockPairs[w]);
+        }
+        if (cb->matched != NULL) {
+            blockRows_destruct(cb->matchedRows[w]);
+            pairIndexList_destruct(cb->matchingBlockPairs[w]);
+        }
+    }
+    for (unsigned b = 0; b < 2; b++) {
+        if (cb->sampled != NULL) {
+            destructBlockSets(cb, cb->buffers[b].blockSampled);
+        }
+        if (cb->matched != NULL) {
+            destructBlockSets(cb, cb->buffers[b].blockMatched);
+        }
+        free(cb->buffers[b].blocks);
+    }
+    if (cb->sampled != NULL) {
+        free(cb->samplers);
+        free(cb->blockPairs);
+        free(cb->sampledRows);
+        free(cb->numPairs);
+        free(cb->chooseTwoArray);
+    }
+    if (cb->matched != NULL) {
+        free(cb->matchingBlockPairs);
+        free(cb->matchedRows);
+    }
+    free(cb->trees);
+    free(cb);
 }
 
-static stSortedSet *pairsFromCoalescences(stSortedSet *coalescences) {
-    stSortedSet *ret = stSortedSet_construct3((int (*)(const void *, const void *))aPair_cmpFunction, (void (*)(void *)) aPair_destruct);
-    stSortedSetIterator *setIt = stSortedSet_getIterator(coalescences);
+// Move the coalescences of a block into the results, keeping the one
+// already there when a pair was seen in an earlier block.
+static void mergeBlockCoalescences(stSortedSet *coalescences, stSortedSet *blockCoalescences) {
     Coalescence *coal;
-    while((coal = stSortedSet_getNext(setIt)) != NULL) {
-        APair *pair = aPair_init();
-        aPair_fillOut(pair, stString_copy(coal->seq1), stString_copy(coal->seq2), coal->pos1, coal->pos2);
-        stSortedSet_insert(ret, pair);
+    while ((coal = stSortedSet_getFirst(blockCoalescences)) != NULL) {
+        stSortedSet_remove(blockCoalescences, coal);
+        if (stSortedSet_search(coalescences, coal) == NULL) {
+            stSortedSet_insert(coalescences, coal);
+        } else {
+            coalescence_destruct(coal);
+        }
     }
-
-    stSortedSet_destructIterator(setIt);
-    return ret;
 }
 
-static stSortedSet *findMatchingCoalescences(char *mafFileName, stSortedSet *coalescences, stSet *legitSequences, bool onlyLeaves) {
-    stSortedSet *matchingCoalescences = stSortedSet_construct3((int (*)(const void *, const void *)) coalescence_cmp, (void (*)(void *)) coalescence_destruct);
+// Find the coalescences in a block of the pairs in the store.
+static void walkBlockMatchingCoalescences(mafBlock_t *block, PairStore *pairs, stSortedSet *matchingCoalescences, stSet *legitSequences, PairIndexList *matchingBlockPairs, BlockRows *blockRows, TreeCache *trees, bool onlyLeaves) {
+    // Use existing mafComparator API to get matching pairs.
+    matchingBlockPairs->length = 0;
+    walkBlockTestingHomology(block, pairs, matchingBlockPairs, legitSequences, 0);
 
-    // Get aPairs from the sampled coalescences.
-    stSortedSet *pairs = pairsFromCoalescences(coalescences);
-    st_logDebug("Converted %" PRIi64 " coalescences back to pairs\n", stSortedSet_size(pairs));
+    // Get the tree
+    char *newickString = parseTreeFromBlockStart(maf_mafBlock_getHeadLine(block));
+    getSeqToBlockRows(block, treeCache_get(trees, newickString), onlyLeaves, blockRows);
+    st_logDebug("Got %" PRIu64 " matching pair indices from the block\n", matchingBlockPairs->length);
 
-    mafFileApi_t *mafFile = maf_newMfa(mafFileName, "r");
+    coalescencesFromPairs(pairs, matchingBlockPairs, blockRows, matchingCoalescences);
+    free(newickString);
+}
+
+static void walkBatchBlock(uint64_t i, unsigned worker, void *data) {
+    CoalescenceBuffer *buffer = data;
+    CoalescenceBatch *cb = buffer->cb;
+    if (cb->sampled != NULL) {
+        // The sampler draws a block's pairs from a random stream keyed
+        // by the block's index, see pairSampler_beginBlock().
+        cb->samplers[worker].block = buffer->firstBlock + i;
+        walkBlockSamplingCoalescences(cb->mafFileName, buffer->blocks[i], buffer->blockSampled[i], cb->samplers + worker, cb->numPairs + worker, cb->legitSequences, cb->sequenceLengthHash, cb->chooseTwoArray, cb->blockPairs[worker], cb->sampledRows[worker], cb->trees[worker], cb->onlyLeaves);
+    }
+    if (cb->matched != NULL) {
+        walkBlockMatchingCoalescences(buffer->blocks[i], cb->pairs, buffer->blockMatched[i], cb->legitSequences, cb->matchingBlockPairs[worker], cb->matchedRows[worker], cb->trees[worker], cb->onlyLeaves);
+    }
+    if (buffer->ownsBlocks) {
+        maf_destroyMafBlockList(buffer->blocks[i]);
+    }
+}
+
+// Fill a buffer with the next alignment blocks, read from mafFile or,
+// when that is NULL, from the blocks of a maf held in memory.
+static void coalescenceBuffer_read(CoalescenceBuffer *buffer, uint64_t firstBlock, mafFileApi_t *mafFile, mafBlock_t **blocks) {
+    uint64_t batchLength = kCoalescenceBatchBlocksPerWorker * buffer->cb->numWorkers;
     mafBlock_t *block;
-    while ((block = maf_readBlock(mafFile)) != NULL) {
-        mafLine_t *line = maf_mafBlock_getHeadLine(block);
-        if (maf_mafLine_getType(line) != 'a') {
-            // Only looking for alignment blocks.
-            maf_destroyMafBlockList(block);
+    buffer->numBlocks = 0;
+    buffer->firstBlock = firstBlock;
+    buffer->ownsBlocks = (mafFile != NULL);
+    while (buffer->numBlocks < batchLength) {
+        if (mafFile != NULL) {
+            block = maf_readBlock(mafFile);
+        } else if ((block = *blocks) != NULL) {
+            *blocks = maf_mafBlock_getNext(*blocks);
+        }
+        if (block == NULL) {
+            break;
+        }
+        if (maf_mafLine_getType(maf_mafBlock_getHeadLine(block)) != 'a') {
+            // Only looking for alignment blocks; skip the header.
+            if (mafFile != NULL) {
+                maf_destroyMafBlockList(block);
+            }
             continue;
         }
+        buffer->blocks[buffer->numBlocks++] = block;
+    }
+}
 
-        // Use existing mafComparator API to get matching pairs.
-        stSet *matchingBlockPairs = stSet_construct();
-        walkBlockTestingHomology(block, pairs, matchingBlockPairs,
-                                 legitSequences, 0);
-        st_logDebug("Got %" PRIi64 " matching pairs from the block\n", stSet_size(matchingBlockPairs));
-
-        // Get the tree
-        char *newickString = parseTreeFromBlockStart(line);
-        stTree *blockTree = stTree_parseNewickString(newickString);
-        stHash *seqToBlockRows = getSeqToBlockRows(block, blockTree, onlyLeaves);
+// Move the coalescences of a walked buffer into the results in block
+// order.
+static void coalescenceBuffer_merge(CoalescenceBuffer *buffer) {
+    CoalescenceBatch *cb = buffer->cb;
+    if (cb->numWorkers == 1) {
+        return;
+    }
+    for (uint64_t i = 0; i < buffer->numBlocks; i++) {
+        if (cb->sampled != NULL) {
+            mergeBlockCoalescences(cb->sampled, buffer->blockSampled[i]);
+        }
+        if (cb->matched != NULL) {
+            mergeBlockCoalescences(cb->matched, buffer->blockMatched[i]);
+        }
+    }
+}
 
-        // Change from a set of positive pairs to a sorted set. NB:
-        // this isn't really necessary, it's just to make the types
-        // match, so if this is appreciably slow just duplicate the
-        // coalescencesFromPairs into sorted set and unsorted set
-        // versions.
-        stSortedSet *matchingBlockPairsSorted = sortedSetFromSet(matchingBlockPairs);
+// Walk the alignment blocks of a maf, read from mafFile or, when that
+// is NULL, from the blocks of a maf held in memory. While the workers
+// walk one buffer the calling thread merges the one walked before and
+// reads the next blocks into it.
+static void coalescenceBatch_walk(CoalescenceBatch *cb, mafFileApi_t *mafFile, mafBlock_t *blocks) {
+    uint64_t batchLength = kCoalescenceBatchBlocksPerWorker * cb->numWorkers;
+    parallelPool_t *pool = parallel_startPool(cb->numWorkers);
+    CoalescenceBuffer *walking = cb->buffers;
+    CoalescenceBuffer *walked = NULL;
+    coalescenceBuffer_read(walking, 0, mafFile, &blocks);
+    while (walking->numBlocks > 0) {
+        parallel_start(pool, walking->numBlocks, walkBatchBlock, walking);
+        CoalescenceBuffer *next = (walking == cb->buffers) ? cb->buffers + 1 : cb->buffers;
+        if (walked != NULL) {
+            coalescenceBuffer_merge(walked);
+        }
+        if (walking->numBlocks == batchLength) {
+            coalescenceBuffer_read(next, walking->firstBlock + walking->numBlocks, mafFile, &blocks);
+        } else {
+            next->numBlocks = 0;
+        }
+        parallel_wait(pool);
+        walked = walking;
+        walking = next;
+    }
+    if (walked != NULL) {
+        coalescenceBuffer_merge(walked);
+    }
+    parallel_finishPool(pool);
+}
 
-        coalescencesFromPairs(matchingBlockPairsSorted,
-                              seqToBlockRows, matchingCoalescences);
+// Walk through the given maf file, sampling pairs and recording where
+// in the tree they coalesce. Blocks are sampled by up to numThreads
+// workers, 0 meaning one per processor, and the sample does not depend
+// on how many there are.
+static void sampleCoalescences(char *mafFileName, stSortedSet *coalescences, double acceptProbability, uint64_t seed, stSet *legitSequences, stHash *sequenceLengthHash, bool onlyLeaves, unsigned numThreads) {
+    CoalescenceBatch *cb = coalescenceBatch_construct(mafFileName, numThreads, legitSequences, onlyLeaves);
+    coalescenceBatch_sample(cb, coalescences, acceptProbability, seed, sequenceLengthHash);
+    mafFileApi_t *mafFile = maf_newMfa(mafFileName, "r");
+    coalescenceBatch_walk(cb, mafFile, NULL);
+    maf_destroyMfa(mafFile);
+    coalescenceBatch_destruct(cb);
+}
 
-        free(newickString);
-        stTree_destruct(blockTree);
-        stHash_destruct(seqToBlockRows);
-        stSet_destruct(matchingBlockPairs);
-        stSortedSet_destruct(matchingBlockPairsSorted);
-        maf_destroyMafBlockList(block);
+static PairStore *pairsFromCoalescences(stSortedSet *coalescences, stSet *legitSequences) {
+    PairStore *ret = pairStore_construct(legitSequences);
+    stSortedSetIterator *setIt = stSortedSet_getIterator(coalescences);
+    Coalescence *coal;
+    while((coal = stSortedSet_getNext(setIt)) != NULL) {
+        pairStore_addNamed(ret, coal->seq1, coal->pos1, coal->seq2, coal->pos2);
     }
 
-    stSortedSet_destruct(pairs);
+    stSortedSet_destructIterator(setIt);
+    pairStore_sort(ret);
+    return ret;
+}
+
+// Find the coalescences in the maf of the pairs of the sampled
+// coalescences, the blocks being shared out as in sampleCoalescences().
+static stSortedSet *findMatchingCoalescences(char *mafFileName, stSortedSet *coalescences, stSet *legitSequences, bool onlyLeaves, unsigned numThreads) {
+    stSortedSet *matchingCoalescences = stSortedSet_construct3((int (*)(const void *, const void *)) coalescence_cmp, (void (*)(void *)) coalescence_destruct);
+
+    // Get pairs from the sampled coalescences.
+    PairStore *pairs = pairsFromCoalescences(coalescences, legitSequences);
+    st_logDebug("Converted %" PRIu64 " coalescences back to pairs\n", pairStore_size(pairs));
+    CoalescenceBatch *cb = coalescenceBatch_construct(mafFileName, numThreads, legitSequences, onlyLeaves);
+    coalescenceBatch_match(cb, matchingCoalescences, pairs);
+    mafFileApi_t *mafFile = maf_newMfa(mafFileName, "r");
+    coalescenceBatch_walk(cb, mafFile, NULL);
     maf_destroyMfa(mafFile);
+    coalescenceBatch_destruct(cb);
+    pairStore_destruct(pairs);
 
     return matchingCoalescences;
 }
@@ -248,7 +493,11 @@ static CoalResult *getResultForSequence(stHash *seqResultsHash, char *seq) {
 
 // Fill in result structures on a per-sequence and overall basis.
 static void buildCoalescenceResults(stSortedSet *sampledCoalescences, stSortedSet *matchedCoalescences, stTree *speciesTree, CoalResult *aggregateResults, stHash *seqResults) {
-    stHash *nameToSpecies = buildNameToNodeHash(speciesTree);
+    // Parse a copy of the species tree, which the options own, to
+    // answer ancestry queries in constant time.
+    char *newickString = stTree_getNewickTreeString(speciesTree);
+    ParsedTree *species = parsedTree_construct(stTree_parseNewickString(newickString));
+    free(newickString);
 
     // Go through each sampled coalescence (from maf A) and find the
     // coalescence from maf B that has the same seqs & positions, if
@@ -277,14 +526,14 @@ static void buildCoalescenceResults(stSortedSet *sampledCoalescences, stSortedSe
                 seq1Result->identicalCoalescences++;
                 seq2Result->identicalCoalescences++;
                 aggregateResults->identicalCoalescences++;
-            } else if (isAncestor(sampledCoal->mrca, matchedCoal->mrca, nameToSpecies)) {
+            } else if (parsedTree_isAncestor(species, sampledCoal->mrca, matchedCoal->mrca)) {
                 // Maf B's coalescence is earlier than maf A's.
                 seq1Result->earlyCoalescences++;
                 seq2Result->earlyCoalescences++;
                 aggregateResults->earlyCoalescences++;
             } else {
                 // Maf B's coalescence is later than maf A's.
-                assert(isAncestor(matchedCoal->mrca, sampledCoal->mrca, nameToSpecies));
+                assert(parsedTree_isAncestor(species, matchedCoal->mrca, sampledCoal->mrca));
                 seq1Result->lateCoalescences++;
                 seq2Result->lateCoalescences++;
                 aggregateResults->lateCoalescences++;
@@ -293,7 +542,7 @@ static void buildCoalescenceResults(stSortedSet *sampledCoalescences, stSortedSe
     }
 
     stSortedSet_destructIterator(coalIt);
-    stHash_destruct(nameToSpecies);
+    parsedTree_destruct(species);
 }
 
 static void reportCoalescenceResult(const char *tag, CoalResult *result, FILE *f) {
@@ -316,38 +565,118 @@ static void reportCoalescenceResults(CoalResult *aggregateResults, stHash *seqRe
     stHash_destructIterator(seqIt);
 }
 
+// Accumulate and report the results of the comparison of the
+// coalescences sampled from mafFile1 with those found in mafFile2.
+static void reportComparison(stSortedSet *sampledCoalescences, stSortedSet *matchedCoalescences, stTree *speciesTree, const char *mafFile1, const char *mafFile2, FILE *f) {
+    st_logInfo("Accumulating results\n");
+    // Overall results.
+    CoalResult *aggregateResults = coalResult_init("aggregate");
+    // The per-sequence result hash.
+    stHash *seqResults = stHash_construct3(stHash_stringKey, stHash_stringEqualKey, free, (void (*)(void *)) coalResult_destruct);
+    profileSpan_t span = profile_begin("buildCoalescenceResults");
+    buildCoalescenceResults(sampledCoalescences, matchedCoalescences, speciesTree, aggregateResults, seqResults);
+    profile_end(span);
+    reportCoalescenceResults(aggregateResults, seqResults, mafFile1, mafFile2, f);
+    coalResult_destruct(aggregateResults);
+    stHash_destruct(seqResults);
+}
+
 void compareMAFCoalescences(PhyloOptions *opts, stSet *legitSequences, stHash *sequenceLengthHash, bool onlyLeaves) {
     // Sample coalescences from the MAF (a pair of sequences from a
     // block and what genome they coalesce in)
     st_logInfo("Sampling coalescences\n");
     stSortedSet *coalescences = stSortedSet_construct3((int (*)(const void *, const void *)) coalescence_cmp, (void (*)(void *)) coalescence_destruct);
-    double acceptProbability = ((double) opts->numSamples) / countPairsInMaf(opts->mafFile1, legitSequences);
-    sampleCoalescences(opts->mafFile1, coalescences, acceptProbability, legitSequences, sequenceLengthHash, onlyLeaves);
+    profileSpan_t span = profile_begin("countPairsInMaf");
+    double acceptProbability = ((double) opts->numSamples) / countPairsInMaf(opts->mafFile1, legitSequences, opts->numThreads);
+    profile_end(span);
+    span = profile_begin("sampleCoalescences");
+    sampleCoalescences(opts->mafFile1, coalescences, acceptProbability, opts->seed, legitSequences, sequenceLengthHash, onlyLeaves, opts->numThreads);
+    profile_end(span);
     st_logInfo("Sampled %" PRIi64 " coalescences\n", stSortedSet_size(coalescences));
 
     st_logInfo("Finding matching coalescences\n");
-    stSortedSet *matchingCoalescences = findMatchingCoalescences(opts->mafFile2, coalescences, legitSequences, onlyLeaves);
+    span = profile_begin("findMatchingCoalescences");
+    stSortedSet *matchingCoalescences = findMatchingCoalescences(opts->mafFile2, coalescences, legitSequences, onlyLeaves, opts->numThreads);
+    profile_end(span);
     st_logInfo("Got %" PRIi64 " comparable coalescences\n", stSortedSet_size(matchingCoalescences));
 
-    st_logInfo("Accumulating results\n");
-    // Overall results.
-    CoalResult *aggregateResults = coalResult_init("aggregate");
-    // The per-sequence result hash.
-    stHash *seqResults = stHash_construct3(stHash_stringKey, stHash_stringEqualKey, free, (void (*)(void *)) coalResult_destruct);
-    buildCoalescenceResults(coalescences, matchingCoalescences, opts->speciesTree, aggregateResults, seqResults);
-
     FILE *outFile;
     if (opts->outFile == NULL) {
         outFile = stdout;
     } else {
         outFile = fopen(opts->outFile, "w");
     }
-    reportCoalescenceResults(aggregateResults, seqResults, opts->mafFile1, opts->mafFile2, outFile);
+    reportComparison(coalescences, matchingCoalescences, opts->speciesTree, opts->mafFile1, opts->mafFile2, outFile);
 
     // Clean up.
     stSortedSet_destruct(coalescences);
     stSortedSet_destruct(matchingCoalescences);
-    coalResult_destruct(aggregateResults);
-    stHash_destruct(seqResults);
+    fclose(outFile);
+}
+
+// Sample coalescences from maf1 and maf2 and find them in the other
+// maf, both mafs having been read into memory once with
+// readMafsConcurrently(). maf1 is walked to take its sample, then maf2
+// to take its own and, on the same blocks, find those of maf1's, then
+// maf1 again to find those of maf2's. The comparison of each direction
+// is the same as compareMAFCoalescences() gives with the mafs in that
+// order, and both are reported. Memory grows with the size of both
+// mafs, which --onePassMemory bounds.
+void compareMAFCoalescencesInOnePass(PhyloOptions *opts, mafBlock_t *blocks1, mafBlock_t *blocks2, stSet *legitSequences, stHash *sequenceLengthHash, bool onlyLeaves) {
+    mafBlock_t *blocks[2] = {blocks1, blocks2};
+    char *mafFiles[2] = {opts->mafFile1, opts->mafFile2};
+    stSortedSet *sampled[2];
+    stSortedSet *matched[2];
+    double acceptProbability[2];
+    profileSpan_t span = profile_begin("countPairsInBlocks");
+    for (int i = 0; i < 2; i++) {
+        sampled[i] = stSortedSet_construct3((int (*)(const void *, const void *)) coalescence_cmp, (void (*)(void *)) coalescence_destruct);
+        matched[i] = stSortedSet_construct3((int (*)(const void *, const void *)) coalescence_cmp, (void (*)(void *)) coalescence_destruct);
+        acceptProbability[i] = ((double) opts->numSamples) / countPairsInBlocks(blocks[i], legitSequences);
+    }
+    profile_end(span);
+
+    st_logInfo("Sampling coalescences from %s\n", mafFiles[0]);
+    span = profile_begin("sampleCoalescences");
+    CoalescenceBatch *cb = coalescenceBatch_construct(mafFiles[0], opts->numThreads, legitSequences, onlyLeaves);
+    coalescenceBatch_sample(cb, sampled[0], acceptProbability[0], opts->seed, sequenceLengthHash);
+    coalescenceBatch_walk(cb, NULL, blocks[0]);
+    coalescenceBatch_destruct(cb);
+    profile_end(span);
+
+    st_logInfo("Sampling coalescences from %s and finding matching coalescences\n", mafFiles[1]);
+    span = profile_begin("sampleAndFindMatchingCoalescences");
+    PairStore *pairs = pairsFromCoalescences(sampled[0], legitSequences);
+    cb = coalescenceBatch_construct(mafFiles[1], opts->numThreads, legitSequences, onlyLeaves);
+    coalescenceBatch_sample(cb, sampled[1], acceptProbability[1], opts->seed, sequenceLengthHash);
+    coalescenceBatch_match(cb, matched[0], pairs);
+    coalescenceBatch_walk(cb, NULL, blocks[1]);
+    coalescenceBatch_destruct(cb);
+    pairStore_destruct(pairs);
+    profile_end(span);
+
+    st_logInfo("Finding matching coalescences in %s\n", mafFiles[0]);
+    span = profile_begin("findMatchingCoalescences");
+    pairs = pairsFromCoalescences(sampled[1], legitSequences);
+    cb = coalescenceBatch_construct(mafFiles[0], opts->numThreads, legitSequences, onlyLeaves);
+    coalescenceBatch_match(cb, matched[1], pairs);
+    coalescenceBatch_walk(cb, NULL, blocks[0]);
+    coalescenceBatch_destruct(cb);
+    pairStore_destruct(pairs);
+    profile_end(span);
+
+    FILE *outFile;
+    if (opts->outFile == NULL) {
+        outFile = stdout;
+    } else {
+        outFile = fopen(opts->outFile, "w");
+    }
+    fprintf(outFile, "<coalescenceTests>\n");
+    for (int i = 0; i < 2; i++) {
+        reportComparison(sampled[i], matched[i], opts->speciesTree, mafFiles[i], mafFiles[1 - i], outFile);
+        stSortedSet_destruct(sampled[i]);
+        stSortedSet_destruct(matched[i]);
+    }
+    fprintf(outFile, "</coalescenceTests>\n");
     fclose(outFile);
 }
@@ -3,6 +3,7 @@
 #include "sonLib.h"
 #include "sharedMaf.h"
 #include "mafPhyloComparator.h"
+#include "blockTree.h"
 
 // Represents an aligned pair and where their MRCA is in the gene
 // tree.
@@ -28,9 +29,10 @@ typedef struct {
 
 int coalescence_cmp(const Coalescence *coal1, const Coalescence *coal2);
 void coalescence_destruct(Coalescence *coal);
-void coalescencesFromPairs(stSortedSet *pairs, stHash *seqToBlockRows, stSortedSet *coalescences);
-void walkBlockSamplingCoalescences(char *mafFileName, mafBlock_t *block, stSortedSet *coalescences, double acceptProbability, stSet *legitSequences, stHash *sequenceLengthHash, uint64_t *chooseTwoArray, bool onlyLeaves);
+void coalescencesFromPairs(PairStore *pairs, PairIndexList *list, BlockRows *blockRows, stSortedSet *coalescences);
+void walkBlockSamplingCoalescences(char *mafFileName, mafBlock_t *block, stSortedSet *coalescences, PairSampler *sampler, uint64_t *numPairs, stSet *legitSequences, stHash *sequenceLengthHash, uint64_t *chooseTwoArray, PairStore *blockPairs, BlockRows *blockRows, TreeCache *trees, bool onlyLeaves);
 
 // Sample, compare and report coalescences from two MAFs.
 void compareMAFCoalescences(PhyloOptions *opts, stSet *legitSequences, stHash *sequenceLengthHash, bool onlyLeaves);
+void compareMAFCoalescencesInOnePass(PhyloOptions *opts, mafBlock_t *blocks1, mafBlock_t *blocks2, stSet *legitSequences, stHash *sequenceLengthHash, bool onlyLeaves);
 #endif
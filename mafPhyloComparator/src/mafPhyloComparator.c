@@ -31,14 +31,50 @@
 #include "sonLib.h"
 #include "common.h"
 #include "sharedMaf.h"
+#include "profile.h"
 #include "comparatorAPI.h"
+#include "comparatorPairCount.h"
 #include "coalescences.h"
 #include "blockTree.h"
 #include "mafPhyloComparator.h"
 
+// --onePass takes about this many bytes of memory per byte of maf, 4.5
+// on a pair of 20000 block mafs.
+static const uint64_t kOnePassBytesPerMafByte = 5;
+static const uint64_t kDefaultOnePassMemory = 4096; // MiB
+
+void usage(void);
 void parseOpts(int argc, char **argv, PhyloOptions *opts);
 void phyloOptions_destruct(PhyloOptions *opts);
-void getLegitSequencesAndLengths(PhyloOptions *opts, stSet *legitSequences, stHash *sequenceLengthHash);
+void getLegitSequencesAndLengths(PhyloOptions *opts, stSet *legitSequences, stHash *sequenceLengthHash, mafBlock_t *blocks1, mafBlock_t *blocks2);
+
+void usage(void) {
+    fprintf(stderr, "Usage: $ mafPhyloComparator --mafFile1=FILE1 --mafFile2=FILE2 --speciesTree=TREE [options]\n\n");
+    fprintf(stderr, "This program samples pairs of aligned positions from the first MAF, finds \n"
+            "where in the block's tree each pair coalesces, and reports how many of the \n"
+            "pairs aligned in the second MAF coalesce earlier, later or in the same place \n"
+            "there. Every block must carry its tree as tree=\"NEWICK\" on its 'a' line.\n\n");
+    fprintf(stderr, "Options:\n");
+    usageMessage('\0', "help", "Print this help screen.");
+    usageMessage('\0', "mafFile1", "The location of the first MAF file, sampled. May be - to read "
+                 "from stdin, or a sharded maf.");
+    usageMessage('\0', "mafFile2", "The location of the second MAF file, as for --mafFile1.");
+    usageMessage('\0', "speciesTree", "The species tree, in newick format, every node labeled.");
+    usageMessage('\0', "out", "The output XML file. [default: stdout]");
+    usageMessage('\0', "numSamples", "The number of pairs to sample. [default: 1000000]");
+    usageMessage('\0', "seed", "Seed of the random numbers of the sample.");
+    usageMessage('\0', "onlyLeaves", "The mafs hold rows for the leaves of the block trees only.");
+    usageMessage('\0', "threads", "Walk blocks with this many workers, 0 for one per processor. "
+                 "Results do not depend on it. [default: 0]");
+    usageMessage('\0', "onePass", "Read each maf once, holding both in memory, and report the "
+                 "comparisons in both directions. Memory grows with the size of the mafs, about five "
+                 "times their combined size on disk, see --onePassMemory.");
+    usageMessage('\0', "onePassMemory", "With --onePass, refuse mafs that would take more than this "
+                 "many MiB of memory by their size on disk, 0 for no limit. stdin can not be sized and "
+                 "is not counted. [default: 4096]");
+    usageMessage('\0', "profile", "Write the time spent in each phase to FILE as a Chrome trace.");
+    usageMessage('\0', "logLevel", "Set the log level.");
+}
 
 void parseOpts(int argc, char *argv[], PhyloOptions *opts) {
     st_logInfo("Parsing arguments\n");
@@ -47,13 +83,25 @@ void parseOpts(int argc, char *argv[], PhyloOptions *opts) {
         {"mafFile2", required_argument, NULL, 0},
         {"logLevel", required_argument, NULL, 0},
         {"numSamples", required_argument, NULL, 0},
+        {"seed", required_argument, NULL, 0},
         {"speciesTree", required_argument, NULL, 0},
         {"out", required_argument, NULL, 0},
         {"onlyLeaves", no_argument, NULL, 0},
+        {"profile", required_argument, NULL, 0},
+        {"threads", required_argument, NULL, 0},
+        {"onePass", no_argument, NULL, 0},
+        {"onePassMemory", required_argument, NULL, 0},
+        {"help", no_argument, NULL, 0},
         {0, 0, 0, 0}
     };
     int longindex;
-    while (getopt_long(argc, argv, "", longopts, &longindex) != -1) {
+    int c;
+    opts->onePassMemory = kDefaultOnePassMemory;
+    while ((c = getopt_long(argc, argv, "", longopts, &longindex)) != -1) {
+        if (c != 0) {
+            usage();
+            exit(EXIT_FAILURE);
+        }
         const char *optName = longopts[longindex].name;
         if (strcmp(optName, "mafFile1") == 0) {
             opts->mafFile1 = stString_copy(optarg);
@@ -67,12 +115,34 @@ void parseOpts(int argc, char *argv[], PhyloOptions *opts) {
             ret = sscanf(optarg, "%" PRIi64, &intArg);
             assert(ret == 1);
             opts->numSamples = intArg;
+        } else if (strcmp(optName, "seed") == 0) {
+            int ret = sscanf(optarg, "%" SCNu64, &(opts->seed));
+            if (ret != 1) {
+                st_errAbort("Unable to parse --seed %s", optarg);
+            }
         } else if (strcmp(optName, "speciesTree") == 0) {
             opts->speciesTree = stTree_parseNewickString(optarg);
         } else if (strcmp(optName, "out") == 0) {
             opts->outFile = stString_copy(optarg);
         } else if (strcmp(optName, "onlyLeaves") == 0) {
             opts->onlyLeaves = true;
+        } else if (strcmp(optName, "profile") == 0) {
+            profile_init(optarg);
+        } else if (strcmp(optName, "threads") == 0) {
+            int ret = sscanf(optarg, "%u", &(opts->numThreads));
+            if (ret != 1) {
+                st_errAbort("Unable to parse --threads %s", optarg);
+            }
+        } else if (strcmp(optName, "onePass") == 0) {
+            opts->isOnePass = true;
+        } else if (strcmp(optName, "onePassMemory") == 0) {
+            int ret = sscanf(optarg, "%" SCNu64, &(opts->onePassMemory));
+            if (ret != 1) {
+                st_errAbort("Unable to parse --onePassMemory %s", optarg);
+            }
+        } else if (strcmp(optName, "help") == 0) {
+            usage();
+            exit(EXIT_SUCCESS);
         }
     }
     if (opts->mafFile1 == NULL) {
@@ -84,6 +154,9 @@ void parseOpts(int argc, char *argv[], PhyloOptions *opts) {
     if (opts->speciesTree == NULL) {
         st_errAbort("--speciesTree is required (in newick format)");
     }
+    if (maf_isStdStream(opts->mafFile1) && maf_isStdStream(opts->mafFile2)) {
+        st_errAbort("Only one of --mafFile1 and --mafFile2 may be - (stdin)");
+    }
     if (opts->numSamples == 0) {
         opts->numSamples = 1000000;
     }
@@ -98,15 +171,51 @@ void phyloOptions_destruct(PhyloOptions *opts) {
 }
 
 // Use the mafComparator API to build the legitSequences set and
-// length hash -- but it expects a different options structure.
-void getLegitSequencesAndLengths(PhyloOptions *opts, stSet *legitSequences, stHash *sequenceLengthHash) {
+// length hash -- but it expects a different options structure. The
+// names are taken from the blocks of mafs read into memory with
+// --onePass, else from the files.
+void getLegitSequencesAndLengths(PhyloOptions *opts, stSet *legitSequences, stHash *sequenceLengthHash, mafBlock_t *blocks1, mafBlock_t *blocks2) {
     Options *comparatorOpts = options_construct();
     comparatorOpts->mafFile1 = stString_copy(opts->mafFile1);
     comparatorOpts->mafFile2 = stString_copy(opts->mafFile2);
-    buildSeqNamesSet(comparatorOpts, legitSequences, sequenceLengthHash);
+    comparatorOpts->isConcurrent = opts->isOnePass;
+    buildSeqNamesSetFromBlocks(comparatorOpts, legitSequences, sequenceLengthHash, blocks1, blocks2);
     options_destruct(comparatorOpts);
 }
 
+// The bytes of a maf, or of all of its shards, 0 for stdin.
+static uint64_t mafFileSize(const char *mafFile) {
+    if (maf_isStdStream(mafFile)) {
+        return 0;
+    }
+    unsigned n;
+    char **shards = maf_getShardList(mafFile, &n);
+    uint64_t size = 0, shardSize;
+    int64_t shardTime;
+    for (unsigned i = 0; i < n; i++) {
+        if (pairCount_statMaf(shards[i], &shardSize, &shardTime)) {
+            size += shardSize;
+        }
+        free(shards[i]);
+    }
+    free(shards);
+    return size;
+}
+
+// --onePass holds both mafs in memory, exit and complain if they would
+// take more than --onePassMemory.
+static void checkOnePassMemory(PhyloOptions *opts) {
+    if (!opts->isOnePass || opts->onePassMemory == 0) {
+        return;
+    }
+    uint64_t memory = (mafFileSize(opts->mafFile1) + mafFileSize(opts->mafFile2)) * kOnePassBytesPerMafByte / (1 << 20);
+    if (memory > opts->onePassMemory) {
+        st_errAbort("--onePass would hold %s and %s in about %" PRIu64 " MiB of memory, more than "
+                    "--onePassMemory %" PRIu64 ". Run without --onePass, or raise --onePassMemory "
+                    "(0 for no limit)", opts->mafFile1, opts->mafFile2, memory, opts->onePassMemory);
+    }
+}
+
 // Check the species tree and exit and complain if it's invalid.
 // All nodes must be labeled and there can be no duplicate names.
 static void checkSpeciesTree(stTree *tree) {
@@ -132,18 +241,38 @@ int main(int argc, char *argv[]) {
     PhyloOptions *opts = st_calloc(1, sizeof(PhyloOptions));
     parseOpts(argc, argv, opts);
     checkSpeciesTree(opts->speciesTree);
+    checkOnePassMemory(opts);
+    // both mafs are read several times, so stdin is copied once up
+    // front, unless --onePass reads each of them once.
+    if (!opts->isOnePass && (maf_isStdStream(opts->mafFile1) || maf_isStdStream(opts->mafFile2))) {
+        maf_spoolStdin();
+    }
+    mafBlock_t *blocks1 = NULL;
+    mafBlock_t *blocks2 = NULL;
+    if (opts->isOnePass) {
+        readMafsConcurrently(opts->mafFile1, opts->mafFile2, &blocks1, &blocks2);
+    }
 
     // TODO: verify that the MAF has a tree for each block and the
     // tree is the format we need?
     st_logDebug("Getting legit sequences and lengths\n");
     stHash *sequenceLengthHash = stHash_construct3(stHash_stringKey, stHash_stringEqualKey, free, free);
     stSet *legitSequences = stSet_construct3(stHash_stringKey, stHash_stringEqualKey, free);
-    getLegitSequencesAndLengths(opts, legitSequences, sequenceLengthHash);
+    profileSpan_t span = profile_begin("getLegitSequencesAndLengths");
+    getLegitSequencesAndLengths(opts, legitSequences, sequenceLengthHash, blocks1, blocks2);
+    profile_end(span);
 
-    compareMAFCoalescences(opts, legitSequences, sequenceLengthHash, opts->onlyLeaves);
+    if (opts->isOnePass) {
+        compareMAFCoalescencesInOnePass(opts, blocks1, blocks2, legitSequences, sequenceLengthHash, opts->onlyLeaves);
+        maf_destroyMafBlockList(blocks1);
+        maf_destroyMafBlockList(blocks2);
+    } else {
+        compareMAFCoalescences(opts, legitSequences, sequenceLengthHash, opts->onlyLeaves);
+    }
 
     // Clean up.
     phyloOptions_destruct(opts);
     stHash_destruct(sequenceLengthHash);
     stSet_destruct(legitSequences);
+    profile_finish();
 }
@@ -7,9 +7,15 @@ typedef struct {
     char *mafFile2;
     char *outFile;
     int64_t numSamples;
+    uint64_t seed; // of the sample's random numbers, 0 unless --seed is given
     stTree *speciesTree;
     bool onlyLeaves; // Whether the mafs have block entries for just
                      // the leaves or for ancestors as well.
+    unsigned numThreads; // blocks walked side by side, 0 meaning one
+                         // per processor
+    bool isOnePass; // read each maf once and compare both directions
+    uint64_t onePassMemory; // MiB that --onePass may hold the mafs in, 0
+                            // for no limit
 } PhyloOptions;
 
 #endif // __MAFPHYLOCOMPARATOR_H_
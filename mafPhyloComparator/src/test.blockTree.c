@@ -87,6 +87,18 @@ static void test_getMRCA(CuTest *testCase) {
     stTree_destruct(tree);
 }
 
+// A store that hands out name ids for the sequences of the test blocks.
+static PairStore *namesStore(void) {
+    stSet *set = stSet_construct3(stHash_stringKey, stHash_stringEqualKey, free);
+    const char *seqs[] = {"a", "b", "c", "d", "e"};
+    for (unsigned i = 0; i < sizeof(seqs) / sizeof(*seqs); i++) {
+        stSet_insert(set, stString_copy(seqs[i]));
+    }
+    PairStore *names = pairStore_construct(set);
+    stSet_destruct(set);
+    return names;
+}
+
 static void test_getSeqToBlockRows_and_getNodeFromPosition_with_ancestors(CuTest *testCase) {
     char *blockStr = "a tree=\"((a, a, b, c)d, (b, c)d)e;\"\n"
                      "s a 100 3 + 200 ggg\n"
@@ -99,70 +111,74 @@ static void test_getSeqToBlockRows_and_getNodeFromPosition_with_ancestors(CuTest
                      "s d 100 3 + 200 ggg\n"
                      "s e 0 3 + 200 ggg\n";
     mafBlock_t *block = maf_newMafBlockFromString(blockStr, 0);
-    stTree *tree = stTree_parseNewickString("((a,a,b,c)d, (b,c)d)e;");
-    stHash *seqToBlockRows = getSeqToBlockRows(block, tree, false);
+    ParsedTree *parsed = parsedTree_construct(stTree_parseNewickString("((a,a,b,c)d, (b,c)d)e;"));
+    stTree *tree = parsed->tree;
+    PairStore *names = namesStore();
+    BlockRows *blockRows = blockRows_construct(names);
+    getSeqToBlockRows(block, parsed, false, blockRows);
 
     // Row 1 -- a:100-103
-    stTree *node = getNodeFromPosition(seqToBlockRows, "a", 100);
+    stTree *node = getNodeFromPosition(blockRows, pairStore_getNameId(names, "a"), 100);
     CuAssertTrue(testCase, node == stTree_getChild(stTree_getChild(tree, 0), 0));
     stTree *prevNode = node;
-    node = getNodeFromPosition(seqToBlockRows, "a", 101);
+    node = getNodeFromPosition(blockRows, pairStore_getNameId(names, "a"), 101);
     CuAssertTrue(testCase, node == prevNode);
-    node = getNodeFromPosition(seqToBlockRows, "a", 102);
+    node = getNodeFromPosition(blockRows, pairStore_getNameId(names, "a"), 102);
     CuAssertTrue(testCase, node == prevNode);
 
     // Row 2 -- a:0-3
-    node = getNodeFromPosition(seqToBlockRows, "a", 0);
+    node = getNodeFromPosition(blockRows, pairStore_getNameId(names, "a"), 0);
     CuAssertTrue(testCase, node == stTree_getChild(stTree_getChild(tree, 0), 1));
     prevNode = node;
-    node = getNodeFromPosition(seqToBlockRows, "a", 1);
+    node = getNodeFromPosition(blockRows, pairStore_getNameId(names, "a"), 1);
     CuAssertTrue(testCase, node == prevNode);
-    node = getNodeFromPosition(seqToBlockRows, "a", 2);
+    node = getNodeFromPosition(blockRows, pairStore_getNameId(names, "a"), 2);
     CuAssertTrue(testCase, node == prevNode);
 
     // Row 3 -- b:0-3
-    node = getNodeFromPosition(seqToBlockRows, "b", 0);
+    node = getNodeFromPosition(blockRows, pairStore_getNameId(names, "b"), 0);
     CuAssertTrue(testCase, node == stTree_getChild(stTree_getChild(tree, 0), 2));
     prevNode = node;
-    node = getNodeFromPosition(seqToBlockRows, "b", 1);
+    node = getNodeFromPosition(blockRows, pairStore_getNameId(names, "b"), 1);
     CuAssertTrue(testCase, node == prevNode);
-    node = getNodeFromPosition(seqToBlockRows, "b", 2);
+    node = getNodeFromPosition(blockRows, pairStore_getNameId(names, "b"), 2);
     CuAssertTrue(testCase, node == prevNode);
 
     // Row 7 -- c:100-103
-    node = getNodeFromPosition(seqToBlockRows, "c", 100);
+    node = getNodeFromPosition(blockRows, pairStore_getNameId(names, "c"), 100);
     CuAssertTrue(testCase, node == stTree_getChild(stTree_getChild(tree, 1), 1));
     prevNode = node;
-    node = getNodeFromPosition(seqToBlockRows, "c", 101);
+    node = getNodeFromPosition(blockRows, pairStore_getNameId(names, "c"), 101);
     CuAssertTrue(testCase, node == prevNode);
-    node = getNodeFromPosition(seqToBlockRows, "c", 102);
+    node = getNodeFromPosition(blockRows, pairStore_getNameId(names, "c"), 102);
     CuAssertTrue(testCase, node == prevNode);
 
     // Row 8 -- d:100-103
-    node = getNodeFromPosition(seqToBlockRows, "d", 100);
+    node = getNodeFromPosition(blockRows, pairStore_getNameId(names, "d"), 100);
     CuAssertTrue(testCase, node == stTree_getChild(tree, 1));
     prevNode = node;
-    node = getNodeFromPosition(seqToBlockRows, "d", 101);
+    node = getNodeFromPosition(blockRows, pairStore_getNameId(names, "d"), 101);
     CuAssertTrue(testCase, node == prevNode);
-    node = getNodeFromPosition(seqToBlockRows, "d", 102);
+    node = getNodeFromPosition(blockRows, pairStore_getNameId(names, "d"), 102);
     CuAssertTrue(testCase, node == prevNode);
 
     // Row 9 -- e:0-3
-    node = getNodeFromPosition(seqToBlockRows, "e", 0);
+    node = getNodeFromPosition(blockRows, pairStore_getNameId(names, "e"), 0);
     CuAssertTrue(testCase, node == tree);
     prevNode = node;
-    node = getNodeFromPosition(seqToBlockRows, "e", 1);
+    node = getNodeFromPosition(blockRows, pairStore_getNameId(names, "e"), 1);
     CuAssertTrue(testCase, node == prevNode);
-    node = getNodeFromPosition(seqToBlockRows, "e", 2);
+    node = getNodeFromPosition(blockRows, pairStore_getNameId(names, "e"), 2);
     CuAssertTrue(testCase, node == prevNode);
 
     // Not in block = NULL
-    node = getNodeFromPosition(seqToBlockRows, "e", 50);
+    node = getNodeFromPosition(blockRows, pairStore_getNameId(names, "e"), 50);
     CuAssertTrue(testCase, node == NULL);
 
     maf_destroyMafBlockList(block);
-    stTree_destruct(tree);
-    stHash_destruct(seqToBlockRows);
+    parsedTree_destruct(parsed);
+    blockRows_destruct(blockRows);
+    pairStore_destruct(names);
 }
 
 // Exactly the same as the test with ancestors above, except that only
@@ -176,52 +192,86 @@ static void test_getSeqToBlockRows_and_getNodeFromPosition_just_leaves(CuTest *t
                      "s b 100 3 + 200 ggg\n"
                      "s c 100 3 + 200 ggg\n";
     mafBlock_t *block = maf_newMafBlockFromString(blockStr, 0);
-    stTree *tree = stTree_parseNewickString("((a,a,b,c)d, (b,c)d)e;");
-    stHash *seqToBlockRows = getSeqToBlockRows(block, tree, true);
+    ParsedTree *parsed = parsedTree_construct(stTree_parseNewickString("((a,a,b,c)d, (b,c)d)e;"));
+    stTree *tree = parsed->tree;
+    PairStore *names = namesStore();
+    BlockRows *blockRows = blockRows_construct(names);
+    getSeqToBlockRows(block, parsed, true, blockRows);
 
     // Row 1 -- a:100-103
-    stTree *node = getNodeFromPosition(seqToBlockRows, "a", 100);
+    stTree *node = getNodeFromPosition(blockRows, pairStore_getNameId(names, "a"), 100);
     CuAssertTrue(testCase, node == stTree_getChild(stTree_getChild(tree, 0), 0));
     stTree *prevNode = node;
-    node = getNodeFromPosition(seqToBlockRows, "a", 101);
+    node = getNodeFromPosition(blockRows, pairStore_getNameId(names, "a"), 101);
     CuAssertTrue(testCase, node == prevNode);
-    node = getNodeFromPosition(seqToBlockRows, "a", 102);
+    node = getNodeFromPosition(blockRows, pairStore_getNameId(names, "a"), 102);
     CuAssertTrue(testCase, node == prevNode);
 
     // Row 2 -- a:0-3
-    node = getNodeFromPosition(seqToBlockRows, "a", 0);
+    node = getNodeFromPosition(blockRows, pairStore_getNameId(names, "a"), 0);
     CuAssertTrue(testCase, node == stTree_getChild(stTree_getChild(tree, 0), 1));
     prevNode = node;
-    node = getNodeFromPosition(seqToBlockRows, "a", 1);
+    node = getNodeFromPosition(blockRows, pairStore_getNameId(names, "a"), 1);
     CuAssertTrue(testCase, node == prevNode);
-    node = getNodeFromPosition(seqToBlockRows, "a", 2);
+    node = getNodeFromPosition(blockRows, pairStore_getNameId(names, "a"), 2);
     CuAssertTrue(testCase, node == prevNode);
 
     // Row 3 -- b:0-3
-    node = getNodeFromPosition(seqToBlockRows, "b", 0);
+    node = getNodeFromPosition(blockRows, pairStore_getNameId(names, "b"), 0);
     CuAssertTrue(testCase, node == stTree_getChild(stTree_getChild(tree, 0), 2));
     prevNode = node;
-    node = getNodeFromPosition(seqToBlockRows, "b", 1);
+    node = getNodeFromPosition(blockRows, pairStore_getNameId(names, "b"), 1);
     CuAssertTrue(testCase, node == prevNode);
-    node = getNodeFromPosition(seqToBlockRows, "b", 2);
+    node = getNodeFromPosition(blockRows, pairStore_getNameId(names, "b"), 2);
     CuAssertTrue(testCase, node == prevNode);
 
     // Row 7 -- c:100-103
-    node = getNodeFromPosition(seqToBlockRows, "c", 100);
+    node = getNodeFromPosition(blockRows, pairStore_getNameId(names, "c"), 100);
     CuAssertTrue(testCase, node == stTree_getChild(stTree_getChild(tree, 1), 1));
     prevNode = node;
-    node = getNodeFromPosition(seqToBlockRows, "c", 101);
+    node = getNodeFromPosition(blockRows, pairStore_getNameId(names, "c"), 101);
     CuAssertTrue(testCase, node == prevNode);
-    node = getNodeFromPosition(seqToBlockRows, "c", 102);
+    node = getNodeFromPosition(blockRows, pairStore_getNameId(names, "c"), 102);
     CuAssertTrue(testCase, node == prevNode);
 
     // Not in block = NULL
-    node = getNodeFromPosition(seqToBlockRows, "e", 50);
+    node = getNodeFromPosition(blockRows, pairStore_getNameId(names, "e"), 50);
     CuAssertTrue(testCase, node == NULL);
 
     maf_destroyMafBlockList(block);
-    stTree_destruct(tree);
-    stHash_destruct(seqToBlockRows);
+    parsedTree_destruct(parsed);
+    blockRows_destruct(blockRows);
+    pairStore_destruct(names);
+}
+
+static void test_getSeqToBlockRows_reused(CuTest *testCase) {
+    // the rows of a block replace those of the block before, and rows
+    // of sequences the store does not know are left out
+    PairStore *names = namesStore();
+    BlockRows *blockRows = blockRows_construct(names);
+    mafBlock_t *block1 = maf_newMafBlockFromString("a tree=\"(a, b)d;\"\n"
+                                                   "s a 0 3 + 200 ggg\n"
+                                                   "s b 0 3 + 200 ggg\n", 0);
+    mafBlock_t *block2 = maf_newMafBlockFromString("a tree=\"(a, x, b)d;\"\n"
+                                                   "s a 10 3 + 200 ggg\n"
+                                                   "s x 0 3 + 200 ggg\n"
+                                                   "s b 10 3 + 200 ggg\n", 0);
+    ParsedTree *tree1 = parsedTree_construct(stTree_parseNewickString("(a, b)d;"));
+    ParsedTree *tree2 = parsedTree_construct(stTree_parseNewickString("(a, x, b)d;"));
+    getSeqToBlockRows(block1, tree1, true, blockRows);
+    CuAssertTrue(testCase, getNodeFromPosition(blockRows, pairStore_getNameId(names, "b"), 2) == stTree_getChild(tree1->tree, 1));
+    getSeqToBlockRows(block2, tree2, true, blockRows);
+    CuAssertIntEquals(testCase, 2, blockRows->numRows);
+    CuAssertTrue(testCase, getNodeFromPosition(blockRows, pairStore_getNameId(names, "b"), 2) == NULL);
+    CuAssertTrue(testCase, getNodeFromPosition(blockRows, pairStore_getNameId(names, "b"), 12) == stTree_getChild(tree2->tree, 2));
+    CuAssertTrue(testCase, getNodeFromPosition(blockRows, pairStore_getNameId(names, "a"), 10) == stTree_getChild(tree2->tree, 0));
+    CuAssertTrue(testCase, getNodeFromPosition(blockRows, pairStore_getNameId(names, "a"), 13) == NULL);
+    maf_destroyMafBlockList(block1);
+    maf_destroyMafBlockList(block2);
+    parsedTree_destruct(tree1);
+    parsedTree_destruct(tree2);
+    blockRows_destruct(blockRows);
+    pairStore_destruct(names);
 }
 
 static void test_buildNameToNodeHash_random(CuTest *testCase) {
@@ -252,6 +302,63 @@ static void test_isAncestor(CuTest *testCase) {
     stTree_destruct(tree);
 }
 
+static void test_parsedTree_getMRCA_random(CuTest *testCase) {
+    // the sparse table agrees with walking up the tree
+    for (int64_t testNum = 0; testNum < 100; testNum++) {
+        ParsedTree *pt = parsedTree_construct(getRandomTree(5));
+        for (int64_t i = 0; i < 100; i++) {
+            int64_t index1 = st_randomInt64(0, pt->numNodes);
+            int64_t index2 = st_randomInt64(0, pt->numNodes);
+            stTree *mrca = getMRCA(pt->nodes[index1], pt->nodes[index2]);
+            CuAssertTrue(testCase, pt->nodes[parsedTree_getMRCA(pt, index1, index2)] == mrca);
+            CuAssertIntEquals(testCase, index1, parsedTree_getIndex(pt, pt->nodes[index1]));
+        }
+        parsedTree_destruct(pt);
+    }
+}
+
+static void test_parsedTree_postOrder(CuTest *testCase) {
+    ParsedTree *pt = parsedTree_construct(stTree_parseNewickString("((a,b)c, (d, e)f, g)h;"));
+    const char *postOrder[] = {"a", "b", "c", "d", "e", "f", "g", "h"};
+    const char *leafPostOrder[] = {"a", "b", "d", "e", "g"};
+    CuAssertIntEquals(testCase, 8, pt->numNodes);
+    CuAssertIntEquals(testCase, 5, pt->numLeaves);
+    for (int64_t i = 0; i < pt->numNodes; i++) {
+        CuAssertStrEquals(testCase, postOrder[i], stTree_getLabel(pt->nodes[pt->postOrder[i]]));
+    }
+    for (int64_t i = 0; i < pt->numLeaves; i++) {
+        CuAssertStrEquals(testCase, leafPostOrder[i], stTree_getLabel(pt->nodes[pt->leafPostOrder[i]]));
+    }
+    parsedTree_destruct(pt);
+}
+
+static void test_parsedTree_isAncestor(CuTest *testCase) {
+    ParsedTree *pt = parsedTree_construct(stTree_parseNewickString("(a,b,(c,d)e)f;"));
+    CuAssertTrue(testCase, parsedTree_isAncestor(pt, "f", "a"));
+    CuAssertTrue(testCase, parsedTree_isAncestor(pt, "f", "d"));
+    CuAssertTrue(testCase, parsedTree_isAncestor(pt, "e", "d"));
+    CuAssertTrue(testCase, !parsedTree_isAncestor(pt, "a", "d"));
+    CuAssertTrue(testCase, !parsedTree_isAncestor(pt, "a", "f"));
+    CuAssertTrue(testCase, !parsedTree_isAncestor(pt, "e", "e"));
+    CuAssertTrue(testCase, !parsedTree_isAncestor(pt, "b", "e"));
+    parsedTree_destruct(pt);
+}
+
+static void test_treeCache_get(CuTest *testCase) {
+    // the same string gives back the same parse
+    TreeCache *cache = treeCache_construct();
+    char *newick = stString_copy("(a, b)d;");
+    ParsedTree *pt = treeCache_get(cache, newick);
+    CuAssertStrEquals(testCase, "d", stTree_getLabel(pt->tree));
+    CuAssertTrue(testCase, treeCache_get(cache, "(a, b)d;") == pt);
+    free(newick);
+    CuAssertTrue(testCase, treeCache_get(cache, "(a, b)d;") == pt);
+    ParsedTree *other = treeCache_get(cache, "(a, c)d;");
+    CuAssertTrue(testCase, other != pt);
+    CuAssertStrEquals(testCase, "c", stTree_getLabel(stTree_getChild(other->tree, 1)));
+    treeCache_destruct(cache);
+}
+
 CuSuite *blockTree_TestSuite(void) {
     CuSuite *suite = CuSuiteNew();
     SUITE_ADD_TEST(suite, test_parseTreeFromBlockStart);
@@ -259,7 +366,12 @@ CuSuite *blockTree_TestSuite(void) {
     SUITE_ADD_TEST(suite, test_getMRCA);
     SUITE_ADD_TEST(suite, test_getSeqToBlockRows_and_getNodeFromPosition_with_ancestors);
     SUITE_ADD_TEST(suite, test_getSeqToBlockRows_and_getNodeFromPosition_just_leaves);
+    SUITE_ADD_TEST(suite, test_getSeqToBlockRows_reused);
     SUITE_ADD_TEST(suite, test_buildNameToNodeHash_random);
     SUITE_ADD_TEST(suite, test_isAncestor);
+    SUITE_ADD_TEST(suite, test_parsedTree_getMRCA_random);
+    SUITE_ADD_TEST(suite, test_parsedTree_postOrder);
+    SUITE_ADD_TEST(suite, test_parsedTree_isAncestor);
+    SUITE_ADD_TEST(suite, test_treeCache_get);
     return suite;
 }
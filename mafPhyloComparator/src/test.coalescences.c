@@ -7,7 +7,7 @@
 #include "test.coalescences.h"
 
 static void test_coalescencesFromPairs(CuTest *testCase) {
-    // get the basic structures (block tree, seqToBlockRow hash, etc)
+    // get the basic structures (block tree, block rows, etc)
     const char *blockStr = "a tree=\"((a, b)d, (b, c)d)e;\"\n"
                            "s a 100 3 + 200 ggg\n"
                            "s b 0 3 + 200 ggg\n"
@@ -17,21 +17,23 @@ static void test_coalescencesFromPairs(CuTest *testCase) {
                            "s d 100 3 + 200 ggg\n"
                            "s e 0 3 + 200 ggg\n";
     mafBlock_t *block = maf_newMafBlockFromString(blockStr, 0);
-    stTree *tree = stTree_parseNewickString("((a, b)d,(b, c)d)e;");
-    stHash *seqToBlockRows = getSeqToBlockRows(block, tree, false);
+    ParsedTree *tree = parsedTree_construct(stTree_parseNewickString("((a, b)d,(b, c)d)e;"));
+    stSet *legitSequences = stSet_construct3(stHash_stringKey, stHash_stringEqualKey, free);
+    stSet_insert(legitSequences, stString_copy("a"));
+    stSet_insert(legitSequences, stString_copy("b"));
+    stSet_insert(legitSequences, stString_copy("c"));
+    PairStore *pairs = pairStore_construct(legitSequences);
+    BlockRows *blockRows = blockRows_construct(pairs);
+    getSeqToBlockRows(block, tree, false, blockRows);
 
     // Construct the test pairs
-    stSortedSet *pairs = stSortedSet_construct3((int(*)(const void *, const void *)) aPair_cmpFunction, (void(*)(void *)) aPair_destruct);
-    APair *pair = aPair_init();
-    aPair_fillOut(pair, stString_copy("a"), stString_copy("b"), 100, 1);
-    stSortedSet_insert(pairs, pair);
-    pair = aPair_init();
-    aPair_fillOut(pair, stString_copy("a"), stString_copy("b"), 100, 100);
-    stSortedSet_insert(pairs, pair);
+    pairStore_addNamed(pairs, "a", 100, "b", 1);
+    pairStore_addNamed(pairs, "a", 100, "b", 100);
+    pairStore_sort(pairs);
 
     // Get coalescences and check that they are correct
     stSortedSet *coalescences = stSortedSet_construct3((int (*)(const void *, const void *)) coalescence_cmp, (void (*)(void *)) coalescence_destruct);
-    coalescencesFromPairs(pairs, seqToBlockRows, coalescences);
+    coalescencesFromPairs(pairs, NULL, blockRows, coalescences);
     CuAssertIntEquals(testCase, 2, stSortedSet_size(coalescences));
     // First coalescence -- a:100,b:1. Should coalesce at species "d"
     Coalescence *coal = stSortedSet_getFirst(coalescences);
@@ -50,8 +52,23 @@ static void test_coalescencesFromPairs(CuTest *testCase) {
 
     // Clean up
     stSortedSet_destruct(coalescences);
-    stSortedSet_destruct(pairs);
-    stTree_destruct(tree);
+
+    // Only the listed pairs, each once however often it is listed
+    coalescences = stSortedSet_construct3((int (*)(const void *, const void *)) coalescence_cmp, (void (*)(void *)) coalescence_destruct);
+    PairIndexList *list = pairIndexList_construct();
+    pairIndexList_append(list, 1);
+    pairIndexList_append(list, 1);
+    coalescencesFromPairs(pairs, list, blockRows, coalescences);
+    CuAssertIntEquals(testCase, 1, stSortedSet_size(coalescences));
+    coal = stSortedSet_getFirst(coalescences);
+    CuAssertIntEquals(testCase, 100, coal->pos2);
+    CuAssertStrEquals(testCase, "e", coal->mrca);
+    pairIndexList_destruct(list);
+    stSortedSet_destruct(coalescences);
+    blockRows_destruct(blockRows);
+    pairStore_destruct(pairs);
+    stSet_destruct(legitSequences);
+    parsedTree_destruct(tree);
     maf_destroyMafBlockList(block);
 }
 
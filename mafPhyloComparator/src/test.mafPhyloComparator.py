@@ -228,6 +228,102 @@ class CoalescencesTest(unittest.TestCase):
             self.assertEqual(getAggregateCoalescenceResult(outputFile, 'identicalCoalescences'), identicalCoalescences, "identical coalescences don't match on test %d" % (i + 1))
         mtt.removeDir(tmpDir)
 
+    def test_coalescences_threads(self):
+        """Test that the results of a phylogeny comparison do not depend on the number of threads."""
+        mtt.makeTempDirParent()
+        tmpDir = os.path.abspath(mtt.makeTempDir("coalescencesThreads"))
+        for i, (maf1, maf2, earlyCoalescences, lateCoalescences, identicalCoalescences) in enumerate(knownValuesOnlyLeaves):
+            testMaf1 = mtt.testFile(os.path.abspath(os.path.join(tmpDir, 'maf1.maf')), 
+                                    maf1, g_headers)
+            testMaf2 = mtt.testFile(os.path.abspath(os.path.join(tmpDir, 'maf2.maf')), 
+                                    maf2, g_headers)
+            parent = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+            outputs = []
+            for threads in ['1', '3']:
+                outputFile = os.path.abspath(os.path.join(tmpDir, 'output.%s.xml' % threads))
+                cmd = [os.path.abspath(os.path.join(parent, 'test', 'mafPhyloComparator')),
+                       '--mafFile1', os.path.abspath(os.path.join(tmpDir, 'maf1.maf')),
+                       '--mafFile2', os.path.abspath(os.path.join(tmpDir, 'maf2.maf')),
+                       '--out', outputFile,
+                       '--numSamples=10000', '--logLevel=critical',
+                       "--speciesTree=%s" % g_speciesTree,
+                       "--onlyLeaves", '--threads', threads
+                       ]
+                mtt.recordCommands([cmd], tmpDir)
+                mtt.runCommandsS([cmd], tmpDir)
+                outputs.append(open(outputFile).read())
+            self.assertEqual(outputs[0], outputs[1], "results depend on the number of threads on test %d" % (i + 1))
+        mtt.removeDir(tmpDir)
+
+    def test_coalescences_duplicatePairs(self):
+        """Test that a pair aligned in more than one block keeps the coalescence of the first, whatever the number of threads."""
+        mtt.makeTempDirParent()
+        tmpDir = os.path.abspath(mtt.makeTempDir("coalescencesDuplicatePairs"))
+        maf1 = """a score=0.000 tree="((A,B)C)E;"
+s A 0 4 + 20 ACTG
+s B 0 4 + 20 ACTG
+
+a score=0.000 tree="((A)C,(B)C)E;"
+s A 0 4 + 20 ACTG
+s B 0 4 + 20 ACTG
+"""
+        maf2 = """a score=0.000 tree="((A,B)C)E;"
+s A 0 4 + 20 ACTG
+s B 0 4 + 20 ACTG
+"""
+        mtt.testFile(os.path.abspath(os.path.join(tmpDir, 'maf1.maf')), maf1, g_headers)
+        mtt.testFile(os.path.abspath(os.path.join(tmpDir, 'maf2.maf')), maf2, g_headers)
+        parent = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+        for threads in ['1', '3']:
+            outputFile = os.path.abspath(os.path.join(tmpDir, 'output.%s.xml' % threads))
+            cmd = [os.path.abspath(os.path.join(parent, 'test', 'mafPhyloComparator')),
+                   '--mafFile1', os.path.abspath(os.path.join(tmpDir, 'maf1.maf')),
+                   '--mafFile2', os.path.abspath(os.path.join(tmpDir, 'maf2.maf')),
+                   '--out', outputFile,
+                   '--numSamples=10000', '--logLevel=critical',
+                   "--speciesTree=%s" % g_speciesTree,
+                   "--onlyLeaves", '--threads', threads
+                   ]
+            mtt.recordCommands([cmd], tmpDir)
+            mtt.runCommandsS([cmd], tmpDir)
+            self.assertEqual(getAggregateCoalescenceResult(outputFile, 'earlyCoalescences'), 0, "threads %s" % threads)
+            self.assertEqual(getAggregateCoalescenceResult(outputFile, 'lateCoalescences'), 0, "threads %s" % threads)
+            self.assertEqual(getAggregateCoalescenceResult(outputFile, 'identicalCoalescences'), 4, "threads %s" % threads)
+        mtt.removeDir(tmpDir)
+
+    def test_coalescences_onePass(self):
+        """Test that --onePass reports the comparisons of both directions, as two runs with the mafs swapped do."""
+        mtt.makeTempDirParent()
+        tmpDir = os.path.abspath(mtt.makeTempDir("coalescencesOnePass"))
+        for i, (maf1, maf2, earlyCoalescences, lateCoalescences, identicalCoalescences) in enumerate(knownValues):
+            testMaf1 = mtt.testFile(os.path.abspath(os.path.join(tmpDir, 'maf1.maf')), 
+                                    maf1, g_headers)
+            testMaf2 = mtt.testFile(os.path.abspath(os.path.join(tmpDir, 'maf2.maf')), 
+                                    maf2, g_headers)
+            parent = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+            outputs = []
+            for name, mafs in [('12', ['maf1.maf', 'maf2.maf']), ('21', ['maf2.maf', 'maf1.maf']),
+                               ('onePass', ['maf1.maf', 'maf2.maf'])]:
+                outputFile = os.path.abspath(os.path.join(tmpDir, 'output.%s.xml' % name))
+                cmd = [os.path.abspath(os.path.join(parent, 'test', 'mafPhyloComparator')),
+                       '--mafFile1', os.path.abspath(os.path.join(tmpDir, mafs[0])),
+                       '--mafFile2', os.path.abspath(os.path.join(tmpDir, mafs[1])),
+                       '--out', outputFile,
+                       '--numSamples=10000', '--logLevel=critical',
+                       "--speciesTree=%s" % g_speciesTree,
+                       ]
+                if name == 'onePass':
+                    cmd.append('--onePass')
+                mtt.recordCommands([cmd], tmpDir)
+                mtt.runCommandsS([cmd], tmpDir)
+                outputs.append(open(outputFile).read())
+            self.assertEqual('<coalescenceTests>\n' + outputs[0] + outputs[1] + '</coalescenceTests>\n', outputs[2],
+                             "--onePass differs from two runs on test %d" % (i + 1))
+            tests = ET.parse(os.path.abspath(os.path.join(tmpDir, 'output.onePass.xml'))).findall('coalescenceTest')
+            self.assertEqual(int(tests[0].find("aggregateCoalescenceResults").attrib['earlyCoalescences']), earlyCoalescences)
+            self.assertEqual(int(tests[0].find("aggregateCoalescenceResults").attrib['lateCoalescences']), lateCoalescences)
+        mtt.removeDir(tmpDir)
+
     def test_coalescences_memoryTest(self):
         """Test that valgrind doesn't catch any memory errors when running mafPhyloComparator in coalescence mode."""
         valgrind = mtt.which('valgrind')
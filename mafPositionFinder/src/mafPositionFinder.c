@@ -37,6 +37,7 @@
 #include <unistd.h>
 #include "common.h"
 #include "sharedMaf.h"
+#include "profile.h"
 #include "buildVersion.h"
 
 const char *g_version = "version 0.2 May 2013";
@@ -67,11 +68,13 @@ void usage(void) {
             "nothing is returned.\n\n");
     fprintf(stderr, "Options: \n");
     usageMessage('h', "help", "show this help message and exit.");
-    usageMessage('m', "maf", "path to maf file.");
+    usageMessage('m', "maf", "path to maf file, or - to read from stdin.");
     usageMessage('s', "seq", "sequence name, e.g. `hg18.chr2'.");
     usageMessage('p', "pos", "position along the chromosome you are searching for. "
                  "Must be a positive number.");
     usageMessage('v', "help", "turns on verbose output.");
+    usageMessage('\0', "profile", "record the time spent in each phase of the program "
+                 "and write it to FILE in the Chrome trace event format.");
     exit(EXIT_FAILURE);
 }
 void parseOptions(int argc, char **argv, char *filename, char *seqName, uint64_t *position) {
@@ -91,6 +94,7 @@ void parseOptions(int argc, char **argv, char *filename, char *seqName, uint64_t
             {"sequence",  required_argument, 0, 's'},
             {"pos",  required_argument, 0, 'p'},
             {"position",  required_argument, 0, 'p'},
+            {"profile", required_argument, 0, 0},
             {0, 0, 0, 0}
         };
         int option_index = 0;
@@ -105,6 +109,10 @@ void parseOptions(int argc, char **argv, char *filename, char *seqName, uint64_t
                 version();
                 exit(EXIT_SUCCESS);
             }
+            if (strcmp("profile", long_options[option_index].name) == 0) {
+                profile_init(optarg);
+                break;
+            }
             break;
         case 'm':
             setMName = 1;
@@ -272,8 +280,11 @@ int main(int argc, char **argv) {
     parseOptions(argc, argv,  filename, targetName, &targetPos);
     mafFileApi_t *mfa = maf_newMfa(filename, "r");
 
+    profileSpan_t span = profile_begin("searchInput");
     searchInput(mfa, targetName, targetPos);
+    profile_end(span);
     maf_destroyMfa(mfa);
+    profile_finish();
 
     return EXIT_SUCCESS;
 }
@@ -36,6 +36,7 @@
 #include <unistd.h>
 #include "common.h"
 #include "sharedMaf.h"
+#include "profile.h"
 #include "buildVersion.h"
 
 const char *g_version = "version 0.1 October 2012";
@@ -64,9 +65,11 @@ void usage(void) {
             );
     fprintf(stderr, "Options: \n");
     usageMessage('h', "help", "show this help message and exit.");
-    usageMessage('m', "maf", "path to maf file.");
+    usageMessage('m', "maf", "path to maf file, or - to read from stdin.");
     usageMessage('\0', "order", "comma separated list of sequence names.");
     usageMessage('v', "verbose", "turns on verbose output.");
+    usageMessage('\0', "profile", "record the time spent in each phase of the program "
+                 "and write it to FILE in the Chrome trace event format.");
     exit(EXIT_FAILURE);
 }
 void parseOptions(int argc, char **argv, char *filename, char *orderlist) {
@@ -82,6 +85,7 @@ void parseOptions(int argc, char **argv, char *filename, char *orderlist) {
             {"version", no_argument, 0, 0},
             {"maf",  required_argument, 0, 'm'},
             {"order",  required_argument, 0, 0},
+            {"profile", required_argument, 0, 0},
             {0, 0, 0, 0}
         };
         int longIndex = 0;
@@ -96,6 +100,10 @@ void parseOptions(int argc, char **argv, char *filename, char *orderlist) {
                 version();
                 exit(EXIT_SUCCESS);
             }
+            if (strcmp("profile", longOptions[longIndex].name) == 0) {
+                profile_init(optarg);
+                break;
+            }
             if (strcmp("order", longOptions[longIndex].name) == 0) {
                 setOrder = true;
                 sscanf(optarg, "%s", orderlist);
@@ -230,8 +238,11 @@ int main(int argc, char **argv) {
     unsigned n = 1 + countChar(orderlist, ',');
     char **order = extractSubStrings(orderlist, n, ',');
     mafFileApi_t *mfa = maf_newMfa(filename, "r");
+    profileSpan_t span = profile_begin("orderInput");
     orderInput(mfa, order, n);
+    profile_end(span);
     maf_destroyMfa(mfa);
     destroyNameList(order, n);
+    profile_finish();
     return EXIT_SUCCESS;
 }
@@ -33,6 +33,7 @@
 #include <string.h>
 #include "common.h"
 #include "sharedMaf.h"
+#include "profile.h"
 #include "buildVersion.h"
 
 const char *g_version = "version 0.1 September 2012";
@@ -72,9 +73,11 @@ void usage(void) {
             "position is used for that block.\n\n");
     fprintf(stderr, "Options: \n");
     usageMessage('h', "help", "show this help message and exit.");
-    usageMessage('m', "maf", "path to the maf file.");
+    usageMessage('m', "maf", "path to the maf file, or - to read from stdin.");
     usageMessage('s', "seq", "sequence name, e.g. `hg18.chr2'\n");
     usageMessage('v', "verbose", "turns on verbose output.");
+    usageMessage('\0', "profile", "record the time spent in each phase of the program "
+                 "and write it to FILE in the Chrome trace event format.");
     exit(EXIT_FAILURE);
 }
 void parseOptions(int argc, char **argv, char *filename, char *seqName) {
@@ -90,6 +93,7 @@ void parseOptions(int argc, char **argv, char *filename, char *seqName) {
             {"version", no_argument, 0, 0},
             {"maf",  required_argument, 0, 'm'},
             {"seq",  required_argument, 0, 's'},
+            {"profile", required_argument, 0, 0},
             {0, 0, 0, 0}
         };
         int longIndex = 0;
@@ -103,6 +107,9 @@ void parseOptions(int argc, char **argv, char *filename, char *seqName) {
                 version();
                 exit(EXIT_SUCCESS);
             }
+            if (strcmp("profile", longOptions[longIndex].name) == 0) {
+                profile_init(optarg);
+            }
             break;
         case 'm':
             setMName = true;
@@ -175,11 +182,12 @@ void populateArray(mafBlock_t *mb, sortingMafBlock_t **array, char *targetSequen
     // the structs into the array.
     unsigned i = 0;
     while (mb != NULL) {
-        de_debug("inserting block %2u: %s %" PRIi64 "\n", i,
-                 maf_mafLine_getLine(maf_mafBlock_getHeadLine(mb)), getTargetStartBlock(mb, targetSequence));
         array[i] = (sortingMafBlock_t *) de_malloc(sizeof(sortingMafBlock_t));
         array[i]->mafBlock = mb;
-        array[i++]->targetStart = getTargetStartBlock(mb, targetSequence);
+        array[i]->targetStart = getTargetStartBlock(mb, targetSequence);
+        de_debug("inserting block %2u: %s %" PRIi64 "\n", i,
+                 maf_mafLine_getLine(maf_mafBlock_getHeadLine(mb)), array[i]->targetStart);
+        ++i;
         mb = maf_mafBlock_getNext(mb);
     }
 }
@@ -217,15 +225,24 @@ int main(int argc, char **argv) {
 
     mafFileApi_t *mfa = maf_newMfa(filename, "r");
     mafBlock_t *mb = NULL;
+    profileSpan_t span = profile_begin("processBody");
     unsigned numBlocks = processBody(mfa, &mb);
+    profile_end(span);
     sortingMafBlock_t *blockArray[numBlocks];
+    span = profile_begin("populateArray");
     populateArray(mb, blockArray, targetSequence);
+    profile_end(span);
 
+    span = profile_begin("qsort");
     qsort(blockArray, numBlocks, sizeof(sortingMafBlock_t *), cmp_by_targetStart);
+    profile_end(span);
+    span = profile_begin("reportBlocks");
     reportBlocks(blockArray, numBlocks);
+    profile_end(span);
     destroyArray(blockArray, numBlocks);
     maf_destroyMfa(mfa);
     maf_destroyMafBlockList(mb);
+    profile_finish();
 
     return(EXIT_SUCCESS);
 }
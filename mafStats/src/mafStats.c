@@ -33,6 +33,8 @@
 #include "common.h"
 #include "sharedMaf.h"
 #include "mafStats.h"
+#include "parallel.h"
+#include "profile.h"
 #include "buildVersion.h"
 
 const char *g_version = "v0.1 July 2012";
@@ -47,11 +49,18 @@ void usage(void) {
             "A program to read MAF file and report back statistics about the contents.\n\n");
     fprintf(stderr, "Options: \n");
     usageMessage('h', "help", "show this help message and exit.");
-    usageMessage('m', "maf", "path to the maf file.");
+    usageMessage('m', "maf", "path to the maf file, or - to read from stdin. May also be "
+                 "a sharded maf, either @FILE where FILE lists one maf per line or a quoted "
+                 "glob pattern such as 'aln.chr*.maf'. The statistics are those of the shards "
+                 "taken together.");
+    usageMessage('\0', "threads", "number of shards of a sharded maf to read at once, 0 "
+                 "(the default) for one per processor.");
     usageMessage('v', "verbose", "turns on verbose output.");
+    usageMessage('\0', "profile", "record the time spent reading the maf and reporting "
+                 "statistics and write it to FILE in the Chrome trace event format.");
     exit(EXIT_FAILURE);
 }
-void parseOptions(int argc, char **argv, char **filename) {
+void parseOptions(int argc, char **argv, char **filename, unsigned *numThreads) {
     extern int g_verbose_flag;
     extern int g_debug_flag;
     int c;
@@ -63,6 +72,8 @@ void parseOptions(int argc, char **argv, char **filename) {
             {"help", no_argument, 0, 'h'},
             {"version", no_argument, 0, 0},
             {"maf",  required_argument, 0, 'm'},
+            {"profile", required_argument, 0, 0},
+            {"threads", required_argument, 0, 0},
             {0, 0, 0, 0}
         };
         int option_index = 0;
@@ -76,6 +87,15 @@ void parseOptions(int argc, char **argv, char **filename) {
                 version();
                 exit(EXIT_SUCCESS);
             }
+            if (strcmp("profile", long_options[option_index].name) == 0) {
+                profile_init(optarg);
+            }
+            if (strcmp("threads", long_options[option_index].name) == 0) {
+                if (sscanf(optarg, "%u", numThreads) != 1) {
+                    fprintf(stderr, "Error, --threads must be a non-negative integer, not %s\n", optarg);
+                    usage();
+                }
+            }
             break;
         case 'm':
             setMName = true;
@@ -213,6 +233,86 @@ void recordStats(mafFileApi_t *mfa, stats_t *stats) {
     }
     stats->numLines = maf_mafFileApi_getLineNumber(mfa);
 }
+void stats_merge(stats_t *stats, stats_t *other) {
+    // fold the stats of one maf into those of another, as if the two mafs had
+    // been read one after the other. other is left as it was.
+    stats->numLines += other->numLines;
+    stats->numHeaderLines += other->numHeaderLines;
+    stats->numSeqLines += other->numSeqLines;
+    stats->numBlocks += other->numBlocks;
+    stats->numELines += other->numELines;
+    stats->numILines += other->numILines;
+    stats->numQLines += other->numQLines;
+    stats->numCommentLines += other->numCommentLines;
+    stats->numGapCharacters += other->numGapCharacters;
+    stats->numSeqCharacters += other->numSeqCharacters;
+    stats->numColumns += other->numColumns;
+    stats->sumSeqField += other->sumSeqField;
+    stats->sumNumSpeciesInBlock += other->sumNumSpeciesInBlock;
+    stats->sumBlockArea += other->sumBlockArea;
+    if (stats->maxSeqField < other->maxSeqField) {
+        stats->maxSeqField = other->maxSeqField;
+    }
+    if (stats->maxNumSpeciesInBlock < other->maxNumSpeciesInBlock) {
+        stats->maxNumSpeciesInBlock = other->maxNumSpeciesInBlock;
+    }
+    if (stats->maxBlockArea < other->maxBlockArea) {
+        stats->maxBlockArea = other->maxBlockArea;
+    }
+    stHashIterator *hit = stHash_getIterator(other->seqHash);
+    char *name = NULL;
+    while ((name = stHash_getNext(hit)) != NULL) {
+        uint64_t *n = stHash_search(other->seqHash, name);
+        uint64_t *v = stHash_search(stats->seqHash, name);
+        if (v == NULL) {
+            v = (uint64_t *) st_malloc(sizeof(*v));
+            *v = *n;
+            stHash_insert(stats->seqHash, stString_copy(name), v);
+        } else {
+            *v += *n;
+        }
+    }
+    stHash_destructIterator(hit);
+}
+typedef struct shardStats {
+    char **shards;
+    stats_t **workerStats; // one per worker, merged once all shards are read
+} shardStats_t;
+static void recordShardStats(uint64_t i, unsigned worker, void *data) {
+    // every shard is a complete maf, with its own header, so is read on its own.
+    // The header of any shard but the first is read as the concatenation of the
+    // shards would read it, as ordinary (comment) lines.
+    shardStats_t *ss = (shardStats_t *) data;
+    stats_t *stats = stats_create(ss->shards[i]);
+    mafFileApi_t *mfa = maf_newMfa(ss->shards[i], "r");
+    if (i > 0) {
+        maf_mafFileApi_setContinued(mfa);
+        stats->numHeaderLines = 0;
+    }
+    recordStats(mfa, stats);
+    maf_destroyMfa(mfa);
+    stats_merge(ss->workerStats[worker], stats);
+    stats_destroy(stats);
+}
+void recordShardedStats(char **shards, unsigned numShards, unsigned numThreads, stats_t *stats) {
+    // the stats of a sharded maf are the sum of the stats of its shards, the
+    // shards are read numThreads at a time.
+    unsigned numWorkers = parallel_numberOfWorkers(numThreads, numShards);
+    shardStats_t ss;
+    ss.shards = shards;
+    ss.workerStats = (stats_t **) st_malloc(sizeof(*(ss.workerStats)) * numWorkers);
+    for (unsigned w = 0; w < numWorkers; ++w) {
+        ss.workerStats[w] = stats_create(stats->filename);
+        ss.workerStats[w]->numHeaderLines = 0; // counted by the first shard
+    }
+    parallel_for(numShards, numWorkers, recordShardStats, &ss);
+    stats->numHeaderLines = 0;
+    for (unsigned w = 0; w < numWorkers; ++w) {
+        stats_merge(stats, ss.workerStats[w]);
+        stats_destroy(ss.workerStats[w]);
+    }
+    free(ss.workerStats);
+}
 void readFilesize(struct stat *fileStat, char **filesizeString) {
     char *s = st_malloc(kMaxStringLength);
     *filesizeString = s;
@@ -249,9 +349,13 @@ void readFilesize(struct stat *fileStat, char **filesizeString) {
     }
 }
 int cmp_seq(const void *a, const void *b) {
+    // most bases first, ties broken by name so the order never depends on the hash
     seq_t **ia = (seq_t **) a;
     seq_t **ib = (seq_t **) b;
-    return ((*ia)->count < (*ib)->count);
+    if ((*ia)->count != (*ib)->count) {
+        return ((*ia)->count < (*ib)->count) ? 1 : -1;
+    }
+    return strcmp((*ia)->name, (*ib)->name);
 }
 void reportHash(stHash *hash) {
     int64_t n = stHash_size(hash);
@@ -273,13 +377,35 @@ void reportHash(stHash *hash) {
     }
     printf("%25s: %12" PRIu64 " (100.00%%)\n", "total", total);
 }
-void reportStats(stats_t *stats) {
+static bool sumFilesizes(char **shards, unsigned numShards, struct stat *fileStat) {
+    // total size of the shards in fileStat->st_size, false if any size is unknown.
+    off_t total = 0;
+    for (unsigned i = 0; i < numShards; ++i) {
+        int status;
+        if (maf_isStdStream(shards[i])) {
+            status = fstat(STDIN_FILENO, fileStat);
+        } else {
+            status = stat(shards[i], fileStat);
+        }
+        if (status != 0 || !S_ISREG(fileStat->st_mode)) {
+            return false;
+        }
+        total += fileStat->st_size;
+    }
+    fileStat->st_size = total;
+    return true;
+}
+void reportStats(stats_t *stats, char **shards, unsigned numShards) {
     struct stat fileStat;
-    stat(stats->filename, &fileStat);
     printf("%s\n", stats->filename);
     printf("------------------------------\n");
     char *filesizeString;
-    readFilesize(&fileStat, &filesizeString);
+    if (sumFilesizes(shards, numShards, &fileStat)) {
+        readFilesize(&fileStat, &filesizeString);
+    } else {
+        // e.g. a pipe, the size is not known
+        filesizeString = stString_copy("unknown");
+    }
     printf("File size:              %10s\n", filesizeString);
     printf("Lines:                  %10" PRIu64 "\n", stats->numLines);
     printf("Header lines:           %10" PRIu64 "\n", stats->numHeaderLines);
@@ -310,16 +436,23 @@ void reportStats(stats_t *stats) {
 }
 int main(int argc, char **argv) {
     char *maf = NULL;
-    parseOptions(argc, argv, &maf);
-    mafFileApi_t *mfa = maf_newMfa(maf, "r");
+    unsigned numThreads = 0;
+    parseOptions(argc, argv, &maf, &numThreads);
+    unsigned numShards = 0;
+    char **shards = maf_getShardList(maf, &numShards);
     stats_t *stats = stats_create(maf);
 
-    recordStats(mfa, stats);
-    reportStats(stats);
+    profileSpan_t span = profile_begin("recordStats");
+    recordShardedStats(shards, numShards, numThreads, stats);
+    profile_end(span);
+    span = profile_begin("reportStats");
+    reportStats(stats, shards, numShards);
+    profile_end(span);
 
     // clean up
     free(maf);
-    maf_destroyMfa(mfa);
+    maf_destroyShardList(shards, numShards);
     stats_destroy(stats);
+    profile_finish();
     return(EXIT_SUCCESS);
 }
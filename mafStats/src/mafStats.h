@@ -56,15 +56,17 @@ typedef struct seq {
 
 void version(void);
 void usage(void);
-void parseOptions(int argc, char **argv, char **filename);
+void parseOptions(int argc, char **argv, char **filename, unsigned *numThreads);
 stats_t* stats_create(char *filename);
 void stats_destroy(stats_t *stats);
 void countCharacters(char *seq, stats_t *stats);
 void processBlock(mafBlock_t *mb, stats_t *stats);
 void recordStats(mafFileApi_t *mfa, stats_t *stats);
+void stats_merge(stats_t *stats, stats_t *other);
+void recordShardedStats(char **shards, unsigned numShards, unsigned numThreads, stats_t *stats);
 void readFilesize(struct stat *fileStat, char **filesizeString);
 int cmp_seq(const void *a, const void *b);
 void reportHash(stHash *hash);
-void reportStats(stats_t *stats);
+void reportStats(stats_t *stats, char **shards, unsigned numShards);
 
 #endif // _MAFSTATS_H_
@@ -0,0 +1,101 @@
+##################################################
+# Copyright (C) 2013 by
+# Dent Earl (dearl@soe.ucsc.edu, dentearl@gmail.com)
+# ... and other members of the Reconstruction Team of David Haussler's
+# lab (BME Dept. UCSC).
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documentation files (the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+# copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in
+# all copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+# THE SOFTWARE.
+##################################################
+import os
+import sys
+import unittest
+sys.path.append(os.path.abspath(os.path.join(os.path.dirname(sys.argv[0]),
+                                             '../../lib/')))
+import mafToolsTest as mtt
+
+# shards of one maf: each has a header of its own, which in the concatenation
+# of the shards is an ordinary comment (or unknown) line. The last header is
+# not followed by a blank line.
+g_shards = ['''track name=euArc visibility=pack
+##maf version=1 scoring=tba.v8
+# tba.v8 (((human chimp) baboon) (mouse rat))
+
+a score=0.0
+s target.chr1  0 10 + 10 ACGTACGTAC
+s seqB.chr1    0 10 + 10 ACGTACGTAC
+s seqC.chr1    0  5 + 10 A----CGT-C
+
+''',
+            '''##maf version=1 scoring=tba.v8
+# tba.v8 (((human chimp) baboon) (mouse rat))
+
+# a comment between blocks
+
+a score=0.0
+s seqA.chr2  0 10 + 10 ACGTACGTAC
+s seqB.chr3  0 10 - 10 ACGTACGTAC
+e seqD.chr1  0 10 + 10 C
+i seqB.chr3  C 0 C 0
+q seqB.chr3                  9999999999
+
+''',
+            '''##maf version=1
+a score=0.0
+s target.chr2  0 10 + 10 ACGTACGTAC
+s seqD.chr5    0 10 + 10 ACGTACGTAC
+s seqA.chr5    0  2 + 10 A--------C
+
+a score=0.0
+s target.chr2  10 3 + 13 ACG
+s seqD.chr5    10 3 + 13 AC-G
+
+''',
+            ]
+
+
+class ShardTest(unittest.TestCase):
+  def testShards(self):
+    """ mafStats of a sharded maf should be those of the concatenation of its shards.
+    """
+    mtt.makeTempDirParent()
+    tmpDir = os.path.abspath(mtt.makeTempDir('shards'))
+    parent = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+    for i, s in enumerate(g_shards):
+      mtt.testFile(os.path.join(tmpDir, 'shard.%d.maf' % i), s)
+    mtt.testFile(os.path.join(tmpDir, 'cat.maf'), ''.join(g_shards))
+    cmd = [os.path.abspath(os.path.join(parent, 'test', 'mafStats')),
+           '--maf', os.path.join(tmpDir, 'cat.maf')]
+    outpipes = [os.path.join(tmpDir, 'expected.txt')]
+    mtt.recordCommands([cmd], tmpDir, outPipes=outpipes)
+    mtt.runCommandsS([cmd], tmpDir, outPipes=outpipes)
+    # the first line is the name of the maf, all else must be the same
+    expected = open(os.path.join(tmpDir, 'expected.txt')).read().split('\n', 1)[1]
+    for threads in ['1', '2', '0']:
+      cmd = [os.path.abspath(os.path.join(parent, 'test', 'mafStats')),
+             '--maf', os.path.join(tmpDir, 'shard.*.maf'), '--threads', threads]
+      outpipes = [os.path.join(tmpDir, 'output.txt')]
+      mtt.recordCommands([cmd], tmpDir, outPipes=outpipes)
+      mtt.runCommandsS([cmd], tmpDir, outPipes=outpipes)
+      output = open(os.path.join(tmpDir, 'output.txt')).read().split('\n', 1)[1]
+      self.assertEqual(expected, output)
+    mtt.removeDir(tmpDir)
+
+
+if __name__ == '__main__':
+  unittest.main()
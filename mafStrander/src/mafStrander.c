@@ -31,6 +31,7 @@
 #include <string.h>
 #include "common.h"
 #include "sharedMaf.h"
+#include "profile.h"
 #include "buildVersion.h"
 
 const char *g_version = "version 0.1 October 2012";
@@ -82,6 +83,7 @@ void parseOptions(int argc, char **argv, char *filename, char *seq, char *strand
             {"maf",  required_argument, 0, 'm'},
             {"seq",  required_argument, 0, 0},
             {"strand",  required_argument, 0, 0},
+            {"profile", required_argument, 0, 0},
             {0, 0, 0, 0}
         };
         int longIndex = 0;
@@ -95,6 +97,10 @@ void parseOptions(int argc, char **argv, char *filename, char *seq, char *strand
                 version();
                 exit(EXIT_SUCCESS);
             }
+            if (strcmp("profile", longOptions[longIndex].name) == 0) {
+                profile_init(optarg);
+                break;
+            }
             if (strcmp("seq", longOptions[longIndex].name) == 0) {
                 setSeq = true;
                 sscanf(optarg, "%s", seq);
@@ -163,9 +169,11 @@ void usage(void) {
             "(i.e. both + and - strands are observed), then nothing is done.\n");
     fprintf(stderr, "Options: \n");
     usageMessage('h', "help", "show this help message and exit.");
-    usageMessage('m', "maf", "input alignment maf file.");
+    usageMessage('m', "maf", "input alignment maf file, or - to read from stdin.");
     usageMessage('\0', "seq", "sequence to base block strandedness upon. (string comparison only done for length of input, i.e. --seq=hg18 will match hg18.chr1, hg18.chr2, etc etc)");
     usageMessage('\0', "strand", "strand to enforce, when possible. may be + or -, defaults to +.");
+    usageMessage('\0', "profile", "record the time spent in each phase of the program "
+                 "and write it to FILE in the Chrome trace event format.");
     exit(EXIT_FAILURE);
 }
 scoredMafLine_t* newScoredMafLine(void) {
@@ -235,7 +243,10 @@ int main(int argc, char **argv) {
     char strand = '+';
     parseOptions(argc, argv, filename, seq, &strand);
     mafFileApi_t *mfa = maf_newMfa(filename, "r");
+    profileSpan_t span = profile_begin("processBody");
     processBody(mfa, seq, strand);
+    profile_end(span);
     maf_destroyMfa(mfa);
+    profile_finish();
     return EXIT_SUCCESS;
 }
@@ -35,6 +35,7 @@
 #include "sonLib.h"
 #include "mafToFastaStitcher.h"
 #include "mafToFastaStitcherAPI.h"
+#include "profile.h"
 #include "buildVersion.h"
 
 const char *g_version = "v0.1 Oct 2012";
@@ -61,6 +62,7 @@ void parseOptions(int argc, char **argv, options_t *options) {
       {"breakpointPenalty",  required_argument, 0, 0},
       {"interstitialSequence",  required_argument, 0, 0},
       {"referenceSequence",  required_argument, 0, 0},
+      {"profile",  required_argument, 0, 0},
       {0, 0, 0, 0}
     };
     int option_index = 0;
@@ -109,6 +111,10 @@ void parseOptions(int argc, char **argv, options_t *options) {
         options->reference = stString_copy(optarg);
         break;
       }
+      if (strcmp("profile", long_options[option_index].name) == 0) {
+        profile_init(optarg);
+        break;
+      }
       break;
     case 'v':
       g_verbose_flag++;
@@ -167,7 +173,7 @@ void usage(void) {
           "\n\n");
   fprintf(stderr, "Options: \n");
   usageMessage('h', "help", "show this message and exit.");
-  usageMessage('m', "maf", "path to the maf file.");
+  usageMessage('m', "maf", "path to the maf file, or - to read from stdin.");
   usageMessage('\0', "seqs", "comma separated list of fasta sequences. each fasta may contain multiple entries. all sequences in the input alignment must be accounted for with an element in a fasta.");
   usageMessage('\0', "outMfa", "multiple sequence fasta output file.");
   usageMessage('\0', "breakpointPenalty", "number of `N' characters to insert into a sequence when a breakpoint is detected.");
@@ -175,6 +181,7 @@ void usage(void) {
   usageMessage('\0', "outMaf", "multiple alignment format output file.");
   usageMessage('\0', "reference", "optional. The name of the reference sequence. All intervening reference sequence between the first and last block of the input --maf will be read out in the output.");
   usageMessage('v', "verbose", "turns on verbose output.");
+  usageMessage('\0', "profile", "record the time spent in each phase of the program and write it to FILE in the Chrome trace event format.");
   exit(EXIT_FAILURE);
 }
 int main(int argc, char **argv) {
@@ -185,19 +192,27 @@ int main(int argc, char **argv) {
   parseOptions(argc, argv, options);
   // read fastas, populate sequenceHash
   de_verbose("Creating sequence hash.\n");
+  profileSpan_t span = profile_begin("createSequenceHash");
   sequenceHash = createSequenceHash(options->seqs);
+  profile_end(span);
   mafFileApi_t *mfapi = maf_newMfa(options->maf, "r");
   de_verbose("Creating alignment hash.\n");
+  span = profile_begin("buildAlignmentHash");
   buildAlignmentHash(mfapi, alignmentHash, sequenceHash, rowOrder, options);
+  profile_end(span);
   if (options->outMfa != NULL) {
     // fasta output
     de_verbose("Writing fasta output.\n");
+    span = profile_begin("writeFastaOut");
     writeFastaOut(alignmentHash, rowOrder, options);
+    profile_end(span);
   }
   if (options->outMaf != NULL) {
     // maf output
     de_verbose("Writing maf output.\n");
+    span = profile_begin("writeMafOut");
     writeMafOut(alignmentHash, rowOrder, options);
+    profile_end(span);
   }
   // cleanup
   maf_destroyMfa(mfapi);
@@ -205,5 +220,6 @@ int main(int argc, char **argv) {
   stHash_destruct(sequenceHash);
   stList_destruct(rowOrder);
   destroyOptions(options);
+  profile_finish();
   return(EXIT_SUCCESS);
 }
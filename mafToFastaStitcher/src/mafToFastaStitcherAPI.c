@@ -623,7 +623,7 @@ void writeMafOut(stHash *alignmentHash, stList *rowOrder, options_t *options) {
     FILE *maf = de_fopen(options->outMaf, "w");
     // fprintf(stderr, "printing Maf out!\n");
     uint64_t maxName = 1, maxStart = 1, maxLen = 1, maxSource = 1;
-    char fmtName[10] = "\0", fmtStart[32] = "\0", fmtLen[32] = "\0", fmtSource[32] = "\0", *fmtLine = NULL;
+    char fmtName[32] = "\0", fmtStart[32] = "\0", fmtLen[32] = "\0", fmtSource[32] = "\0", *fmtLine = NULL;
     fprintf(maf, "##maf version=1\n\n");
     if (stList_length(rowOrder) == 0) {
         // There's nothing to write out.
@@ -32,6 +32,7 @@
 #include "common.h"
 #include "CuTest.h"
 #include "sharedMaf.h"
+#include "profile.h"
 #include "sonLib.h"
 #include "stPinchGraphs.h"
 #include "mafTransitiveClosure.h"
@@ -57,6 +58,7 @@ void parseOptions(int argc, char **argv, char *filename) {
             {"test", no_argument, 0, 't'},
             {"maf",  required_argument, 0, 'm'},
             {"sort", no_argument, 0, 's'},
+            {"profile", required_argument, 0, 0},
             {0, 0, 0, 0}
         };
         int option_index = 0;
@@ -69,6 +71,9 @@ void parseOptions(int argc, char **argv, char *filename) {
                 version();
                 exit(EXIT_SUCCESS);
             }
+            if (strcmp("profile", long_options[option_index].name) == 0) {
+                profile_init(optarg);
+            }
             break;
         case 'm':
             setMName = 1;
@@ -128,8 +133,10 @@ void usage(void) {
             "\n\n");
     fprintf(stderr, "Options: \n");
     usageMessage('h', "help", "show this message and exit.");
-    usageMessage('m', "maf", "path to the maf file.");
+    usageMessage('m', "maf", "path to the maf file, or - to read from stdin.");
     usageMessage('v', "verbose", "turns on verbose output..");
+    usageMessage('\0', "profile", "record the time spent in each phase of the program "
+                 "and write it to FILE in the Chrome trace event format.");
     exit(EXIT_FAILURE);
 }
 uint64_t hashMafTcSeq(const mafTcSeq_t *mtcs) {
@@ -322,14 +329,14 @@ mafTcComparisonOrder_t *getComparisonOrderFromMatrix(char **mat, uint64_t numRow
     mafTcRegion_t *todo = newMafTcRegion(0, numCols - 1); // the entire region needs to be done
     mafTcComparisonOrder_t *co = NULL;
     uint64_t r = 0;
-    if (g_debug_flag) {
+    if (de_debugEnabled()) {
         printTodoArray(todo, numCols);
         printVizMatrix(vizMat, numRows, numCols);
     }
     while (todo != NULL && r < numRows) {
         todo = getComparisonOrderFromRow(mat, r, &co, todo, (lengths[r] != numCols));
         r++;
-        if (g_debug_flag) {            
+        if (de_debugEnabled()) {
             updateVizMatrix(vizMat, co);
             printTodoArray(todo, numCols);
             printVizMatrix(vizMat, numRows, numCols);
@@ -346,7 +353,7 @@ mafTcRegion_t* getComparisonOrderFromRow(char **mat, uint64_t row, mafTcComparis
     mafTcRegion_t *headTodo = todo;
     mafTcComparisonOrder_t *co = NULL;
     bool inGap;
-    de_debug("getComparisonOrderFromRow(mat, %u, done, todo)\n", row);
+    de_debug("getComparisonOrderFromRow(mat, %" PRIu64 ", done, todo)\n", row);
     while (todo != NULL) {
         // walk the todo linked list and see if we can fill in any regions with the current row.
         de_debug("starting to walk todo [%" PRIu64 ", %" PRIu64 "]\n", todo->start, todo->end);
@@ -395,8 +402,10 @@ mafTcRegion_t* getComparisonOrderFromRow(char **mat, uint64_t row, mafTcComparis
                     de_debug("newTodoTail->start: %" PRIu64 ", ->end: %" PRIu64 "\n", 
                              newTodoTail->start, newTodoTail->end);
                 }
-                de_debug("current newTodo:\n");
-                printRegion(newTodo);
+                if (de_debugEnabled()) {
+                    de_debug("current newTodo:\n");
+                    printRegion(newTodo);
+                }
             } else {
                 de_debug("now inside a sequence region\n");
                 // inside a sequence region
@@ -744,7 +753,7 @@ void walkBlockAddingAlignments(mafBlock_t *mb, stPinchThreadSet *threadSet) {
     uint64_t seqFieldLength = maf_mafBlock_getSequenceFieldLength(mb);
     char **mat = maf_mafBlock_getSequenceMatrix(mb, numSeqs, seqFieldLength);
     int **vizMat = NULL;
-    if (g_debug_flag) {
+    if (de_debugEnabled()) {
         vizMat = getVizMatrix(mb, numSeqs, seqFieldLength);
     }
     char *strands = maf_mafBlock_getStrandArray(mb);
@@ -926,20 +935,33 @@ int main(int argc, char **argv) {
     char filename[kMaxStringLength];
     stHash *sequenceHash, *nameHash;
     parseOptions(argc, argv, filename);
+    if (maf_isStdStream(filename)) {
+        // two passes are made over the input
+        maf_spoolStdin();
+    }
     // first pass, build sequence hash
     mafFileApi_t *mfa = maf_newMfa(filename, "r");
+    profileSpan_t span = profile_begin("createSequenceHash");
     createSequenceHash(mfa, &sequenceHash, &nameHash);
+    profile_end(span);
+    span = profile_begin("buildThreadSet");
     stPinchThreadSet *threadSet = buildThreadSet(sequenceHash);
+    profile_end(span);
     maf_destroyMfa(mfa);
     // second pass, build pinch graph
     mfa = maf_newMfa(filename, "r");
+    span = profile_begin("addAlignmentsToThreadSet");
     addAlignmentsToThreadSet(mfa, threadSet);
+    profile_end(span);
     maf_destroyMfa(mfa);
     // consolidate and report
+    span = profile_begin("reportTransitiveClosure");
     reportTransitiveClosure(threadSet, sequenceHash, nameHash);
+    profile_end(span);
     // cleanup
     stHash_destruct(sequenceHash);
     stHash_destruct(nameHash);
     stPinchThreadSet_destruct(threadSet);
+    profile_finish();
     return EXIT_SUCCESS;
 }